@@ -18,6 +18,11 @@
 //  3. This notice may not be removed or altered from any source distribution.
 //--------------------------------------------------------------------------------------------------
 
+#ifdef ENABLE_MEMBENCH
+#include "membench.hpp"
+#endif
+#include "tilecon.hpp"
+
 #include <mc1/leds.h>
 #include <mc1/mmio.h>
 #include <mc1/vconsole.h>
@@ -60,10 +65,10 @@ constexpr float digit_scalef() {
 }
 
 template <int N>
-void vcon_print_float(const float x) {
+void con_print_float(const float x) {
   auto xi = static_cast<int>(x * digit_scalef<N>());
   constexpr auto iscale = digit_scalei<N>();
-  vcon_print_dec(xi / iscale);
+  con_print_dec(xi / iscale);
   if (N > 0) {
     auto frac = xi % iscale;
     char buf[N + 2];
@@ -73,7 +78,7 @@ void vcon_print_float(const float x) {
       buf[i] = '0' + (frac % 10);
       frac /= 10;
     }
-    vcon_print(buf);
+    con_print(buf);
   }
 }
 
@@ -84,32 +89,37 @@ void print_size(uint32_t size) {
     size = size >> 10;
     ++size_div;
   }
-  vcon_print_dec(static_cast<int>(size));
-  vcon_print(SIZE_SUFFIX[size_div]);
+  con_print_dec(static_cast<int>(size));
+  con_print(SIZE_SUFFIX[size_div]);
 }
 
 void print_addr_and_size(const char* str, const uint32_t addr, const uint32_t size) {
-  vcon_print(str);
-  vcon_print("0x");
-  vcon_print_hex(addr);
-  vcon_print(", ");
+  con_print(str);
+  con_print("0x");
+  con_print_hex(addr);
+  con_print(", ");
   print_size(size);
-  vcon_print("\n");
+  con_print("\n");
 }
 
 // Console class.
 class console_t {
 public:
   void init(void* mem) {
-    m_vcon_mem = mem;
-
-    // Show the console.
-    vcon_init(m_vcon_mem);
-    vcon_set_colors(0, 0xff000000U);
-    vcon_show(LAYER_2);
+    // Show the console (use a tile map console if the video logic supports it).
+    void* mem_end = tilecon_t::init(mem, 0, 0xff000000U);
+    if (mem_end == nullptr) {
+      vcon_init(mem);
+      vcon_set_colors(0, 0xff000000U);
+      vcon_show(LAYER_2);
+      mem_end = reinterpret_cast<uint8_t*>(mem) + vcon_memory_requirement();
+    }
+#ifdef ENABLE_MEMBENCH
+    m_free_mem = mem_end;
+#endif
 
     // Print a welcome message.
-    vcon_print("\n                      **** MC1 - The MRISC32 computer ****\n\n");
+    con_print("\n                      **** MC1 - The MRISC32 computer ****\n\n");
   }
 
   void deinit() {
@@ -125,17 +135,22 @@ public:
         "\nbss:      ", linker_constant(&__bss_start), linker_constant(&__bss_size));
 
     // Print CPU info.
-    vcon_print("\n\nCPU Freq: ");
-    vcon_print_float<2>(static_cast<float>(MMIO(CPUCLK)) * (1.0F / 1000000.0F));
-    vcon_print(" MHz\n\n");
+    con_print("\n\nCPU Freq: ");
+    con_print_float<2>(static_cast<float>(MMIO(CPUCLK)) * (1.0F / 1000000.0F));
+    con_print(" MHz\n\n");
+
+#ifdef ENABLE_MEMBENCH
+    // Run the memory benchmark.
+    membench_t::run(m_free_mem);
+#endif
 
 #ifdef ENABLE_SELFTEST
     // Run the selftest.
-    vcon_print("Selftest: ");
+    con_print("Selftest: ");
     if (selftest_run(selftest_callback)) {
-      vcon_print(" PASS\n\n");
+      con_print(" PASS\n\n");
     } else {
-      vcon_print(" FAIL\n\n");
+      con_print(" FAIL\n\n");
     }
 #endif
 
@@ -147,17 +162,19 @@ public:
   }
 
   static void print(const char* msg) {
-    vcon_print(msg);
+    con_print(msg);
   }
 
 private:
 #ifdef ENABLE_SELFTEST
   static void selftest_callback(int pass, int /* test_no */) {
-    vcon_print(pass ? "*" : "!");
+    con_print(pass ? "*" : "!");
   }
 #endif
 
-  void* m_vcon_mem;
+#ifdef ENABLE_MEMBENCH
+  void* m_free_mem;
+#endif
   bool m_diags_have_been_run = false;
 };
 
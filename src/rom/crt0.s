@@ -128,9 +128,10 @@ bss_cleared:
 
 
     ; ------------------------------------------------------------------------
-    ; Make both video layers "silent" (use no memory cycles).
-    ; We also set the background color for both layers, since the content of
-    ; the palette registers is undefined after reset.
+    ; Make all video layers "silent" (use no memory cycles).
+    ; We also set the background color for all layers, since the content of
+    ; the palette registers is undefined after reset. Layers 3 and 4 are only
+    ; present in some configurations, but the VCP words are reserved anyway.
     ; ------------------------------------------------------------------------
 
     BOOTSTAGE   3, 0b1001111
@@ -145,6 +146,12 @@ bss_cleared:
     stw     r1, [r4, #32]       ; Layer 2 VCP
     stw     z, [r4, #36]        ; (fully transparent black for layer 2)
     stw     r3, [r4, #40]
+    stw     r1, [r4, #48]       ; Layer 3 VCP
+    stw     z, [r4, #52]
+    stw     r3, [r4, #56]
+    stw     r1, [r4, #64]       ; Layer 4 VCP
+    stw     z, [r4, #68]
+    stw     r3, [r4, #72]
 
 
     ; ------------------------------------------------------------------------
@@ -27,9 +27,10 @@
 
 #include "elf32.hpp"
 
-#include <mc1/mfat_mc1.h>
+#include "memfuncs.hpp"
+#include "warmboot.hpp"
 
-#include <cstring>
+#include <mc1/mfat_mc1.h>
 
 namespace elf32 {
 namespace {
@@ -43,6 +44,7 @@ namespace {
 #define SHT_FINI_ARRAY 15
 
 // Elf32_Shdr.sh_flags
+#define SHF_WRITE 0x1
 #define SHF_ALLOC 0x2
 
 // ELF header
@@ -142,6 +144,9 @@ bool load(const char* file_name, uint32_t& entry_address) {
   // Get the entry address.
   entry_address = elf_header.e_entry;
 
+  // Start recording a new image (for warm boots, see warmboot.hpp).
+  warmboot::begin();
+
   for (unsigned i = 0U; i < elf_header.e_shnum; ++i) {
     // Read the section header.
     Elf32_Shdr sec_header;
@@ -166,12 +171,18 @@ bool load(const char* file_name, uint32_t& entry_address) {
       if (!f.read(reinterpret_cast<uint8_t*>(sec_header.sh_addr), sec_header.sh_size)) {
         return false;
       }
+      if ((sec_header.sh_flags & SHF_WRITE) == 0U) {
+        warmboot::add_region(sec_header.sh_addr, sec_header.sh_size);
+      } else {
+        warmboot::add_data_region(sec_header.sh_addr, sec_header.sh_size);
+      }
     }
 
     // NOBITS need to be cleared.
     if (sec_header.sh_type == SHT_NOBITS) {
       auto* ptr = reinterpret_cast<uint8_t*>(sec_header.sh_addr);
-      std::memset(ptr, 0, sec_header.sh_size);
+      rom_memset(ptr, 0, sec_header.sh_size);
+      warmboot::add_bss_region(sec_header.sh_addr, sec_header.sh_size);
     }
   }
 
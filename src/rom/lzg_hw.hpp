@@ -0,0 +1,82 @@
+// -*- mode: c; tab-width: 2; indent-tabs-mode: nil; -*-
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2022 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ROM_LZG_HW_HPP_
+#define ROM_LZG_HW_HPP_
+
+#include <mc1/mmio.h>
+
+#include <cstdint>
+
+// LZG engine registers that are implemented by the MC1 MMIO logic but that are not (yet) defined
+// by libmc1 (see lzgdec.vhd).
+
+#ifndef LZGSRC
+// Source address (the start of the LZG header).
+#define LZGSRC 208
+#endif
+
+#ifndef LZGDST
+// Destination address.
+#define LZGDST 212
+#endif
+
+#ifndef LZGCTRL
+// Control: Write with bit 0 set to start the decompression.
+#define LZGCTRL 216
+#endif
+
+#ifndef LZGSTAT
+// Status: Bit 0 = busy, bit 1 = done, bit 2 = error, bit 31 = the engine is present.
+#define LZGSTAT 220
+#endif
+
+// Note: Using an anonymous namespace saves a few bytes of code size.
+namespace {
+
+// Check if the LZG engine is present.
+inline bool lzg_hw_present() {
+  return (MMIO(LZGSTAT) & 0x80000000U) != 0U;
+}
+
+// Decompress a complete LZG buffer (header included) using the LZG engine. Returns false if the
+// engine is not present or if the decompression failed, in which case the caller should fall back
+// to software decompression.
+inline bool lzg_hw_decode(const void* src, void* dst) {
+  if (!lzg_hw_present()) {
+    return false;
+  }
+
+  MMIO(LZGSRC) = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(src));
+  MMIO(LZGDST) = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(dst));
+  MMIO(LZGCTRL) = 1U;
+
+  // Wait for the engine to finish.
+  uint32_t stat;
+  do {
+    stat = MMIO(LZGSTAT);
+  } while ((stat & 1U) != 0U);
+
+  return (stat & 4U) == 0U;
+}
+
+}  // namespace
+
+#endif  // ROM_LZG_HW_HPP_
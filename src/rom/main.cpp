@@ -20,6 +20,8 @@
 
 #include "elf32.hpp"
 #include "mosaic.hpp"
+#include "sdspi_hw.hpp"
+#include "warmboot.hpp"
 
 #ifdef ENABLE_SPLASH
 #include "splash.hpp"
@@ -90,14 +92,33 @@ private:
 // Boot function type.
 using boot_fun_t = void();
 
+[[noreturn]] void run_boot_exe(uint32_t entry_address) {
+  // Call the boot function.
+  auto* boot_fun = reinterpret_cast<boot_fun_t*>(entry_address);
+  boot_fun();
+
+  // If we got this far the EXE file has finished executing and returned. We can not trust the
+  // contents of RAM (e.g. the stack), so we need to soft reset.
+  __asm__ volatile("\tj\tz, #0x00000200");
+  __builtin_unreachable();
+}
+
+// Block I/O functions for mfat. The SD SPI engine is used when it is present, and the libmc1 SD
+// card driver (bit-banged) is used as a fallback.
 int read_block_fun(char* ptr, unsigned block_no, void* custom) {
+  if (sdspi_hw_t::is_ready()) {
+    return sdspi_hw_t::read_block(reinterpret_cast<uint8_t*>(ptr), block_no) ? 0 : -1;
+  }
   auto* ctx = reinterpret_cast<sdctx_t*>(custom);
   sdcard_read(ctx, ptr, block_no, 1);
   return 0;
 }
 
-int write_block_fun(const char*, unsigned, void*) {
-  // Not implemented.
+int write_block_fun(const char* ptr, unsigned block_no, void*) {
+  if (sdspi_hw_t::is_ready()) {
+    return sdspi_hw_t::write_block(reinterpret_cast<const uint8_t*>(ptr), block_no) ? 0 : -1;
+  }
+  // Not implemented (the ROM never writes to the SD card without the engine).
   return -1;
 }
 
@@ -112,6 +133,20 @@ void sdcard_log_fun(const char* msg) {
 }  // namespace
 
 extern "C" int main(int, char**) {
+  // After a soft reset, the boot executable may still be in memory. In that case we only check that
+  // the file on the SD card has not changed, and start it right away without initializing the
+  // video or reading the file (see warmboot.hpp).
+  sdctx_t sdctx;
+  uint32_t entry_address = 0U;
+  if (warmboot::is_intact() && sdcard_init(&sdctx, nullptr)) {
+    sdspi_hw_t::init();
+    mfat_stat_t stat;
+    if (mfat_mount(&read_block_fun, &write_block_fun, &sdctx) == 0 &&
+        mfat_stat(BOOT_EXE, &stat) == 0 && warmboot::restore(stat, entry_address)) {
+      run_boot_exe(entry_address);
+    }
+  }
+
   sevseg_print("OLLEH ");  // Print a friendly "HELLO".
 
   mosaic_t mosaic;
@@ -121,7 +156,6 @@ extern "C" int main(int, char**) {
 #ifdef ENABLE_CONSOLE
   console_t console;
 #endif
-  sdctx_t sdctx;
   frame_sync_t frame_sync;
 
   auto status = boot_status_t::NONE;
@@ -196,6 +230,8 @@ extern "C" int main(int, char**) {
       //--------------------------------------------------------------------------------------------
       case boot_state_t::WAIT_FOR_SDCARD: {
         if (sdcard_init(&sdctx, sdcard_log_fun)) {
+          // Use the SD SPI engine for the block transfers (if present).
+          sdspi_hw_t::init();
           state = boot_state_t::MOUNT_FAT;
         } else {
           status = boot_status_t::NO_SDCARD;
@@ -232,16 +268,13 @@ extern "C" int main(int, char**) {
           mosaic.deinit();
 
           // Try to load the boot executable.
-          uint32_t entry_address = 0;
           if (elf32::load(BOOT_EXE, entry_address)) {
-            // Call the boot function.
-            auto* boot_fun = reinterpret_cast<boot_fun_t*>(entry_address);
-            boot_fun();
+            warmboot::commit(stat, entry_address);
+            run_boot_exe(entry_address);
           }
 
-          // If we got this far we either could not load the EXE file, or the EXE file has finished
-          // executing and returned. In either case we can not trust the contents of RAM (e.g. the
-          // stack), so we need to soft reset.
+          // If we got this far we could not load the EXE file. In that case we can not trust the
+          // contents of RAM (e.g. the stack), so we need to soft reset.
           __asm__ volatile("\tj\tz, #0x00000200");
         }
 
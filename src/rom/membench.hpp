@@ -0,0 +1,535 @@
+// -*- mode: c; tab-width: 2; indent-tabs-mode: nil; -*-
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2022 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+// Memory benchmark.
+//
+// This consists of two parts:
+//
+//  1. Memory function throughput (in bytes per clock cycle) of the ROM memory functions in
+//     memfuncs.s and of the corresponding C library functions, using XRAM buffers. The ROM
+//     memory functions are first checked against reference results (a self test).
+//  2. If the SD SPI engine is present and a card responds in SPI mode (e.g. the SD card model in
+//     mc1_tb), a block is read through the engine, written back unchanged and read again.
+//  3. Memory subsystem performance for ROM, VRAM and XRAM: Sequential and random read, write and
+//     copy bandwidth (bytes per clock cycle), and load latency (clock cycles per dependent load).
+//     The suite is run twice: First with the video layers active (so that the CPU competes with
+//     the video logic for the VRAM ports), and then with the video layers silent.
+//
+// The results are printed to the console. They are also reported via the SEGDISP6/SEGDISP7
+// registers (which are not connected to any display), so that they can be picked up by the mc1_tb
+// simulation test bench (see test/mc1_tb.vhd), which writes them to CSV files.
+//
+// Mailbox protocol: SEGDISP6 holds a value, and SEGDISP7 holds a tag that tells what the value is:
+//
+//   bits 31-16: 0x4d42 ("MB")
+//   bits 15-12: Field (1 = size, 2 = cycles, 3 = end of suite, 4 = memory function cycles,
+//               5 = number of failed memory function self test checks, 6 = number of failed SD
+//               engine checks)
+//   bits 11-8:  Video (0 = silent, 1 = active)
+//   bits 7-4:   Memory (0 = ROM, 1 = VRAM, 2 = XRAM)
+//   bits 3-0:   Test (0 = read, 1 = write, 2 = copy, 3 = random read, 4 = random write,
+//               5 = latency), or memory function (see func_t)
+//
+// For the latency test the size is the number of loads, and for all other tests (and the memory
+// functions) it is the number of bytes.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ROM_MEMBENCH_HPP_
+#define ROM_MEMBENCH_HPP_
+
+#include "memfuncs.hpp"
+#include "sdspi_hw.hpp"
+#include "tilecon.hpp"
+
+#include <mc1/mmio.h>
+#include <mc1/vcp.h>
+
+#include <cstdint>
+#include <cstring>
+
+// Defined by the linker script.
+extern char __rom_start;
+extern char __rom_size;
+
+// Note: Using an anonymous namespace saves a few bytes of code size.
+namespace {
+
+// Memory benchmark class.
+class membench_t {
+public:
+  /// @brief Run the memory benchmarks.
+  /// @param vram_free Start of the free VRAM area (used for the VRAM tests).
+  static void run(void* vram_free) {
+    run_memfuncs();
+    run_suite(vram_free);
+  }
+
+private:
+  static const uint32_t BENCH_SIZE = 16384U;
+
+  // The memory subsystem suite uses small buffers, so that it completes quickly in simulation.
+  static const uint32_t SUITE_SIZE = 4096U;
+  static const uint32_t SUITE_WORDS = SUITE_SIZE / 4U;
+  static const uint32_t SUITE_MASK = SUITE_WORDS - 1U;
+  static const uint32_t LATENCY_LOADS = 1024U;
+
+  // Word stride for the random access tests. It is odd (so that all the words of the buffer are
+  // visited), and close to the golden ratio of the buffer size (so that consecutive accesses are
+  // far apart).
+  static const uint32_t RANDOM_STRIDE = ((SUITE_WORDS * 0x9e37U) >> 16) | 1U;
+
+  // The SD engine test uses block 1 (block 0 holds the partition table).
+  static const uint32_t SD_BLOCK_SIZE = 512U;
+  static const uint32_t SD_TEST_BLOCK = 1U;
+
+  // VRAM word offsets of the VCP start addresses for layers 1 and 2 (see rtl/video.vhd).
+  static const uint32_t VCP1_START = 4U;
+  static const uint32_t VCP2_START = 8U;
+
+  enum memory_t { MEM_ROM = 0, MEM_VRAM = 1, MEM_XRAM = 2, NUM_MEMORIES = 3 };
+
+  enum test_t {
+    TEST_READ = 0,
+    TEST_WRITE = 1,
+    TEST_COPY = 2,
+    TEST_RANDOM_READ = 3,
+    TEST_RANDOM_WRITE = 4,
+    TEST_LATENCY = 5,
+    NUM_TESTS = 6
+  };
+
+  enum func_t {
+    FUNC_MEMSET_LIBC = 0,
+    FUNC_MEMSET_ROM = 1,
+    FUNC_FILL32_ROM = 2,
+    FUNC_MEMCPY_LIBC = 3,
+    FUNC_MEMCPY_ROM = 4,
+    FUNC_MEMCPY_UNALIGNED_LIBC = 5,
+    FUNC_MEMCPY_UNALIGNED_ROM = 6,
+    FUNC_MEMCMP_LIBC = 7,
+    FUNC_MEMCMP_ROM = 8,
+    FUNC_CRC32_ROM = 9
+  };
+
+  enum field_t {
+    FIELD_SIZE = 1,
+    FIELD_CYCLES = 2,
+    FIELD_END = 3,
+    FIELD_FUNC_CYCLES = 4,
+    FIELD_FUNC_FAILURES = 5,
+    FIELD_SD_FAILURES = 6
+  };
+
+  // A memory area to run the suite on (buf is nullptr if the area can not be tested).
+  struct area_t {
+    const char* name;
+    uint32_t* buf;
+    bool writable;
+  };
+
+  // Read a block through the SD SPI engine, write the same data back, and read it again (so the
+  // card contents are left unchanged). The test is skipped if there is no card in SPI mode.
+  static void run_sd_test(uint8_t* buf1, uint8_t* buf2) {
+    if (!sdspi_hw_t::init()) {
+      return;
+    }
+    uint32_t failures = 0U;
+    failures += sdspi_hw_t::read_block(buf1, SD_TEST_BLOCK) ? 0U : 1U;
+    failures += sdspi_hw_t::write_block(buf1, SD_TEST_BLOCK) ? 0U : 1U;
+    rom_memset(buf2, 0, SD_BLOCK_SIZE);
+    failures += sdspi_hw_t::read_block(buf2, SD_TEST_BLOCK) ? 0U : 1U;
+    failures += rom_memcmp(buf1, buf2, SD_BLOCK_SIZE) == 0 ? 0U : 1U;
+    report(make_tag(FIELD_SD_FAILURES, false, 0U, 0U), failures);
+    con_print("SD engine test: ");
+    if (failures == 0U) {
+      con_print("OK\n");
+    } else {
+      con_print_dec(static_cast<int>(failures));
+      con_print(" failed checks\n");
+    }
+  }
+
+  static void run_memfuncs() {
+    if (MMIO(XRAMSIZE) < 2U * BENCH_SIZE) {
+      con_print("Membench: Not enough XRAM\n\n");
+      return;
+    }
+    auto* buf1 = reinterpret_cast<uint8_t*>(XRAM_START);
+    auto* buf2 = buf1 + BENCH_SIZE;
+
+    // Check the ROM memory functions before measuring them.
+    const auto failures = self_test(buf1, buf2);
+    report(make_tag(FIELD_FUNC_FAILURES, false, 0U, 0U), failures);
+    con_print("Memfuncs self test: ");
+    if (failures == 0U) {
+      con_print("OK\n");
+    } else {
+      con_print_dec(static_cast<int>(failures));
+      con_print(" failed checks\n");
+    }
+
+    run_sd_test(buf1, buf2);
+
+    con_print("Membench (bytes/cycle):\n");
+
+    run_func(FUNC_MEMSET_LIBC,
+             "memset, libc:           ",
+             measure([=] { std::memset(buf1, 0x55, BENCH_SIZE); }));
+    run_func(FUNC_MEMSET_ROM,
+             "memset, ROM:            ",
+             measure([=] { rom_memset(buf1, 0x55, BENCH_SIZE); }));
+    run_func(FUNC_FILL32_ROM, "fill32, ROM:            ", measure([=] {
+               rom_fill32(reinterpret_cast<uint32_t*>(buf1), 0x55555555U, BENCH_SIZE / 4U);
+             }));
+
+    run_func(FUNC_MEMCPY_LIBC,
+             "memcpy, libc:           ",
+             measure([=] { std::memcpy(buf2, buf1, BENCH_SIZE); }));
+    run_func(FUNC_MEMCPY_ROM,
+             "memcpy, ROM:            ",
+             measure([=] { rom_memcpy(buf2, buf1, BENCH_SIZE); }));
+    run_func(FUNC_MEMCPY_UNALIGNED_LIBC,
+             "memcpy unaligned, libc: ",
+             measure([=] { std::memcpy(buf2, buf1 + 1, BENCH_SIZE - 1U); }));
+    run_func(FUNC_MEMCPY_UNALIGNED_ROM,
+             "memcpy unaligned, ROM:  ",
+             measure([=] { rom_memcpy(buf2, buf1 + 1, BENCH_SIZE - 1U); }));
+
+    run_func(FUNC_MEMCMP_LIBC,
+             "memcmp, libc:           ",
+             measure([=] { (void)std::memcmp(buf2, buf1, BENCH_SIZE); }));
+    run_func(FUNC_MEMCMP_ROM,
+             "memcmp, ROM:            ",
+             measure([=] { (void)rom_memcmp(buf2, buf1, BENCH_SIZE); }));
+
+    run_func(FUNC_CRC32_ROM,
+             "crc32, ROM:             ",
+             measure([=] { (void)rom_crc32(buf1, BENCH_SIZE, 0U); }));
+    con_print("\n");
+  }
+
+  static void run_func(const func_t func, const char* name, const uint32_t cycles) {
+    report(make_tag(FIELD_SIZE, false, 0U, func), BENCH_SIZE);
+    report(make_tag(FIELD_FUNC_CYCLES, false, 0U, func), cycles);
+    print_result(name, cycles);
+  }
+
+  // Bitwise CRC-32 (the same as zlib crc32), used as a reference for rom_crc32.
+  static uint32_t ref_crc32(const uint8_t* data, const uint32_t size, uint32_t crc) {
+    crc = ~crc;
+    for (uint32_t i = 0U; i < size; ++i) {
+      crc ^= data[i];
+      for (int k = 0; k < 8; ++k) {
+        crc = (crc >> 1U) ^ (0xedb88320U & (0U - (crc & 1U)));
+      }
+    }
+    return ~crc;
+  }
+
+  static int sign(const int x) {
+    return (x > 0) - (x < 0);
+  }
+
+  // Check the ROM memory functions against reference results, for different alignments and sizes
+  // (the sizes cover both the scalar and the vector code paths). Returns the number of failed
+  // checks.
+  static uint32_t self_test(uint8_t* buf1, uint8_t* buf2) {
+    static const uint32_t SIZES[] = {0U, 1U, 7U, 100U, 1500U};
+    static const uint32_t GUARD = 0xaaU;
+    uint32_t failures = 0U;
+
+    // Fill the source buffer with pseudo random data.
+    uint32_t x = 1U;
+    for (uint32_t i = 0U; i < 2048U; ++i) {
+      x = x * 1664525U + 1013904223U;
+      buf1[i] = static_cast<uint8_t>(x >> 24U);
+    }
+
+    // CRC-32: The standard check value, different alignments, and a chained CRC.
+    failures += rom_crc32("123456789", 9U, 0U) != 0xcbf43926U ? 1U : 0U;
+    for (uint32_t offs = 0U; offs < 4U; ++offs) {
+      for (const auto size : SIZES) {
+        const auto ref = ref_crc32(&buf1[offs], size, 0x12345678U);
+        failures += rom_crc32(&buf1[offs], size, 0x12345678U) != ref ? 1U : 0U;
+      }
+    }
+    failures += rom_crc32(&buf1[700], 800U, rom_crc32(buf1, 700U, 0U)) !=
+                        ref_crc32(buf1, 1500U, 0U)
+                    ? 1U
+                    : 0U;
+
+    for (uint32_t dst_offs = 0U; dst_offs < 4U; ++dst_offs) {
+      for (const auto size : SIZES) {
+        // memcpy (from all source alignments), and check that the bytes around the copy are
+        // untouched.
+        for (uint32_t src_offs = 0U; src_offs < 4U; ++src_offs) {
+          std::memset(buf2, GUARD, size + 8U);
+          rom_memcpy(&buf2[dst_offs], &buf1[src_offs], size);
+          failures += std::memcmp(&buf2[dst_offs], &buf1[src_offs], size) != 0 ? 1U : 0U;
+          failures += (buf2[dst_offs + size] != GUARD ||
+                       (dst_offs > 0U && buf2[dst_offs - 1U] != GUARD))
+                          ? 1U
+                          : 0U;
+        }
+
+        // memcmp: Equal areas, and areas that differ in the first, a middle and the last byte.
+        std::memcpy(&buf2[dst_offs], buf1, size);
+        failures += rom_memcmp(&buf2[dst_offs], buf1, size) != 0 ? 1U : 0U;
+        if (size > 0U) {
+          const uint32_t positions[] = {0U, size / 2U, size - 1U};
+          for (const auto pos : positions) {
+            buf2[dst_offs + pos] ^= 0x81U;
+            failures += sign(rom_memcmp(&buf2[dst_offs], buf1, size)) !=
+                                sign(std::memcmp(&buf2[dst_offs], buf1, size))
+                            ? 1U
+                            : 0U;
+            buf2[dst_offs + pos] ^= 0x81U;
+          }
+        }
+
+        // memset.
+        std::memset(buf2, GUARD, size + 8U);
+        rom_memset(&buf2[dst_offs], 0x5a, size);
+        for (uint32_t i = 0U; i < size + 8U; ++i) {
+          const bool inside = i >= dst_offs && i < dst_offs + size;
+          failures += buf2[i] != (inside ? 0x5aU : GUARD) ? 1U : 0U;
+        }
+      }
+    }
+
+    // fill32.
+    auto* words = reinterpret_cast<uint32_t*>(buf2);
+    rom_fill32(words, 0x55555555U, 400U);
+    rom_fill32(&words[1], 0x12345678U, 375U);
+    for (uint32_t i = 0U; i < 400U; ++i) {
+      const bool inside = i >= 1U && i < 376U;
+      failures += words[i] != (inside ? 0x12345678U : 0x55555555U) ? 1U : 0U;
+    }
+
+    return failures;
+  }
+
+  static void run_suite(void* vram_free) {
+    // Select the memory areas. ROM is tested from the start of the ROM code (read only), VRAM
+    // after the memory that is used by the console, and XRAM from the start.
+    area_t areas[NUM_MEMORIES];
+    const auto rom_size = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&__rom_size));
+    const auto rom_start = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&__rom_start));
+    areas[MEM_ROM].name = "ROM  ";
+    areas[MEM_ROM].buf = (rom_size >= rom_start + SUITE_SIZE)
+                             ? reinterpret_cast<uint32_t*>(&__rom_start)
+                             : nullptr;
+    areas[MEM_ROM].writable = false;
+
+    const auto vram_start = (reinterpret_cast<uintptr_t>(vram_free) + 3U) & ~uintptr_t(3U);
+    const auto vram_end = static_cast<uintptr_t>(VRAM_START) + MMIO(VRAMSIZE);
+    areas[MEM_VRAM].name = "VRAM ";
+    areas[MEM_VRAM].buf = (vram_end >= vram_start + 2U * SUITE_SIZE)
+                              ? reinterpret_cast<uint32_t*>(vram_start)
+                              : nullptr;
+    areas[MEM_VRAM].writable = true;
+
+    areas[MEM_XRAM].name = "XRAM ";
+    areas[MEM_XRAM].buf =
+        (MMIO(XRAMSIZE) >= 2U * SUITE_SIZE) ? reinterpret_cast<uint32_t*>(XRAM_START) : nullptr;
+    areas[MEM_XRAM].writable = true;
+
+    con_print("Memory (bytes/cycle, latency in cycles/load):\n");
+    con_print("Video Mem     Read  Write   Copy  RndRd  RndWr    Lat\n");
+
+    // Run the suite with the video layers active (i.e. as they are right now).
+    run_tests(areas, true);
+
+    // Silence the video layers, and wait for the VCP:s to restart with the new programs.
+    auto* vcp_mem = reinterpret_cast<volatile uint32_t*>(VRAM_START);
+    const auto old_vcp1 = vcp_mem[VCP1_START];
+    const auto old_vcp2 = vcp_mem[VCP2_START];
+    vcp_set_prg(LAYER_1, nullptr);
+    vcp_set_prg(LAYER_2, nullptr);
+    wait_for_next_frame();
+
+    // Run the suite with the video layers silent.
+    run_tests(areas, false);
+
+    // Restore the video layers.
+    vcp_mem[VCP1_START] = old_vcp1;
+    vcp_mem[VCP2_START] = old_vcp2;
+
+    report(make_tag(FIELD_END, false, 0U, 0U), 0U);
+    MMIO(SEGDISP6) = 0U;
+    MMIO(SEGDISP7) = 0U;
+    con_print("\n");
+  }
+
+  static void run_tests(const area_t* areas, const bool video) {
+    for (uint32_t mem = 0U; mem < NUM_MEMORIES; ++mem) {
+      const auto& area = areas[mem];
+      if (area.buf == nullptr) {
+        continue;
+      }
+      con_print(video ? "on    " : "off   ");
+      con_print(area.name);
+      for (uint32_t test = 0U; test < NUM_TESTS; ++test) {
+        const bool is_write =
+            (test == TEST_WRITE || test == TEST_COPY || test == TEST_RANDOM_WRITE);
+        if (is_write && !area.writable) {
+          con_print("      -");
+          continue;
+        }
+        const auto size = (test == TEST_LATENCY) ? LATENCY_LOADS : SUITE_SIZE;
+        const auto cycles = run_test(static_cast<test_t>(test), area.buf);
+        report(make_tag(FIELD_SIZE, video, mem, test), size);
+        report(make_tag(FIELD_CYCLES, video, mem, test), cycles);
+        if (test == TEST_LATENCY) {
+          print_ratio(cycles, size);
+        } else {
+          print_ratio(size, cycles);
+        }
+      }
+      con_print("\n");
+    }
+  }
+
+  static uint32_t run_test(const test_t test, uint32_t* buf) {
+    volatile uint32_t* p = buf;
+    switch (test) {
+      case TEST_READ:
+        return measure([=] {
+          uint32_t sum = 0U;
+          for (uint32_t i = 0U; i < SUITE_WORDS; i += 4U) {
+            sum += p[i] + p[i + 1U] + p[i + 2U] + p[i + 3U];
+          }
+          (void)sum;
+        });
+      case TEST_WRITE:
+        return measure([=] {
+          for (uint32_t i = 0U; i < SUITE_WORDS; i += 4U) {
+            p[i] = i;
+            p[i + 1U] = i;
+            p[i + 2U] = i;
+            p[i + 3U] = i;
+          }
+        });
+      case TEST_COPY:
+        return measure([=] {
+          volatile uint32_t* dst = p + SUITE_WORDS;
+          for (uint32_t i = 0U; i < SUITE_WORDS; i += 4U) {
+            dst[i] = p[i];
+            dst[i + 1U] = p[i + 1U];
+            dst[i + 2U] = p[i + 2U];
+            dst[i + 3U] = p[i + 3U];
+          }
+        });
+      case TEST_RANDOM_READ:
+        return measure([=] {
+          uint32_t sum = 0U;
+          uint32_t idx = 0U;
+          for (uint32_t i = 0U; i < SUITE_WORDS; ++i) {
+            idx = (idx + RANDOM_STRIDE) & SUITE_MASK;
+            sum += p[idx];
+          }
+          (void)sum;
+        });
+      case TEST_RANDOM_WRITE:
+        return measure([=] {
+          uint32_t idx = 0U;
+          for (uint32_t i = 0U; i < SUITE_WORDS; ++i) {
+            idx = (idx + RANDOM_STRIDE) & SUITE_MASK;
+            p[idx] = i;
+          }
+        });
+      default:
+      case TEST_LATENCY:
+        // Pointer chasing: The address of each load depends on the value of the previous load.
+        return measure([=] {
+          uint32_t idx = 0U;
+          for (uint32_t i = 0U; i < LATENCY_LOADS; ++i) {
+            idx = (idx + p[idx] + RANDOM_STRIDE) & SUITE_MASK;
+          }
+        });
+    }
+  }
+
+  static uint32_t make_tag(const field_t field,
+                           const bool video,
+                           const uint32_t mem,
+                           const uint32_t test) {
+    return 0x4d420000U | (static_cast<uint32_t>(field) << 12) | ((video ? 1U : 0U) << 8) |
+           (mem << 4) | test;
+  }
+
+  static void report(const uint32_t tag, const uint32_t value) {
+    // Note: The tag is written last, since that is what the test bench reacts to.
+    MMIO(SEGDISP6) = value;
+    MMIO(SEGDISP7) = tag;
+  }
+
+  static void wait_for_next_frame() {
+    const auto frame_no = MMIO(VIDFRAMENO);
+    while (MMIO(VIDFRAMENO) == frame_no) {
+    }
+  }
+
+  template <typename F>
+  static uint32_t measure(F f) {
+    // Note: Only CLKCNTLO is used, since the difference of the low 32 bits of the 64-bit clock
+    // counter is exact as long as a single measurement takes less than 2^32 cycles.
+    const auto t0 = MMIO(CLKCNTLO);
+    f();
+    return MMIO(CLKCNTLO) - t0;
+  }
+
+  static void print_result(const char* name, const uint32_t cycles) {
+    // Print the number of bytes per cycle, with two decimals.
+    const auto rate = (BENCH_SIZE * 100U) / cycles;
+    con_print(name);
+    con_print_dec(static_cast<int>(rate / 100U));
+    con_print(((rate % 100U) < 10U) ? ".0" : ".");
+    con_print_dec(static_cast<int>(rate % 100U));
+    con_print("\n");
+  }
+
+  static void print_ratio(const uint32_t num, const uint32_t den) {
+    // Print num / den with two decimals, right aligned in a seven characters wide column.
+    auto x = (num * 100U) / den;
+    if (x > 999999U) {
+      x = 999999U;
+    }
+    char buf[8];
+    int pos = 7;
+    buf[pos] = 0;
+    for (int k = 0; k < 3 || x != 0U; ++k) {
+      if (k == 2) {
+        buf[--pos] = '.';
+      }
+      buf[--pos] = static_cast<char>('0' + (x % 10U));
+      x /= 10U;
+    }
+    while (pos > 0) {
+      buf[--pos] = ' ';
+    }
+    con_print(buf);
+  }
+};
+
+}  // namespace
+
+#endif  // ROM_MEMBENCH_HPP_
@@ -0,0 +1,57 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2022 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+
+#ifndef MC1_MEMFUNCS_H_
+#define MC1_MEMFUNCS_H_
+
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+// Memory functions for the ROM, implemented in memfuncs.s. They use the vector unit for the bulk of
+// the work, and have the same semantics as the corresponding standard C functions.
+//--------------------------------------------------------------------------------------------------
+
+extern "C" {
+
+/// @brief Copy a memory area (the areas must not overlap).
+void* rom_memcpy(void* dst, const void* src, uint32_t size);
+
+/// @brief Fill a memory area with a byte value.
+void* rom_memset(void* dst, int value, uint32_t size);
+
+/// @brief Compare two memory areas.
+/// @returns zero if the areas are equal, or the difference between the first differing bytes.
+int rom_memcmp(const void* a, const void* b, uint32_t size);
+
+/// @brief Fill a word aligned memory area with a 32-bit value.
+/// @param dst The start of the memory area.
+/// @param value The value to fill the memory area with.
+/// @param count The number of words to fill.
+void rom_fill32(uint32_t* dst, uint32_t value, uint32_t count);
+
+/// @brief Update a CRC-32 (the same as zlib crc32).
+/// @param data The data.
+/// @param size The number of bytes.
+/// @param crc The CRC of the preceding data (0 for the first call).
+/// @returns the updated CRC.
+uint32_t rom_crc32(const void* data, uint32_t size, uint32_t crc);
+}
+
+#endif  // MC1_MEMFUNCS_H_
@@ -0,0 +1,435 @@
+; -*- mode: mr32asm; tab-width: 4; indent-tabs-mode: nil; -*-
+; ----------------------------------------------------------------------------
+; Memory functions for the ROM (see memfuncs.hpp).
+;
+; The bulk of the work is done with vector length agnostic loops (using the
+; max vector length of the machine). Unaligned heads and tails are handled
+; with scalar byte loops, and copies between buffers with different word
+; alignment use vector byte loads/stores.
+; ----------------------------------------------------------------------------
+
+    .section .text.memfuncs, "ax"
+    .p2align 2
+
+
+; ----------------------------------------------------------------------------
+; void* rom_memcpy(void* dst, const void* src, uint32_t size)
+; r1 = dst, r2 = src, r3 = size
+; ----------------------------------------------------------------------------
+
+    .globl  rom_memcpy
+rom_memcpy:
+    mov     r4, r1
+    xor     r5, r1, r2
+    and     r5, r5, #3
+    bnz     r5, memcpy_bytes    ; Different alignment: Copy bytes.
+
+memcpy_head:
+    ; Copy single bytes until dst (and src) are word aligned.
+    bz      r3, memcpy_done
+    and     r5, r4, #3
+    bz      r5, memcpy_words
+    ldub    r5, [r2, #0]
+    add     r2, r2, #1
+    add     r3, r3, #-1
+    stb     r5, [r4, #0]
+    add     r4, r4, #1
+    b       memcpy_head
+
+memcpy_words:
+    lsr     r5, r3, #2
+    and     r3, r3, #3
+    bz      r5, memcpy_bytes
+    getsr   vl, #0x10
+memcpy_words_loop:
+    minu    vl, vl, r5
+    sub     r5, r5, vl
+    ldw     v1, [r2, #4]
+    ldea    r2, [r2, vl*4]
+    stw     v1, [r4, #4]
+    ldea    r4, [r4, vl*4]
+    bnz     r5, memcpy_words_loop
+
+memcpy_bytes:
+    bz      r3, memcpy_done
+    getsr   vl, #0x10
+memcpy_bytes_loop:
+    minu    vl, vl, r3
+    sub     r3, r3, vl
+    ldub    v1, [r2, #1]
+    add     r2, r2, vl
+    stb     v1, [r4, #1]
+    add     r4, r4, vl
+    bnz     r3, memcpy_bytes_loop
+
+memcpy_done:
+    ret
+
+
+; ----------------------------------------------------------------------------
+; void* rom_memset(void* dst, int value, uint32_t size)
+; r1 = dst, r2 = value, r3 = size
+; ----------------------------------------------------------------------------
+
+    .globl  rom_memset
+rom_memset:
+    mov     r4, r1
+
+memset_head:
+    ; Store single bytes until dst is word aligned.
+    bz      r3, memset_done
+    and     r5, r4, #3
+    bz      r5, memset_words
+    stb     r2, [r4, #0]
+    add     r4, r4, #1
+    add     r3, r3, #-1
+    b       memset_head
+
+memset_words:
+    ; Replicate the byte value to all four bytes of a word.
+    and     r2, r2, #255
+    ldi     r5, #0x01010101
+    mul     r2, r2, r5
+
+    lsr     r5, r3, #2
+    and     r3, r3, #3
+    bz      r5, memset_tail
+    getsr   vl, #0x10
+    or      v1, vz, r2
+memset_words_loop:
+    minu    vl, vl, r5
+    sub     r5, r5, vl
+    stw     v1, [r4, #4]
+    ldea    r4, [r4, vl*4]
+    bnz     r5, memset_words_loop
+
+memset_tail:
+    bz      r3, memset_done
+    stb     r2, [r4, #0]
+    add     r4, r4, #1
+    add     r3, r3, #-1
+    b       memset_tail
+
+memset_done:
+    ret
+
+
+; ----------------------------------------------------------------------------
+; int rom_memcmp(const void* a, const void* b, uint32_t size)
+; r1 = a, r2 = b, r3 = size
+;
+; Word aligned data is compared in blocks of four vectors (4 * VL words): The
+; XOR of the two blocks is OR:ed into a single vector, which is reduced to a
+; scalar via the stack. When a block differs, it is rescanned by the scalar
+; word loop, which finds the first differing word (and the byte loop then
+; finds the first differing byte).
+; ----------------------------------------------------------------------------
+
+    .globl  rom_memcmp
+rom_memcmp:
+    xor     r5, r1, r2
+    and     r5, r5, #3
+    bnz     r5, memcmp_bytes    ; Different alignment: Compare bytes.
+
+memcmp_head:
+    ; Compare single bytes until a (and b) are word aligned.
+    bz      r3, memcmp_equal
+    and     r5, r1, #3
+    bz      r5, memcmp_blocks
+    ldub    r6, [r1, #0]
+    ldub    r7, [r2, #0]
+    sub     r5, r6, r7
+    bnz     r5, memcmp_differ
+    add     r1, r1, #1
+    add     r2, r2, #1
+    add     r3, r3, #-1
+    b       memcmp_head
+
+memcmp_blocks:
+    getsr   vl, #0x10
+    lsl     r8, vl, #2          ; r8 = vector size in bytes
+    lsl     r9, vl, #4          ; r9 = block size in bytes
+    sub     sp, sp, r8          ; Room for the reduction
+memcmp_block_loop:
+    sltu    r5, r3, r9
+    bnz     r5, memcmp_blocks_done
+    or      v3, vz, #0
+    mov     r6, r1
+    mov     r7, r2
+    ldi     r10, #4
+memcmp_block_vector_loop:
+    ldw     v1, [r6, #4]
+    ldw     v2, [r7, #4]
+    add     r10, r10, #-1
+    xor     v1, v1, v2
+    add     r6, r6, r8
+    add     r7, r7, r8
+    or      v3, v3, v1
+    bnz     r10, memcmp_block_vector_loop
+
+    ; Reduce the differences to a scalar.
+    stw     v3, [sp, #4]
+    mov     r6, sp
+    mov     r7, vl
+    ldi     r5, #0
+memcmp_reduce_loop:
+    ldw     r10, [r6, #0]
+    add     r6, r6, #4
+    add     r7, r7, #-1
+    or      r5, r5, r10
+    bnz     r7, memcmp_reduce_loop
+    bnz     r5, memcmp_blocks_done  ; Rescan the differing block.
+
+    add     r1, r1, r9
+    add     r2, r2, r9
+    sub     r3, r3, r9
+    b       memcmp_block_loop
+
+memcmp_blocks_done:
+    add     sp, sp, r8
+
+memcmp_words:
+    ; Compare whole words until we find a word that differs (the bytes of
+    ; that word are then compared by the byte loop).
+    sltu    r5, r3, #4
+    bnz     r5, memcmp_bytes
+    ldw     r6, [r1, #0]
+    ldw     r7, [r2, #0]
+    xor     r5, r6, r7
+    bnz     r5, memcmp_bytes
+    add     r1, r1, #4
+    add     r2, r2, #4
+    add     r3, r3, #-4
+    b       memcmp_words
+
+memcmp_bytes:
+    bz      r3, memcmp_equal
+    ldub    r6, [r1, #0]
+    ldub    r7, [r2, #0]
+    sub     r5, r6, r7
+    bnz     r5, memcmp_differ
+    add     r1, r1, #1
+    add     r2, r2, #1
+    add     r3, r3, #-1
+    b       memcmp_bytes
+
+memcmp_equal:
+    ldi     r1, #0
+    ret
+
+memcmp_differ:
+    mov     r1, r5
+    ret
+
+
+; ----------------------------------------------------------------------------
+; void rom_fill32(uint32_t* dst, uint32_t value, uint32_t count)
+; r1 = dst (word aligned), r2 = value, r3 = number of words
+; ----------------------------------------------------------------------------
+
+    .globl  rom_fill32
+rom_fill32:
+    bz      r3, fill32_done
+    getsr   vl, #0x10
+    or      v1, vz, r2
+fill32_loop:
+    minu    vl, vl, r3
+    sub     r3, r3, vl
+    stw     v1, [r1, #4]
+    ldea    r1, [r1, vl*4]
+    bnz     r3, fill32_loop
+
+fill32_done:
+    ret
+
+
+; ----------------------------------------------------------------------------
+; uint32_t rom_crc32(const void* data, uint32_t size, uint32_t crc)
+; r1 = data, r2 = size, r3 = crc
+;
+; This is the same CRC-32 as zlib. Each byte is processed as two nibbles
+; using a 16-entry table, which keeps the table small.
+;
+; The CRC has a serial dependency from byte to byte, so the word aligned bulk
+; of the data is split into VL equally sized blocks (one per vector lane),
+; and each lane calculates the CRC of its block starting from zero. The lane
+; CRC:s are then combined in order: crc = crc * x^(8 * block size) ^ lane,
+; where the multiplication is done modulo the CRC polynomial (the power is
+; calculated by repeated squaring). Short buffers, the unaligned head and
+; the tail are handled one byte at a time.
+; ----------------------------------------------------------------------------
+
+    .set    CRC32_POLY, 0xedb88320
+    .set    CRC32_MIN_BLOCK_WORDS, 16
+
+    .globl  rom_crc32
+rom_crc32:
+    ldi     r4, #crc32_table
+    ldi     r5, #-1
+    xor     r3, r3, r5          ; r3 = ~crc
+    ldi     r14, #CRC32_POLY
+
+crc32_head:
+    ; Process single bytes until data is word aligned.
+    bz      r2, crc32_done
+    and     r6, r1, #3
+    bz      r6, crc32_blocks
+    ldub    r6, [r1, #0]
+    add     r1, r1, #1
+    add     r2, r2, #-1
+    xor     r3, r3, r6
+    and     r6, r3, #15
+    lsr     r3, r3, #4
+    ldw     r6, [r4, r6*4]
+    xor     r3, r3, r6
+    and     r6, r3, #15
+    lsr     r3, r3, #4
+    ldw     r6, [r4, r6*4]
+    xor     r3, r3, r6
+    b       crc32_head
+
+crc32_blocks:
+    getsr   vl, #0x10
+    lsr     r6, r2, #2
+    divu    r6, r6, vl          ; r6 = words per block
+    sltu    r7, r6, #CRC32_MIN_BLOCK_WORDS
+    bnz     r7, crc32_tail
+    lsl     r7, r6, #2          ; r7 = block size in bytes (the lane stride)
+    mul     r8, r7, vl          ; r8 = number of bytes in all the blocks
+    sub     r2, r2, r8
+    or      v1, vz, #0          ; v1 = lane CRC:s
+    mov     r9, r6
+    mov     r10, r1
+crc32_vector_loop:
+    ldw     v2, [r10, r7]
+    add     r10, r10, #4
+    add     r9, r9, #-1
+    xor     v1, v1, v2
+    and     v2, v1, #15
+    lsr     v1, v1, #4
+    ldw     v2, [r4, v2*4]
+    xor     v1, v1, v2
+    and     v2, v1, #15
+    lsr     v1, v1, #4
+    ldw     v2, [r4, v2*4]
+    xor     v1, v1, v2
+    and     v2, v1, #15
+    lsr     v1, v1, #4
+    ldw     v2, [r4, v2*4]
+    xor     v1, v1, v2
+    and     v2, v1, #15
+    lsr     v1, v1, #4
+    ldw     v2, [r4, v2*4]
+    xor     v1, v1, v2
+    and     v2, v1, #15
+    lsr     v1, v1, #4
+    ldw     v2, [r4, v2*4]
+    xor     v1, v1, v2
+    and     v2, v1, #15
+    lsr     v1, v1, #4
+    ldw     v2, [r4, v2*4]
+    xor     v1, v1, v2
+    and     v2, v1, #15
+    lsr     v1, v1, #4
+    ldw     v2, [r4, v2*4]
+    xor     v1, v1, v2
+    and     v2, v1, #15
+    lsr     v1, v1, #4
+    ldw     v2, [r4, v2*4]
+    xor     v1, v1, v2
+    bnz     r9, crc32_vector_loop
+    add     r1, r1, r8
+
+    ; Store the lane CRC:s (and LR) on the stack.
+    lsl     r15, vl, #2
+    add     r15, r15, #4
+    sub     sp, sp, r15
+    stw     lr, [sp, #0]
+    add     r9, sp, #4
+    stw     v1, [r9, #4]
+
+    ; r8 = x^(8 * block size) mod P.
+    lsl     r5, r7, #3
+    ldi     r6, #0x40000000     ; x^1
+    ldi     r8, #0x80000000     ; x^0
+crc32_pow_loop:
+    and     r7, r5, #1
+    bz      r7, crc32_pow_square
+    mov     r10, r8
+    mov     r11, r6
+    bl      crc32_mulmod
+    mov     r8, r10
+crc32_pow_square:
+    lsr     r5, r5, #1
+    bz      r5, crc32_combine
+    mov     r10, r6
+    mov     r11, r6
+    bl      crc32_mulmod
+    mov     r6, r10
+    b       crc32_pow_loop
+
+crc32_combine:
+    ; crc = crc * x^(8 * block size) ^ lane, for all lanes (in order).
+    mov     r7, vl
+crc32_combine_loop:
+    mov     r10, r3
+    mov     r11, r8
+    bl      crc32_mulmod
+    ldw     r3, [r9, #0]
+    add     r9, r9, #4
+    add     r7, r7, #-1
+    xor     r3, r3, r10
+    bnz     r7, crc32_combine_loop
+
+    ldw     lr, [sp, #0]
+    add     sp, sp, r15
+
+crc32_tail:
+    bz      r2, crc32_done
+    ldub    r6, [r1, #0]
+    add     r1, r1, #1
+    add     r2, r2, #-1
+    xor     r3, r3, r6
+    and     r6, r3, #15
+    lsr     r3, r3, #4
+    ldw     r6, [r4, r6*4]
+    xor     r3, r3, r6
+    and     r6, r3, #15
+    lsr     r3, r3, #4
+    ldw     r6, [r4, r6*4]
+    xor     r3, r3, r6
+    b       crc32_tail
+
+crc32_done:
+    ldi     r5, #-1
+    xor     r1, r3, r5          ; return ~crc
+    ret
+
+; r10 = r10 * r11 mod P (r14 = P, clobbers r11, r12 and r13).
+crc32_mulmod:
+    ldi     r12, #0
+crc32_mulmod_loop:
+    bz      r10, crc32_mulmod_done
+    asr     r13, r10, #31
+    and     r13, r13, r11
+    xor     r12, r12, r13
+    lsl     r10, r10, #1
+    lsl     r13, r11, #31
+    asr     r13, r13, #31
+    and     r13, r13, r14
+    lsr     r11, r11, #1
+    xor     r11, r11, r13
+    b       crc32_mulmod_loop
+crc32_mulmod_done:
+    mov     r10, r12
+    ret
+
+
+    .section .rodata.memfuncs, "a"
+    .p2align 2
+
+crc32_table:
+    .word   0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac
+    .word   0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c
+    .word   0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c
+    .word   0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
@@ -21,6 +21,9 @@
 #ifndef ROM_MOSAIC_HPP_
 #define ROM_MOSAIC_HPP_
 
+#include "memfuncs.hpp"
+#include "vcp_ext.hpp"
+
 #include <mc1/mmio.h>
 #include <mc1/vcp.h>
 
@@ -39,6 +42,9 @@ public:
     auto* pixels = reinterpret_cast<uint32_t*>(mem);
     auto* vcp_start = &pixels[MOSAIC_W * MOSAIC_H];
 
+    // Clear the pixels (they are not updated until the first frame has been displayed).
+    rom_fill32(pixels, 0U, MOSAIC_W * MOSAIC_H);
+
     // Get the HW resolution.
     const auto native_width = MMIO(VIDWIDTH);
     const auto native_height = MMIO(VIDHEIGHT);
@@ -48,17 +54,12 @@ public:
     *vcp++ = vcp_emit_setreg(VCR_XINCR, (0x010000 * MOSAIC_W) / native_width);
     *vcp++ = vcp_emit_setreg(VCR_CMODE, CMODE_RGBA8888);
 
-    // Address pointers.
-    uint32_t vcp_pixels_addr = to_vcp_addr(reinterpret_cast<uintptr_t>(pixels));
+    // Address pointers (the video logic steps the row address every VCR_REPEAT lines).
     *vcp++ = vcp_emit_waity(0);
     *vcp++ = vcp_emit_setreg(VCR_HSTOP, native_width);
-    *vcp++ = vcp_emit_setreg(VCR_ADDR, vcp_pixels_addr);
-    for (int k = 1; k < MOSAIC_H; ++k) {
-      auto y = (static_cast<uint32_t>(k) * native_height) / static_cast<uint32_t>(MOSAIC_H);
-      vcp_pixels_addr += MOSAIC_W;
-      *vcp++ = vcp_emit_waity(y);
-      *vcp++ = vcp_emit_setreg(VCR_ADDR, vcp_pixels_addr);
-    }
+    *vcp++ = vcp_emit_setreg(VCR_STRIDE, MOSAIC_W);
+    *vcp++ = vcp_emit_setreg(VCR_REPEAT, vcp_repeat_value(native_height, MOSAIC_H));
+    *vcp++ = vcp_emit_setreg(VCR_ADDR, to_vcp_addr(reinterpret_cast<uintptr_t>(pixels)));
 
     // VCP epilogue: Wait forever.
     *vcp++ = vcp_emit_waity(32767);
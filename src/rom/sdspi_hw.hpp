@@ -0,0 +1,219 @@
+// -*- mode: c; tab-width: 2; indent-tabs-mode: nil; -*-
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2022 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ROM_SDSPI_HW_HPP_
+#define ROM_SDSPI_HW_HPP_
+
+#include <mc1/mmio.h>
+
+#include <cstdint>
+
+// SD SPI engine registers that are implemented by the MC1 MMIO logic but that are not (yet) defined
+// by libmc1 (see sdspi.vhd).
+
+#ifndef SDCTRL
+// Control: Bit 0 = enable, bit 1 = chip select, bits 15-8 = clock divider.
+#define SDCTRL 108
+#endif
+
+#ifndef SDDATA
+// Single byte transfer (write to send a byte, read the last received byte).
+#define SDDATA 112
+#endif
+
+#ifndef SDBLK
+// Block transfer: Bits 10-0 = number of bytes, bit 31 = direction (1 = write).
+#define SDBLK 116
+#endif
+
+#ifndef SDSTAT
+// Status: Bit 0 = busy, bit 1 = CRC error, bit 2 = timeout, bit 3 = write error, bits 23-16 = FIFO
+// words, bit 31 = the engine is present.
+#define SDSTAT 120
+#endif
+
+#ifndef SDFIFO
+// Block FIFO (read to pop a word, write to push a word).
+#define SDFIFO 124
+#endif
+
+// Note: Using an anonymous namespace saves a few bytes of code size.
+namespace {
+
+//--------------------------------------------------------------------------------------------------
+// SD card block transfers using the SD SPI engine.
+//
+// The card is initialized by the libmc1 SD card driver (which bit-bangs the SD card pins), and the
+// engine is only used for the data block transfers. The engine is disabled between transfers, so
+// the bit-banged driver keeps working (e.g. if the card has to be initialized again).
+//--------------------------------------------------------------------------------------------------
+
+class sdspi_hw_t {
+public:
+  /// @brief Check if the SD SPI engine is present.
+  static bool is_present() {
+    return (MMIO(SDSTAT) & 0x80000000U) != 0U;
+  }
+
+  /// @brief Prepare for block transfers (call this after the card has been initialized).
+  /// @returns true if the engine can be used for block transfers.
+  static bool init() {
+    s_ready = false;
+    if (!is_present()) {
+      return false;
+    }
+
+    // Select the fastest SPI clock that does not exceed 25 MHz (the SPI clock period is
+    // 2 * (DIV + 1) CPU clock cycles).
+    auto div = (MMIO(CPUCLK) + (2U * MAX_SPI_CLK - 1U)) / (2U * MAX_SPI_CLK);
+    div = div > 0U ? div - 1U : 0U;
+    div = div < 255U ? div : 255U;
+    s_ctrl = (div << 8U) | CTRL_EN;
+
+    // Read the OCR (CMD58) to find out if the card uses block addressing (SDHC/SDXC) or byte
+    // addressing (SDSC).
+    select();
+    const auto r1 = command(58U, 0U);
+    uint32_t ocr = 0U;
+    for (int i = 0; i < 4; ++i) {
+      ocr = (ocr << 8U) | xfer(0xffU);
+    }
+    deselect();
+    if (r1 != 0U) {
+      return false;
+    }
+    s_block_addressing = (ocr & 0x40000000U) != 0U;
+
+    s_ready = true;
+    return true;
+  }
+
+  /// @brief Check if the engine has been prepared for block transfers.
+  static bool is_ready() {
+    return s_ready;
+  }
+
+  /// @brief Read one 512 byte block from the card.
+  static bool read_block(uint8_t* ptr, const uint32_t block_no) {
+    select();
+    auto ok = command(17U, block_addr(block_no)) == 0U;
+    if (ok) {
+      MMIO(SDBLK) = BLOCK_SIZE;
+      ok = (wait() & (STAT_CRCERR | STAT_TIMEOUT)) == 0U;
+    }
+    if (ok) {
+      if ((reinterpret_cast<uintptr_t>(ptr) & 3U) == 0U) {
+        auto* dst = reinterpret_cast<uint32_t*>(ptr);
+        for (uint32_t i = 0U; i < BLOCK_SIZE / 4U; ++i) {
+          dst[i] = MMIO(SDFIFO);
+        }
+      } else {
+        for (uint32_t i = 0U; i < BLOCK_SIZE; i += 4U) {
+          const auto word = MMIO(SDFIFO);
+          ptr[i] = static_cast<uint8_t>(word);
+          ptr[i + 1U] = static_cast<uint8_t>(word >> 8U);
+          ptr[i + 2U] = static_cast<uint8_t>(word >> 16U);
+          ptr[i + 3U] = static_cast<uint8_t>(word >> 24U);
+        }
+      }
+    }
+    deselect();
+    return ok;
+  }
+
+  /// @brief Write one 512 byte block to the card.
+  static bool write_block(const uint8_t* ptr, const uint32_t block_no) {
+    select();
+    auto ok = command(24U, block_addr(block_no)) == 0U;
+    if (ok) {
+      for (uint32_t i = 0U; i < BLOCK_SIZE; i += 4U) {
+        MMIO(SDFIFO) = static_cast<uint32_t>(ptr[i]) | (static_cast<uint32_t>(ptr[i + 1U]) << 8U) |
+                       (static_cast<uint32_t>(ptr[i + 2U]) << 16U) |
+                       (static_cast<uint32_t>(ptr[i + 3U]) << 24U);
+      }
+      MMIO(SDBLK) = 0x80000000U | BLOCK_SIZE;
+      ok = (wait() & (STAT_TIMEOUT | STAT_WRERR)) == 0U;
+    }
+    deselect();
+    return ok;
+  }
+
+private:
+  static const uint32_t BLOCK_SIZE = 512U;
+  static const uint32_t MAX_SPI_CLK = 25000000U;
+  static const uint32_t CTRL_EN = 1U;
+  static const uint32_t CTRL_CS = 2U;
+  static const uint32_t STAT_BUSY = 1U;
+  static const uint32_t STAT_CRCERR = 2U;
+  static const uint32_t STAT_TIMEOUT = 4U;
+  static const uint32_t STAT_WRERR = 8U;
+
+  static uint32_t wait() {
+    uint32_t stat;
+    do {
+      stat = MMIO(SDSTAT);
+    } while ((stat & STAT_BUSY) != 0U);
+    return stat;
+  }
+
+  static uint32_t xfer(const uint32_t byte) {
+    MMIO(SDDATA) = byte;
+    wait();
+    return MMIO(SDDATA) & 255U;
+  }
+
+  static void select() {
+    MMIO(SDCTRL) = s_ctrl | CTRL_CS;
+    xfer(0xffU);
+  }
+
+  static void deselect() {
+    MMIO(SDCTRL) = s_ctrl;
+    xfer(0xffU);
+    MMIO(SDCTRL) = s_ctrl & ~CTRL_EN;
+  }
+
+  // Send a command, and return the R1 response (0xff if the card did not respond).
+  static uint32_t command(const uint32_t cmd, const uint32_t arg) {
+    xfer(0x40U | cmd);
+    xfer(arg >> 24U);
+    xfer((arg >> 16U) & 255U);
+    xfer((arg >> 8U) & 255U);
+    xfer(arg & 255U);
+    xfer(0x01U);  // The CRC is not checked in SPI mode (just send the end bit).
+    uint32_t r1 = 0xffU;
+    for (int i = 0; i < 8 && (r1 & 0x80U) != 0U; ++i) {
+      r1 = xfer(0xffU);
+    }
+    return r1;
+  }
+
+  static uint32_t block_addr(const uint32_t block_no) {
+    return s_block_addressing ? block_no : block_no * BLOCK_SIZE;
+  }
+
+  static inline uint32_t s_ctrl = 0U;
+  static inline bool s_block_addressing = false;
+  static inline bool s_ready = false;
+};
+
+}  // namespace
+
+#endif  // ROM_SDSPI_HW_HPP_
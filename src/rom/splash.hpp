@@ -22,6 +22,9 @@
 #define ROM_SPLASH_HPP_
 
 #include "fp32.hpp"
+#include "lzg_hw.hpp"
+#include "memfuncs.hpp"
+#include "vcp_ext.hpp"
 
 #include <mc1/mci_decode.h>
 #include <mc1/mmio.h>
@@ -52,12 +55,18 @@ public:
     m_pixels = reinterpret_cast<uint32_t*>(mem);
     m_vcp = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(mem) + pixels_size);
 
-    // Decode the pixels.
-    mci_decode_pixels(boot_splash_mci, m_pixels);
+    // Decode the pixels (using the LZG engine if possible).
+    if (!decode_pixels_hw(hdr, pixels_size)) {
+      mci_decode_pixels(boot_splash_mci, m_pixels);
+    }
 
     // Generate the VCP.
     auto* mem_end = generate_vcp(scale_for_t(0));
 
+    // Copy the palette (ABGR32 words that follow the MCI header) into the VCP. It stays at the same
+    // place in the VCP when the VCP is regenerated, so it only needs to be copied once.
+    rom_memcpy(m_palette, hdr + 1, 4U * m_num_palette_colors);
+
     // Set up the VCP address.
     vcp_set_prg(LAYER_2, m_vcp);
 
@@ -73,6 +82,23 @@ public:
   }
 
 private:
+  bool decode_pixels_hw(const mci_header_t* hdr, const uint32_t pixels_size) {
+    // The LZG compressed pixel data follows the palette. Only use the LZG engine if the data is
+    // LZG compressed and decompresses to the expected size.
+    const auto* lzg = reinterpret_cast<const uint8_t*>(hdr + 1) + 4U * hdr->num_pal_colors;
+    if (lzg[0] != 'L' || lzg[1] != 'Z' || lzg[2] != 'G') {
+      return false;
+    }
+    const auto decoded_size = (static_cast<uint32_t>(lzg[3]) << 24U) |
+                              (static_cast<uint32_t>(lzg[4]) << 16U) |
+                              (static_cast<uint32_t>(lzg[5]) << 8U) |
+                              static_cast<uint32_t>(lzg[6]);
+    if (decoded_size != pixels_size) {
+      return false;
+    }
+    return lzg_hw_decode(lzg, m_pixels);
+  }
+
   static fp32_t scale_for_t(const uint32_t t) {
     // Scaling as a function of time: Simulate an x^2 "bouncing" motion.
     auto t_mod = t & 127U;
@@ -94,6 +120,8 @@ private:
     const auto view_top = (native_height - view_height) / 2U;
     const auto view_left = (native_width - view_width) / 2U;
 
+    // Note: The VCP is only about 20 words, and each word is calculated, so it is emitted directly
+    // (the palette is skipped, since it is copied once by init()).
     auto* vcp = m_vcp;
 
     // We add a wait here, and add a few NOP:s (to fill up the pipeline after the WAITY instruction)
@@ -112,24 +140,16 @@ private:
     // Palette.
     *vcp++ = vcp_emit_setpal(0, m_num_palette_colors);
     m_palette = vcp;
-    mci_decode_palette(boot_splash_mci, vcp);
     vcp += m_num_palette_colors;
 
-    // Address pointers.
+    // Address pointers (the video logic steps the row address every VCR_REPEAT lines).
     *vcp++ = vcp_emit_waity(view_top);
     *vcp++ = vcp_emit_setreg(VCR_HSTRT, view_left);
     *vcp++ = vcp_emit_setreg(VCR_HSTOP, view_left + view_width);
-    uint32_t vcp_pixels_addr = to_vcp_addr(reinterpret_cast<uintptr_t>(m_pixels));
-    const auto vcp_pixels_stride = m_img_word_stride;
-    auto y = fp32_t(view_top);
-    const auto y_step = fp32_t(view_height) / m_img_height;
-    for (uint32_t k = 0U; k < m_img_height; ++k) {
-      *vcp++ = vcp_emit_waity(static_cast<uint32_t>(y));
-      *vcp++ = vcp_emit_setreg(VCR_ADDR, vcp_pixels_addr);
-      y += y_step;
-      vcp_pixels_addr += vcp_pixels_stride;
-    }
-    *vcp++ = vcp_emit_waity(static_cast<uint32_t>(y));
+    *vcp++ = vcp_emit_setreg(VCR_STRIDE, m_img_word_stride);
+    *vcp++ = vcp_emit_setreg(VCR_REPEAT, vcp_repeat_value(view_height, m_img_height));
+    *vcp++ = vcp_emit_setreg(VCR_ADDR, to_vcp_addr(reinterpret_cast<uintptr_t>(m_pixels)));
+    *vcp++ = vcp_emit_waity(view_top + view_height);
     *vcp++ = vcp_emit_setreg(VCR_HSTOP, 0);
 
     // VCP epilogue: Wait forever.
@@ -0,0 +1,215 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2022 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ROM_TILECON_HPP_
+#define ROM_TILECON_HPP_
+
+#include "font8x8.hpp"
+#include "memfuncs.hpp"
+#include "vcp_ext.hpp"
+
+#include <mc1/mmio.h>
+#include <mc1/vconsole.h>
+#include <mc1/vcp.h>
+
+#include <cstdint>
+
+#ifndef VIDSTAT
+// Video status: Bits 3:0 = line FIFO underrun during the last frame (layers 1-4), bits 11:8 =
+// number of video layers, bit 31 = the top layer supports tile mode.
+#define VIDSTAT 204
+#endif
+
+// Note: Using an anonymous namespace saves a few bytes of code size.
+namespace {
+
+//--------------------------------------------------------------------------------------------------
+// Text console that uses a tile map (CMODE_TILE) in video layer 2.
+//
+// The glyph table is built from the ROM font when the console is initialized, and printing a
+// character only writes one byte to the tile map. The console requires that layer 2 is the top
+// layer and that it supports tile mode (see VIDSTAT). Otherwise the con_* functions below fall back
+// to the libmc1 console (vconsole).
+//--------------------------------------------------------------------------------------------------
+
+class tilecon_t {
+public:
+  /// @brief Check if the video logic supports a tile map console in layer 2.
+  static bool is_supported() {
+    const auto stat = MMIO(VIDSTAT);
+    return (stat & 0x80000000U) != 0U && ((stat >> 8U) & 15U) == 2U;
+  }
+
+  /// @brief Initialize and show the console.
+  /// @param mem Start of the VRAM area to use (word aligned).
+  /// @param color0 Background color (ABGR32).
+  /// @param color1 Text color (ABGR32).
+  /// @returns the end of the used VRAM area, or nullptr if tile mode is not supported.
+  static void* init(void* mem, const uint32_t color0, const uint32_t color1) {
+    if (!is_supported()) {
+      return nullptr;
+    }
+
+    // Get the HW resolution, and select a vertical glyph scale that gives at least MIN_ROWS rows.
+    const auto native_width = MMIO(VIDWIDTH);
+    const auto native_height = MMIO(VIDHEIGHT);
+    const uint32_t log2_scale = (native_height >= 2U * GLYPH_H * MIN_ROWS) ? 1U : 0U;
+    const uint32_t lines_per_row = GLYPH_H << log2_scale;
+    s_rows = native_height / lines_per_row;
+
+    // "Allocate" memory. The tile map has an extra (blank) row that covers the lines below the
+    // last full row.
+    auto* glyphs = reinterpret_cast<uint32_t*>(mem);
+    s_map = reinterpret_cast<uint8_t*>(&glyphs[NUM_GLYPHS * 4]);
+    auto* vcp_start = reinterpret_cast<uint32_t*>(&s_map[(s_rows + 1U) * COLS]);
+
+    // Build the glyph table from the ROM font. Each 8x8 font glyph is stretched to an 8x16 tile
+    // glyph (one byte per glyph row, four rows per word), and all other glyphs are blank.
+    rom_fill32(glyphs, 0U, NUM_GLYPHS * 4U);
+    for (int c = 0; c < FONT8X8_NUM_CHARS; ++c) {
+      const auto* src = &FONT8X8[c * 8];
+      auto* dst = &glyphs[(FONT8X8_FIRST_CHAR + c) * 4];
+      for (int i = 0; i < 4; ++i) {
+        const uint32_t row0 = src[2 * i];
+        const uint32_t row1 = src[2 * i + 1];
+        dst[i] = row0 | (row0 << 8U) | (row1 << 16U) | (row1 << 24U);
+      }
+    }
+
+    // Clear the tile map.
+    rom_fill32(reinterpret_cast<uint32_t*>(s_map), 0U, ((s_rows + 1U) * COLS) / 4U);
+    s_col = 0U;
+    s_row = 0U;
+
+    // VCP prologue.
+    auto* vcp = vcp_start;
+    *vcp++ = vcp_emit_setreg(VCR_XINCR, (0x010000U * COLS * GLYPH_W) / native_width);
+    *vcp++ = vcp_emit_setreg(VCR_CMODE, vcp_tile_cmode_value(log2_scale));
+    *vcp++ = vcp_emit_setreg(VCR_GLYPHS, to_vcp_addr(reinterpret_cast<uintptr_t>(glyphs)));
+
+    // Palette.
+    *vcp++ = vcp_emit_setpal(0, 2);
+    *vcp++ = color0;
+    *vcp++ = color1;
+
+    // Tile map rows (the video logic steps the map row address every VCR_REPEAT lines).
+    *vcp++ = vcp_emit_waity(0);
+    *vcp++ = vcp_emit_setreg(VCR_HSTOP, native_width);
+    *vcp++ = vcp_emit_setreg(VCR_STRIDE, COLS / 4U);
+    *vcp++ = vcp_emit_setreg(VCR_REPEAT, vcp_repeat_value(lines_per_row, 1U));
+    *vcp++ = vcp_emit_setreg(VCR_ADDR, to_vcp_addr(reinterpret_cast<uintptr_t>(s_map)));
+
+    // VCP epilogue: Wait forever.
+    *vcp++ = vcp_emit_waity(32767);
+
+    // Show the console.
+    vcp_set_prg(LAYER_2, vcp_start);
+
+    return reinterpret_cast<void*>(vcp);
+  }
+
+  /// @brief Check if the tile map console has been initialized.
+  static bool is_active() {
+    return s_map != nullptr;
+  }
+
+  /// @brief Print a string.
+  static void print(const char* str) {
+    for (; *str != 0; ++str) {
+      const auto c = static_cast<uint8_t>(*str);
+      if (c == '\n') {
+        newline();
+        continue;
+      }
+      if (s_col >= COLS) {
+        newline();
+      }
+      s_map[s_row * COLS + s_col] = c < NUM_GLYPHS ? c : 0U;
+      ++s_col;
+    }
+  }
+
+private:
+  static const uint32_t COLS = 80U;
+  static const uint32_t GLYPH_W = 8U;
+  static const uint32_t GLYPH_H = 16U;
+  static const uint32_t MIN_ROWS = 30U;
+  static const uint32_t NUM_GLYPHS = 128U;
+
+  static void newline() {
+    s_col = 0U;
+    if (s_row + 1U < s_rows) {
+      ++s_row;
+      return;
+    }
+
+    // Scroll up one row (row by row, since rom_memcpy does not handle overlapping areas).
+    for (uint32_t row = 1U; row < s_rows; ++row) {
+      rom_memcpy(&s_map[(row - 1U) * COLS], &s_map[row * COLS], COLS);
+    }
+    rom_fill32(reinterpret_cast<uint32_t*>(&s_map[s_row * COLS]), 0U, COLS / 4U);
+  }
+
+  static inline uint8_t* s_map = nullptr;
+  static inline uint32_t s_rows = 0U;
+  static inline uint32_t s_row = 0U;
+  static inline uint32_t s_col = 0U;
+};
+
+//--------------------------------------------------------------------------------------------------
+// Console output functions (tile map console, or vconsole as a fallback).
+//--------------------------------------------------------------------------------------------------
+
+inline void con_print(const char* str) {
+  if (tilecon_t::is_active()) {
+    tilecon_t::print(str);
+  } else {
+    vcon_print(str);
+  }
+}
+
+inline void con_print_dec(const int x) {
+  char buf[12];
+  auto* p = &buf[sizeof(buf) - 1];
+  *p = 0;
+  auto u = x < 0 ? -static_cast<uint32_t>(x) : static_cast<uint32_t>(x);
+  do {
+    *--p = static_cast<char>('0' + (u % 10U));
+    u /= 10U;
+  } while (u != 0U);
+  if (x < 0) {
+    *--p = '-';
+  }
+  con_print(p);
+}
+
+inline void con_print_hex(const uint32_t x) {
+  char buf[9];
+  for (int i = 0; i < 8; ++i) {
+    const auto digit = (x >> (28 - 4 * i)) & 15U;
+    buf[i] = static_cast<char>(digit < 10U ? '0' + digit : 'a' + (digit - 10U));
+  }
+  buf[8] = 0;
+  con_print(buf);
+}
+
+}  // namespace
+
+#endif  // ROM_TILECON_HPP_
@@ -2,8 +2,9 @@
 # -*- mode: python; tab-width: 4; indent-tabs-mode: nil; -*-
 
 import argparse
-import math
+import os
 import struct
+import sys
 
 _RAW_BASE_ADDRESS = 512
 
@@ -15,34 +16,97 @@ def closest_pot(x):
     return res
 
 
-def convert(raw_filename, template_filename):
-    # Read the raw rom file and pad start and end with zeros to account for start address and
-    # a power-of-two size.
+def read_rom_words(raw_filename, rom_size):
+    # Read the raw rom file and pad start and end with zeros to account for the start address and
+    # the ROM size.
     with open(raw_filename, 'rb') as f:
         raw_data = f.read()
     raw_data = bytearray(_RAW_BASE_ADDRESS) + raw_data
-    rom_size = int(closest_pot(len(raw_data)))
+    raw_data = raw_data + bytearray((-len(raw_data)) % 4)
+    if rom_size is None:
+        rom_size = len(raw_data)
+    elif rom_size < len(raw_data):
+        sys.exit(f'Error: The ROM image ({len(raw_data)} bytes) does not fit in {rom_size} bytes')
     raw_data = raw_data + bytearray(rom_size - len(raw_data))
+    return struct.unpack(f'<{rom_size // 4}I', raw_data)
+
+
+def write_hex_file(filename, words):
+    # One 32-bit word per line (readable with hread in VHDL, or $readmemh in Verilog).
+    with open(filename, 'w', encoding='utf8') as f:
+        f.write(''.join(f'{word:08x}\n' for word in words))
+
+
+def write_mif_file(filename, words):
+    # Altera/Intel Memory Initialization File. Runs of identical words are collapsed into address
+    # ranges to keep the file small.
+    lines = [
+        'WIDTH=32;',
+        f'DEPTH={len(words)};',
+        'ADDRESS_RADIX=HEX;',
+        'DATA_RADIX=HEX;',
+        'CONTENT BEGIN'
+    ]
+    start = 0
+    while start < len(words):
+        end = start
+        while end + 1 < len(words) and words[end + 1] == words[start]:
+            end += 1
+        if end == start:
+            lines.append(f'    {start:x} : {words[start]:08x};')
+        else:
+            lines.append(f'    [{start:x}..{end:x}] : {words[start]:08x};')
+        start = end + 1
+    lines.append('END;')
+    with open(filename, 'w', encoding='utf8') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+def write_if_changed(filename, contents):
+    # Only touch the output file if the contents changed (avoids needless re-analysis of the VHDL).
+    if os.path.exists(filename):
+        with open(filename, 'r', encoding='utf8') as f:
+            if f.read() == contents:
+                return
+    with open(filename, 'w', encoding='utf8') as f:
+        f.write(contents)
+
+
+def convert(raw_filename, template_filename, rom_size, hex_filename, mif_filename, out_filename):
+    words = read_rom_words(raw_filename, rom_size)
 
     # Derive dynamic data.
-    ADDR_BITS = str(int(math.log(rom_size, 2) - 2))
-    DATA = ''
-    raw_data_32bit = struct.unpack('<' + ('I' * (rom_size // 4)), raw_data)
-    for x in range(0, len(raw_data_32bit)):
-        tail = '' if x == (len(raw_data_32bit) - 1) else ',\n'
-        word = raw_data_32bit[x]
-        DATA = DATA + (f'    x"{word:08x}"{tail}')
+    NUM_WORDS = str(len(words))
+    ADDR_BITS = str(max(1, (len(words) - 1).bit_length()))
+    if hex_filename:
+        # Load the contents from the hex file during elaboration. The generated VHDL does not
+        # change when the ROM contents change (as long as the ROM size is fixed).
+        write_hex_file(hex_filename, words)
+        DATA = f'read_hex_file("{os.path.abspath(hex_filename)}")'
+    else:
+        DATA = '(\n' + ',\n'.join(f'    x"{word:08x}"' for word in words) + '\n  )'
+    ATTRIBUTES = ''
+    if mif_filename:
+        # Let Quartus initialize the ROM from the MIF file, which makes it possible to update the
+        # ROM contents of a compiled design (quartus_cdb --update_mif + quartus_asm).
+        write_mif_file(mif_filename, words)
+        mif_path = os.path.abspath(mif_filename)
+        ATTRIBUTES = ('  attribute ram_init_file : string;\n' +
+                      f'  attribute ram_init_file of C_ROM : signal is "{mif_path}";\n')
 
     # Read the VHDL template.
     with open(template_filename, 'r', encoding='utf8') as f:
-        template = f.readlines()
+        template = f.read()
 
     # Generate the output.
-    for l in template:
-        l = l.rstrip()
-        l = l.replace("${ADDR_BITS}", ADDR_BITS)
-        l = l.replace("${DATA}", DATA)
-        print(l)
+    result = template.replace('${ATTRIBUTES}\n', ATTRIBUTES)
+    result = result.replace('${NUM_WORDS}', NUM_WORDS)
+    result = result.replace('${ADDR_BITS}', ADDR_BITS)
+    result = result.replace('${DATA}', DATA)
+    if out_filename:
+        write_if_changed(out_filename, result)
+    else:
+        sys.stdout.write(result)
 
 
 def main():
@@ -51,10 +115,32 @@ def main():
             description='Convert a raw file to a VHDL ROM file')
     parser.add_argument('raw', metavar='RAW_FILE', help='the raw file to convert')
     parser.add_argument('template', metavar='TEMPLATE_FILE', help='the VHDL template file')
+    size_group = parser.add_mutually_exclusive_group()
+    size_group.add_argument('--exact', action='store_true',
+                            help='do not pad the ROM to a power of two size')
+    size_group.add_argument('--size', type=lambda x: int(x, 0),
+                            help='the ROM size in bytes (must be a multiple of 4)')
+    parser.add_argument('-o', '--output', metavar='VHDL_FILE',
+                        help='write the VHDL to VHDL_FILE (only if changed) instead of stdout')
+    parser.add_argument('--hex', metavar='HEX_FILE',
+                        help='load the ROM contents from HEX_FILE instead of inlining them')
+    parser.add_argument('--mif', metavar='MIF_FILE',
+                        help='also write a MIF file, and use it for initializing the ROM (Quartus)')
     args = parser.parse_args()
 
+    # Determine the ROM size.
+    if args.size is not None:
+        if args.size <= 0 or args.size % 4 != 0:
+            parser.error('the ROM size must be a positive multiple of 4')
+        rom_size = args.size
+    elif args.exact:
+        rom_size = None
+    else:
+        raw_size = _RAW_BASE_ADDRESS + os.path.getsize(args.raw)
+        rom_size = closest_pot(raw_size + (-raw_size) % 4)
+
     # Convert the file.
-    convert(args.raw, args.template)
+    convert(args.raw, args.template, rom_size, args.hex, args.mif, args.output)
 
 
 if __name__ == "__main__":
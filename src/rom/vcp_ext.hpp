@@ -0,0 +1,73 @@
+// -*- mode: c; tab-width: 2; indent-tabs-mode: nil; -*-
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2022 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ROM_VCP_EXT_HPP_
+#define ROM_VCP_EXT_HPP_
+
+#include <mc1/vcp.h>
+
+#include <cstdint>
+
+// Video control registers that are implemented by the MC1 video logic but that are not (yet)
+// defined by libmc1.
+
+#ifndef VCR_STRIDE
+// Row stride (in words) that is added to VCR_ADDR every VCR_REPEAT scanlines.
+#define VCR_STRIDE 7
+#endif
+
+#ifndef VCR_REPEAT
+// Number of scanlines per row, as an unsigned 12.12 fixed point number (0 = disable stepping).
+#define VCR_REPEAT 8
+#endif
+
+#ifndef VCR_PALBANK
+// Palette bank selection: Bits 7:0 = displayed bank, bits 15:8 = bank written by SETPAL.
+#define VCR_PALBANK 9
+#endif
+
+#ifndef VCR_GLYPHS
+// Glyph table base address (in words) for CMODE_TILE.
+#define VCR_GLYPHS 10
+#endif
+
+#ifndef CMODE_TILE
+// Tile mode: VCR_ADDR points to a tile map (8-bit glyph indices), and VCR_GLYPHS points to a glyph
+// table (8x16 pixels, 1 bpp, 4 words per glyph). Bits 5:4 of CMODE hold the log2 of the vertical
+// glyph scale.
+#define CMODE_TILE 6
+#endif
+
+// Note: Using an anonymous namespace saves a few bytes of code size.
+namespace {
+
+// Convert a line count ratio to a VCR_REPEAT value.
+inline uint32_t vcp_repeat_value(const uint32_t lines, const uint32_t rows) {
+  return (lines << 12U) / rows;
+}
+
+// Make a CMODE_TILE value with a vertical glyph scale of 2^log2_scale.
+inline uint32_t vcp_tile_cmode_value(const uint32_t log2_scale) {
+  return (log2_scale << 4U) | CMODE_TILE;
+}
+
+}  // namespace
+
+#endif  // ROM_VCP_EXT_HPP_
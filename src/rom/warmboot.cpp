@@ -0,0 +1,273 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2022 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+
+#include "warmboot.hpp"
+
+#include "memfuncs.hpp"
+
+#include <mc1/mmio.h>
+
+#include <cstddef>
+
+// Defined by the linker script.
+extern char __warm_boot_record;
+extern char __vram_free_start;
+
+namespace warmboot {
+namespace {
+const uint32_t RECORD_MAGIC = 0x544f4f42U;  // "BOOT"
+const uint32_t MAX_REGIONS = 8U;
+
+// Size of the reserved memory area for the record (see link.ld).
+const uint32_t RECORD_AREA_SIZE = 128U;
+
+// The ROM stack is at the top of VRAM (see crt0.s).
+const uint32_t ROM_STACK_SIZE = 512U;
+
+// Regions that are separated by at most this many bytes (e.g. due to alignment) are merged.
+const uint32_t MAX_REGION_GAP = 16U;
+
+struct region_t {
+  uint32_t addr;
+  uint32_t size;
+};
+
+struct region_list_t {
+  uint32_t num_regions;
+  region_t regions[MAX_REGIONS];
+};
+
+struct record_t {
+  uint32_t magic;
+  uint32_t entry_address;
+  uint32_t file_size;
+  uint32_t file_time_crc;  // CRC of the modification time of the file.
+  uint32_t image_crc;      // CRC of the read-only regions.
+  uint32_t snapshot_addr;
+  uint32_t snapshot_size;
+  uint32_t snapshot_crc;
+  region_list_t read_only;
+  uint32_t record_crc;  // CRC of all the fields above.
+};
+static_assert(sizeof(record_t) <= RECORD_AREA_SIZE, "The warm boot record is too large");
+
+// The snapshot starts with this header, which is followed by the initial contents of the writable
+// regions (each padded to a multiple of four bytes).
+struct snapshot_t {
+  region_list_t data;
+  region_list_t bss;
+};
+
+// The record and the snapshot header that are being built while loading an image. Note: These live
+// in the ROM BSS, since the stored record may be overwritten while the image is being loaded.
+record_t s_new_record;
+snapshot_t s_new_snapshot;
+bool s_new_record_ok;
+
+record_t& stored_record() {
+  return *reinterpret_cast<record_t*>(&__warm_boot_record);
+}
+
+uint32_t record_addr() {
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&__warm_boot_record));
+}
+
+uint32_t align4(uint32_t x) {
+  return (x + 3U) & ~3U;
+}
+
+// Check if a memory area is in RAM that is not used by the ROM (i.e. the VRAM above the ROM BSS
+// and below the ROM stack, or the XRAM).
+bool is_free_ram(uint32_t addr, uint32_t size) {
+  const auto free_vram_start =
+      static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&__vram_free_start));
+  const auto free_vram_end = static_cast<uint32_t>(VRAM_START) + MMIO(VRAMSIZE) - ROM_STACK_SIZE;
+  const auto xram_start = static_cast<uint32_t>(XRAM_START);
+  const auto xram_end = xram_start + MMIO(XRAMSIZE);
+  const auto end = addr + size;
+  return end >= addr && ((addr >= free_vram_start && end <= free_vram_end) ||
+                         (addr >= xram_start && end <= xram_end));
+}
+
+uint32_t calc_image_crc(const record_t& record) {
+  uint32_t crc = 0U;
+  for (uint32_t i = 0U; i < record.read_only.num_regions; ++i) {
+    const auto& region = record.read_only.regions[i];
+    crc = rom_crc32(reinterpret_cast<const void*>(region.addr), region.size, crc);
+  }
+  return crc;
+}
+
+uint32_t calc_file_time_crc(const mfat_stat_t& stat) {
+  return rom_crc32(&stat.st_mtim, sizeof(stat.st_mtim), 0U);
+}
+
+uint32_t calc_record_crc(const record_t& record) {
+  return rom_crc32(&record, offsetof(record_t, record_crc), 0U);
+}
+
+uint32_t calc_end(const region_list_t& list, uint32_t end) {
+  for (uint32_t i = 0U; i < list.num_regions; ++i) {
+    const auto region_end = list.regions[i].addr + list.regions[i].size;
+    end = region_end > end ? region_end : end;
+  }
+  return end;
+}
+
+void add_to_list(region_list_t& list, uint32_t addr, uint32_t size) {
+  if (size == 0U || !s_new_record_ok) {
+    return;
+  }
+
+  // The image must not overlap the stored record.
+  if (addr < record_addr() + RECORD_AREA_SIZE && record_addr() < addr + size) {
+    s_new_record_ok = false;
+    return;
+  }
+
+  // Extend the last region if possible.
+  if (list.num_regions > 0U) {
+    auto& last = list.regions[list.num_regions - 1U];
+    const auto last_end = last.addr + last.size;
+    if (addr >= last_end && (addr - last_end) <= MAX_REGION_GAP) {
+      last.size = (addr + size) - last.addr;
+      return;
+    }
+  }
+
+  if (list.num_regions == MAX_REGIONS) {
+    s_new_record_ok = false;
+    return;
+  }
+  list.regions[list.num_regions].addr = addr;
+  list.regions[list.num_regions].size = size;
+  ++list.num_regions;
+}
+
+}  // namespace
+
+bool is_intact() {
+  // Validate the record, the snapshot and the image (cheapest check first).
+  const auto& record = stored_record();
+  if (record.magic != RECORD_MAGIC || record.record_crc != calc_record_crc(record) ||
+      record.read_only.num_regions > MAX_REGIONS ||
+      !is_free_ram(record.snapshot_addr, record.snapshot_size)) {
+    return false;
+  }
+  const auto* snapshot = reinterpret_cast<const snapshot_t*>(record.snapshot_addr);
+  if (record.snapshot_crc != rom_crc32(snapshot, record.snapshot_size, 0U) ||
+      snapshot->data.num_regions > MAX_REGIONS || snapshot->bss.num_regions > MAX_REGIONS ||
+      record.image_crc != calc_image_crc(record)) {
+    return false;
+  }
+  return true;
+}
+
+bool restore(const mfat_stat_t& stat, uint32_t& entry_address) {
+  // The record has been validated by is_intact(), but check that it is still there (it is cheap),
+  // and that the boot executable file has not changed.
+  const auto& record = stored_record();
+  if (record.magic != RECORD_MAGIC || record.record_crc != calc_record_crc(record) ||
+      record.file_size != stat.st_size || record.file_time_crc != calc_file_time_crc(stat)) {
+    return false;
+  }
+
+  // Restore the writable regions, and clear the BSS regions.
+  const auto* snapshot = reinterpret_cast<const snapshot_t*>(record.snapshot_addr);
+  const auto* src = reinterpret_cast<const uint8_t*>(&snapshot[1]);
+  for (uint32_t i = 0U; i < snapshot->data.num_regions; ++i) {
+    const auto& region = snapshot->data.regions[i];
+    rom_memcpy(reinterpret_cast<void*>(region.addr), src, region.size);
+    src += align4(region.size);
+  }
+  for (uint32_t i = 0U; i < snapshot->bss.num_regions; ++i) {
+    const auto& region = snapshot->bss.regions[i];
+    rom_memset(reinterpret_cast<void*>(region.addr), 0, region.size);
+  }
+
+  entry_address = record.entry_address;
+  return true;
+}
+
+void begin() {
+  stored_record().magic = 0U;
+
+  s_new_record.read_only.num_regions = 0U;
+  s_new_snapshot.data.num_regions = 0U;
+  s_new_snapshot.bss.num_regions = 0U;
+  s_new_record_ok = true;
+}
+
+void add_region(uint32_t addr, uint32_t size) {
+  add_to_list(s_new_record.read_only, addr, size);
+}
+
+void add_data_region(uint32_t addr, uint32_t size) {
+  add_to_list(s_new_snapshot.data, addr, size);
+}
+
+void add_bss_region(uint32_t addr, uint32_t size) {
+  add_to_list(s_new_snapshot.bss, addr, size);
+}
+
+void commit(const mfat_stat_t& stat, uint32_t entry_address) {
+  if (!s_new_record_ok) {
+    return;
+  }
+  s_new_record_ok = false;
+
+  // The snapshot is placed right after the image.
+  auto image_end = calc_end(s_new_record.read_only, 0U);
+  image_end = calc_end(s_new_snapshot.data, image_end);
+  image_end = calc_end(s_new_snapshot.bss, image_end);
+  const auto snapshot_addr = align4(image_end);
+  auto snapshot_size = static_cast<uint32_t>(sizeof(snapshot_t));
+  for (uint32_t i = 0U; i < s_new_snapshot.data.num_regions; ++i) {
+    snapshot_size += align4(s_new_snapshot.data.regions[i].size);
+  }
+  if (!is_free_ram(snapshot_addr, snapshot_size)) {
+    return;
+  }
+
+  // Save the initial contents of the writable regions (the program has not started yet).
+  auto* dst = reinterpret_cast<uint8_t*>(snapshot_addr);
+  rom_memcpy(dst, &s_new_snapshot, sizeof(snapshot_t));
+  dst += sizeof(snapshot_t);
+  for (uint32_t i = 0U; i < s_new_snapshot.data.num_regions; ++i) {
+    const auto& region = s_new_snapshot.data.regions[i];
+    rom_memcpy(dst, reinterpret_cast<const void*>(region.addr), region.size);
+    dst += align4(region.size);
+  }
+
+  s_new_record.magic = RECORD_MAGIC;
+  s_new_record.entry_address = entry_address;
+  s_new_record.file_size = stat.st_size;
+  s_new_record.file_time_crc = calc_file_time_crc(stat);
+  s_new_record.image_crc = calc_image_crc(s_new_record);
+  s_new_record.snapshot_addr = snapshot_addr;
+  s_new_record.snapshot_size = snapshot_size;
+  s_new_record.snapshot_crc = rom_crc32(reinterpret_cast<const void*>(snapshot_addr),
+                                        snapshot_size,
+                                        0U);
+  s_new_record.record_crc = calc_record_crc(s_new_record);
+  stored_record() = s_new_record;
+}
+
+}  // namespace warmboot
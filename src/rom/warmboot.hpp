@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2022 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+
+#ifndef MC1_WARMBOOT_H_
+#define MC1_WARMBOOT_H_
+
+#include <mc1/mfat_mc1.h>
+
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+// Warm boot support.
+//
+// When the boot executable is loaded, the memory regions that it occupies are recorded in a
+// reserved memory area that is not touched by the ROM (see link.ld), together with a CRC of the
+// read-only regions, the entry address, and the size and modification time of the file. A snapshot
+// of the initial contents of the writable sections (and the extents of the BSS sections) is stored
+// right after the image.
+//
+// After a soft reset the ROM checks that the record, the snapshot and the read-only regions are all
+// intact (i.e. the program has not overwritten them). If so, it mounts the SD card file system and
+// checks that the boot executable still has the same size and modification time (so that a new
+// boot executable is picked up). Only then does it restore the writable sections from the snapshot,
+// clear the BSS sections and start the executable directly, without reading the file. Otherwise
+// the executable is loaded from the SD card as usual.
+//--------------------------------------------------------------------------------------------------
+
+namespace warmboot {
+
+/// @brief Check if the image that was loaded the last time is still intact in memory.
+/// @returns true if the image can be restored (see restore()).
+bool is_intact();
+
+/// @brief Restore the image that was loaded the last time (is_intact() must have returned true).
+/// @param stat The current status of the boot executable file.
+/// @param[out] entry_address The start address of the program.
+/// @returns true if the image was restored and can be started, or false if the boot executable
+/// needs to be loaded (e.g. because the file has changed).
+bool restore(const mfat_stat_t& stat, uint32_t& entry_address);
+
+/// @brief Start recording a new image (this invalidates the current warm boot record).
+void begin();
+
+/// @brief Add a read-only memory region to the new record.
+/// @param addr The start address of the region.
+/// @param size The size of the region, in bytes.
+void add_region(uint32_t addr, uint32_t size);
+
+/// @brief Add a writable memory region to the new record (its contents are saved by commit()).
+/// @param addr The start address of the region.
+/// @param size The size of the region, in bytes.
+void add_data_region(uint32_t addr, uint32_t size);
+
+/// @brief Add a BSS memory region to the new record.
+/// @param addr The start address of the region.
+/// @param size The size of the region, in bytes.
+void add_bss_region(uint32_t addr, uint32_t size);
+
+/// @brief Store the new record (if any), after the image has been loaded successfully.
+/// @param stat The status of the boot executable file.
+/// @param entry_address The start address of the program.
+void commit(const mfat_stat_t& stat, uint32_t entry_address);
+
+}  // namespace warmboot
+
+#endif  // MC1_WARMBOOT_H_
@@ -227,6 +227,7 @@ begin
       LOG2_VRAM_SIZE => 18,          -- 2^18 = 256 KiB
       XRAM_SIZE => 2**26,            -- 2^26 = 64 MiB
       NUM_VIDEO_LAYERS => 2,
+      LOG2_PALETTE_BANKS => 2,       -- 4 palette banks per layer
       VIDEO_CONFIG => C_1920_1080
     )
     port map (
@@ -282,6 +283,7 @@ begin
       T_DESL => 200000.0,                   -- Can be lowered to 100 us?
       T_MRD => 14.0,
       T_RC => 60.0,
+      T_RAS => 42.0,
       T_RCD => 15.0,
       T_RP => 15.0,
       T_WR => 14.0,                         -- Same as t_DPL?
@@ -0,0 +1,122 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2019 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- This is a synchronization circuit for multi-bit signals that must never be seen in a partially
+-- updated state (e.g. a set of configuration registers that belong together).
+--
+-- The source value is captured in a hold register in the source clock domain, and a request toggle
+-- is sent to the target clock domain (via a two-flip-flop synchronizer). When the target clock
+-- domain sees the toggle, it copies the hold register (which is stable at that point) to the output
+-- and returns the toggle as an acknowledge. The hold register is not updated again until the
+-- acknowledge has been received, so all bits of the output are always updated together.
+--
+-- A new value is sent whenever the source value differs from the last sent value, so a value that
+-- changes every cycle is sampled once per round trip (a few cycles of each clock).
+----------------------------------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity handshake_synchronizer is
+  generic(
+    BITS : positive
+  );
+  port(
+    -- Source clock domain.
+    i_src_rst : in std_logic;
+    i_src_clk : in std_logic;
+    i_d : in std_logic_vector(BITS-1 downto 0);
+
+    -- Target clock domain.
+    i_rst : in std_logic;
+    i_clk : in std_logic;
+    o_q : out std_logic_vector(BITS-1 downto 0)
+  );
+end handshake_synchronizer;
+
+architecture rtl of handshake_synchronizer is
+  -- Source clock domain signals.
+  signal s_hold : std_logic_vector(BITS-1 downto 0);
+  signal s_req : std_logic;
+  signal s_ack_src : std_logic;
+
+  -- Target clock domain signals.
+  signal s_req_dst : std_logic;
+  signal s_ack : std_logic;
+  signal s_q : std_logic_vector(BITS-1 downto 0);
+
+  -- Intel/Altera specific constraints (the hold register is stable when it is captured).
+  attribute ALTERA_ATTRIBUTE : string;
+  attribute ALTERA_ATTRIBUTE of rtl : architecture is "-name SDC_STATEMENT ""set_false_path -from [get_registers {*|handshake_synchronizer:*|s_hold*}] -to [get_registers {*|handshake_synchronizer:*|s_q*}] """;
+begin
+  -- Source clock domain: Capture a new value and send a request when the previous request has been
+  -- acknowledged.
+  process(i_src_rst, i_src_clk)
+  begin
+    if i_src_rst = '1' then
+      s_hold <= (others => '0');
+      s_req <= '0';
+    elsif rising_edge(i_src_clk) then
+      if s_req = s_ack_src and i_d /= s_hold then
+        s_hold <= i_d;
+        s_req <= not s_req;
+      end if;
+    end if;
+  end process;
+
+  sync_ack: entity work.bit_synchronizer
+    generic map (
+      STEADY_CYCLES => 0
+    )
+    port map (
+      i_rst => i_src_rst,
+      i_clk => i_src_clk,
+      i_d => s_ack,
+      o_q => s_ack_src
+    );
+
+  -- Target clock domain: Copy the hold register when a new request arrives, and acknowledge it.
+  sync_req: entity work.bit_synchronizer
+    generic map (
+      STEADY_CYCLES => 0
+    )
+    port map (
+      i_rst => i_rst,
+      i_clk => i_clk,
+      i_d => s_req,
+      o_q => s_req_dst
+    );
+
+  process(i_rst, i_clk)
+  begin
+    if i_rst = '1' then
+      s_ack <= '0';
+      s_q <= (others => '0');
+    elsif rising_edge(i_clk) then
+      if s_req_dst /= s_ack then
+        s_q <= s_hold;
+        s_ack <= s_req_dst;
+      end if;
+    end if;
+  end process;
+
+  o_q <= s_q;
+end rtl;
@@ -0,0 +1,698 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- LZG decompression engine.
+--
+-- This is a Wishbone master that decompresses a complete LZG buffer (as produced by liblzg, header
+-- included) from a source address to a destination address without CPU intervention. Both
+-- addresses are byte addresses, and neither has to be word aligned. The input is read as 32-bit
+-- words (up to eight bytes past the end of the input may be read), and the output is written as
+-- 32-bit words with byte select.
+--
+-- Registers (see mmio.vhd for the addresses):
+--   LZGSRC (RW):   Source address (the start of the LZG header).
+--   LZGDST (RW):   Destination address.
+--   LZGCTRL (RW):  Writing a value with bit 0 set starts the decompression (ignored when BUSY).
+--   LZGSTAT (R):
+--     0:     BUSY (a decompression is in progress)
+--     1:     DONE (the last decompression has finished - cleared when a new one is started)
+--     2:     ERROR (bad header, corrupt data, checksum mismatch or a bus error)
+--     31:    Present (always set - reads as zero when the engine is not included)
+--
+-- Both LZG methods (COPY and LZG1) are supported. Literals and near copies (offset <= 8) produce
+-- one byte per cycle. Copies with an offset that fits in the internal history buffer produce one
+-- byte every two cycles, and longer copies read the source bytes back from the destination buffer
+-- (one bus read per source word). The checksum and the decoded size are checked at the end.
+----------------------------------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity lzgdec is
+  generic(
+    LOG2_HISTORY_SIZE : positive := 12  -- History buffer size (log2 of number of bytes, >= 5).
+  );
+  port(
+    i_rst : in std_logic;
+    i_clk : in std_logic;
+
+    -- Register interface.
+    i_src : in std_logic_vector(31 downto 0);
+    i_dst : in std_logic_vector(31 downto 0);
+    i_start : in std_logic;
+    o_stat : out std_logic_vector(31 downto 0);
+
+    -- Wishbone memory interface (b4 pipelined master).
+    o_wb_cyc : out std_logic;
+    o_wb_stb : out std_logic;
+    o_wb_adr : out std_logic_vector(29 downto 0);
+    o_wb_dat : out std_logic_vector(31 downto 0);
+    o_wb_we : out std_logic;
+    o_wb_sel : out std_logic_vector(3 downto 0);
+    i_wb_dat : in std_logic_vector(31 downto 0);
+    i_wb_ack : in std_logic;
+    i_wb_stall : in std_logic;
+    i_wb_err : in std_logic
+  );
+end lzgdec;
+
+architecture rtl of lzgdec is
+  constant C_HISTORY_SIZE : positive := 2**LOG2_HISTORY_SIZE;
+
+  -- Copies with an offset of at most C_NEAR_MAX bytes use a shift register with the most recent
+  -- output bytes, and copies with an offset of at most C_HISTORY_MAX bytes use the history buffer
+  -- (the margin guarantees that a byte is never overwritten while it may still be read).
+  constant C_NEAR_MAX : positive := 8;
+  constant C_HISTORY_MAX : positive := C_HISTORY_SIZE - 8;
+
+  -- LZG constants.
+  constant C_SHORT_OFFSET_BIAS : positive := 8;
+  constant C_MEDIUM_OFFSET_BIAS : positive := 8;
+  constant C_DISTANT_OFFSET_BIAS : positive := 2056;
+
+  type T_STATE is (
+    IDLE,
+    HEADER,
+    MARKERS,
+    SYMBOL,
+    MARKER_ARG,
+    DISTANT_B2,
+    DISTANT_B3,
+    MEDIUM_B2,
+    COPY_START,
+    COPY_NEAR,
+    COPY_HIST_WAIT,
+    COPY_HIST,
+    COPY_MEM,
+    LITERALS,
+    FINISH
+  );
+
+  type T_BUS_OP is (
+    NONE,
+    RD_INPUT,
+    RD_COPY,
+    WR_OUTPUT
+  );
+
+  type T_WORD_ARRAY is array (natural range <>) of std_logic_vector(31 downto 0);
+  type T_BYTE_ARRAY is array (natural range <>) of std_logic_vector(7 downto 0);
+
+  type T_LENGTH_LUT is array (0 to 31) of natural;
+  constant C_LENGTH_LUT : T_LENGTH_LUT := (
+      2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17,
+      18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 35, 48, 72, 128
+    );
+
+  -- Sequencer signals.
+  signal s_state : T_STATE;
+  signal s_hdr_idx : integer range 0 to 15;
+  signal s_dec_size : unsigned(31 downto 0);
+  signal s_in_left : unsigned(31 downto 0);
+  signal s_checksum : std_logic_vector(31 downto 0);
+  signal s_sum_a : unsigned(15 downto 0);
+  signal s_sum_b : unsigned(15 downto 0);
+  signal s_markers : T_BYTE_ARRAY(0 to 3);
+  signal s_symbol : std_logic_vector(7 downto 0);
+  signal s_marker : integer range 0 to 3;
+  signal s_arg : std_logic_vector(7 downto 0);
+  signal s_offset : unsigned(19 downto 0);
+  signal s_length : integer range 0 to 128;
+  signal s_busy : std_logic;
+  signal s_done : std_logic;
+  signal s_err : std_logic;
+
+  -- Input signals (a two word FIFO, where the first word holds the byte at s_src).
+  signal s_src : unsigned(31 downto 0);
+  signal s_fetch_adr : unsigned(29 downto 0);
+  signal s_in_buf : T_WORD_ARRAY(0 to 1);
+  signal s_in_count : integer range 0 to 2;
+
+  -- Output signals.
+  signal s_dst : unsigned(31 downto 0);
+  signal s_out_count : unsigned(31 downto 0);
+  signal s_out_word : std_logic_vector(31 downto 0);
+  signal s_out_sel : std_logic_vector(3 downto 0);
+  signal s_recent : T_BYTE_ARRAY(0 to C_NEAR_MAX-1);
+
+  -- Write buffer (one complete or final output word).
+  signal s_wr_pending : std_logic;
+  signal s_wr_adr : unsigned(29 downto 0);
+  signal s_wr_dat : std_logic_vector(31 downto 0);
+  signal s_wr_sel : std_logic_vector(3 downto 0);
+
+  -- Source word for long copies (read back from the destination buffer).
+  signal s_cp_req : std_logic;
+  signal s_cp_valid : std_logic;
+  signal s_cp_adr : unsigned(29 downto 0);
+  signal s_cp_word : std_logic_vector(31 downto 0);
+
+  -- History buffer signals.
+  signal s_history : T_BYTE_ARRAY(0 to C_HISTORY_SIZE-1);
+  signal s_hist_we : std_logic;
+  signal s_hist_wadr : unsigned(LOG2_HISTORY_SIZE-1 downto 0);
+  signal s_hist_wdat : std_logic_vector(7 downto 0);
+  signal s_hist_radr : unsigned(LOG2_HISTORY_SIZE-1 downto 0);
+  signal s_hist_q : std_logic_vector(7 downto 0);
+
+  -- Wishbone master signals.
+  signal s_bus_op : T_BUS_OP;
+  signal s_wb_cyc : std_logic;
+  signal s_wb_stb : std_logic;
+  signal s_wb_adr : unsigned(29 downto 0);
+  signal s_wb_dat : std_logic_vector(31 downto 0);
+  signal s_wb_we : std_logic;
+  signal s_wb_sel : std_logic_vector(3 downto 0);
+
+  function get_byte(word : std_logic_vector(31 downto 0);
+                    idx : unsigned(1 downto 0)) return std_logic_vector is
+    variable v_idx : integer range 0 to 3;
+  begin
+    v_idx := to_integer(idx);
+    return word(v_idx*8+7 downto v_idx*8);
+  end function;
+begin
+  assert LOG2_HISTORY_SIZE >= 5
+    report "The history buffer must be at least 32 bytes" severity error;
+
+  --------------------------------------------------------------------------------------------------
+  -- Sequencer and Wishbone master.
+  --
+  -- The Wishbone master has at most one request in flight. Writes go first, so reads from the
+  -- destination buffer always see the data that has been written so far.
+  --------------------------------------------------------------------------------------------------
+
+  process(i_clk, i_rst)
+    variable v_in_buf : T_WORD_ARRAY(0 to 1);
+    variable v_in_count : integer range 0 to 2;
+    variable v_wr_pending : std_logic;
+    variable v_wr_adr : unsigned(29 downto 0);
+    variable v_wr_dat : std_logic_vector(31 downto 0);
+    variable v_wr_sel : std_logic_vector(3 downto 0);
+    variable v_cp_req : std_logic;
+    variable v_cp_valid : std_logic;
+    variable v_cp_adr : unsigned(29 downto 0);
+    variable v_cp_word : std_logic_vector(31 downto 0);
+    variable v_bus_free : boolean;
+    variable v_err : boolean;
+    variable v_have_byte : boolean;
+    variable v_byte : std_logic_vector(7 downto 0);
+    variable v_consume : boolean;
+    variable v_can_emit : boolean;
+    variable v_emit : boolean;
+    variable v_emit_byte : std_logic_vector(7 downto 0);
+    variable v_out_word : std_logic_vector(31 downto 0);
+    variable v_out_sel : std_logic_vector(3 downto 0);
+    variable v_lane : integer range 0 to 3;
+    variable v_src_adr : unsigned(31 downto 0);
+    variable v_sum_a : unsigned(15 downto 0);
+  begin
+    if i_rst = '1' then
+      s_state <= IDLE;
+      s_hdr_idx <= 0;
+      s_dec_size <= (others => '0');
+      s_in_left <= (others => '0');
+      s_checksum <= (others => '0');
+      s_sum_a <= (others => '0');
+      s_sum_b <= (others => '0');
+      s_markers <= (others => (others => '0'));
+      s_symbol <= (others => '0');
+      s_marker <= 0;
+      s_arg <= (others => '0');
+      s_offset <= (others => '0');
+      s_length <= 0;
+      s_busy <= '0';
+      s_done <= '0';
+      s_err <= '0';
+      s_src <= (others => '0');
+      s_fetch_adr <= (others => '0');
+      s_in_buf <= (others => (others => '0'));
+      s_in_count <= 0;
+      s_dst <= (others => '0');
+      s_out_count <= (others => '0');
+      s_out_word <= (others => '0');
+      s_out_sel <= (others => '0');
+      s_recent <= (others => (others => '0'));
+      s_wr_pending <= '0';
+      s_wr_adr <= (others => '0');
+      s_wr_dat <= (others => '0');
+      s_wr_sel <= (others => '0');
+      s_cp_req <= '0';
+      s_cp_valid <= '0';
+      s_cp_adr <= (others => '0');
+      s_cp_word <= (others => '0');
+      s_hist_we <= '0';
+      s_hist_wadr <= (others => '0');
+      s_hist_wdat <= (others => '0');
+      s_hist_radr <= (others => '0');
+      s_bus_op <= NONE;
+      s_wb_cyc <= '0';
+      s_wb_stb <= '0';
+      s_wb_adr <= (others => '0');
+      s_wb_dat <= (others => '0');
+      s_wb_we <= '0';
+      s_wb_sel <= (others => '0');
+    elsif rising_edge(i_clk) then
+      v_in_buf := s_in_buf;
+      v_in_count := s_in_count;
+      v_wr_pending := s_wr_pending;
+      v_wr_adr := s_wr_adr;
+      v_wr_dat := s_wr_dat;
+      v_wr_sel := s_wr_sel;
+      v_cp_req := s_cp_req;
+      v_cp_valid := s_cp_valid;
+      v_cp_adr := s_cp_adr;
+      v_cp_word := s_cp_word;
+      v_err := false;
+      s_hist_we <= '0';
+
+      ----------------------------------------------------------------------------------------------
+      -- Complete the current bus request.
+      ----------------------------------------------------------------------------------------------
+
+      v_bus_free := s_bus_op = NONE;
+      if s_bus_op /= NONE then
+        if s_wb_stb = '1' and i_wb_stall = '0' then
+          s_wb_stb <= '0';
+        end if;
+        if i_wb_ack = '1' or i_wb_err = '1' then
+          case s_bus_op is
+            when RD_INPUT =>
+              v_in_buf(v_in_count) := i_wb_dat;
+              v_in_count := v_in_count + 1;
+            when RD_COPY =>
+              v_cp_word := i_wb_dat;
+              v_cp_valid := '1';
+              v_cp_req := '0';
+            when others =>
+              v_wr_pending := '0';
+          end case;
+          if i_wb_err = '1' then
+            v_err := true;
+          end if;
+          v_bus_free := true;
+        end if;
+      end if;
+
+      ----------------------------------------------------------------------------------------------
+      -- Decode.
+      ----------------------------------------------------------------------------------------------
+
+      -- The next input byte.
+      v_have_byte := v_in_count /= 0;
+      v_byte := get_byte(v_in_buf(0), s_src(1 downto 0));
+      v_consume := false;
+
+      -- The last byte of a word can only be output when the write buffer is free.
+      v_can_emit := s_dst(1 downto 0) /= "11" or v_wr_pending = '0';
+      v_emit := false;
+      v_emit_byte := v_byte;
+
+      case s_state is
+        when IDLE =>
+          if i_start = '1' then
+            s_src <= unsigned(i_src);
+            s_fetch_adr <= unsigned(i_src(31 downto 2));
+            v_in_count := 0;
+            s_dst <= unsigned(i_dst);
+            s_out_count <= (others => '0');
+            s_out_sel <= (others => '0');
+            v_cp_valid := '0';
+            s_sum_a <= to_unsigned(1, 16);
+            s_sum_b <= to_unsigned(0, 16);
+            s_hdr_idx <= 0;
+            s_busy <= '1';
+            s_done <= '0';
+            s_err <= '0';
+            s_state <= HEADER;
+          end if;
+
+        when HEADER =>
+          -- Magic ID ("LZG"), decoded size, encoded size, checksum and method.
+          if v_have_byte then
+            v_consume := true;
+            case s_hdr_idx is
+              when 0 =>
+                if v_byte /= x"4c" then
+                  v_err := true;
+                end if;
+              when 1 =>
+                if v_byte /= x"5a" then
+                  v_err := true;
+                end if;
+              when 2 =>
+                if v_byte /= x"47" then
+                  v_err := true;
+                end if;
+              when 3 to 6 =>
+                s_dec_size <= s_dec_size(23 downto 0) & unsigned(v_byte);
+              when 7 to 10 =>
+                s_in_left <= s_in_left(23 downto 0) & unsigned(v_byte);
+              when 11 to 14 =>
+                s_checksum <= s_checksum(23 downto 0) & v_byte;
+              when others =>
+                if v_byte = x"00" then
+                  s_state <= LITERALS;
+                elsif v_byte = x"01" then
+                  s_state <= MARKERS;
+                else
+                  v_err := true;
+                end if;
+            end case;
+            if s_hdr_idx = 15 then
+              s_hdr_idx <= 0;
+            else
+              s_hdr_idx <= s_hdr_idx + 1;
+            end if;
+          end if;
+
+        when MARKERS =>
+          if s_in_left = 0 then
+            v_err := true;
+          elsif v_have_byte then
+            v_consume := true;
+            s_markers <= s_markers(1 to 3) & v_byte;
+            if s_hdr_idx = 3 then
+              s_state <= SYMBOL;
+            else
+              s_hdr_idx <= s_hdr_idx + 1;
+            end if;
+          end if;
+
+        when SYMBOL =>
+          if s_in_left = 0 then
+            s_state <= FINISH;
+          elsif v_have_byte and v_can_emit then
+            v_consume := true;
+            s_symbol <= v_byte;
+            if v_byte = s_markers(0) then
+              s_marker <= 0;
+              s_state <= MARKER_ARG;
+            elsif v_byte = s_markers(1) then
+              s_marker <= 1;
+              s_state <= MARKER_ARG;
+            elsif v_byte = s_markers(2) then
+              s_marker <= 2;
+              s_state <= MARKER_ARG;
+            elsif v_byte = s_markers(3) then
+              s_marker <= 3;
+              s_state <= MARKER_ARG;
+            else
+              -- Literal.
+              v_emit := true;
+            end if;
+          end if;
+
+        when MARKER_ARG =>
+          if s_in_left = 0 then
+            v_err := true;
+          elsif v_have_byte and v_can_emit then
+            v_consume := true;
+            s_arg <= v_byte;
+            if v_byte = x"00" then
+              -- A single occurrence of a marker symbol.
+              v_emit := true;
+              v_emit_byte := s_symbol;
+              s_state <= SYMBOL;
+            else
+              case s_marker is
+                when 0 =>
+                  -- Distant copy.
+                  s_length <= C_LENGTH_LUT(to_integer(unsigned(v_byte(4 downto 0))));
+                  s_offset <= "0" & unsigned(v_byte(7 downto 5)) & x"0000";
+                  s_state <= DISTANT_B2;
+                when 1 =>
+                  -- Medium copy.
+                  s_length <= C_LENGTH_LUT(to_integer(unsigned(v_byte(4 downto 0))));
+                  s_state <= MEDIUM_B2;
+                when 2 =>
+                  -- Short copy.
+                  s_length <= to_integer(unsigned(v_byte(7 downto 6))) + 3;
+                  s_offset <= resize(unsigned(v_byte(5 downto 0)), 20) + C_SHORT_OFFSET_BIAS;
+                  s_state <= COPY_START;
+                when others =>
+                  -- Near copy (including RLE).
+                  s_length <= C_LENGTH_LUT(to_integer(unsigned(v_byte(4 downto 0))));
+                  s_offset <= resize(unsigned(v_byte(7 downto 5)), 20) + 1;
+                  s_state <= COPY_START;
+              end case;
+            end if;
+          end if;
+
+        when DISTANT_B2 =>
+          if s_in_left = 0 then
+            v_err := true;
+          elsif v_have_byte then
+            v_consume := true;
+            s_offset(15 downto 8) <= unsigned(v_byte);
+            s_state <= DISTANT_B3;
+          end if;
+
+        when DISTANT_B3 =>
+          if s_in_left = 0 then
+            v_err := true;
+          elsif v_have_byte then
+            v_consume := true;
+            s_offset <= (s_offset(19 downto 8) & unsigned(v_byte)) + C_DISTANT_OFFSET_BIAS;
+            s_state <= COPY_START;
+          end if;
+
+        when MEDIUM_B2 =>
+          if s_in_left = 0 then
+            v_err := true;
+          elsif v_have_byte then
+            v_consume := true;
+            s_offset <= resize(unsigned(s_arg(7 downto 5)) & unsigned(v_byte), 20) +
+                        C_MEDIUM_OFFSET_BIAS;
+            s_state <= COPY_START;
+          end if;
+
+        when COPY_START =>
+          if resize(s_offset, 32) > s_out_count then
+            -- The copy starts before the start of the output buffer.
+            v_err := true;
+          elsif s_offset <= C_NEAR_MAX then
+            s_state <= COPY_NEAR;
+          elsif s_offset <= C_HISTORY_MAX then
+            s_hist_radr <= s_dst(LOG2_HISTORY_SIZE-1 downto 0) -
+                           resize(s_offset, LOG2_HISTORY_SIZE);
+            s_state <= COPY_HIST_WAIT;
+          else
+            s_state <= COPY_MEM;
+          end if;
+
+        when COPY_NEAR =>
+          if v_can_emit then
+            v_emit := true;
+            v_emit_byte := s_recent(to_integer(s_offset) - 1);
+            s_length <= s_length - 1;
+            if s_length = 1 then
+              s_state <= SYMBOL;
+            end if;
+          end if;
+
+        when COPY_HIST_WAIT =>
+          -- Wait for the history buffer read.
+          s_state <= COPY_HIST;
+
+        when COPY_HIST =>
+          if v_can_emit then
+            v_emit := true;
+            v_emit_byte := s_hist_q;
+            s_hist_radr <= s_hist_radr + 1;
+            s_length <= s_length - 1;
+            if s_length = 1 then
+              s_state <= SYMBOL;
+            else
+              s_state <= COPY_HIST_WAIT;
+            end if;
+          end if;
+
+        when COPY_MEM =>
+          v_src_adr := s_dst - resize(s_offset, 32);
+          if v_cp_valid = '1' and v_cp_adr = v_src_adr(31 downto 2) then
+            if v_can_emit then
+              v_emit := true;
+              v_emit_byte := get_byte(v_cp_word, v_src_adr(1 downto 0));
+              s_length <= s_length - 1;
+              if s_length = 1 then
+                s_state <= SYMBOL;
+              end if;
+            end if;
+          elsif v_cp_req = '0' then
+            v_cp_req := '1';
+            v_cp_valid := '0';
+            v_cp_adr := v_src_adr(31 downto 2);
+          end if;
+
+        when LITERALS =>
+          -- Uncompressed data (the COPY method).
+          if s_in_left = 0 then
+            s_state <= FINISH;
+          elsif v_have_byte and v_can_emit then
+            v_consume := true;
+            v_emit := true;
+          end if;
+
+        when FINISH =>
+          if s_out_sel /= "0000" then
+            -- Write the final (partial) output word.
+            if v_wr_pending = '0' then
+              v_wr_pending := '1';
+              v_wr_adr := s_dst(31 downto 2);
+              v_wr_dat := s_out_word;
+              v_wr_sel := s_out_sel;
+              s_out_sel <= (others => '0');
+            end if;
+          elsif v_wr_pending = '0' and v_cp_req = '0' and v_bus_free then
+            if s_out_count /= s_dec_size or
+               std_logic_vector(s_sum_b & s_sum_a) /= s_checksum then
+              s_err <= '1';
+            end if;
+            s_busy <= '0';
+            s_done <= '1';
+            s_state <= IDLE;
+          end if;
+      end case;
+
+      -- Consume the input byte.
+      if v_consume then
+        if s_src(1 downto 0) = "11" then
+          v_in_buf(0) := v_in_buf(1);
+          v_in_count := v_in_count - 1;
+        end if;
+        s_src <= s_src + 1;
+        if s_state /= HEADER then
+          -- Count the encoded bytes, and update the checksum.
+          s_in_left <= s_in_left - 1;
+          v_sum_a := s_sum_a + unsigned(v_byte);
+          s_sum_a <= v_sum_a;
+          s_sum_b <= s_sum_b + v_sum_a;
+        end if;
+      end if;
+
+      -- Output a byte.
+      if v_emit then
+        if s_out_count = s_dec_size then
+          -- The data does not fit in the decoded size given by the header.
+          v_err := true;
+        else
+          v_lane := to_integer(s_dst(1 downto 0));
+          v_out_word := s_out_word;
+          v_out_sel := s_out_sel;
+          v_out_word(v_lane*8+7 downto v_lane*8) := v_emit_byte;
+          v_out_sel(v_lane) := '1';
+          if v_lane = 3 then
+            v_wr_pending := '1';
+            v_wr_adr := s_dst(31 downto 2);
+            v_wr_dat := v_out_word;
+            v_wr_sel := v_out_sel;
+            v_out_sel := "0000";
+          end if;
+          s_out_word <= v_out_word;
+          s_out_sel <= v_out_sel;
+          s_recent <= v_emit_byte & s_recent(0 to C_NEAR_MAX-2);
+          s_hist_we <= '1';
+          s_hist_wadr <= s_dst(LOG2_HISTORY_SIZE-1 downto 0);
+          s_hist_wdat <= v_emit_byte;
+          s_dst <= s_dst + 1;
+          s_out_count <= s_out_count + 1;
+        end if;
+      end if;
+
+      -- Stop on errors (FINISH waits for the bus and writes the data that has been decoded so far).
+      if v_err then
+        s_err <= '1';
+        s_state <= FINISH;
+      end if;
+
+      ----------------------------------------------------------------------------------------------
+      -- Start the next bus request.
+      ----------------------------------------------------------------------------------------------
+
+      if v_bus_free then
+        if v_wr_pending = '1' then
+          s_bus_op <= WR_OUTPUT;
+          s_wb_cyc <= '1';
+          s_wb_stb <= '1';
+          s_wb_adr <= v_wr_adr;
+          s_wb_dat <= v_wr_dat;
+          s_wb_we <= '1';
+          s_wb_sel <= v_wr_sel;
+        elsif v_cp_req = '1' then
+          s_bus_op <= RD_COPY;
+          s_wb_cyc <= '1';
+          s_wb_stb <= '1';
+          s_wb_adr <= v_cp_adr;
+          s_wb_we <= '0';
+          s_wb_sel <= (others => '1');
+        elsif s_state /= IDLE and s_state /= FINISH and not v_err and v_in_count < 2 then
+          s_bus_op <= RD_INPUT;
+          s_wb_cyc <= '1';
+          s_wb_stb <= '1';
+          s_wb_adr <= s_fetch_adr;
+          s_wb_we <= '0';
+          s_wb_sel <= (others => '1');
+          s_fetch_adr <= s_fetch_adr + 1;
+        else
+          s_bus_op <= NONE;
+          s_wb_cyc <= '0';
+          s_wb_stb <= '0';
+        end if;
+      end if;
+
+      s_in_buf <= v_in_buf;
+      s_in_count <= v_in_count;
+      s_wr_pending <= v_wr_pending;
+      s_wr_adr <= v_wr_adr;
+      s_wr_dat <= v_wr_dat;
+      s_wr_sel <= v_wr_sel;
+      s_cp_req <= v_cp_req;
+      s_cp_valid <= v_cp_valid;
+      s_cp_adr <= v_cp_adr;
+      s_cp_word <= v_cp_word;
+    end if;
+  end process;
+
+  o_wb_cyc <= s_wb_cyc;
+  o_wb_stb <= s_wb_stb;
+  o_wb_adr <= std_logic_vector(s_wb_adr);
+  o_wb_dat <= s_wb_dat;
+  o_wb_we <= s_wb_we;
+  o_wb_sel <= s_wb_sel;
+
+  o_stat <= "1" & x"000000" & "0000" & s_err & s_done & s_busy;
+
+
+  --------------------------------------------------------------------------------------------------
+  -- History buffer (the last C_HISTORY_SIZE output bytes).
+  --------------------------------------------------------------------------------------------------
+
+  process(i_clk)
+  begin
+    if rising_edge(i_clk) then
+      if s_hist_we = '1' then
+        s_history(to_integer(s_hist_wadr)) <= s_hist_wdat;
+      end if;
+      s_hist_q <= s_history(to_integer(s_hist_radr));
+    end if;
+  end process;
+end rtl;
@@ -23,6 +23,7 @@
 
 library ieee;
 use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
 library mrisc32;
 use mrisc32.config.all;
 use mrisc32.debug.all;
@@ -32,14 +33,22 @@ use work.vid_types.all;
 entity mc1 is
   generic(
     -- Note: Be sure to pass in values that are suitable for your target platform.
-    CPU_CLK_HZ : positive;            -- CPU clock frequency, in Hz.
-    COLOR_BITS_R : positive := 8;     -- Set this to < 8 to enable dithering.
-    COLOR_BITS_G : positive := 8;     -- Set this to < 8 to enable dithering.
-    COLOR_BITS_B : positive := 8;     -- Set this to < 8 to enable dithering.
-    LOG2_VRAM_SIZE : natural := 14;   -- VRAM size (log2 of number of bytes).
-    XRAM_SIZE : natural := 0;         -- XRAM size (number of bytes).
-    NUM_VIDEO_LAYERS : positive := 2; -- Number of video layers (1 or 2).
-    VIDEO_CONFIG : T_VIDEO_CONFIG     -- Native video resolution.
+    CPU_CLK_HZ : positive;                -- CPU clock frequency, in Hz.
+    COLOR_BITS_R : positive := 8;         -- Set this to < 8 to enable dithering.
+    COLOR_BITS_G : positive := 8;         -- Set this to < 8 to enable dithering.
+    COLOR_BITS_B : positive := 8;         -- Set this to < 8 to enable dithering.
+    LOG2_VRAM_SIZE : natural := 14;       -- VRAM size (log2 of number of bytes).
+    XRAM_SIZE : natural := 0;             -- XRAM size (number of bytes).
+    NUM_VIDEO_LAYERS : positive := 2;     -- Number of video layers (1 to 4).
+    LOG2_PALETTE_BANKS : natural := 0;    -- Number of palette banks per layer (log2).
+    LOG2_VIDEO_PORT_WORDS : natural := 0; -- Width of the VRAM video read port (log2 of words).
+    VIDEO_PIXEL_ADDR_STAGES : natural := 0;   -- Extra pixel address pipeline stages (for Fmax).
+    VIDEO_PIXEL_SHIFT_STAGES : natural := 0;  -- Extra pixel shift pipeline stages (for Fmax).
+    VIDEO_BLEND_MUL_STAGES : natural := 0;    -- Extra layer blend pipeline stages (for Fmax).
+    VIDEO_SPRITE : boolean := false;          -- Hardware sprite (e.g. a mouse pointer).
+    VIDEO_TILE_MODE : boolean := false;       -- Tile mode (CMODE 6) in the top video layer.
+    LZG_ENGINE : boolean := false;            -- Hardware LZG decompression engine.
+    VIDEO_CONFIG : T_VIDEO_CONFIG         -- Native video resolution.
   );
   port(
     -- CPU interface.
@@ -107,6 +116,32 @@ architecture rtl of mc1 is
   signal s_cpud_stall : std_logic;
   signal s_cpud_err : std_logic;
 
+  -- LZG engine memory interface (Wishbone B4 pipelined master).
+  signal s_lzg_cyc : std_logic;
+  signal s_lzg_stb : std_logic;
+  signal s_lzg_adr : std_logic_vector(29 downto 0);
+  signal s_lzg_dat_w : std_logic_vector(31 downto 0);
+  signal s_lzg_we : std_logic;
+  signal s_lzg_sel : std_logic_vector(3 downto 0);
+  signal s_lzg_dat : std_logic_vector(31 downto 0);
+  signal s_lzg_ack : std_logic;
+  signal s_lzg_stall : std_logic;
+  signal s_lzg_err : std_logic;
+  signal s_lzg_start : std_logic;
+  signal s_lzg_stat : std_logic_vector(31 downto 0);
+
+  -- Data master interface of the crossbar (CPU data, optionally shared with the LZG engine).
+  signal s_memd_cyc : std_logic;
+  signal s_memd_stb : std_logic;
+  signal s_memd_adr : std_logic_vector(29 downto 0);
+  signal s_memd_dat_w : std_logic_vector(31 downto 0);
+  signal s_memd_we : std_logic;
+  signal s_memd_sel : std_logic_vector(3 downto 0);
+  signal s_memd_dat : std_logic_vector(31 downto 0);
+  signal s_memd_ack : std_logic;
+  signal s_memd_stall : std_logic;
+  signal s_memd_err : std_logic;
+
   -- ROM memory interface (Wishbone B4 pipelined slave).
   signal s_rom_cyc : std_logic;
   signal s_rom_stb : std_logic;
@@ -139,14 +174,20 @@ architecture rtl of mc1 is
   signal s_io_ack : std_logic;
   signal s_io_stall : std_logic;
   signal s_io_err : std_logic;
+  signal s_io_regs_w : T_MMIO_REGS_WO;
 
   -- Video logic signals.
-  signal s_video_adr : std_logic_vector(LOG2_VRAM_SIZE-3 downto 0);
-  signal s_video_dat : std_logic_vector(31 downto 0);
+  signal s_video_adr : std_logic_vector(LOG2_VRAM_SIZE-3-LOG2_VIDEO_PORT_WORDS downto 0);
+  signal s_video_dat : std_logic_vector(32*(2**LOG2_VIDEO_PORT_WORDS)-1 downto 0);
   signal s_raster_y : std_logic_vector(15 downto 0);
+  signal s_layer_underrun : std_logic_vector(C_VID_MAX_LAYERS-1 downto 0);
+  signal s_sprite_cfg : std_logic_vector(56 downto 0);
 
   -- Video logic signals in the CPU clock domain.
   signal s_raster_y_cpu : std_logic_vector(15 downto 0);
+  signal s_layer_underrun_cpu : std_logic_vector(C_VID_MAX_LAYERS-1 downto 0);
+  signal s_vidstat_cpu : std_logic_vector(31 downto 0);
+  signal s_sprite_cfg_cpu : std_logic_vector(56 downto 0);
 begin
   --------------------------------------------------------------------------------------------------
   -- CPU core
@@ -193,8 +234,95 @@ begin
   -- Wishbone memory subsystem
   --------------------------------------------------------------------------------------------------
 
-  -- This 2 x 4 crossbar connects the CPU instruction and data ports to the four Wishbone slaves
-  -- (ROM, VRAM, XRAM, MMIO).
+  -- When the LZG engine is included, it shares the data master port of the crossbar with the CPU
+  -- data port.
+  LzgGen: if LZG_ENGINE generate
+  begin
+    lzg_arbiter_1: entity work.wb_arbiter_2x1
+      generic map (
+        ADR_WIDTH => 30,
+        DAT_WIDTH => 32,
+        GRANULARITY => 8
+      )
+      port map (
+        i_rst => i_cpu_rst,
+        i_clk => i_cpu_clk,
+
+        -- Master interface A: CPU data.
+        i_adr_a => s_cpud_adr,
+        i_dat_a => s_cpud_dat_w,
+        i_we_a => s_cpud_we,
+        i_sel_a => s_cpud_sel,
+        i_cyc_a => s_cpud_cyc,
+        i_stb_a => s_cpud_stb,
+        o_dat_a => s_cpud_dat,
+        o_ack_a => s_cpud_ack,
+        o_stall_a => s_cpud_stall,
+        o_err_a => s_cpud_err,
+
+        -- Master interface B: LZG engine.
+        i_adr_b => s_lzg_adr,
+        i_dat_b => s_lzg_dat_w,
+        i_we_b => s_lzg_we,
+        i_sel_b => s_lzg_sel,
+        i_cyc_b => s_lzg_cyc,
+        i_stb_b => s_lzg_stb,
+        o_dat_b => s_lzg_dat,
+        o_ack_b => s_lzg_ack,
+        o_stall_b => s_lzg_stall,
+        o_err_b => s_lzg_err,
+
+        -- Slave interface: Crossbar master interface A.
+        o_adr => s_memd_adr,
+        o_dat => s_memd_dat_w,
+        o_we => s_memd_we,
+        o_sel => s_memd_sel,
+        o_cyc => s_memd_cyc,
+        o_stb => s_memd_stb,
+        i_dat => s_memd_dat,
+        i_ack => s_memd_ack,
+        i_stall => s_memd_stall,
+        i_err => s_memd_err
+      );
+
+    lzgdec_1: entity work.lzgdec
+      port map (
+        i_rst => i_cpu_rst,
+        i_clk => i_cpu_clk,
+
+        i_src => s_io_regs_w.LZGSRC,
+        i_dst => s_io_regs_w.LZGDST,
+        i_start => s_lzg_start,
+        o_stat => s_lzg_stat,
+
+        o_wb_cyc => s_lzg_cyc,
+        o_wb_stb => s_lzg_stb,
+        o_wb_adr => s_lzg_adr,
+        o_wb_dat => s_lzg_dat_w,
+        o_wb_we => s_lzg_we,
+        o_wb_sel => s_lzg_sel,
+        i_wb_dat => s_lzg_dat,
+        i_wb_ack => s_lzg_ack,
+        i_wb_stall => s_lzg_stall,
+        i_wb_err => s_lzg_err
+      );
+  else generate
+    s_memd_cyc <= s_cpud_cyc;
+    s_memd_stb <= s_cpud_stb;
+    s_memd_adr <= s_cpud_adr;
+    s_memd_dat_w <= s_cpud_dat_w;
+    s_memd_we <= s_cpud_we;
+    s_memd_sel <= s_cpud_sel;
+    s_cpud_dat <= s_memd_dat;
+    s_cpud_ack <= s_memd_ack;
+    s_cpud_stall <= s_memd_stall;
+    s_cpud_err <= s_memd_err;
+
+    s_lzg_stat <= (others => '0');
+  end generate;
+
+  -- This 2 x 4 crossbar connects the CPU instruction and data ports (and the LZG engine) to the
+  -- four Wishbone slaves (ROM, VRAM, XRAM, MMIO).
   memory_crossbar_1: entity work.wb_crossbar_2x4
     generic map (
       ADR_WIDTH => 30,
@@ -205,19 +333,19 @@ begin
       i_rst => i_cpu_rst,
       i_clk => i_cpu_clk,
 
-      -- Master interface A: CPU data.
+      -- Master interface A: CPU data (and the LZG engine).
       -- This interface has precedence over interface B, and we want the data port to have
       -- precedence.
-      i_cyc_a => s_cpud_cyc,
-      i_stb_a => s_cpud_stb,
-      i_adr_a => s_cpud_adr,
-      i_dat_a => s_cpud_dat_w,
-      i_we_a => s_cpud_we,
-      i_sel_a => s_cpud_sel,
-      o_dat_a => s_cpud_dat,
-      o_ack_a => s_cpud_ack,
-      o_stall_a => s_cpud_stall,
-      o_err_a => s_cpud_err,
+      i_cyc_a => s_memd_cyc,
+      i_stb_a => s_memd_stb,
+      i_adr_a => s_memd_adr,
+      i_dat_a => s_memd_dat_w,
+      i_we_a => s_memd_we,
+      i_sel_a => s_memd_sel,
+      o_dat_a => s_memd_dat,
+      o_ack_a => s_memd_ack,
+      o_stall_a => s_memd_stall,
+      o_err_a => s_memd_err,
 
       -- Master interface B: CPU instruction.
       i_cyc_b => s_cpui_cyc,
@@ -298,7 +426,8 @@ begin
   -- Internal VRAM.
   vram_1: entity work.vram
     generic map (
-      ADR_BITS => LOG2_VRAM_SIZE-2
+      ADR_BITS => LOG2_VRAM_SIZE-2,
+      LOG2_READ_WORDS => LOG2_VIDEO_PORT_WORDS
     )
     port map (
       i_rst => i_cpu_rst,
@@ -347,6 +476,7 @@ begin
       o_wb_err => s_io_err,
 
       i_raster_y => s_raster_y_cpu,
+      i_vidstat => s_vidstat_cpu,
       i_switches => i_io_switches,
       i_buttons => i_io_buttons,
       i_kb_scancode => i_io_kb_scancode,
@@ -355,10 +485,38 @@ begin
       i_mousepos => i_io_mousepos,
       i_mousebtns => i_io_mousebtns,
       i_sdin => i_io_sdin,
+      i_lzgstat => s_lzg_stat,
+
+      o_regs_w => s_io_regs_w,
 
-      o_regs_w => o_io_regs_w
+      o_lzg_start => s_lzg_start
     );
 
+  o_io_regs_w <= s_io_regs_w;
+
+  -- Hardware sprite configuration: enable (bit 56), bitmap address (bits 55..32), x (bits 31..16)
+  -- and y (bits 15..0). When the sprite follows the mouse, SPRPOS is relative to MOUSEPOS (e.g. the
+  -- negated hot spot of a mouse pointer).
+  process(i_cpu_clk, i_cpu_rst)
+    variable v_x : signed(15 downto 0);
+    variable v_y : signed(15 downto 0);
+  begin
+    if i_cpu_rst = '1' then
+      s_sprite_cfg_cpu <= (others => '0');
+    elsif rising_edge(i_cpu_clk) then
+      v_x := signed(s_io_regs_w.SPRPOS(31 downto 16));
+      v_y := signed(s_io_regs_w.SPRPOS(15 downto 0));
+      if s_io_regs_w.SPRCTRL(1) = '1' then
+        v_x := v_x + signed(i_io_mousepos(31 downto 16));
+        v_y := v_y + signed(i_io_mousepos(15 downto 0));
+      end if;
+      s_sprite_cfg_cpu <= s_io_regs_w.SPRCTRL(0) &
+                          s_io_regs_w.SPRADDR(23 downto 0) &
+                          std_logic_vector(v_x) &
+                          std_logic_vector(v_y);
+    end if;
+  end process;
+
 
   --------------------------------------------------------------------------------------------------
   -- Video logic
@@ -370,6 +528,13 @@ begin
       COLOR_BITS_B => COLOR_BITS_B,
       ADR_BITS => LOG2_VRAM_SIZE-2,
       NUM_LAYERS => NUM_VIDEO_LAYERS,
+      LOG2_PALETTE_BANKS => LOG2_PALETTE_BANKS,
+      LOG2_READ_WORDS => LOG2_VIDEO_PORT_WORDS,
+      PIXEL_ADDR_STAGES => VIDEO_PIXEL_ADDR_STAGES,
+      PIXEL_SHIFT_STAGES => VIDEO_PIXEL_SHIFT_STAGES,
+      BLEND_MUL_STAGES => VIDEO_BLEND_MUL_STAGES,
+      ENABLE_SPRITE => VIDEO_SPRITE,
+      ENABLE_TILE_MODE => VIDEO_TILE_MODE,
       VIDEO_CONFIG => VIDEO_CONFIG
     )
     port map (
@@ -379,6 +544,11 @@ begin
       o_read_adr => s_video_adr,
       i_read_dat => s_video_dat,
 
+      i_sprite_enable => s_sprite_cfg(56),
+      i_sprite_addr => s_sprite_cfg(55 downto 32),
+      i_sprite_xpos => s_sprite_cfg(31 downto 16),
+      i_sprite_ypos => s_sprite_cfg(15 downto 0),
+
       o_r => o_vga_r,
       o_g => o_vga_g,
       o_b => o_vga_b,
@@ -386,7 +556,8 @@ begin
       o_hsync => o_vga_hs,
       o_vsync => o_vga_vs,
 
-      o_raster_y => s_raster_y
+      o_raster_y => s_raster_y,
+      o_layer_underrun => s_layer_underrun
     );
 
 
@@ -397,8 +568,8 @@ begin
   -- these two domains are independent of each other since most communication between the two
   -- happens via the dual-ported, dual-clocked VRAM.
   --
-  -- In rare occasions we need to send signals from the video domain to the CPU domain, but we try
-  -- to keep the number of signals that need to cross clock domains to a minimum.
+  -- In rare occasions we need to send signals between the video domain and the CPU domain, but we
+  -- try to keep the number of signals that need to cross clock domains to a minimum.
   --------------------------------------------------------------------------------------------------
 
   -- The raster Y coordinate is exposed as an MMIO register, and needs to cross from the video
@@ -414,4 +585,43 @@ begin
       o_q => s_raster_y_cpu
     );
 
+  -- The line FIFO underrun flags are exposed in the VIDSTAT MMIO register (they only change once
+  -- per frame), together with the (constant) video layer configuration.
+  sync_layer_underrun: entity work.synchronizer
+    generic map (
+      BITS => s_layer_underrun'length
+    )
+    port map (
+      i_rst => i_cpu_rst,
+      i_clk => i_cpu_clk,
+      i_d => s_layer_underrun,
+      o_q => s_layer_underrun_cpu
+    );
+  s_vidstat_cpu(31) <= '1' when VIDEO_TILE_MODE else '0';
+  s_vidstat_cpu(30 downto 12) <= (others => '0');
+  s_vidstat_cpu(11 downto 8) <= std_logic_vector(to_unsigned(NUM_VIDEO_LAYERS, 4));
+  s_vidstat_cpu(7 downto s_layer_underrun_cpu'length) <= (others => '0');
+  s_vidstat_cpu(s_layer_underrun_cpu'left downto 0) <= s_layer_underrun_cpu;
+
+  -- The sprite configuration is written by the CPU, and needs to cross from the CPU clock domain
+  -- to the video clock domain. The fields belong together (e.g. x and y change together when the
+  -- mouse moves), so all bits must be updated at the same time in the video clock domain.
+  SpriteSyncGen: if VIDEO_SPRITE generate
+  begin
+    sync_sprite_cfg: entity work.handshake_synchronizer
+      generic map (
+        BITS => s_sprite_cfg'length
+      )
+      port map (
+        i_src_rst => i_cpu_rst,
+        i_src_clk => i_cpu_clk,
+        i_d => s_sprite_cfg_cpu,
+        i_rst => i_vga_rst,
+        i_clk => i_vga_clk,
+        o_q => s_sprite_cfg
+      );
+  else generate
+    s_sprite_cfg <= (others => '0');
+  end generate;
+
 end rtl;
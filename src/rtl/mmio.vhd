@@ -54,6 +54,7 @@ entity mmio is
 
     -- Some intput registers are collected externally.
     i_raster_y : in std_logic_vector(15 downto 0);
+    i_vidstat : in std_logic_vector(31 downto 0);
     i_switches : in std_logic_vector(31 downto 0);
     i_buttons : in std_logic_vector(31 downto 0);
     i_kb_scancode : in std_logic_vector(8 downto 0);
@@ -62,9 +63,13 @@ entity mmio is
     i_mousepos : in std_logic_vector(31 downto 0);
     i_mousebtns : in std_logic_vector(31 downto 0);
     i_sdin : in std_logic_vector(31 downto 0);
+    i_lzgstat : in std_logic_vector(31 downto 0);
 
     -- All output registers are exported externally.
-    o_regs_w: out T_MMIO_REGS_WO
+    o_regs_w: out T_MMIO_REGS_WO;
+
+    -- Write strobe for starting the LZG engine.
+    o_lzg_start : out std_logic
   );
 end mmio;
 
@@ -106,8 +111,23 @@ architecture rtl of mmio is
   constant C_ADR_LEDS       : T_REG_ADR := reg_adr(24);
   constant C_ADR_SDOUT      : T_REG_ADR := reg_adr(25);
   constant C_ADR_SDWE       : T_REG_ADR := reg_adr(26);
+  constant C_ADR_SDCTRL     : T_REG_ADR := reg_adr(27);
+  constant C_ADR_SDDATA     : T_REG_ADR := reg_adr(28);
+  constant C_ADR_SDBLK      : T_REG_ADR := reg_adr(29);
+  constant C_ADR_SDSTAT     : T_REG_ADR := reg_adr(30);
+  constant C_ADR_SDFIFO     : T_REG_ADR := reg_adr(31);
+
+  constant C_ADR_KEYBUF     : T_REG_ADR := reg_adr(32);  -- 32..47
+
+  constant C_ADR_SPRADDR    : T_REG_ADR := reg_adr(48);
+  constant C_ADR_SPRPOS     : T_REG_ADR := reg_adr(49);
+  constant C_ADR_SPRCTRL    : T_REG_ADR := reg_adr(50);
+  constant C_ADR_VIDSTAT    : T_REG_ADR := reg_adr(51);
 
-  constant C_ADR_KEYBUF     : T_REG_ADR := reg_adr(32);
+  constant C_ADR_LZGSRC     : T_REG_ADR := reg_adr(52);
+  constant C_ADR_LZGDST     : T_REG_ADR := reg_adr(53);
+  constant C_ADR_LZGCTRL    : T_REG_ADR := reg_adr(54);
+  constant C_ADR_LZGSTAT    : T_REG_ADR := reg_adr(55);
 
   -- Keyboard events are stored in a circular buffer.
   constant C_LOG2_KEY_BUF_SIZE : integer := 4;
@@ -134,6 +154,15 @@ architecture rtl of mmio is
   -- Keyboard input circular buffer.
   signal s_key_buf : T_KEY_BUF;
 
+  -- SD SPI engine signals.
+  signal s_sd_data_we : std_logic;
+  signal s_sd_blk_we : std_logic;
+  signal s_sd_fifo_we : std_logic;
+  signal s_sd_fifo_re : std_logic;
+  signal s_sd_sck : std_logic;
+  signal s_sd_mosi : std_logic;
+  signal s_sd_cs_n : std_logic;
+
   function sign_ext_raster(x : std_logic_vector) return std_logic_vector is
     variable v_ext : std_logic_vector(31 downto 0);
   begin
@@ -146,6 +175,25 @@ architecture rtl of mmio is
     return v_ext;
   end function;
 
+  -- When the SD SPI engine is enabled, it drives the SD card CLK, CMD/MOSI and DAT3/CS* pins.
+  function with_sdspi_pins(regs : T_MMIO_REGS_WO;
+                           sck : std_logic;
+                           mosi : std_logic;
+                           cs_n : std_logic) return T_MMIO_REGS_WO is
+    variable v_regs : T_MMIO_REGS_WO;
+  begin
+    v_regs := regs;
+    if regs.SDCTRL(0) = '1' then
+      v_regs.SDOUT(3) := cs_n;
+      v_regs.SDOUT(4) := mosi;
+      v_regs.SDOUT(5) := sck;
+      v_regs.SDWE(0) := '0';
+      v_regs.SDWE(3) := '1';
+      v_regs.SDWE(4) := '1';
+    end if;
+    return v_regs;
+  end function;
+
   function reg_adr_to_key_buf_adr(x : T_REG_ADR) return T_KEY_BUF_ADR is
   begin
     -- NOTE: This is a simplification that works since C_ADR_KEYBUF is
@@ -197,11 +245,33 @@ begin
 
   -- Dynamic read-only registers from external sources.
   s_regs_r.VIDY <= sign_ext_raster(i_raster_y);
+  s_regs_r.VIDSTAT <= i_vidstat;
   s_regs_r.SWITCHES <= i_switches;
   s_regs_r.BUTTONS <= i_buttons;
   s_regs_r.MOUSEPOS <= i_mousepos;
   s_regs_r.MOUSEBTNS <= i_mousebtns;
   s_regs_r.SDIN <= i_sdin;
+  s_regs_r.LZGSTAT <= i_lzgstat;
+
+  -- SD card SPI engine.
+  sdspi_1: entity work.sdspi
+    port map (
+      i_rst => i_rst,
+      i_clk => i_wb_clk,
+      i_ctrl => s_regs_w.SDCTRL,
+      i_wdata => i_wb_dat,
+      i_data_we => s_sd_data_we,
+      i_blk_we => s_sd_blk_we,
+      i_fifo_we => s_sd_fifo_we,
+      i_fifo_re => s_sd_fifo_re,
+      o_data => s_regs_r.SDDATA,
+      o_stat => s_regs_r.SDSTAT,
+      o_fifo => s_regs_r.SDFIFO,
+      o_sck => s_sd_sck,
+      o_mosi => s_sd_mosi,
+      o_cs_n => s_sd_cs_n,
+      i_miso => i_sdin(0)
+    );
 
   -- Key event circular buffer.
   process(i_rst, i_wb_clk)
@@ -240,6 +310,16 @@ begin
   o_wb_err <= '0';
   o_wb_stall <= '0';
 
+  -- Some SD SPI engine registers trigger actions when they are accessed.
+  s_sd_data_we <= '1' when s_we = '1' and s_reg_adr = C_ADR_SDDATA else '0';
+  s_sd_blk_we <= '1' when s_we = '1' and s_reg_adr = C_ADR_SDBLK else '0';
+  s_sd_fifo_we <= '1' when s_we = '1' and s_reg_adr = C_ADR_SDFIFO else '0';
+  s_sd_fifo_re <= '1' when s_request = '1' and i_wb_we = '0' and s_reg_adr = C_ADR_SDFIFO else
+                  '0';
+
+  -- Writing to LZGCTRL with bit 0 set starts the LZG engine.
+  o_lzg_start <= '1' when s_we = '1' and s_reg_adr = C_ADR_LZGCTRL and i_wb_dat(0) = '1' else '0';
+
   process(i_rst, i_wb_clk)
     variable v_key_event : T_KEY_EVENT;
   begin
@@ -256,6 +336,14 @@ begin
       s_regs_w.LEDS <= (others => '0');
       s_regs_w.SDOUT <= (others => '0');
       s_regs_w.SDWE <= (others => '0');
+      s_regs_w.SDCTRL <= (others => '0');
+      s_regs_w.SDBLK <= (others => '0');
+      s_regs_w.SPRADDR <= (others => '0');
+      s_regs_w.SPRPOS <= (others => '0');
+      s_regs_w.SPRCTRL <= (others => '0');
+      s_regs_w.LZGSRC <= (others => '0');
+      s_regs_w.LZGDST <= (others => '0');
+      s_regs_w.LZGCTRL <= (others => '0');
     elsif rising_edge(i_wb_clk) then
       -- All registers are readable.
       if s_reg_adr = C_ADR_CLKCNTLO then
@@ -312,7 +400,33 @@ begin
         o_wb_dat <= s_regs_w.SDOUT;
       elsif s_reg_adr = C_ADR_SDWE then
         o_wb_dat <= s_regs_w.SDWE;
-      elsif s_reg_adr >= C_ADR_KEYBUF then
+      elsif s_reg_adr = C_ADR_SDCTRL then
+        o_wb_dat <= s_regs_w.SDCTRL;
+      elsif s_reg_adr = C_ADR_SDDATA then
+        o_wb_dat <= s_regs_r.SDDATA;
+      elsif s_reg_adr = C_ADR_SDBLK then
+        o_wb_dat <= s_regs_w.SDBLK;
+      elsif s_reg_adr = C_ADR_SDSTAT then
+        o_wb_dat <= s_regs_r.SDSTAT;
+      elsif s_reg_adr = C_ADR_SDFIFO then
+        o_wb_dat <= s_regs_r.SDFIFO;
+      elsif s_reg_adr = C_ADR_SPRADDR then
+        o_wb_dat <= s_regs_w.SPRADDR;
+      elsif s_reg_adr = C_ADR_SPRPOS then
+        o_wb_dat <= s_regs_w.SPRPOS;
+      elsif s_reg_adr = C_ADR_SPRCTRL then
+        o_wb_dat <= s_regs_w.SPRCTRL;
+      elsif s_reg_adr = C_ADR_VIDSTAT then
+        o_wb_dat <= s_regs_r.VIDSTAT;
+      elsif s_reg_adr = C_ADR_LZGSRC then
+        o_wb_dat <= s_regs_w.LZGSRC;
+      elsif s_reg_adr = C_ADR_LZGDST then
+        o_wb_dat <= s_regs_w.LZGDST;
+      elsif s_reg_adr = C_ADR_LZGCTRL then
+        o_wb_dat <= s_regs_w.LZGCTRL;
+      elsif s_reg_adr = C_ADR_LZGSTAT then
+        o_wb_dat <= s_regs_r.LZGSTAT;
+      elsif s_reg_adr >= C_ADR_KEYBUF and s_reg_adr < C_ADR_KEYBUF + C_KEY_BUF_SIZE then
         v_key_event := s_key_buf(reg_adr_to_key_buf_adr(s_reg_adr));
         o_wb_dat <= v_key_event(9) & "0000000000000000000000" & v_key_event(8 downto 0);
       else
@@ -343,6 +457,22 @@ begin
           s_regs_w.SDOUT <= i_wb_dat;
         elsif s_reg_adr = C_ADR_SDWE then
           s_regs_w.SDWE <= i_wb_dat;
+        elsif s_reg_adr = C_ADR_SDCTRL then
+          s_regs_w.SDCTRL <= i_wb_dat;
+        elsif s_reg_adr = C_ADR_SDBLK then
+          s_regs_w.SDBLK <= i_wb_dat;
+        elsif s_reg_adr = C_ADR_SPRADDR then
+          s_regs_w.SPRADDR <= i_wb_dat;
+        elsif s_reg_adr = C_ADR_SPRPOS then
+          s_regs_w.SPRPOS <= i_wb_dat;
+        elsif s_reg_adr = C_ADR_SPRCTRL then
+          s_regs_w.SPRCTRL <= i_wb_dat;
+        elsif s_reg_adr = C_ADR_LZGSRC then
+          s_regs_w.LZGSRC <= i_wb_dat;
+        elsif s_reg_adr = C_ADR_LZGDST then
+          s_regs_w.LZGDST <= i_wb_dat;
+        elsif s_reg_adr = C_ADR_LZGCTRL then
+          s_regs_w.LZGCTRL <= i_wb_dat;
         end if;
       end if;
 
@@ -356,5 +486,5 @@ begin
   -- Output the state of the written registers.
   --------------------------------------------------------------------------------------------------
 
-  o_regs_w <= s_regs_w;
+  o_regs_w <= with_sdspi_pins(s_regs_w, s_sd_sck, s_sd_mosi, s_sd_cs_n);
 end rtl;
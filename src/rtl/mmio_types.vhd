@@ -42,6 +42,9 @@ package mmio_types is
     VIDFPS : T_MMIO_REG_WORD;      -- Video refresh rate in 65536 * frames per s.
     VIDFRAMENO : T_MMIO_REG_WORD;  -- Video frame number (free running counter).
     VIDY : T_MMIO_REG_WORD;        -- Video raster Y position.
+    VIDSTAT : T_MMIO_REG_WORD;     -- Video status (bits 0-3: layer 1-4 line FIFO underrun during
+                                   -- the last frame, bits 8-11: number of layers, bit 31: the
+                                   -- top layer supports tile mode).
 
     -- External registers.
     -- TODO(m): microSD inputs, GPIO inputs.
@@ -56,6 +59,10 @@ package mmio_types is
                                    --   2: DAT2
                                    --   3: DAT3/SS*
                                    --   4: CMD/MOSI
+    SDDATA : T_MMIO_REG_WORD;      -- SD SPI engine: Last received byte (write to send a byte).
+    SDSTAT : T_MMIO_REG_WORD;      -- SD SPI engine: Status (see sdspi.vhd).
+    SDFIFO : T_MMIO_REG_WORD;      -- SD SPI engine: Block FIFO head (read to pop, write to push).
+    LZGSTAT : T_MMIO_REG_WORD;     -- LZG engine: Status (see lzgdec.vhd).
   end record T_MMIO_REGS_RO;
 
   --------------------------------------------------------------------------------------------------
@@ -84,6 +91,17 @@ package mmio_types is
                                    --   4: CMD/MOSI
                                    --   5: CLK/SCK   (always unmasked)
     SDWE : T_MMIO_REG_WORD;        -- SD card write enable bit mask (bits 0-4).
+    SDCTRL : T_MMIO_REG_WORD;      -- SD SPI engine: Control (see sdspi.vhd). When the engine is
+                                   -- enabled it overrides SDOUT/SDWE for CLK, CMD and DAT3.
+    SDBLK : T_MMIO_REG_WORD;       -- SD SPI engine: Block transfer (write to start a transfer).
+    SPRADDR : T_MMIO_REG_WORD;     -- Sprite: VRAM word address of the 16x16 ABGR32 bitmap.
+    SPRPOS : T_MMIO_REG_WORD;      -- Sprite: Position (x & y coord in upper & lower 16 bits).
+    SPRCTRL : T_MMIO_REG_WORD;     -- Sprite: Control:
+                                   --   0: Enable
+                                   --   1: Follow the mouse (SPRPOS is relative to MOUSEPOS)
+    LZGSRC : T_MMIO_REG_WORD;      -- LZG engine: Source address (the LZG header).
+    LZGDST : T_MMIO_REG_WORD;      -- LZG engine: Destination address.
+    LZGCTRL : T_MMIO_REG_WORD;     -- LZG engine: Control (write with bit 0 set to start).
 
   end record T_MMIO_REGS_WO;
 end package;
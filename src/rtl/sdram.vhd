@@ -41,6 +41,23 @@ use ieee.math_real.all;
 -- This SDRAM controller provides a symmetric 32-bit synchronous read/write
 -- interface for a 16Mx16-bit SDRAM chip (e.g. AS4C16M16SA-6TCN, IS42S16400F,
 -- etc.).
+--
+-- The controller uses an open-page policy:
+--
+--  * The row of each bank is left open after a read/write, and the currently
+--    open row of each bank is tracked. Accesses that hit an open row are
+--    issued directly as READ/WRITE commands (no tRCD or tRP penalty), and a
+--    bank is only precharged when an access needs another row of that bank.
+--  * The address is mapped as ROW:BANK:COL, so that sequential accesses that
+--    cross a row boundary continue in the next bank (while the previous row is
+--    still open).
+--  * A new request is accepted as soon as the command bus is free, so the
+--    commands for the next request (e.g. an ACTIVE to another bank or a READ
+--    to an open row) are issued while the data of a previous read burst is
+--    still in flight.
+--  * Auto refresh (which requires all banks to be precharged) is scheduled
+--    into idle cycles once half of the refresh interval has passed, and is
+--    forced when the refresh interval is about to expire.
 entity sdram is
   generic (
     -- clock frequency (in MHz)
@@ -74,6 +91,7 @@ entity sdram is
     T_DESL : real := 200000.0; -- startup delay
     T_MRD  : real :=     12.0; -- mode register cycle time
     T_RC   : real :=     60.0; -- row cycle time
+    T_RAS  : real :=     42.0; -- activate to precharge delay
     T_RCD  : real :=     18.0; -- RAS to CAS delay
     T_RP   : real :=     18.0; -- precharge to activate delay
     T_WR   : real :=     12.0; -- write recovery time
@@ -110,7 +128,7 @@ entity sdram is
     ack : out std_logic;
 
     -- The valid signal is asserted when there is a valid word on the output
-    -- data bus.
+    -- data bus. Read requests are always completed in order.
     valid : out std_logic;
 
     -- output data bus
@@ -146,6 +164,15 @@ architecture arch of sdram is
     return natural(ceil(log2(real(n))));
   end ilog2;
 
+  function max(a : natural; b : natural) return natural is
+  begin
+    if a > b then
+      return a;
+    else
+      return b;
+    end if;
+  end max;
+
   -- Convert a ROW address to a signal suitable for sdram_a.
   function row2addr(x : unsigned) return unsigned is
   begin
@@ -157,8 +184,8 @@ architecture arch of sdram is
     variable a : unsigned(SDRAM_ADDR_WIDTH-2 downto 0);
   begin
     a := resize(x, SDRAM_ADDR_WIDTH-1);
-    -- A10 = '1' -> auto precharge
-    return a(SDRAM_ADDR_WIDTH-2 downto 10) & "1" & a(9 downto 0);
+    -- A10 = '0' -> no auto precharge (leave the row open)
+    return a(SDRAM_ADDR_WIDTH-2 downto 10) & "0" & a(9 downto 0);
   end col2addr;
 
   -- Adjust the incoming address to the SDRAM address space (e.g.
@@ -188,7 +215,8 @@ architecture arch of sdram is
   -- the write burst mode enables bursting for write operations
   constant WRITE_BURST_MODE : std_logic := '0'; -- 0=burst, 1=single
 
-  -- the value written to the address bus during initialization
+  -- the value written to the address bus during initialization (and for the
+  -- PRECHARGE ALL command)
   constant INIT_CMD : unsigned(SDRAM_ADDR_WIDTH-1 downto 0) := (
     to_unsigned(0, SDRAM_ADDR_WIDTH-11) &
     "10000000000"
@@ -204,6 +232,9 @@ architecture arch of sdram is
     to_unsigned(ilog2(BURST_LENGTH), 3)
   );
 
+  -- the number of banks
+  constant NUM_BANKS : natural := 2**SDRAM_BANK_WIDTH;
+
   -- calculate the clock period (in nanoseconds)
   constant CLK_PERIOD : real := 1.0/CLK_FREQ*1000.0;
 
@@ -226,17 +257,32 @@ architecture arch of sdram is
   -- executed
   constant PRECHARGE_WAIT : natural := natural(ceil(T_RP/CLK_PERIOD));
 
-  -- the number of clock cycles to wait while a READ command is being executed
-  constant READ_WAIT : natural := CAS_LATENCY+BURST_LENGTH;
+  -- the number of clock cycles that a READ or WRITE command occupies the
+  -- command bus (i.e. the minimum distance between two READ/WRITE commands)
+  constant BURST_WAIT : natural := BURST_LENGTH;
 
-  -- the number of clock cycles to wait while a WRITE command is being executed
-  constant WRITE_WAIT : natural := BURST_LENGTH+natural(ceil((T_WR+T_RP)/CLK_PERIOD));
+  -- the minimum number of clock cycles between an ACTIVE command and a
+  -- PRECHARGE command
+  constant RAS_WAIT : natural := natural(ceil(T_RAS/CLK_PERIOD));
+
+  -- the minimum number of clock cycles between a WRITE command and a
+  -- PRECHARGE command
+  constant WRITE_RECOVERY_WAIT : natural := BURST_LENGTH+natural(ceil(T_WR/CLK_PERIOD));
+
+  -- the minimum number of clock cycles between a READ command and a WRITE
+  -- command (the read data must have left the DQ bus, plus one turnaround
+  -- cycle)
+  constant READ_TO_WRITE_WAIT : natural := CAS_LATENCY+BURST_LENGTH+1;
 
   -- the number of clock cycles before the memory controller needs to refresh
   -- the SDRAM
   constant REFRESH_INTERVAL : natural := natural(floor(T_REFI/CLK_PERIOD))-10;
 
-  type state_t is (INIT, MODE, IDLE, ACTIVE, READ, WRITE, REFRESH);
+  -- the number of clock cycles after which a refresh is performed if the
+  -- controller is idle
+  constant REFRESH_IDLE_INTERVAL : natural := REFRESH_INTERVAL/2;
+
+  type state_t is (INIT, MODE, IDLE, ACTIVE, READ, WRITE, PRECHARGE, PRECHARGE_ALL, REFRESH);
 
   -- state signals
   signal state, next_state : state_t;
@@ -246,48 +292,80 @@ architecture arch of sdram is
 
   -- control signals
   signal start          : std_logic;
+  signal issue_rw       : std_logic;
+  signal restart_wait   : std_logic;
   signal load_mode_done : std_logic;
   signal active_done    : std_logic;
   signal refresh_done   : std_logic;
-  signal read_done      : std_logic;
-  signal write_done     : std_logic;
+  signal precharge_done : std_logic;
+  signal burst_done     : std_logic;
   signal should_refresh : std_logic;
+  signal must_refresh   : std_logic;
 
   -- counters
   constant MAX_WAIT_COUNT    : natural := INIT_WAIT+PRECHARGE_WAIT+REFRESH_WAIT+REFRESH_WAIT+1;
   constant MAX_REFRESH_COUNT : natural := REFRESH_INTERVAL;
+  constant MAX_BLOCK_COUNT   : natural := max(max(RAS_WAIT, WRITE_RECOVERY_WAIT), READ_TO_WRITE_WAIT);
   signal wait_counter    : natural range 0 to MAX_WAIT_COUNT;
   signal refresh_counter : natural range 0 to MAX_REFRESH_COUNT;
 
+  -- the number of clock cycles until a READ, WRITE or PRECHARGE command may
+  -- be issued (0 = may be issued now)
+  signal read_block      : natural range 0 to MAX_BLOCK_COUNT;
+  signal write_block     : natural range 0 to MAX_BLOCK_COUNT;
+  signal precharge_block : natural range 0 to MAX_BLOCK_COUNT;
+
   -- registers
-  signal addr_reg  : unsigned(ADDR_WIDTH-1 downto 0);
-  signal data_reg  : std_logic_vector(DATA_WIDTH-1 downto 0);
-  signal we_reg    : std_logic;
-  signal sel_n_reg : std_logic_vector(DATA_WIDTH/8-1 downto 0);
-  signal q_reg     : std_logic_vector(DATA_WIDTH-1 downto 0);
+  signal req_pending : std_logic;
+  signal addr_reg    : unsigned(ADDR_WIDTH-1 downto 0);
+  signal data_reg    : std_logic_vector(DATA_WIDTH-1 downto 0);
+  signal we_reg      : std_logic;
+  signal sel_reg     : std_logic_vector(DATA_WIDTH/8-1 downto 0);
+  signal q_reg       : std_logic_vector(DATA_WIDTH-1 downto 0);
+
+  -- the current request (either the pending request or a new request)
+  signal cur_valid : std_logic;
+  signal cur_we    : std_logic;
+  signal cur_data  : std_logic_vector(DATA_WIDTH-1 downto 0);
+  signal cur_sel   : std_logic_vector(DATA_WIDTH/8-1 downto 0);
+
+  -- open row tracking
+  type row_array_t is array (0 to NUM_BANKS-1) of unsigned(SDRAM_ROW_WIDTH-1 downto 0);
+  signal bank_open     : std_logic_vector(NUM_BANKS-1 downto 0);
+  signal bank_row      : row_array_t;
+  signal row_hit       : std_logic;
+  signal row_conflict  : std_logic;
+  signal any_bank_open : std_logic;
+
+  -- read data pipeline (one bit per cycle since a READ command was issued)
+  signal read_pipe : std_logic_vector(CAS_LATENCY+BURST_LENGTH-1 downto 0);
 
   -- DQ in/out signals
   signal dq_in : std_logic_vector(SDRAM_DATA_WIDTH-1 downto 0);
   signal dq_out : std_logic_vector(SDRAM_DATA_WIDTH-1 downto 0);
   signal dq_out_en : std_logic;
 
-  -- aliases to decode the address
+  -- aliases to decode the address (ROW:BANK:COL)
   signal addr_current : unsigned(SDRAM_COL_WIDTH+SDRAM_ROW_WIDTH+SDRAM_BANK_WIDTH-1 downto 0);
   alias col  : unsigned(SDRAM_COL_WIDTH-1 downto 0) is addr_current(SDRAM_COL_WIDTH-1 downto 0);
-  alias row  : unsigned(SDRAM_ROW_WIDTH-1 downto 0) is addr_current(SDRAM_COL_WIDTH+SDRAM_ROW_WIDTH-1 downto SDRAM_COL_WIDTH);
-  alias bank : unsigned(SDRAM_BANK_WIDTH-1 downto 0) is addr_current(SDRAM_COL_WIDTH+SDRAM_ROW_WIDTH+SDRAM_BANK_WIDTH-1 downto SDRAM_COL_WIDTH+SDRAM_ROW_WIDTH);
+  alias bank : unsigned(SDRAM_BANK_WIDTH-1 downto 0) is addr_current(SDRAM_COL_WIDTH+SDRAM_BANK_WIDTH-1 downto SDRAM_COL_WIDTH);
+  alias row  : unsigned(SDRAM_ROW_WIDTH-1 downto 0) is addr_current(SDRAM_COL_WIDTH+SDRAM_BANK_WIDTH+SDRAM_ROW_WIDTH-1 downto SDRAM_COL_WIDTH+SDRAM_BANK_WIDTH);
 
   -- Use fast I/O flip-flops for the SDRAM data in/out signals.
   attribute useioff of dq_in : signal is true;
   attribute useioff of dq_out : signal is true;
 begin
   -- state machine
-  fsm : process (state, wait_counter, req, we_reg, sel_n_reg, load_mode_done, active_done, refresh_done, read_done, write_done, should_refresh)
+  fsm : process (state, wait_counter, cur_valid, cur_we, row_hit, row_conflict, any_bank_open, load_mode_done, active_done, refresh_done, precharge_done, burst_done, should_refresh, must_refresh, read_block, write_block, precharge_block)
+    variable v_dispatch : boolean;
   begin
     next_state <= state;
 
     -- default to a NOP command
     next_cmd <= CMD_NOP;
+    issue_rw <= '0';
+
+    v_dispatch := false;
 
     case state is
       -- execute the initialisation sequence
@@ -311,67 +389,71 @@ begin
           next_state <= IDLE;
         end if;
 
-      -- wait for a read/write request
+      -- wait for a read/write request (or for a timing constraint)
       when IDLE =>
-        if should_refresh = '1' then
-          next_state <= REFRESH;
-          next_cmd   <= CMD_AUTO_REFRESH;
-        elsif req = '1' then
-          next_state <= ACTIVE;
-          next_cmd   <= CMD_ACTIVE;
-        end if;
+        v_dispatch := true;
 
       -- activate the row
       when ACTIVE =>
-        if active_done = '1' then
-          if we_reg = '1' then
-            next_state <= WRITE;
-            next_cmd   <= CMD_WRITE;
-          else
-            next_state <= READ;
-            next_cmd   <= CMD_READ;
-          end if;
-        end if;
+        v_dispatch := active_done = '1';
 
-      -- execute a read command
-      when READ =>
-        if read_done = '1' then
-          if should_refresh = '1' then
-            next_state <= REFRESH;
-            next_cmd   <= CMD_AUTO_REFRESH;
-          elsif req = '1' then
-            next_state <= ACTIVE;
-            next_cmd   <= CMD_ACTIVE;
-          else
-            next_state <= IDLE;
-          end if;
-        end if;
+      -- execute a read or write command
+      when READ | WRITE =>
+        v_dispatch := burst_done = '1';
 
-      -- execute a write command
-      when WRITE =>
-        if write_done = '1' then
-          if should_refresh = '1' then
-            next_state <= REFRESH;
-            next_cmd   <= CMD_AUTO_REFRESH;
-          elsif req = '1' then
-            next_state <= ACTIVE;
-            next_cmd   <= CMD_ACTIVE;
-          else
-            next_state <= IDLE;
-          end if;
+      -- close the row of a single bank
+      when PRECHARGE =>
+        v_dispatch := precharge_done = '1';
+
+      -- close the rows of all banks before a refresh
+      when PRECHARGE_ALL =>
+        if precharge_done = '1' then
+          next_state <= REFRESH;
+          next_cmd   <= CMD_AUTO_REFRESH;
         end if;
 
       -- execute an auto refresh
       when REFRESH =>
-        if refresh_done = '1' then
-          if req = '1' then
-            next_state <= ACTIVE;
-            next_cmd   <= CMD_ACTIVE;
-          else
-            next_state <= IDLE;
+        v_dispatch := refresh_done = '1';
+    end case;
+
+    -- select the next command
+    if v_dispatch then
+      next_state <= IDLE;
+      if must_refresh = '1' or (should_refresh = '1' and cur_valid = '0') then
+        -- all banks must be precharged before a refresh
+        if any_bank_open = '0' then
+          next_state <= REFRESH;
+          next_cmd   <= CMD_AUTO_REFRESH;
+        elsif precharge_block = 0 then
+          next_state <= PRECHARGE_ALL;
+          next_cmd   <= CMD_PRECHARGE;
+        end if;
+      elsif cur_valid = '1' then
+        if row_hit = '1' then
+          -- the row is already open: issue the command right away
+          if cur_we = '1' and write_block = 0 then
+            next_state <= WRITE;
+            next_cmd   <= CMD_WRITE;
+            issue_rw   <= '1';
+          elsif cur_we = '0' and read_block = 0 then
+            next_state <= READ;
+            next_cmd   <= CMD_READ;
+            issue_rw   <= '1';
+          end if;
+        elsif row_conflict = '1' then
+          -- another row is open in the bank: close it first
+          if precharge_block = 0 then
+            next_state <= PRECHARGE;
+            next_cmd   <= CMD_PRECHARGE;
           end if;
+        else
+          -- the bank is idle: activate the row
+          next_state <= ACTIVE;
+          next_cmd   <= CMD_ACTIVE;
         end if;
-    end case;
+      end if;
+    end if;
   end process;
 
   -- latch the next state
@@ -387,28 +469,72 @@ begin
   end process;
 
   -- the wait counter is used to hold the current state for a number of clock
-  -- cycles
+  -- cycles (it is restarted for every new command, since consecutive commands
+  -- may use the same state, e.g. READ -> READ)
+  restart_wait <= '1' when state /= next_state or
+                           (state /= INIT and next_cmd /= CMD_NOP) else '0';
   update_wait_counter : process (clk, reset)
   begin
     if reset = '1' then
       wait_counter <= 0;
     elsif rising_edge(clk) then
-      if state /= next_state then -- state changing
+      if restart_wait = '1' then
         wait_counter <= 0;
       elsif state = IDLE then    -- counter would overflow when IDLE
         wait_counter <= 0;
-      else
+      elsif wait_counter /= MAX_WAIT_COUNT then
         wait_counter <= wait_counter + 1;
       end if;
     end if;
   end process;
 
+  -- the block counters keep track of the minimum distance between commands
+  update_block_counters : process (clk, reset)
+    variable v_read_block : natural range 0 to MAX_BLOCK_COUNT;
+    variable v_write_block : natural range 0 to MAX_BLOCK_COUNT;
+    variable v_precharge_block : natural range 0 to MAX_BLOCK_COUNT;
+  begin
+    if reset = '1' then
+      read_block <= 0;
+      write_block <= 0;
+      precharge_block <= 0;
+    elsif rising_edge(clk) then
+      v_read_block := read_block;
+      v_write_block := write_block;
+      v_precharge_block := precharge_block;
+      if v_read_block /= 0 then
+        v_read_block := v_read_block - 1;
+      end if;
+      if v_write_block /= 0 then
+        v_write_block := v_write_block - 1;
+      end if;
+      if v_precharge_block /= 0 then
+        v_precharge_block := v_precharge_block - 1;
+      end if;
+
+      if next_cmd = CMD_ACTIVE then
+        v_precharge_block := max(v_precharge_block, RAS_WAIT-1);
+      elsif next_cmd = CMD_READ then
+        v_write_block := max(v_write_block, READ_TO_WRITE_WAIT-1);
+        v_precharge_block := max(v_precharge_block, BURST_WAIT-1);
+      elsif next_cmd = CMD_WRITE then
+        v_read_block := max(v_read_block, BURST_WAIT-1);
+        v_precharge_block := max(v_precharge_block, WRITE_RECOVERY_WAIT-1);
+      end if;
+
+      read_block <= v_read_block;
+      write_block <= v_write_block;
+      precharge_block <= v_precharge_block;
+    end if;
+  end process;
+
   -- the refresh counter is used to periodically trigger a refresh operation
   update_refresh_counter : process (clk, reset)
   begin
     if reset = '1' then
       refresh_counter <= 0;
       should_refresh <= '0';
+      must_refresh <= '0';
     elsif rising_edge(clk) then
       -- Update the refresh counter.
       if state = REFRESH and wait_counter = 0 then
@@ -418,28 +544,75 @@ begin
       end if;
 
       -- Time for a refresh?
-      if refresh_counter = REFRESH_INTERVAL-2 then
-        should_refresh <= '1';
-      elsif state /= REFRESH and next_state = REFRESH then
+      if state /= REFRESH and next_state = REFRESH then
         should_refresh <= '0';
+        must_refresh <= '0';
+      else
+        if refresh_counter = REFRESH_IDLE_INTERVAL then
+          should_refresh <= '1';
+        end if;
+        if refresh_counter = REFRESH_INTERVAL-2 then
+          must_refresh <= '1';
+        end if;
       end if;
     end if;
   end process;
 
+  -- a new request is accepted when there is no pending request
+  start <= req and not req_pending;
+
   -- latch the request
   latch_request : process (reset, clk)
   begin
     if reset = '1' then
+      req_pending <= '0';
       addr_reg <= (others => '0');
       data_reg <= (others => '0');
       we_reg <= '0';
-      sel_n_reg <= (others => '0');
+      sel_reg <= (others => '0');
     elsif rising_edge(clk) then
       if start = '1' then
-        addr_reg  <= addr;
-        data_reg  <= data;
-        we_reg    <= we;
-        sel_n_reg <= not sel;
+        addr_reg <= addr;
+        data_reg <= data;
+        we_reg   <= we;
+        sel_reg  <= sel;
+      end if;
+
+      -- a new request that is issued right away never becomes pending
+      if start = '1' then
+        req_pending <= not issue_rw;
+      elsif issue_rw = '1' then
+        req_pending <= '0';
+      end if;
+    end if;
+  end process;
+
+  -- the current request is the pending request, if any, otherwise a new
+  -- request
+  cur_valid <= req_pending or req;
+  cur_we    <= we_reg   when req_pending = '1' else we;
+  cur_data  <= data_reg when req_pending = '1' else data;
+  cur_sel   <= sel_reg  when req_pending = '1' else sel;
+  addr_current <= adjust_addr(addr_reg) when req_pending = '1' else adjust_addr(addr);
+
+  -- open row tracking
+  row_hit <= bank_open(to_integer(bank)) when bank_row(to_integer(bank)) = row else '0';
+  row_conflict <= bank_open(to_integer(bank)) when bank_row(to_integer(bank)) /= row else '0';
+  any_bank_open <= '1' when bank_open /= (bank_open'range => '0') else '0';
+
+  update_open_rows : process (reset, clk)
+  begin
+    if reset = '1' then
+      bank_open <= (others => '0');
+      bank_row <= (others => (others => '0'));
+    elsif rising_edge(clk) then
+      if state = INIT or next_state = PRECHARGE_ALL then
+        bank_open <= (others => '0');
+      elsif next_cmd = CMD_ACTIVE then
+        bank_open(to_integer(bank)) <= '1';
+        bank_row(to_integer(bank)) <= row;
+      elsif next_cmd = CMD_PRECHARGE then
+        bank_open(to_integer(bank)) <= '0';
       end if;
     end if;
   end process;
@@ -448,31 +621,19 @@ begin
   load_mode_done <= '1' when wait_counter = LOAD_MODE_WAIT-1 else '0';
   active_done    <= '1' when wait_counter = ACTIVE_WAIT-1    else '0';
   refresh_done   <= '1' when wait_counter = REFRESH_WAIT-1   else '0';
-  read_done      <= '1' when wait_counter = READ_WAIT-1      else '0';
-  write_done     <= '1' when wait_counter = WRITE_WAIT-1     else '0';
-
-  -- a new request is only allowed at the end of the IDLE, READ, WRITE, and
-  -- REFRESH states, as long as a refresh is not pending.
-  start <= (not should_refresh) when
-               (state = IDLE) or
-               (state = READ and read_done = '1') or
-               (state = WRITE and write_done = '1') or
-               (state = REFRESH and refresh_done = '1') else '0';
+  precharge_done <= '1' when wait_counter = PRECHARGE_WAIT-1 else '0';
+  burst_done     <= '1' when wait_counter = BURST_WAIT-1     else '0';
 
   -- assert the ready signal when we're ready to accept a new request
-  ready <= start;
+  ready <= not req_pending;
 
-  -- assert the acknowledge signal at the beginning of the ACTIVE state
+  -- assert the acknowledge signal when a request has been accepted
   process (reset, clk)
   begin
     if reset = '1' then
       ack <= '0';
     elsif rising_edge(clk) then
-      if next_state = ACTIVE and next_state /= state then
-        ack <= '1';
-      else
-        ack <= '0';
-      end if;
+      ack <= start;
     end if;
   end process;
 
@@ -495,7 +656,6 @@ begin
   (sdram_cs_n, sdram_ras_n, sdram_cas_n, sdram_we_n) <= cmd;
 
   -- set SDRAM bank and address
-  addr_current <= adjust_addr(addr) when start = '1' else adjust_addr(addr_reg);
   process (reset, clk)
   begin
     if reset = '1' then
@@ -503,14 +663,14 @@ begin
       sdram_a <= (others => '0');
     elsif rising_edge(clk) then
       case next_state is
-        when ACTIVE | READ | WRITE =>
+        when ACTIVE | READ | WRITE | PRECHARGE =>
           sdram_ba <= bank;
         when others =>
           sdram_ba <= (others => '0');
       end case;
 
       case next_state is
-        when INIT =>
+        when INIT | PRECHARGE_ALL =>
           sdram_a <= INIT_CMD;
         when MODE =>
           sdram_a <= MODE_REG;
@@ -519,6 +679,7 @@ begin
         when READ | WRITE =>
           sdram_a <= col2addr(col);
         when others =>
+          -- Note: A10 = '0' -> PRECHARGE only precharges the selected bank
           sdram_a <= (others => '0');
       end case;
     end if;
@@ -526,53 +687,60 @@ begin
 
   -- read the next sub-word as it's bursted from the SDRAM
   process (reset, clk)
-    -- Add one extra cycle delay due to SDRAM clock phase diff.
-    constant C_START_CNT : integer := -1;
-    variable v_burst_cnt : integer range C_START_CNT to BURST_LENGTH := BURST_LENGTH;
   begin
     if reset = '1' then
+      read_pipe <= (others => '0');
       q_reg <= (others => '0');
       valid <= '0';
     elsif rising_edge(clk) then
-      if state = READ and wait_counter = CAS_LATENCY then
-        v_burst_cnt := C_START_CNT;
-      elsif v_burst_cnt < BURST_LENGTH then
-        v_burst_cnt := v_burst_cnt + 1;
+      -- Keep track of issued READ commands. Read bursts may overlap with
+      -- later commands, so we use a delay line rather than the FSM state.
+      if cmd = CMD_READ then
+        read_pipe <= read_pipe(read_pipe'left-1 downto 0) & '1';
+      else
+        read_pipe <= read_pipe(read_pipe'left-1 downto 0) & '0';
       end if;
 
-      if v_burst_cnt >= 0 and v_burst_cnt < BURST_LENGTH then
-        q_reg(SDRAM_DATA_WIDTH*(v_burst_cnt+1)-1 downto SDRAM_DATA_WIDTH*v_burst_cnt) <= dq_in;
-      end if;
+      -- The data arrives CAS_LATENCY cycles after the READ command, plus one
+      -- extra cycle delay due to SDRAM clock phase diff.
+      for k in 0 to BURST_LENGTH-1 loop
+        if read_pipe(CAS_LATENCY+k) = '1' then
+          q_reg(SDRAM_DATA_WIDTH*(k+1)-1 downto SDRAM_DATA_WIDTH*k) <= dq_in;
+        end if;
+      end loop;
 
       -- Was this the final sub-word?
-      if v_burst_cnt = (BURST_LENGTH - 1) then
-        valid <= '1';
-      else
-        valid <= '0';
-      end if;
+      valid <= read_pipe(CAS_LATENCY+BURST_LENGTH-1);
     end if;
   end process;
 
   -- write the next sub-word from the write buffer
   process (reset, clk)
     variable v_burst_cnt : natural range 0 to BURST_LENGTH := BURST_LENGTH;
+    variable v_write_buf : std_logic_vector(DATA_WIDTH-1 downto 0);
+    variable v_write_sel_n : std_logic_vector(DATA_WIDTH/8-1 downto 0);
   begin
     if reset = '1' then
       dq_out_en <= '0';
       dq_out <= (others => '0');
       sdram_dqm <= (others => '0');
+      v_write_buf := (others => '0');
+      v_write_sel_n := (others => '0');
     elsif rising_edge(clk) then
-      if next_state = WRITE and next_state /= state then
-        -- Start a new write burst.
+      if next_cmd = CMD_WRITE then
+        -- Start a new write burst (the data is taken from the current request,
+        -- since the request register may be reused for a new request).
         v_burst_cnt := 0;
+        v_write_buf := cur_data;
+        v_write_sel_n := not cur_sel;
       elsif v_burst_cnt < BURST_LENGTH then
         v_burst_cnt := v_burst_cnt + 1;
       end if;
 
       if v_burst_cnt < BURST_LENGTH then
         dq_out_en <= '1';
-        dq_out <= data_reg(SDRAM_DATA_WIDTH*(v_burst_cnt+1)-1 downto SDRAM_DATA_WIDTH*v_burst_cnt);
-        sdram_dqm <= sel_n_reg((SDRAM_DATA_WIDTH/8)*(v_burst_cnt+1)-1 downto (SDRAM_DATA_WIDTH/8)*v_burst_cnt);
+        dq_out <= v_write_buf(SDRAM_DATA_WIDTH*(v_burst_cnt+1)-1 downto SDRAM_DATA_WIDTH*v_burst_cnt);
+        sdram_dqm <= v_write_sel_n((SDRAM_DATA_WIDTH/8)*(v_burst_cnt+1)-1 downto (SDRAM_DATA_WIDTH/8)*v_burst_cnt);
       else
         dq_out_en <= '0';
         dq_out <= (others => '0');
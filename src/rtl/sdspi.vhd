@@ -0,0 +1,486 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- SD card SPI engine.
+--
+-- This is an SPI master (SPI mode 0) for talking to an SD card in SPI mode. It takes care of the
+-- bit level signalling, and it can transfer a complete data block (including the start token and
+-- the CRC16) between the card and a 512 byte FIFO without CPU intervention.
+--
+-- Registers (see mmio.vhd for the addresses):
+--   SDCTRL (RW):
+--     0:     Enable (the engine drives the CLK, CMD/MOSI and DAT3/CS* pins)
+--     1:     Chip select (DAT3/CS* is driven low when this bit is set)
+--     15-8:  Clock divider - the SPI clock period is 2 * (DIV + 1) CPU clock cycles
+--   SDDATA (RW):
+--     Write: Transfer one byte (bits 7-0).
+--     Read:  The last received byte (valid when BUSY is clear).
+--   SDBLK (W):
+--     Start a block transfer.
+--     10-0:  Number of data bytes (a multiple of four, at most 512)
+--     31:    Direction (0 = read from the card into the FIFO, 1 = write from the FIFO to the card)
+--   SDSTAT (R):
+--     0:     BUSY (a byte or block transfer is in progress)
+--     1:     CRCERR (the CRC16 of the last block read did not match)
+--     2:     TIMEOUT (the card did not send a start token or did not leave the busy state)
+--     3:     WRERR (the card did not accept the last written data block)
+--     23-16: Number of words in the FIFO
+--     31:    PRESENT (always set, so that software can detect the engine - the register reads as
+--            zero in systems without the engine)
+--   SDFIFO (RW):
+--     Read:  Pop one word from the FIFO (the first byte is in the least significant bits).
+--     Write: Push one word to the FIFO.
+--
+-- A block read clocks out 0xff bytes until the card sends a start token (0xfe), reads the data
+-- bytes into the FIFO and finally reads the CRC16 and checks it against the received data (the
+-- FIFO is cleared when a block read is started). A block write sends a start token, the data bytes
+-- from the FIFO and the CRC16, and then waits for the data response token and for the card to
+-- finish programming. The data response token can be read from SDDATA.
+--
+-- The commands that precede a block transfer (e.g. CMD17 / CMD24) are sent using SDDATA.
+----------------------------------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity sdspi is
+  port(
+    i_rst : in std_logic;
+    i_clk : in std_logic;
+
+    -- Register interface.
+    i_ctrl : in std_logic_vector(31 downto 0);
+    i_wdata : in std_logic_vector(31 downto 0);
+    i_data_we : in std_logic;
+    i_blk_we : in std_logic;
+    i_fifo_we : in std_logic;
+    i_fifo_re : in std_logic;
+    o_data : out std_logic_vector(31 downto 0);
+    o_stat : out std_logic_vector(31 downto 0);
+    o_fifo : out std_logic_vector(31 downto 0);
+
+    -- SPI signals.
+    o_sck : out std_logic;
+    o_mosi : out std_logic;
+    o_cs_n : out std_logic;
+    i_miso : in std_logic
+  );
+end sdspi;
+
+architecture rtl of sdspi is
+  constant C_LOG2_FIFO_WORDS : positive := 7;  -- 128 words = 512 bytes
+  constant C_FIFO_WORDS : positive := 2**C_LOG2_FIFO_WORDS;
+
+  -- Maximum number of bytes to wait for a start token or for the end of busy (at 25 MHz this is
+  -- about 0.3 s, which is longer than the SD card read and write timeouts).
+  constant C_TIMEOUT_BYTES : positive := 2**20-1;
+
+  constant C_START_TOKEN : std_logic_vector(7 downto 0) := x"fe";
+  constant C_IDLE_BYTE : std_logic_vector(7 downto 0) := x"ff";
+
+  type T_STATE is (
+    IDLE,
+    SINGLE,
+    RD_TOKEN,
+    RD_DATA,
+    RD_CRC,
+    WR_TOKEN,
+    WR_DATA,
+    WR_CRC,
+    WR_RESP,
+    WR_BUSY
+  );
+
+  type T_FIFO is array (0 to C_FIFO_WORDS-1) of std_logic_vector(31 downto 0);
+
+  -- Byte shifter signals.
+  signal s_xfer_start : std_logic;
+  signal s_xfer_byte : std_logic_vector(7 downto 0);
+  signal s_xfer_active : std_logic;
+  signal s_xfer_done : std_logic;
+  signal s_div_cnt : unsigned(7 downto 0);
+  signal s_bit_cnt : integer range 0 to 7;
+  signal s_sck : std_logic;
+  signal s_miso : std_logic;
+  signal s_tx_shift : std_logic_vector(7 downto 0);
+  signal s_rx_shift : std_logic_vector(7 downto 0);
+
+  -- Sequencer signals.
+  signal s_state : T_STATE;
+  signal s_count : unsigned(10 downto 0);
+  signal s_timeout : integer range 0 to C_TIMEOUT_BYTES;
+  signal s_crc : std_logic_vector(15 downto 0);
+  signal s_crc_rx : std_logic_vector(7 downto 0);
+  signal s_second_crc_byte : std_logic;
+  signal s_rx_byte : std_logic_vector(7 downto 0);
+  signal s_byte_idx : integer range 0 to 3;
+  signal s_word : std_logic_vector(31 downto 0);
+  signal s_crc_err : std_logic;
+  signal s_timeout_err : std_logic;
+  signal s_wr_err : std_logic;
+
+  -- FIFO signals.
+  signal s_fifo : T_FIFO;
+  signal s_fifo_wr_ptr : unsigned(C_LOG2_FIFO_WORDS-1 downto 0);
+  signal s_fifo_rd_ptr : unsigned(C_LOG2_FIFO_WORDS-1 downto 0);
+  signal s_fifo_count : unsigned(C_LOG2_FIFO_WORDS downto 0);
+  signal s_fifo_head : std_logic_vector(31 downto 0);
+  signal s_fifo_rd_adr : unsigned(C_LOG2_FIFO_WORDS-1 downto 0);
+  signal s_fifo_push : std_logic;
+  signal s_fifo_push_data : std_logic_vector(31 downto 0);
+  signal s_fifo_pop : std_logic;
+  signal s_fifo_clear : std_logic;
+  signal s_eng_push : std_logic;
+  signal s_eng_pop : std_logic;
+
+  -- CRC16-CCITT (polynomial x^16 + x^12 + x^5 + 1), as used for SD card data blocks.
+  function crc16_update(crc : std_logic_vector(15 downto 0);
+                        data : std_logic_vector(7 downto 0)) return std_logic_vector is
+    variable v_crc : std_logic_vector(15 downto 0);
+    variable v_feedback : std_logic;
+  begin
+    v_crc := crc;
+    for k in 7 downto 0 loop
+      v_feedback := v_crc(15) xor data(k);
+      v_crc := v_crc(14 downto 0) & '0';
+      if v_feedback = '1' then
+        v_crc := v_crc xor x"1021";
+      end if;
+    end loop;
+    return v_crc;
+  end function;
+
+  function get_byte(word : std_logic_vector(31 downto 0);
+                    idx : integer) return std_logic_vector is
+  begin
+    return word(idx*8+7 downto idx*8);
+  end function;
+begin
+  --------------------------------------------------------------------------------------------------
+  -- Byte shifter.
+  --------------------------------------------------------------------------------------------------
+
+  -- MOSI is updated on the falling SCK edge and sampled by the card on the rising SCK edge. MISO is
+  -- sampled (from a register) just before the falling SCK edge, which gives the card as much time
+  -- as possible to drive the next bit.
+  process(i_clk, i_rst)
+  begin
+    if i_rst = '1' then
+      s_xfer_active <= '0';
+      s_xfer_done <= '0';
+      s_div_cnt <= (others => '0');
+      s_bit_cnt <= 0;
+      s_sck <= '0';
+      s_miso <= '1';
+      s_tx_shift <= (others => '1');
+      s_rx_shift <= (others => '1');
+    elsif rising_edge(i_clk) then
+      s_xfer_done <= '0';
+      s_miso <= i_miso;
+
+      if s_xfer_active = '0' then
+        s_sck <= '0';
+        if s_xfer_start = '1' then
+          s_xfer_active <= '1';
+          s_div_cnt <= unsigned(i_ctrl(15 downto 8));
+          s_bit_cnt <= 0;
+          s_tx_shift <= s_xfer_byte;
+        end if;
+      elsif s_div_cnt /= 0 then
+        s_div_cnt <= s_div_cnt - 1;
+      else
+        s_div_cnt <= unsigned(i_ctrl(15 downto 8));
+        if s_sck = '0' then
+          s_sck <= '1';
+        else
+          s_sck <= '0';
+          s_rx_shift <= s_rx_shift(6 downto 0) & s_miso;
+          s_tx_shift <= s_tx_shift(6 downto 0) & '1';
+          if s_bit_cnt = 7 then
+            s_xfer_active <= '0';
+            s_xfer_done <= '1';
+            s_bit_cnt <= 0;
+          else
+            s_bit_cnt <= s_bit_cnt + 1;
+          end if;
+        end if;
+      end if;
+    end if;
+  end process;
+
+
+  --------------------------------------------------------------------------------------------------
+  -- Transfer sequencer and FIFO.
+  --------------------------------------------------------------------------------------------------
+
+  -- The engine pushes received words during block reads, and pops words to send during block
+  -- writes. The CPU should only access the FIFO when no block transfer is in progress, except for
+  -- popping words that have already been received.
+  s_eng_push <= '1' when s_state = RD_DATA and s_xfer_done = '1' and s_byte_idx = 3 else '0';
+  s_eng_pop <= '1' when (s_state = WR_TOKEN or s_state = WR_DATA) and s_xfer_done = '1' and
+                        s_count /= 0 and s_byte_idx = 3 else '0';
+  s_fifo_push <= s_eng_push or i_fifo_we;
+  s_fifo_push_data <= s_rx_shift & s_word(23 downto 0) when s_eng_push = '1' else i_wdata;
+  s_fifo_pop <= s_eng_pop or i_fifo_re;
+  s_fifo_clear <= '1' when s_state = IDLE and i_data_we = '0' and i_blk_we = '1' and
+                           i_wdata(31) = '0' else '0';
+
+  -- FIFO pointers.
+  process(i_clk, i_rst)
+  begin
+    if i_rst = '1' then
+      s_fifo_wr_ptr <= (others => '0');
+      s_fifo_rd_ptr <= (others => '0');
+      s_fifo_count <= (others => '0');
+    elsif rising_edge(i_clk) then
+      if s_fifo_clear = '1' then
+        s_fifo_wr_ptr <= (others => '0');
+        s_fifo_rd_ptr <= (others => '0');
+        s_fifo_count <= (others => '0');
+      else
+        if s_fifo_push = '1' then
+          s_fifo_wr_ptr <= s_fifo_wr_ptr + 1;
+        end if;
+        if s_fifo_pop = '1' then
+          s_fifo_rd_ptr <= s_fifo_rd_ptr + 1;
+        end if;
+        if s_fifo_push = '1' and s_fifo_pop = '0' then
+          s_fifo_count <= s_fifo_count + 1;
+        elsif s_fifo_push = '0' and s_fifo_pop = '1' then
+          s_fifo_count <= s_fifo_count - 1;
+        end if;
+      end if;
+    end if;
+  end process;
+
+  -- FIFO memory. The head of the FIFO is read synchronously, so that the memory can be inferred as
+  -- block RAM (the head is valid one cycle after a pop, and two cycles after a push to an empty
+  -- FIFO).
+  s_fifo_rd_adr <= (others => '0') when s_fifo_clear = '1' else
+                   s_fifo_rd_ptr + 1 when s_fifo_pop = '1' else
+                   s_fifo_rd_ptr;
+
+  process(i_clk)
+  begin
+    if rising_edge(i_clk) then
+      if s_fifo_push = '1' then
+        s_fifo(to_integer(s_fifo_wr_ptr)) <= s_fifo_push_data;
+      end if;
+      s_fifo_head <= s_fifo(to_integer(s_fifo_rd_adr));
+    end if;
+  end process;
+
+  -- Transfer sequencer.
+  process(i_clk, i_rst)
+    procedure send_byte(data : std_logic_vector(7 downto 0)) is
+    begin
+      s_xfer_byte <= data;
+      s_xfer_start <= '1';
+    end procedure;
+
+    -- Start sending the next byte from the FIFO (and include it in the CRC).
+    procedure send_fifo_byte is
+      variable v_byte : std_logic_vector(7 downto 0);
+    begin
+      v_byte := get_byte(s_fifo_head, s_byte_idx);
+      send_byte(v_byte);
+      s_crc <= crc16_update(s_crc, v_byte);
+      s_count <= s_count - 1;
+      if s_byte_idx = 3 then
+        s_byte_idx <= 0;
+      else
+        s_byte_idx <= s_byte_idx + 1;
+      end if;
+    end procedure;
+  begin
+    if i_rst = '1' then
+      s_xfer_start <= '0';
+      s_xfer_byte <= (others => '1');
+      s_state <= IDLE;
+      s_count <= (others => '0');
+      s_timeout <= 0;
+      s_crc <= (others => '0');
+      s_crc_rx <= (others => '0');
+      s_second_crc_byte <= '0';
+      s_rx_byte <= (others => '1');
+      s_byte_idx <= 0;
+      s_word <= (others => '0');
+      s_crc_err <= '0';
+      s_timeout_err <= '0';
+      s_wr_err <= '0';
+    elsif rising_edge(i_clk) then
+      s_xfer_start <= '0';
+
+      case s_state is
+        when IDLE =>
+          if i_data_we = '1' then
+            send_byte(i_wdata(7 downto 0));
+            s_state <= SINGLE;
+          elsif i_blk_we = '1' then
+            s_count <= unsigned(i_wdata(10 downto 0));
+            s_timeout <= C_TIMEOUT_BYTES;
+            s_crc <= (others => '0');
+            s_second_crc_byte <= '0';
+            s_byte_idx <= 0;
+            s_crc_err <= '0';
+            s_timeout_err <= '0';
+            s_wr_err <= '0';
+            if i_wdata(31) = '1' then
+              send_byte(C_START_TOKEN);
+              s_state <= WR_TOKEN;
+            else
+              send_byte(C_IDLE_BYTE);
+              s_state <= RD_TOKEN;
+            end if;
+          end if;
+
+        when SINGLE =>
+          if s_xfer_done = '1' then
+            s_rx_byte <= s_rx_shift;
+            s_state <= IDLE;
+          end if;
+
+        when RD_TOKEN =>
+          if s_xfer_done = '1' then
+            if s_rx_shift = C_START_TOKEN then
+              send_byte(C_IDLE_BYTE);
+              if s_count = 0 then
+                s_state <= RD_CRC;
+              else
+                s_state <= RD_DATA;
+              end if;
+            elsif s_timeout = 0 then
+              s_timeout_err <= '1';
+              s_state <= IDLE;
+            else
+              send_byte(C_IDLE_BYTE);
+              s_timeout <= s_timeout - 1;
+            end if;
+          end if;
+
+        when RD_DATA =>
+          if s_xfer_done = '1' then
+            send_byte(C_IDLE_BYTE);
+            s_crc <= crc16_update(s_crc, s_rx_shift);
+            s_word(s_byte_idx*8+7 downto s_byte_idx*8) <= s_rx_shift;
+            if s_byte_idx = 3 then
+              s_byte_idx <= 0;
+            else
+              s_byte_idx <= s_byte_idx + 1;
+            end if;
+            s_count <= s_count - 1;
+            if s_count = 1 then
+              s_state <= RD_CRC;
+            end if;
+          end if;
+
+        when RD_CRC =>
+          if s_xfer_done = '1' then
+            if s_second_crc_byte = '0' then
+              send_byte(C_IDLE_BYTE);
+              s_crc_rx <= s_rx_shift;
+              s_second_crc_byte <= '1';
+            else
+              if (s_crc_rx & s_rx_shift) /= s_crc then
+                s_crc_err <= '1';
+              end if;
+              s_state <= IDLE;
+            end if;
+          end if;
+
+        when WR_TOKEN | WR_DATA =>
+          if s_xfer_done = '1' then
+            if s_count /= 0 then
+              send_fifo_byte;
+              s_state <= WR_DATA;
+            else
+              send_byte(s_crc(15 downto 8));
+              s_state <= WR_CRC;
+            end if;
+          end if;
+
+        when WR_CRC =>
+          if s_xfer_done = '1' then
+            if s_second_crc_byte = '0' then
+              send_byte(s_crc(7 downto 0));
+              s_second_crc_byte <= '1';
+            else
+              send_byte(C_IDLE_BYTE);
+              s_state <= WR_RESP;
+            end if;
+          end if;
+
+        when WR_RESP =>
+          if s_xfer_done = '1' then
+            if s_rx_shift /= C_IDLE_BYTE then
+              -- Data response token: xxx0sss1, where sss = 010 means "data accepted".
+              send_byte(C_IDLE_BYTE);
+              s_rx_byte <= s_rx_shift;
+              if s_rx_shift(4 downto 0) /= "00101" then
+                s_wr_err <= '1';
+              end if;
+              s_state <= WR_BUSY;
+            elsif s_timeout = 0 then
+              s_timeout_err <= '1';
+              s_state <= IDLE;
+            else
+              send_byte(C_IDLE_BYTE);
+              s_timeout <= s_timeout - 1;
+            end if;
+          end if;
+
+        when WR_BUSY =>
+          if s_xfer_done = '1' then
+            -- The card holds MISO low while it is busy.
+            if s_rx_shift /= x"00" then
+              s_state <= IDLE;
+            elsif s_timeout = 0 then
+              s_timeout_err <= '1';
+              s_state <= IDLE;
+            else
+              send_byte(C_IDLE_BYTE);
+              s_timeout <= s_timeout - 1;
+            end if;
+          end if;
+      end case;
+    end if;
+  end process;
+
+
+  --------------------------------------------------------------------------------------------------
+  -- Outputs.
+  --------------------------------------------------------------------------------------------------
+
+  o_data <= x"000000" & s_rx_byte;
+  o_stat(0) <= '0' when s_state = IDLE else '1';
+  o_stat(1) <= s_crc_err;
+  o_stat(2) <= s_timeout_err;
+  o_stat(3) <= s_wr_err;
+  o_stat(15 downto 4) <= (others => '0');
+  o_stat(23 downto 16) <= std_logic_vector(resize(s_fifo_count, 8));
+  o_stat(30 downto 24) <= (others => '0');
+  o_stat(31) <= '1';
+  o_fifo <= s_fifo_head;
+
+  o_sck <= s_sck;
+  o_mosi <= s_tx_shift(7);
+  o_cs_n <= not i_ctrl(1);
+end rtl;
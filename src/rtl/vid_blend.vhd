@@ -22,7 +22,19 @@ use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 use work.vid_types.all;
 
+----------------------------------------------------------------------------------------------------
+-- Layer blending.
+--
+-- The delay from i_color_* to o_color is C_VID_BLEND_DELAY + MUL_STAGES clock cycles (see
+-- vid_types). For higher clock frequencies, MUL_STAGES extra register stages can be inserted after
+-- the multiplications (B3), which also lets the synthesis tool use the output registers of the
+-- hardware multipliers.
+----------------------------------------------------------------------------------------------------
+
 entity vid_blend is
+  generic(
+    MUL_STAGES : natural := 0
+  );
   port(
     i_rst : in std_logic;
     i_clk : in std_logic;
@@ -64,6 +76,14 @@ architecture rtl of vid_blend is
   signal s_b3_g_2 : unsigned(16 downto 0);
   signal s_b3_b_2 : unsigned(16 downto 0);
 
+  -- Outputs from B3, after the optional extra pipeline stages.
+  signal s_b3x_r_1 : unsigned(16 downto 0);
+  signal s_b3x_g_1 : unsigned(16 downto 0);
+  signal s_b3x_b_1 : unsigned(16 downto 0);
+  signal s_b3x_r_2 : unsigned(16 downto 0);
+  signal s_b3x_g_2 : unsigned(16 downto 0);
+  signal s_b3x_b_2 : unsigned(16 downto 0);
+
   -- Outputs from B4.
   signal s_b4_r : std_logic_vector(8 downto 0);
   signal s_b4_b : std_logic_vector(8 downto 0);
@@ -218,6 +238,52 @@ begin
   end process;
 
 
+  -- Optional extra pipeline stages after the multiplications.
+  MulStagesGen: if MUL_STAGES > 0 generate
+    type T_MUL_STAGE is record
+      r_1 : unsigned(16 downto 0);
+      g_1 : unsigned(16 downto 0);
+      b_1 : unsigned(16 downto 0);
+      r_2 : unsigned(16 downto 0);
+      g_2 : unsigned(16 downto 0);
+      b_2 : unsigned(16 downto 0);
+    end record;
+    type T_MUL_STAGES is array (1 to MUL_STAGES) of T_MUL_STAGE;
+    signal s_stages : T_MUL_STAGES;
+  begin
+    process(i_clk, i_rst)
+    begin
+      if i_rst = '1' then
+        s_stages <= (others => (others => (others => '0')));
+      elsif rising_edge(i_clk) then
+        s_stages(1) <= (r_1 => s_b3_r_1,
+                        g_1 => s_b3_g_1,
+                        b_1 => s_b3_b_1,
+                        r_2 => s_b3_r_2,
+                        g_2 => s_b3_g_2,
+                        b_2 => s_b3_b_2);
+        for k in 2 to MUL_STAGES loop
+          s_stages(k) <= s_stages(k-1);
+        end loop;
+      end if;
+    end process;
+
+    s_b3x_r_1 <= s_stages(MUL_STAGES).r_1;
+    s_b3x_g_1 <= s_stages(MUL_STAGES).g_1;
+    s_b3x_b_1 <= s_stages(MUL_STAGES).b_1;
+    s_b3x_r_2 <= s_stages(MUL_STAGES).r_2;
+    s_b3x_g_2 <= s_stages(MUL_STAGES).g_2;
+    s_b3x_b_2 <= s_stages(MUL_STAGES).b_2;
+  else generate
+    s_b3x_r_1 <= s_b3_r_1;
+    s_b3x_g_1 <= s_b3_g_1;
+    s_b3x_b_1 <= s_b3_b_1;
+    s_b3x_r_2 <= s_b3_r_2;
+    s_b3x_g_2 <= s_b3_g_2;
+    s_b3x_b_2 <= s_b3_b_2;
+  end generate;
+
+
   --------------------------------------------------------------------------------------------------
   -- B4 - Blend all channels to the final color.
   --------------------------------------------------------------------------------------------------
@@ -233,9 +299,9 @@ begin
       s_b4_b <= (others => '0');
     elsif rising_edge(i_clk) then
       -- Blend (add the scaled components).
-      v_r := std_logic_vector(s_b3_r_1 + s_b3_r_2);
-      v_g := std_logic_vector(s_b3_g_1 + s_b3_g_2);
-      v_b := std_logic_vector(s_b3_b_1 + s_b3_b_2);
+      v_r := std_logic_vector(s_b3x_r_1 + s_b3x_r_2);
+      v_g := std_logic_vector(s_b3x_g_1 + s_b3x_g_2);
+      v_b := std_logic_vector(s_b3x_b_1 + s_b3x_b_2);
 
       -- Extract the most significant bits of each channel.
       -- TODO(m): We could do dithering here too.
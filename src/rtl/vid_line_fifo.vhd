@@ -0,0 +1,232 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- This is a line FIFO that decouples the pixel pipeline of a video layer from the VRAM video port.
+--
+-- The FIFO is flushed when i_row_start_imminent is asserted (during the horizontal blanking
+-- interval), and it then fetches consecutive memory rows, starting at i_row_start_addr (the rows
+-- are fetched in decrementing order when i_decremental_read is set). A new row is requested from
+-- the memory whenever there is room for it in the FIFO, and the memory may grant the request during
+-- any cycle (the data arrives one cycle after a granted request). Until the pixel pipeline has
+-- started to read from the FIFO, the FIFO restarts if i_row_start_addr changes (e.g. when the VCP
+-- changes ADDR late in the blanking interval).
+--
+-- The pixel pipeline drains the FIFO: A read request for a row that is in the FIFO (or that is
+-- being fetched during the same cycle) is answered during the next cycle, just like a memory read
+-- without wait states, and the rows before the requested row are dropped. The requested row stays
+-- in the FIFO until a later row is requested.
+--
+-- A read request for a row that has not been fetched is an underrun, which means that the layer
+-- needs more memory bandwidth than it got. The pixel pipeline does not get an ack for the request,
+-- o_underrun is asserted, and the FIFO restarts fetching from the row after the missed row.
+--
+-- Addresses are given in units of memory rows (2^LOG2_READ_WORDS words), and each FIFO entry holds
+-- one full memory row.
+----------------------------------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity vid_line_fifo is
+  generic(
+    LOG2_READ_WORDS : natural;
+    LOG2_DEPTH : positive
+  );
+  port(
+    i_rst : in std_logic;
+    i_clk : in std_logic;
+
+    -- Fetch control.
+    i_fetch_en : in std_logic;
+    i_decremental_read : in std_logic;
+    i_row_start_imminent : in std_logic;
+    i_row_start_addr : in std_logic_vector(23 downto 0);
+    o_underrun : out std_logic;
+
+    -- Interface from the pixel pipeline.
+    i_read_en : in std_logic;
+    i_read_adr : in std_logic_vector(23 downto 0);
+    o_read_ack : out std_logic;
+    o_read_dat : out std_logic_vector(32*(2**LOG2_READ_WORDS)-1 downto 0);
+
+    -- Interface to the RAM.
+    o_read_en : out std_logic;
+    o_read_adr : out std_logic_vector(23 downto 0);
+    i_read_grant : in std_logic;
+    i_read_dat : in std_logic_vector(32*(2**LOG2_READ_WORDS)-1 downto 0)
+  );
+end vid_line_fifo;
+
+architecture rtl of vid_line_fifo is
+  constant C_DEPTH : positive := 2**LOG2_DEPTH;
+
+  subtype T_ROW is std_logic_vector(32*(2**LOG2_READ_WORDS)-1 downto 0);
+  type T_ROW_ARRAY is array (0 to C_DEPTH-1) of T_ROW;
+  subtype T_IDX is unsigned(LOG2_DEPTH-1 downto 0);
+
+  signal s_rows : T_ROW_ARRAY;
+  signal s_rd_idx : T_IDX;
+  signal s_wr_idx : T_IDX;
+  signal s_count : integer range 0 to C_DEPTH;
+  signal s_inflight : std_logic;
+  signal s_head_adr : unsigned(23 downto 0);
+  signal s_fetch_adr : unsigned(23 downto 0);
+  signal s_start_adr : std_logic_vector(23 downto 0);
+  signal s_primed : std_logic;
+  signal s_fetch_req : std_logic;
+  signal s_resp_ack : std_logic;
+  signal s_resp_fwd : std_logic;
+  signal s_underrun : std_logic;
+
+  function next_adr(adr : unsigned; decremental : std_logic) return unsigned is
+  begin
+    if decremental = '1' then
+      return adr - 1;
+    else
+      return adr + 1;
+    end if;
+  end;
+begin
+  -- Request a new row as long as there is room for it (including the row that is in flight).
+  s_fetch_req <= i_fetch_en when s_count < C_DEPTH-1 or
+                                 (s_count = C_DEPTH-1 and s_inflight = '0') else
+                 '0';
+
+  process(i_clk, i_rst)
+    variable v_rd_idx : T_IDX;
+    variable v_wr_idx : T_IDX;
+    variable v_count : integer range 0 to C_DEPTH;
+    variable v_avail : integer range 0 to C_DEPTH;
+    variable v_granted : std_logic;
+    variable v_dist : unsigned(23 downto 0);
+    variable v_flush : boolean;
+    variable v_restart_adr : unsigned(23 downto 0);
+  begin
+    if i_rst = '1' then
+      s_rd_idx <= (others => '0');
+      s_wr_idx <= (others => '0');
+      s_count <= 0;
+      s_inflight <= '0';
+      s_head_adr <= (others => '0');
+      s_fetch_adr <= (others => '0');
+      s_start_adr <= (others => '0');
+      s_primed <= '0';
+      s_resp_ack <= '0';
+      s_resp_fwd <= '0';
+      s_underrun <= '0';
+    elsif rising_edge(i_clk) then
+      v_rd_idx := s_rd_idx;
+      v_wr_idx := s_wr_idx;
+      v_count := s_count;
+      v_granted := s_fetch_req and i_read_grant;
+      v_flush := false;
+      v_restart_adr := s_fetch_adr;
+
+      -- The row that was granted during the last cycle is stored in the FIFO during this cycle.
+      if s_inflight = '1' then
+        v_wr_idx := v_wr_idx + 1;
+        v_count := v_count + 1;
+      end if;
+
+      -- Advance the fetch address when the memory grants the request.
+      if v_granted = '1' then
+        s_fetch_adr <= next_adr(s_fetch_adr, i_decremental_read);
+      end if;
+      s_inflight <= v_granted;
+
+      -- Serve read requests from the pixel pipeline.
+      s_resp_ack <= '0';
+      s_resp_fwd <= '0';
+      s_underrun <= '0';
+      if i_read_en = '1' then
+        s_primed <= '1';
+
+        -- The requested row is v_dist rows after the head of the FIFO. The rows that are stored
+        -- in the FIFO are followed by the row that is granted during this cycle (if any).
+        if i_decremental_read = '1' then
+          v_dist := s_head_adr - unsigned(i_read_adr);
+        else
+          v_dist := unsigned(i_read_adr) - s_head_adr;
+        end if;
+        v_avail := v_count;
+        if v_granted = '1' then
+          v_avail := v_avail + 1;
+        end if;
+
+        if v_dist < v_avail then
+          -- Drop the rows before the requested row.
+          if to_integer(v_dist) = v_count then
+            s_resp_fwd <= '1';
+          end if;
+          v_rd_idx := v_rd_idx + v_dist(LOG2_DEPTH-1 downto 0);
+          v_count := v_count - to_integer(v_dist);
+          s_head_adr <= unsigned(i_read_adr);
+          s_resp_ack <= '1';
+        else
+          -- Underrun: Restart from the row after the missed row.
+          s_underrun <= '1';
+          v_flush := true;
+          v_restart_adr := next_adr(unsigned(i_read_adr), i_decremental_read);
+        end if;
+      elsif i_row_start_imminent = '1' or
+            (s_primed = '0' and i_row_start_addr /= s_start_adr) then
+        -- Start fetching a new line.
+        s_start_adr <= i_row_start_addr;
+        s_primed <= '0';
+        v_flush := true;
+        v_restart_adr := unsigned(i_row_start_addr);
+      end if;
+
+      -- Flush the FIFO (including the row that is granted during this cycle, if any).
+      if v_flush then
+        v_rd_idx := v_wr_idx;
+        v_count := 0;
+        s_inflight <= '0';
+        s_head_adr <= v_restart_adr;
+        s_fetch_adr <= v_restart_adr;
+      end if;
+
+      s_rd_idx <= v_rd_idx;
+      s_wr_idx <= v_wr_idx;
+      s_count <= v_count;
+    end if;
+  end process;
+
+  -- FIFO storage (written one cycle after a granted request).
+  process(i_clk)
+  begin
+    if rising_edge(i_clk) then
+      if s_inflight = '1' then
+        s_rows(to_integer(s_wr_idx)) <= i_read_dat;
+      end if;
+    end if;
+  end process;
+
+  -- Outputs to the memory subsystem.
+  o_read_en <= s_fetch_req;
+  o_read_adr <= std_logic_vector(s_fetch_adr);
+
+  -- Outputs to the pixel pipeline.
+  o_read_ack <= s_resp_ack;
+  o_read_dat <= i_read_dat when s_resp_fwd = '1' else
+                s_rows(to_integer(s_rd_idx));
+  o_underrun <= s_underrun;
+end rtl;
@@ -23,25 +23,41 @@ use ieee.numeric_std.all;
 
 ----------------------------------------------------------------------------------------------------
 -- Video color palette memory.
+--
+-- The memory holds 2^LOG2_NUM_BANKS palette banks of 256 colors each. Writes go to the bank given
+-- by i_write_bank and reads are done from the bank given by i_read_bank, so that one bank can be
+-- displayed while another bank is being updated. Bank numbers are taken modulo the number of
+-- banks.
 ----------------------------------------------------------------------------------------------------
 
 entity vid_palette is
+  generic(
+    LOG2_NUM_BANKS : natural := 0
+  );
   port(
     i_rst : in std_logic;
     i_clk : in std_logic;
 
     i_write_enable : in std_logic;
+    i_write_bank : in std_logic_vector(7 downto 0);
     i_write_addr : in std_logic_vector(7 downto 0);
     i_write_data : in std_logic_vector(31 downto 0);
 
+    i_read_bank : in std_logic_vector(7 downto 0);
     i_read_addr : in std_logic_vector(7 downto 0);
     o_read_data : out std_logic_vector(31 downto 0)
   );
 end vid_palette;
 
 architecture rtl of vid_palette is
-  type T_MEM is array (255 downto 0) of std_logic_vector(31 downto 0);
+  constant C_NUM_BANKS : positive := 2**LOG2_NUM_BANKS;
+  type T_MEM is array (C_NUM_BANKS*256-1 downto 0) of std_logic_vector(31 downto 0);
   signal s_mem : T_MEM;
+
+  function mem_index(bank : std_logic_vector; addr : std_logic_vector) return integer is
+  begin
+    return (to_integer(unsigned(bank)) mod C_NUM_BANKS) * 256 + to_integer(unsigned(addr));
+  end;
 begin
   -- The palette memory is a simple dual port memory (should synthesize to BRAM
   -- in an FPGA).
@@ -49,9 +65,9 @@ begin
   begin
     if rising_edge(i_clk) then
       if i_write_enable = '1' then
-        s_mem(to_integer(unsigned(i_write_addr))) <= i_write_data;
+        s_mem(mem_index(i_write_bank, i_write_addr)) <= i_write_data;
       end if;
-      o_read_data <= s_mem(to_integer(unsigned(i_read_addr)));
+      o_read_data <= s_mem(mem_index(i_read_bank, i_read_addr));
     end if;
   end process;
 end rtl;
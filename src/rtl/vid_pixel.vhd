@@ -36,35 +36,79 @@ use work.vid_types.all;
 --
 -- The pipeline is as follows:
 --
---   XCOORD -> PIXADDR -> PIXFETCH1 -> PIXFETCH2 -> SHIFT -> PALFETCH -> COLOR
+--   XCOORD -> PIXADDR -> PIXFETCH1 -> PIXFETCH2 -> SHIFT -> GLYPHFETCH1 -> GLYPHFETCH2 ->
+--   PALADDR -> PALFETCH -> COLOR
 --
 -- XCOORD:
 --   Calculate the next x coordinate.
 --
 -- PIXADDR:
---   Calculate the source pixel word address.
+--   Calculate the source pixel word address. For higher clock frequencies, ADDR_STAGES extra
+--   register stages can be inserted between the address calculation and the memory row compare.
 --
 -- PIXFETCH1:
---   Request the pixel word from RAM.
+--   Request the memory row (2^LOG2_READ_WORDS words) that holds the pixel word from RAM.
 --
 -- PIXFETCH2:
---   Get the pixel word from RAM.
+--   Get the memory row from RAM.
 --
 -- SHIFT:
---   Shift the relevant bits from the pixel word into the least significant part, according to the
---   current CMODE and x coordinate. This effectively produces the palette lookup address.
+--   Select the pixel word from the memory row, and shift the relevant bits from the pixel word into
+--   the least significant part, according to the current CMODE and x coordinate. This effectively
+--   produces the palette lookup address. In tile mode, the pixel word is a tile map word, and this
+--   stage calculates the glyph address for the tile instead. For higher clock frequencies,
+--   SHIFT_STAGES extra register stages can be inserted between the word selection and the shift.
+--
+-- GLYPHFETCH1:
+--   Request the glyph word from RAM (tile mode only).
+--
+-- GLYPHFETCH2:
+--   Get the glyph row from RAM (tile mode only).
+--
+-- PALADDR:
+--   Select the palette lookup address (the glyph pixel in tile mode).
 --
 -- PALFETCH:
 --   Fetch the palette color value.
 --
+-- The GLYPHFETCH1, GLYPHFETCH2 and PALADDR stages (and the tile map prefetch logic) are only
+-- present when ENABLE_TILE_MODE is true. Otherwise the palette lookup address is taken directly
+-- from the SHIFT stage, and CMODE = 6 is an undefined color mode.
+--
 -- COLOR:
 --   Final color step.
+--
+-- Tile mode:
+--   In tile mode (CMODE = 6), ADDR points to a tile map row, where each tile is an 8-bit glyph
+--   index (four tiles per word, the first tile in the least significant byte). The GLYPHS VCR
+--   points to a glyph table, where each glyph is 8x16 pixels at one bit per pixel: The glyph for
+--   tile number T occupies the four words starting at GLYPHS + 4 * T, with one byte per glyph row
+--   (the first row in the least significant byte), and the leftmost pixel in the least significant
+--   bit of each byte. The glyph pixel value (0 or 1) is used as the palette index.
+--
+--   The glyph row is the number of scanlines since the start of the current map row (see
+--   vid_regs), divided by 2^CMODE[5:4], which makes it possible to vertically scale the glyphs
+--   (use REPEAT to step ADDR to the next map row).
+--
+--   The tile map words are read ahead of time into a small cache, during memory cycles that are
+--   not used by glyph reads. This requires that 0 < XINCR <= 1.0, and that the layer has no memory
+--   wait states: Tile mode reads bypass the line FIFO, and they are served as urgent reads (see
+--   video_layer). Tile mode requires ENABLE_TILE_MODE, which is only enabled for the top layer
+--   (see video).
+--
+-- Delay:
+--   The delay from i_raster_x to o_color is C_VID_PIXEL_DELAY + ADDR_STAGES + SHIFT_STAGES clock
+--   cycles, plus C_VID_TILE_MODE_DELAY clock cycles if ENABLE_TILE_MODE is true (see vid_types).
 ----------------------------------------------------------------------------------------------------
 
 entity vid_pixel is
   generic(
     X_COORD_BITS : positive;
-    Y_COORD_BITS : positive
+    Y_COORD_BITS : positive;
+    LOG2_READ_WORDS : natural;
+    ADDR_STAGES : natural := 0;
+    SHIFT_STAGES : natural := 0;
+    ENABLE_TILE_MODE : boolean := false
   );
   port(
     i_rst : in std_logic;
@@ -75,9 +119,10 @@ entity vid_pixel is
     i_raster_y : in std_logic_vector(Y_COORD_BITS-1 downto 0);
 
     -- RAM interface.
+    -- Note: The read address is given in units of memory rows (2^LOG2_READ_WORDS words).
     o_mem_read_en : out std_logic;
     o_mem_read_addr : out std_logic_vector(23 downto 0);
-    i_mem_data : in std_logic_vector(31 downto 0);
+    i_mem_data : in std_logic_vector(32*(2**LOG2_READ_WORDS)-1 downto 0);
     i_mem_ack : in std_logic;
 
     -- Palette interface.
@@ -87,6 +132,9 @@ entity vid_pixel is
     -- VCR:s.
     i_regs : in T_VID_REGS;
 
+    -- Number of scanlines since the start of the current row (used in tile mode).
+    i_row_line : in std_logic_vector(11 downto 0);
+
     -- Final output color.
     o_color : out std_logic_vector(31 downto 0)
   );
@@ -96,6 +144,9 @@ architecture rtl of vid_pixel is
   -- Fixed point configuration (16.16 bits).
   constant C_FP_BITS : positive := 32;
 
+  -- Number of words per memory row.
+  constant C_NUM_WORDS : positive := 2**LOG2_READ_WORDS;
+
   -- Color modes.
   constant C_CMODE_RGBA32 : std_logic_vector(3 downto 0) := 4X"0";
   constant C_CMODE_RGBA16 : std_logic_vector(3 downto 0) := 4X"1";
@@ -103,6 +154,7 @@ architecture rtl of vid_pixel is
   constant C_CMODE_PAL4 : std_logic_vector(3 downto 0) := 4X"3";
   constant C_CMODE_PAL2 : std_logic_vector(3 downto 0) := 4X"4";
   constant C_CMODE_PAL1 : std_logic_vector(3 downto 0) := 4X"5";
+  constant C_CMODE_TILE : std_logic_vector(3 downto 0) := 4X"6";
 
   signal s_xc_hpos : signed(23 downto 0);
   signal s_xc_next_active : std_logic;
@@ -122,9 +174,18 @@ architecture rtl of vid_pixel is
   signal s_pa_offs_2 : std_logic_vector(23 downto 0);
   signal s_pa_offs_1 : std_logic_vector(23 downto 0);
   signal s_pa_offs : std_logic_vector(23 downto 0);
+  signal s_pa_calc_addr : std_logic_vector(23 downto 0);
+  signal s_pa_calc_shift : std_logic_vector(4 downto 0);
+  signal s_pa_calc_is_tile : std_logic;
   signal s_pa_addr : std_logic_vector(23 downto 0);
+  signal s_pa_xc_active : std_logic;
+  signal s_pa_xc_in_blanking_area : std_logic;
+  signal s_pa_xc_is_hstrt : std_logic;
   signal s_pa_prev_addr : std_logic_vector(23 downto 0);
   signal s_pa_addr_is_new : std_logic;
+  signal s_pa_is_tile : std_logic;
+  signal s_pa_word_is_new : std_logic;
+  signal s_pa_next_new_word : std_logic;
   signal s_pa_next_mem_read_en : std_logic;
   signal s_pa_next_shift_32 : std_logic_vector(4 downto 0);
   signal s_pa_next_shift_16 : std_logic_vector(4 downto 0);
@@ -134,26 +195,91 @@ architecture rtl of vid_pixel is
   signal s_pa_next_shift_1 : std_logic_vector(4 downto 0);
   signal s_pa_next_shift : std_logic_vector(4 downto 0);
   signal s_pa_mem_read_en : std_logic;
+  signal s_pa_word : integer range 0 to C_NUM_WORDS-1;
   signal s_pa_shift : std_logic_vector(4 downto 0);
   signal s_pa_active : std_logic;
   signal s_pa_in_blanking_area : std_logic;
-
+  signal s_pa_new_word : std_logic;
+  signal s_pa_first : std_logic;
+  signal s_pa_map_entry : std_logic;
+
+  signal s_mpf_req : std_logic;
+  signal s_mpf_req_addr : std_logic_vector(23 downto 0);
+  signal s_mpf_issue : std_logic;
+  signal s_mpf_pending : std_logic;
+  signal s_mpf_addr : std_logic_vector(23 downto 0);
+
+  signal s_rq_addr : std_logic_vector(23 downto 0);
+  signal s_rq_to_cache : std_logic;
+  signal s_rq_to_glyph : std_logic;
+  signal s_rq_word : integer range 0 to C_NUM_WORDS-1;
+  signal s_rq_entry : std_logic;
+  signal s_rq_byte : std_logic_vector(1 downto 0);
+
+  signal s_pf1_word : integer range 0 to C_NUM_WORDS-1;
   signal s_pf1_shift : std_logic_vector(4 downto 0);
   signal s_pf1_active : std_logic;
   signal s_pf1_in_blanking_area : std_logic;
+  signal s_pf1_first : std_logic;
+  signal s_pf1_map_entry : std_logic;
 
-  signal s_pf2_data : std_logic_vector(31 downto 0);
+  signal s_pf2_data : std_logic_vector(32*C_NUM_WORDS-1 downto 0);
+  signal s_pf2_word : integer range 0 to C_NUM_WORDS-1;
   signal s_pf2_shift : std_logic_vector(4 downto 0);
   signal s_pf2_active : std_logic;
   signal s_pf2_in_blanking_area : std_logic;
-
+  signal s_pf2_first : std_logic;
+  signal s_pf2_map_entry : std_logic;
+  signal s_map_word_0 : std_logic_vector(31 downto 0);
+  signal s_map_word_1 : std_logic_vector(31 downto 0);
+
+  signal s_sh_sel_word_data : std_logic_vector(31 downto 0);
+  signal s_sh_sel_map_word : std_logic_vector(31 downto 0);
+  signal s_sh_word_data : std_logic_vector(31 downto 0);
+  signal s_sh_shift : std_logic_vector(4 downto 0);
+  signal s_sh_active : std_logic;
+  signal s_sh_src_in_blanking_area : std_logic;
+  signal s_sh_first : std_logic;
   signal s_sh_shifted_idx : std_logic_vector(7 downto 0);
+  signal s_sh_next_pal_idx : std_logic_vector(7 downto 0);
+  signal s_sh_map_word : std_logic_vector(31 downto 0);
+  signal s_sh_tile : std_logic_vector(7 downto 0);
+  signal s_sh_glyph_row : unsigned(11 downto 0);
+  signal s_sh_next_is_tile : std_logic;
+  signal s_sh_next_glyph_addr : std_logic_vector(23 downto 0);
+  signal s_sh_next_glyph_read_en : std_logic;
   signal s_sh_shifted_rgba16 : std_logic_vector(15 downto 0);
   signal s_sh_next_data : std_logic_vector(31 downto 0);
   signal s_sh_data : std_logic_vector(31 downto 0);
   signal s_sh_next_is_truecolor : std_logic;
   signal s_sh_is_truecolor : std_logic;
   signal s_sh_in_blanking_area : std_logic;
+  signal s_sh_pal_idx : std_logic_vector(7 downto 0);
+  signal s_sh_is_tile : std_logic;
+  signal s_sh_glyph_read_en : std_logic;
+  signal s_sh_glyph_addr : std_logic_vector(23 downto 0);
+  signal s_sh_glyph_byte : std_logic_vector(1 downto 0);
+  signal s_sh_glyph_bit : std_logic_vector(2 downto 0);
+
+  signal s_gf1_data : std_logic_vector(31 downto 0);
+  signal s_gf1_is_truecolor : std_logic;
+  signal s_gf1_in_blanking_area : std_logic;
+  signal s_gf1_pal_idx : std_logic_vector(7 downto 0);
+  signal s_gf1_is_tile : std_logic;
+  signal s_gf1_glyph_bit : std_logic_vector(2 downto 0);
+
+  signal s_gf2_data : std_logic_vector(31 downto 0);
+  signal s_gf2_is_truecolor : std_logic;
+  signal s_gf2_in_blanking_area : std_logic;
+  signal s_gf2_pal_idx : std_logic_vector(7 downto 0);
+  signal s_gf2_is_tile : std_logic;
+  signal s_gf2_glyph_bit : std_logic_vector(2 downto 0);
+  signal s_gf2_glyph : std_logic_vector(7 downto 0);
+  signal s_gf2_glyph_pixel : std_logic;
+
+  signal s_pl_data : std_logic_vector(31 downto 0);
+  signal s_pl_is_truecolor : std_logic;
+  signal s_pl_in_blanking_area : std_logic;
 
   signal s_palf_next_data : std_logic_vector(31 downto 0);
   signal s_palf_data : std_logic_vector(31 downto 0);
@@ -187,6 +313,18 @@ architecture rtl of vid_pixel is
     return v_a & v_b & v_g & v_r;
   end;
 
+  function select_word(x: std_logic_vector; idx: integer) return std_logic_vector is
+    variable v_result : std_logic_vector(31 downto 0);
+  begin
+    v_result := (others => '0');
+    for k in 0 to C_NUM_WORDS-1 loop
+      if idx = k then
+        v_result := x(k*32+31 downto k*32);
+      end if;
+    end loop;
+    return v_result;
+  end;
+
   function shr_8bits(x: std_logic_vector; s: std_logic_vector) return std_logic_vector is
     variable v_shift : integer;
     variable v_shr32 : unsigned(31 downto 0);
@@ -238,8 +376,6 @@ begin
 
   -----------------------------------------------------------------------------
   -- PIXADDR
-  -- TODO(m): If we need to run at higher clock frequencies, split this stage
-  -- into two pipeline stages.
   -----------------------------------------------------------------------------
 
   -- Determine the offset, taking into account the bits-per-pixel as a shift.
@@ -263,20 +399,34 @@ begin
         s_pa_offs_8 when C_CMODE_PAL8,
         s_pa_offs_4 when C_CMODE_PAL4,
         s_pa_offs_2 when C_CMODE_PAL2,
-        s_pa_offs_1 when C_CMODE_PAL1,
+        s_pa_offs_1 when C_CMODE_PAL1 | C_CMODE_TILE,
         (others => '-') when others;
 
   -- Calculate the memory address.
-  s_pa_addr <= std_logic_vector(unsigned(i_regs.ADDR) + unsigned(s_pa_offs));
+  s_pa_calc_addr <= std_logic_vector(unsigned(i_regs.ADDR) + unsigned(s_pa_offs));
 
-  -- Is this the same address as for the previous cycle?
+  -- Is this the same memory row as for the previous cycle?
   -- The largest possible address delta between two pixels is 256, so we only
   -- need to compare the 9 least significant bits of the address (special case:
-  -- if we're on the HSTRT X coordinate, we force a new data read).
-  -- Note: We assume that there are no wait-states from the memory, so we do
-  -- not have to consider whether or not we got an ACK for the last request.
-  s_pa_addr_is_new <= '1' when s_pa_addr(8 downto 0) /= s_pa_prev_addr(8 downto 0) else '0';
-  s_pa_next_mem_read_en <= s_xc_active and (s_pa_addr_is_new or s_xc_is_hstrt);
+  -- if we're on the HSTRT X coordinate, we force a new data read). The word
+  -- index bits within the memory row are not part of the comparison.
+  -- Note: We assume that there are no wait-states from the memory (the line
+  -- FIFO answers all requests during the next cycle unless it underruns), so
+  -- we do not have to consider whether or not we got an ACK for the last
+  -- request.
+  s_pa_addr_is_new <= '1' when s_pa_addr(8 downto LOG2_READ_WORDS) /=
+                               s_pa_prev_addr(8 downto LOG2_READ_WORDS) else '0';
+
+  -- In tile mode (where each tile map word covers 32 pixels), the tile map word is only read on the
+  -- HSTRT X coordinate. Every time that we enter a new tile map word we request a prefetch of the
+  -- following tile map word instead (see MAPPREFETCH below).
+  s_pa_calc_is_tile <= '1' when ENABLE_TILE_MODE and i_regs.CMODE(3 downto 0) = C_CMODE_TILE else
+                       '0';
+  s_pa_word_is_new <= '1' when s_pa_addr(8 downto 0) /= s_pa_prev_addr(8 downto 0) else '0';
+  s_pa_next_mem_read_en <= s_pa_xc_active and s_pa_xc_is_hstrt when s_pa_is_tile = '1' else
+                           s_pa_xc_active and (s_pa_addr_is_new or s_pa_xc_is_hstrt);
+  s_pa_next_new_word <= s_pa_is_tile and s_pa_xc_active and
+                        (s_pa_word_is_new or s_pa_xc_is_hstrt);
 
   -- Determine the bit shift amount.
   s_pa_next_shift_32 <= "00000";
@@ -287,32 +437,115 @@ begin
   s_pa_next_shift_1 <= s_xc_pos(20 downto 16);
 
   ShiftMux: with i_regs.CMODE(3 downto 0) select
-    s_pa_next_shift <=
+    s_pa_calc_shift <=
         s_pa_next_shift_32 when C_CMODE_RGBA32,
         s_pa_next_shift_16 when C_CMODE_RGBA16,
         s_pa_next_shift_8 when C_CMODE_PAL8,
         s_pa_next_shift_4 when C_CMODE_PAL4,
         s_pa_next_shift_2 when C_CMODE_PAL2,
-        s_pa_next_shift_1 when C_CMODE_PAL1,
+        s_pa_next_shift_1 when C_CMODE_PAL1 | C_CMODE_TILE,
         (others => '-') when others;
 
+  -- Optional extra pipeline stages between the address calculation and the memory row compare.
+  AddrStagesGen: if ADDR_STAGES > 0 generate
+    type T_ADDR_STAGE is record
+      addr : std_logic_vector(23 downto 0);
+      shift : std_logic_vector(4 downto 0);
+      is_tile : std_logic;
+      active : std_logic;
+      in_blanking_area : std_logic;
+      is_hstrt : std_logic;
+    end record;
+    type T_ADDR_STAGES is array (1 to ADDR_STAGES) of T_ADDR_STAGE;
+    signal s_stages : T_ADDR_STAGES;
+  begin
+    process(i_clk, i_rst)
+    begin
+      if i_rst = '1' then
+        s_stages <= (others => (addr => (others => '0'),
+                                shift => (others => '0'),
+                                is_tile => '0',
+                                active => '0',
+                                in_blanking_area => '1',
+                                is_hstrt => '0'));
+      elsif rising_edge(i_clk) then
+        s_stages(1) <= (addr => s_pa_calc_addr,
+                        shift => s_pa_calc_shift,
+                        is_tile => s_pa_calc_is_tile,
+                        active => s_xc_active,
+                        in_blanking_area => s_xc_in_blanking_area,
+                        is_hstrt => s_xc_is_hstrt);
+        for k in 2 to ADDR_STAGES loop
+          s_stages(k) <= s_stages(k-1);
+        end loop;
+      end if;
+    end process;
+
+    s_pa_addr <= s_stages(ADDR_STAGES).addr;
+    s_pa_next_shift <= s_stages(ADDR_STAGES).shift;
+    s_pa_is_tile <= s_stages(ADDR_STAGES).is_tile;
+    s_pa_xc_active <= s_stages(ADDR_STAGES).active;
+    s_pa_xc_in_blanking_area <= s_stages(ADDR_STAGES).in_blanking_area;
+    s_pa_xc_is_hstrt <= s_stages(ADDR_STAGES).is_hstrt;
+  else generate
+    s_pa_addr <= s_pa_calc_addr;
+    s_pa_next_shift <= s_pa_calc_shift;
+    s_pa_is_tile <= s_pa_calc_is_tile;
+    s_pa_xc_active <= s_xc_active;
+    s_pa_xc_in_blanking_area <= s_xc_in_blanking_area;
+    s_pa_xc_is_hstrt <= s_xc_is_hstrt;
+  end generate;
+
   -- PIXADDR registers.
   process(i_clk, i_rst)
   begin
     if i_rst = '1' then
+      s_pa_word <= 0;
       s_pa_shift <= (others => '0');
       s_pa_active <= '0';
       s_pa_in_blanking_area <= '1';
       s_pa_prev_addr <=  24x"123456";  -- Unlikely address.
       s_pa_mem_read_en <= '0';
+      s_pa_new_word <= '0';
+      s_pa_first <= '0';
+      s_pa_map_entry <= '0';
     elsif rising_edge(i_clk) then
+      s_pa_word <= to_integer(unsigned(s_pa_addr(7 downto 0))) mod C_NUM_WORDS;
       s_pa_shift <= s_pa_next_shift;
-      s_pa_active <= s_xc_active;
-      s_pa_in_blanking_area <= s_xc_in_blanking_area;
-      if s_pa_next_mem_read_en then
+      s_pa_active <= s_pa_xc_active;
+      s_pa_in_blanking_area <= s_pa_xc_in_blanking_area;
+      if s_pa_next_mem_read_en = '1' or s_pa_next_new_word = '1' then
         s_pa_prev_addr <= s_pa_addr;
       end if;
       s_pa_mem_read_en <= s_pa_next_mem_read_en;
+      s_pa_new_word <= s_pa_next_new_word;
+      s_pa_first <= s_pa_xc_active and s_pa_xc_is_hstrt;
+      s_pa_map_entry <= s_pa_addr(0);
+    end if;
+  end process;
+
+
+  -----------------------------------------------------------------------------
+  -- MAPPREFETCH (tile mode only)
+  -----------------------------------------------------------------------------
+
+  -- Request a prefetch of the next tile map word when we enter a new tile map
+  -- word. The prefetch is issued during the first memory cycle that is not
+  -- used by other reads (there are at least 32 cycles to the next word).
+  s_mpf_req <= s_pa_new_word or s_mpf_pending;
+  s_mpf_req_addr <= std_logic_vector(unsigned(s_pa_prev_addr) + 1) when s_pa_new_word = '1' else
+                    s_mpf_addr;
+  s_mpf_issue <= s_mpf_req and not (s_pa_mem_read_en or s_sh_glyph_read_en);
+
+  -- MAPPREFETCH registers.
+  process(i_clk, i_rst)
+  begin
+    if i_rst = '1' then
+      s_mpf_pending <= '0';
+      s_mpf_addr <= (others => '0');
+    elsif rising_edge(i_clk) then
+      s_mpf_pending <= s_mpf_req and not s_mpf_issue;
+      s_mpf_addr <= s_mpf_req_addr;
     end if;
   end process;
 
@@ -321,21 +554,52 @@ begin
   -- PIXFETCH1
   -----------------------------------------------------------------------------
 
-  -- Outputs to the memory read interface.
-  o_mem_read_addr <= s_pa_prev_addr;
-  o_mem_read_en <= s_pa_mem_read_en;
+  -- Select the memory request (glyph reads have priority over pixel reads and
+  -- tile map prefetches).
+  s_rq_addr <= s_sh_glyph_addr when s_sh_glyph_read_en = '1' else
+               s_mpf_req_addr when s_mpf_issue = '1' else
+               s_pa_prev_addr;
+
+  -- Outputs to the memory read interface (convert the word address to a row address).
+  o_mem_read_addr <= std_logic_vector(shift_right(unsigned(s_rq_addr), LOG2_READ_WORDS));
+  o_mem_read_en <= s_pa_mem_read_en or s_mpf_issue or s_sh_glyph_read_en;
+
+  -- Remember where to put the requested data (it arrives one cycle later).
+  process(i_clk, i_rst)
+  begin
+    if i_rst = '1' then
+      s_rq_to_cache <= '0';
+      s_rq_to_glyph <= '0';
+      s_rq_word <= 0;
+      s_rq_entry <= '0';
+      s_rq_byte <= (others => '0');
+    elsif rising_edge(i_clk) then
+      s_rq_to_cache <= (s_mpf_issue or (s_pa_mem_read_en and s_pa_new_word)) and
+                       not s_sh_glyph_read_en;
+      s_rq_to_glyph <= s_sh_glyph_read_en;
+      s_rq_word <= to_integer(unsigned(s_rq_addr(7 downto 0))) mod C_NUM_WORDS;
+      s_rq_entry <= s_rq_addr(0);
+      s_rq_byte <= s_sh_glyph_byte;
+    end if;
+  end process;
 
   -- PIXFETCH1 registers.
   process(i_clk, i_rst)
   begin
     if i_rst = '1' then
+      s_pf1_word <= 0;
       s_pf1_shift <= (others => '0');
       s_pf1_active <= '0';
       s_pf1_in_blanking_area <= '1';
+      s_pf1_first <= '0';
+      s_pf1_map_entry <= '0';
     elsif rising_edge(i_clk) then
+      s_pf1_word <= s_pa_word;
       s_pf1_shift <= s_pa_shift;
       s_pf1_active <= s_pa_active;
       s_pf1_in_blanking_area <= s_pa_in_blanking_area;
+      s_pf1_first <= s_pa_first;
+      s_pf1_map_entry <= s_pa_map_entry;
     end if;
   end process;
 
@@ -349,9 +613,14 @@ begin
   begin
     if i_rst = '1' then
       s_pf2_data <= (others => '0');
+      s_pf2_word <= 0;
       s_pf2_shift <= (others => '0');
       s_pf2_active <= '0';
       s_pf2_in_blanking_area <= '1';
+      s_pf2_first <= '0';
+      s_pf2_map_entry <= '0';
+      s_map_word_0 <= (others => '0');
+      s_map_word_1 <= (others => '0');
     elsif rising_edge(i_clk) then
       if s_pf1_active = '0' then
         -- Force palette color #0 ("background") for the inactive area.
@@ -359,9 +628,22 @@ begin
       elsif i_mem_ack = '1' then
         s_pf2_data <= i_mem_data;
       end if;
+      s_pf2_word <= s_pf1_word;
       s_pf2_shift <= s_pf1_shift;
       s_pf2_active <= s_pf1_active;
       s_pf2_in_blanking_area <= s_pf1_in_blanking_area;
+      s_pf2_first <= s_pf1_first;
+      s_pf2_map_entry <= s_pf1_map_entry;
+
+      -- The tile map cache holds two consecutive tile map words (indexed by the
+      -- least significant bit of the word address).
+      if i_mem_ack = '1' and s_rq_to_cache = '1' then
+        if s_rq_entry = '1' then
+          s_map_word_1 <= select_word(i_mem_data, s_rq_word);
+        else
+          s_map_word_0 <= select_word(i_mem_data, s_rq_word);
+        end if;
+      end if;
     end if;
   end process;
 
@@ -370,13 +652,69 @@ begin
   -- SHIFT
   -----------------------------------------------------------------------------
 
+  -- Select the pixel word from the memory row, and the tile map word from the tile map cache.
+  -- Note: The tile map word must be selected here (before any extra pipeline stages), since the
+  -- tile map cache entry may be overwritten by a prefetch in the next cycle.
+  s_sh_sel_word_data <= select_word(s_pf2_data, s_pf2_word);
+  s_sh_sel_map_word <= s_map_word_1 when s_pf2_map_entry = '1' else s_map_word_0;
+
+  -- Optional extra pipeline stages between the word selection and the shift.
+  ShiftStagesGen: if SHIFT_STAGES > 0 generate
+    type T_SHIFT_STAGE is record
+      word_data : std_logic_vector(31 downto 0);
+      map_word : std_logic_vector(31 downto 0);
+      shift : std_logic_vector(4 downto 0);
+      active : std_logic;
+      in_blanking_area : std_logic;
+      first : std_logic;
+    end record;
+    type T_SHIFT_STAGES is array (1 to SHIFT_STAGES) of T_SHIFT_STAGE;
+    signal s_stages : T_SHIFT_STAGES;
+  begin
+    process(i_clk, i_rst)
+    begin
+      if i_rst = '1' then
+        s_stages <= (others => (word_data => (others => '0'),
+                                map_word => (others => '0'),
+                                shift => (others => '0'),
+                                active => '0',
+                                in_blanking_area => '1',
+                                first => '0'));
+      elsif rising_edge(i_clk) then
+        s_stages(1) <= (word_data => s_sh_sel_word_data,
+                        map_word => s_sh_sel_map_word,
+                        shift => s_pf2_shift,
+                        active => s_pf2_active,
+                        in_blanking_area => s_pf2_in_blanking_area,
+                        first => s_pf2_first);
+        for k in 2 to SHIFT_STAGES loop
+          s_stages(k) <= s_stages(k-1);
+        end loop;
+      end if;
+    end process;
+
+    s_sh_word_data <= s_stages(SHIFT_STAGES).word_data;
+    s_sh_map_word <= s_stages(SHIFT_STAGES).map_word;
+    s_sh_shift <= s_stages(SHIFT_STAGES).shift;
+    s_sh_active <= s_stages(SHIFT_STAGES).active;
+    s_sh_src_in_blanking_area <= s_stages(SHIFT_STAGES).in_blanking_area;
+    s_sh_first <= s_stages(SHIFT_STAGES).first;
+  else generate
+    s_sh_word_data <= s_sh_sel_word_data;
+    s_sh_map_word <= s_sh_sel_map_word;
+    s_sh_shift <= s_pf2_shift;
+    s_sh_active <= s_pf2_active;
+    s_sh_src_in_blanking_area <= s_pf2_in_blanking_area;
+    s_sh_first <= s_pf2_first;
+  end generate;
+
   -- Determine the palette index by shifting and masking the data word.
-  s_sh_shifted_idx <= shr_8bits(s_pf2_data, s_pf2_shift);
+  s_sh_shifted_idx <= shr_8bits(s_sh_word_data, s_sh_shift);
 
   -- Mask the palette index according to the current CMODE (i.e. only preserve
   -- the correct number of bits per pixel).
   IdxMaskMux: with i_regs.CMODE(3 downto 0) select
-    o_pal_addr <=
+    s_sh_next_pal_idx <=
         "0000"    & s_sh_shifted_idx(3 downto 0) when C_CMODE_PAL4,
         "000000"  & s_sh_shifted_idx(1 downto 0) when C_CMODE_PAL2,
         "0000000" & s_sh_shifted_idx(0 downto 0) when C_CMODE_PAL1,
@@ -385,18 +723,35 @@ begin
   -- Truecolor data transformation.
   -- NOTE: We select the correct half of the 32-bit word when the color mode is
   -- RGBA16, based on the shift amount (which can only be 0 or 16).
-  s_sh_shifted_rgba16 <= s_pf2_data(31 downto 16) when s_pf2_shift(4) = '1' else
-                         s_pf2_data(15 downto 0);
-  s_sh_next_data <= s_pf2_data when i_regs.CMODE(3 downto 0) = C_CMODE_RGBA32 else
+  s_sh_shifted_rgba16 <= s_sh_word_data(31 downto 16) when s_sh_shift(4) = '1' else
+                         s_sh_word_data(15 downto 0);
+  s_sh_next_data <= s_sh_word_data when i_regs.CMODE(3 downto 0) = C_CMODE_RGBA32 else
                     abgr16_to_abgr32(s_sh_shifted_rgba16);
 
   -- Is this a palette lookup or truecolor pixel?
   -- Note: We force palette mode in the inactive area.
   IsTruecolorMux: with i_regs.CMODE(3 downto 0) select
     s_sh_next_is_truecolor <=
-        s_pf2_active when C_CMODE_RGBA32 | C_CMODE_RGBA16,
+        s_sh_active when C_CMODE_RGBA32 | C_CMODE_RGBA16,
         '0' when others;
 
+  -- Tile mode: Select the tile from the cached tile map word, and calculate the
+  -- glyph address (GLYPHS + 4 * tile + glyph_row / 4).
+  s_sh_tile <= shr_8bits(s_sh_map_word, s_sh_shift(4 downto 3) & "000");
+  s_sh_glyph_row <= shift_right(unsigned(i_row_line),
+                                to_integer(unsigned(i_regs.CMODE(5 downto 4))));
+  s_sh_next_glyph_addr <= std_logic_vector(unsigned(i_regs.GLYPHS) +
+                                           (unsigned(s_sh_tile) & s_sh_glyph_row(3 downto 2)));
+  s_sh_next_is_tile <= s_sh_active when ENABLE_TILE_MODE and
+                                        i_regs.CMODE(3 downto 0) = C_CMODE_TILE else
+                       '0';
+
+  -- Only read the glyph word when it differs from the previous one (we force a
+  -- new read for the first pixel of the line).
+  s_sh_next_glyph_read_en <= s_sh_next_is_tile when s_sh_first = '1' or
+                                                    s_sh_next_glyph_addr /= s_sh_glyph_addr else
+                             '0';
+
   -- SHIFT registers.
   process(i_clk, i_rst)
   begin
@@ -404,21 +759,120 @@ begin
       s_sh_data <= (others => '0');
       s_sh_is_truecolor <= '0';
       s_sh_in_blanking_area <= '1';
+      s_sh_pal_idx <= (others => '0');
+      s_sh_is_tile <= '0';
+      s_sh_glyph_read_en <= '0';
+      s_sh_glyph_addr <= (others => '0');
+      s_sh_glyph_byte <= (others => '0');
+      s_sh_glyph_bit <= (others => '0');
     elsif rising_edge(i_clk) then
       s_sh_data <= s_sh_next_data;
       s_sh_is_truecolor <= s_sh_next_is_truecolor;
-      s_sh_in_blanking_area <= s_pf2_in_blanking_area;
+      s_sh_in_blanking_area <= s_sh_src_in_blanking_area;
+      s_sh_pal_idx <= s_sh_next_pal_idx;
+      s_sh_is_tile <= s_sh_next_is_tile;
+      s_sh_glyph_read_en <= s_sh_next_glyph_read_en;
+      if s_sh_next_glyph_read_en = '1' then
+        s_sh_glyph_addr <= s_sh_next_glyph_addr;
+        s_sh_glyph_byte <= std_logic_vector(s_sh_glyph_row(1 downto 0));
+      end if;
+      s_sh_glyph_bit <= s_sh_shift(2 downto 0);
     end if;
   end process;
 
 
+  TileModeGen: if ENABLE_TILE_MODE generate
+    -----------------------------------------------------------------------------
+    -- GLYPHFETCH1
+    -----------------------------------------------------------------------------
+
+    -- GLYPHFETCH1 registers.
+    process(i_clk, i_rst)
+    begin
+      if i_rst = '1' then
+        s_gf1_data <= (others => '0');
+        s_gf1_is_truecolor <= '0';
+        s_gf1_in_blanking_area <= '1';
+        s_gf1_pal_idx <= (others => '0');
+        s_gf1_is_tile <= '0';
+        s_gf1_glyph_bit <= (others => '0');
+      elsif rising_edge(i_clk) then
+        s_gf1_data <= s_sh_data;
+        s_gf1_is_truecolor <= s_sh_is_truecolor;
+        s_gf1_in_blanking_area <= s_sh_in_blanking_area;
+        s_gf1_pal_idx <= s_sh_pal_idx;
+        s_gf1_is_tile <= s_sh_is_tile;
+        s_gf1_glyph_bit <= s_sh_glyph_bit;
+      end if;
+    end process;
+
+
+    -----------------------------------------------------------------------------
+    -- GLYPHFETCH2
+    -----------------------------------------------------------------------------
+
+    -- GLYPHFETCH2 registers.
+    process(i_clk, i_rst)
+    begin
+      if i_rst = '1' then
+        s_gf2_data <= (others => '0');
+        s_gf2_is_truecolor <= '0';
+        s_gf2_in_blanking_area <= '1';
+        s_gf2_pal_idx <= (others => '0');
+        s_gf2_is_tile <= '0';
+        s_gf2_glyph_bit <= (others => '0');
+        s_gf2_glyph <= (others => '0');
+      elsif rising_edge(i_clk) then
+        s_gf2_data <= s_gf1_data;
+        s_gf2_is_truecolor <= s_gf1_is_truecolor;
+        s_gf2_in_blanking_area <= s_gf1_in_blanking_area;
+        s_gf2_pal_idx <= s_gf1_pal_idx;
+        s_gf2_is_tile <= s_gf1_is_tile;
+        s_gf2_glyph_bit <= s_gf1_glyph_bit;
+        if i_mem_ack = '1' and s_rq_to_glyph = '1' then
+          s_gf2_glyph <= shr_8bits(select_word(i_mem_data, s_rq_word), s_rq_byte & "000");
+        end if;
+      end if;
+    end process;
+
+
+    -----------------------------------------------------------------------------
+    -- PALADDR
+    -----------------------------------------------------------------------------
+
+    -- Select the palette index (the glyph pixel is used in tile mode).
+    s_gf2_glyph_pixel <= s_gf2_glyph(to_integer(unsigned(s_gf2_glyph_bit)));
+    o_pal_addr <= "0000000" & s_gf2_glyph_pixel when s_gf2_is_tile = '1' else s_gf2_pal_idx;
+
+    -- PALADDR registers.
+    process(i_clk, i_rst)
+    begin
+      if i_rst = '1' then
+        s_pl_data <= (others => '0');
+        s_pl_is_truecolor <= '0';
+        s_pl_in_blanking_area <= '1';
+      elsif rising_edge(i_clk) then
+        s_pl_data <= s_gf2_data;
+        s_pl_is_truecolor <= s_gf2_is_truecolor;
+        s_pl_in_blanking_area <= s_gf2_in_blanking_area;
+      end if;
+    end process;
+  else generate
+    -- Without tile mode, the palette lookup address is taken directly from the SHIFT stage.
+    o_pal_addr <= s_sh_next_pal_idx;
+    s_pl_data <= s_sh_data;
+    s_pl_is_truecolor <= s_sh_is_truecolor;
+    s_pl_in_blanking_area <= s_sh_in_blanking_area;
+  end generate;
+
+
   -----------------------------------------------------------------------------
   -- PALFETCH
   -----------------------------------------------------------------------------
 
   -- Select which color source to use (truecolor or palette).
-  s_palf_next_data <= (others => '0') when s_sh_in_blanking_area = '1' else
-                      s_sh_data when s_sh_is_truecolor = '1' else
+  s_palf_next_data <= (others => '0') when s_pl_in_blanking_area = '1' else
+                      s_pl_data when s_pl_is_truecolor = '1' else
                       i_pal_data;
 
   -- PALFETCH registers.
@@ -19,23 +19,38 @@
 
 library ieee;
 use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
 use work.vid_types.all;
 
 ----------------------------------------------------------------------------------------------------
 -- Video control registers.
+--
+-- Apart from holding the register values, this entity implements automatic row stepping: When
+-- REPEAT is non-zero, STRIDE is added to ADDR every REPEAT scanlines. REPEAT is an unsigned 12.12
+-- fixed point number, so non-integer (and less than one) line counts are supported, which makes
+-- it possible to vertically scale an image without emitting a VCP instruction per row. Writing to
+-- ADDR or REPEAT restarts the line count.
+--
+-- The integer part of the line count (i.e. the number of scanlines since the start of the current
+-- row) is provided to the pixel pipeline, which uses it for selecting the glyph row in tile mode.
 ----------------------------------------------------------------------------------------------------
 
 entity vid_regs is
+  generic(
+    Y_COORD_BITS : positive
+  );
   port(
     i_rst : in std_logic;
     i_clk : in std_logic;
 
     i_restart_frame : in std_logic;
+    i_raster_y : in std_logic_vector(Y_COORD_BITS-1 downto 0);
     i_write_enable : in std_logic;
-    i_write_addr : in std_logic_vector(2 downto 0);
+    i_write_addr : in std_logic_vector(3 downto 0);
     i_write_data : in std_logic_vector(23 downto 0);
 
-    o_regs : out T_VID_REGS
+    o_regs : out T_VID_REGS;
+    o_row_line : out std_logic_vector(11 downto 0)
   );
 end vid_regs;
 
@@ -47,32 +62,94 @@ architecture rtl of vid_regs is
   constant C_DEFAULT_HSTOP : std_logic_vector(23 downto 0) := x"000000";
   constant C_DEFAULT_CMODE : std_logic_vector(23 downto 0) := x"000002";
   constant C_DEFAULT_RMODE : std_logic_vector(23 downto 0) := x"000135";
+  constant C_DEFAULT_STRIDE : std_logic_vector(23 downto 0) := x"000000";
+  constant C_DEFAULT_REPEAT : std_logic_vector(23 downto 0) := x"000000";
+  constant C_DEFAULT_PALBANK : std_logic_vector(23 downto 0) := x"000000";
+  constant C_DEFAULT_GLYPHS : std_logic_vector(23 downto 0) := x"000000";
+
+  -- One scanline in 12.12 fixed point.
+  constant C_ONE_LINE : unsigned(23 downto 0) := x"001000";
 
   signal s_regs : T_VID_REGS;
   signal s_next_regs : T_VID_REGS;
+
+  signal s_write_addr_reg : std_logic;
+  signal s_write_repeat_reg : std_logic;
+
+  signal s_prev_raster_y : std_logic_vector(Y_COORD_BITS-1 downto 0);
+  signal s_new_line : std_logic;
+  signal s_line_acc : unsigned(23 downto 0);
+  signal s_line_acc_plus_1 : unsigned(23 downto 0);
+  signal s_step_enabled : std_logic;
+  signal s_do_step : std_logic;
+  signal s_stepped_addr : std_logic_vector(23 downto 0);
 begin
   -- Write logic.
-  s_next_regs.ADDR <= i_write_data when i_write_enable = '1' and i_write_addr = "000" else
+  s_write_addr_reg <= '1' when i_write_enable = '1' and i_write_addr = "0000" else '0';
+  s_write_repeat_reg <= '1' when i_write_enable = '1' and i_write_addr = "1000" else '0';
+
+  s_next_regs.ADDR <= i_write_data when s_write_addr_reg = '1' else
                       C_DEFAULT_ADDR when i_restart_frame = '1' else
+                      s_stepped_addr when s_do_step = '1' else
                       s_regs.ADDR;
-  s_next_regs.XOFFS <= i_write_data when i_write_enable = '1' and i_write_addr = "001" else
+  s_next_regs.XOFFS <= i_write_data when i_write_enable = '1' and i_write_addr = "0001" else
                        C_DEFAULT_XOFFS when i_restart_frame = '1' else
                        s_regs.XOFFS;
-  s_next_regs.XINCR <= i_write_data when i_write_enable = '1' and i_write_addr = "010" else
+  s_next_regs.XINCR <= i_write_data when i_write_enable = '1' and i_write_addr = "0010" else
                        C_DEFAULT_XINCR when i_restart_frame = '1' else
                        s_regs.XINCR;
-  s_next_regs.HSTRT <= i_write_data when i_write_enable = '1' and i_write_addr = "011" else
+  s_next_regs.HSTRT <= i_write_data when i_write_enable = '1' and i_write_addr = "0011" else
                        C_DEFAULT_HSTRT when i_restart_frame = '1' else
                        s_regs.HSTRT;
-  s_next_regs.HSTOP <= i_write_data when i_write_enable = '1' and i_write_addr = "100" else
+  s_next_regs.HSTOP <= i_write_data when i_write_enable = '1' and i_write_addr = "0100" else
                        C_DEFAULT_HSTOP when i_restart_frame = '1' else
                        s_regs.HSTOP;
-  s_next_regs.CMODE <= i_write_data when i_write_enable = '1' and i_write_addr = "101" else
+  s_next_regs.CMODE <= i_write_data when i_write_enable = '1' and i_write_addr = "0101" else
                        C_DEFAULT_CMODE when i_restart_frame = '1' else
                        s_regs.CMODE;
-  s_next_regs.RMODE <= i_write_data when i_write_enable = '1' and i_write_addr = "110" else
+  s_next_regs.RMODE <= i_write_data when i_write_enable = '1' and i_write_addr = "0110" else
                        C_DEFAULT_RMODE when i_restart_frame = '1' else
                        s_regs.RMODE;
+  s_next_regs.STRIDE <= i_write_data when i_write_enable = '1' and i_write_addr = "0111" else
+                        C_DEFAULT_STRIDE when i_restart_frame = '1' else
+                        s_regs.STRIDE;
+  s_next_regs.REPEAT <= i_write_data when s_write_repeat_reg = '1' else
+                        C_DEFAULT_REPEAT when i_restart_frame = '1' else
+                        s_regs.REPEAT;
+  s_next_regs.PALBANK <= i_write_data when i_write_enable = '1' and i_write_addr = "1001" else
+                         C_DEFAULT_PALBANK when i_restart_frame = '1' else
+                         s_regs.PALBANK;
+  s_next_regs.GLYPHS <= i_write_data when i_write_enable = '1' and i_write_addr = "1010" else
+                        C_DEFAULT_GLYPHS when i_restart_frame = '1' else
+                        s_regs.GLYPHS;
+
+  -- Automatic row stepping: Add one line to the line accumulator at the start of every new
+  -- scanline, and step ADDR once per clock cycle for as long as the accumulator holds at least
+  -- REPEAT lines (this normally happens during the first few cycles of the horizontal blanking
+  -- interval). The accumulator keeps counting lines when stepping is disabled, so that the row
+  -- line count is valid relative to the last ADDR write.
+  s_new_line <= '1' when i_raster_y /= s_prev_raster_y else '0';
+  s_line_acc_plus_1 <= s_line_acc + C_ONE_LINE when s_new_line = '1' else s_line_acc;
+  s_step_enabled <= '1' when s_regs.REPEAT /= C_DEFAULT_REPEAT else '0';
+  s_do_step <= '1' when s_step_enabled = '1' and s_line_acc >= unsigned(s_regs.REPEAT) else '0';
+  s_stepped_addr <= std_logic_vector(unsigned(s_regs.ADDR) + unsigned(s_regs.STRIDE));
+
+  process(i_clk, i_rst)
+  begin
+    if i_rst = '1' then
+      s_prev_raster_y <= (others => '0');
+      s_line_acc <= (others => '0');
+    elsif rising_edge(i_clk) then
+      s_prev_raster_y <= i_raster_y;
+      if i_restart_frame = '1' or s_write_addr_reg = '1' or s_write_repeat_reg = '1' then
+        s_line_acc <= (others => '0');
+      elsif s_do_step = '1' then
+        s_line_acc <= s_line_acc_plus_1 - unsigned(s_regs.REPEAT);
+      else
+        s_line_acc <= s_line_acc_plus_1;
+      end if;
+    end if;
+  end process;
 
   -- Clocked registers.
   process(i_clk, i_rst)
@@ -85,6 +162,10 @@ begin
       s_regs.HSTOP <= C_DEFAULT_HSTOP;
       s_regs.CMODE <= C_DEFAULT_CMODE;
       s_regs.RMODE <= C_DEFAULT_RMODE;
+      s_regs.STRIDE <= C_DEFAULT_STRIDE;
+      s_regs.REPEAT <= C_DEFAULT_REPEAT;
+      s_regs.PALBANK <= C_DEFAULT_PALBANK;
+      s_regs.GLYPHS <= C_DEFAULT_GLYPHS;
     elsif rising_edge(i_clk) then
       s_regs <= s_next_regs;
     end if;
@@ -92,4 +173,5 @@ begin
 
   -- Outputs.
   o_regs <= s_regs;
+  o_row_line <= std_logic_vector(s_line_acc(23 downto 12));
 end rtl;
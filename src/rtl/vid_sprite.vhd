@@ -0,0 +1,257 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.vid_types.all;
+
+----------------------------------------------------------------------------------------------------
+-- Hardware sprite (e.g. a mouse pointer).
+--
+-- The sprite is a 16x16 pixel ABGR32 bitmap in VRAM (16 words per line, 256 words in total, aligned
+-- to a 16 word boundary), that is alpha blended on top of the output of the video layers.
+--
+-- One sprite line is fetched into a line buffer during the horizontal blanking interval of each
+-- scanline that the sprite covers (at raster x = C_FETCH_X, while the layers fill their line
+-- FIFO:s for the line). The fetch takes 16 / 2^LOG2_READ_WORDS memory cycles, and the sprite should
+-- have the highest VRAM read priority.
+--
+-- The sprite pixels are blended with i_color (the output of the video layers) as:
+--
+--   o_color = (sprite * f + i_color * (256 - f)) / 256, f = alpha + alpha / 128
+--
+-- ...i.e. alpha = 0 is fully transparent and alpha = 255 is fully opaque.
+--
+-- COLOR_DELAY is the delay from i_raster_x to i_color, and the delay from i_color to o_color is
+-- C_VID_SPRITE_DELAY clock cycles (see vid_types).
+----------------------------------------------------------------------------------------------------
+
+entity vid_sprite is
+  generic(
+    X_COORD_BITS : positive;
+    Y_COORD_BITS : positive;
+    LOG2_READ_WORDS : natural;
+    COLOR_DELAY : positive
+  );
+  port(
+    i_rst : in std_logic;
+    i_clk : in std_logic;
+
+    i_raster_x : in std_logic_vector(X_COORD_BITS-1 downto 0);
+    i_raster_y : in std_logic_vector(Y_COORD_BITS-1 downto 0);
+
+    -- Sprite configuration.
+    i_enable : in std_logic;
+    i_addr : in std_logic_vector(23 downto 0);  -- VRAM word address of the bitmap.
+    i_xpos : in std_logic_vector(15 downto 0);  -- Signed x coordinate of the top left corner.
+    i_ypos : in std_logic_vector(15 downto 0);  -- Signed y coordinate of the top left corner.
+
+    -- VRAM read interface (row addresses, see video_layer).
+    o_read_en : out std_logic;
+    o_read_adr : out std_logic_vector(23 downto 0);
+    i_read_ack : in std_logic;
+    i_read_dat : in std_logic_vector(32*(2**LOG2_READ_WORDS)-1 downto 0);
+
+    i_color : in std_logic_vector(31 downto 0);
+    o_color : out std_logic_vector(31 downto 0)
+  );
+end vid_sprite;
+
+architecture rtl of vid_sprite is
+  constant C_SIZE : positive := 16;
+  constant C_NUM_WORDS : positive := 2**LOG2_READ_WORDS;
+  constant C_ROWS_PER_LINE : positive := C_SIZE / C_NUM_WORDS;
+  constant C_FETCH_X : integer := -64;
+
+  type T_LINE_BUF is array (0 to C_SIZE-1) of std_logic_vector(31 downto 0);
+
+  -- The pixel index (and a valid flag) is calculated in raster time, and delayed to line up with
+  -- i_color.
+  type T_IDX_DELAY is array (1 to COLOR_DELAY) of std_logic_vector(4 downto 0);
+
+  signal s_raster_x : signed(15 downto 0);
+  signal s_raster_y : signed(15 downto 0);
+  signal s_line : signed(15 downto 0);
+  signal s_pixel : signed(15 downto 0);
+
+  -- Line fetch signals.
+  signal s_line_active : std_logic;
+  signal s_fetch_en : std_logic;
+  signal s_fetch_adr : unsigned(23 downto 0);
+  signal s_fetch_row : integer range 0 to C_ROWS_PER_LINE-1;
+  signal s_store_row : integer range 0 to C_ROWS_PER_LINE-1;
+  signal s_line_buf : T_LINE_BUF;
+
+  -- Pixel pipeline signals.
+  signal s_idx_delay : T_IDX_DELAY;
+  signal s_s1_sprite : std_logic_vector(31 downto 0);
+  signal s_s1_color : std_logic_vector(31 downto 0);
+  signal s_s2_r : unsigned(16 downto 0);
+  signal s_s2_g : unsigned(16 downto 0);
+  signal s_s2_b : unsigned(16 downto 0);
+  signal s_s2_r_bg : unsigned(16 downto 0);
+  signal s_s2_g_bg : unsigned(16 downto 0);
+  signal s_s2_b_bg : unsigned(16 downto 0);
+begin
+  s_raster_x <= resize(signed(i_raster_x), 16);
+  s_raster_y <= resize(signed(i_raster_y), 16);
+
+  -- Sprite relative coordinates.
+  s_line <= s_raster_y - signed(i_ypos);
+  s_pixel <= s_raster_x - signed(i_xpos);
+
+
+  --------------------------------------------------------------------------------------------------
+  -- Line fetch.
+  --------------------------------------------------------------------------------------------------
+
+  process(i_clk, i_rst)
+  begin
+    if i_rst = '1' then
+      s_line_active <= '0';
+      s_fetch_en <= '0';
+      s_fetch_adr <= (others => '0');
+      s_fetch_row <= 0;
+      s_store_row <= 0;
+      s_line_buf <= (others => (others => '0'));
+    elsif rising_edge(i_clk) then
+      if s_raster_x = to_signed(C_FETCH_X, 16) then
+        -- Start of a new line: Does the sprite cover this line?
+        if i_enable = '1' and s_line >= 0 and s_line < C_SIZE then
+          s_line_active <= '1';
+          s_fetch_en <= '1';
+        else
+          s_line_active <= '0';
+          s_fetch_en <= '0';
+        end if;
+        s_fetch_adr <= unsigned(i_addr) + shift_left(resize(unsigned(s_line), 24), 4);
+        s_fetch_row <= 0;
+        s_store_row <= 0;
+      elsif s_fetch_en = '1' then
+        -- Request one row per cycle (the sprite has the highest VRAM read priority, so every
+        -- request is granted).
+        s_fetch_adr <= s_fetch_adr + C_NUM_WORDS;
+        if s_fetch_row = C_ROWS_PER_LINE-1 then
+          s_fetch_en <= '0';
+        else
+          s_fetch_row <= s_fetch_row + 1;
+        end if;
+      end if;
+
+      -- Store the fetched rows in the line buffer (one cycle after each request).
+      if i_read_ack = '1' then
+        for k in 0 to C_NUM_WORDS-1 loop
+          s_line_buf(s_store_row * C_NUM_WORDS + k) <= i_read_dat(k*32+31 downto k*32);
+        end loop;
+        if s_store_row < C_ROWS_PER_LINE-1 then
+          s_store_row <= s_store_row + 1;
+        end if;
+      end if;
+    end if;
+  end process;
+
+  o_read_en <= s_fetch_en;
+  o_read_adr <= std_logic_vector(shift_right(s_fetch_adr, LOG2_READ_WORDS));
+
+
+  --------------------------------------------------------------------------------------------------
+  -- Pixel pipeline.
+  --------------------------------------------------------------------------------------------------
+
+  -- Calculate the sprite pixel index in raster time, and delay it.
+  process(i_clk, i_rst)
+  begin
+    if i_rst = '1' then
+      s_idx_delay <= (others => (others => '0'));
+    elsif rising_edge(i_clk) then
+      if s_line_active = '1' and s_pixel >= 0 and s_pixel < C_SIZE then
+        s_idx_delay(1) <= '1' & std_logic_vector(s_pixel(3 downto 0));
+      else
+        s_idx_delay(1) <= (others => '0');
+      end if;
+      for k in 2 to COLOR_DELAY loop
+        s_idx_delay(k) <= s_idx_delay(k-1);
+      end loop;
+    end if;
+  end process;
+
+  -- S1 - Look up the sprite pixel.
+  process(i_clk, i_rst)
+    variable v_idx : std_logic_vector(4 downto 0);
+  begin
+    if i_rst = '1' then
+      s_s1_sprite <= (others => '0');
+      s_s1_color <= (others => '0');
+    elsif rising_edge(i_clk) then
+      v_idx := s_idx_delay(COLOR_DELAY);
+      if v_idx(4) = '1' then
+        s_s1_sprite <= s_line_buf(to_integer(unsigned(v_idx(3 downto 0))));
+      else
+        s_s1_sprite <= (others => '0');
+      end if;
+      s_s1_color <= i_color;
+    end if;
+  end process;
+
+  -- S2 - Scale the sprite and the background colors.
+  process(i_clk, i_rst)
+    variable v_alpha : unsigned(7 downto 0);
+    variable v_f : unsigned(8 downto 0);
+    variable v_f_bg : unsigned(8 downto 0);
+  begin
+    if i_rst = '1' then
+      s_s2_r <= (others => '0');
+      s_s2_g <= (others => '0');
+      s_s2_b <= (others => '0');
+      s_s2_r_bg <= (others => '0');
+      s_s2_g_bg <= (others => '0');
+      s_s2_b_bg <= (others => '0');
+    elsif rising_edge(i_clk) then
+      v_alpha := unsigned(s_s1_sprite(31 downto 24));
+      v_f := ('0' & v_alpha) + ("00000000" & v_alpha(7));
+      v_f_bg := to_unsigned(256, 9) - v_f;
+      s_s2_r <= unsigned(s_s1_sprite(7 downto 0)) * v_f;
+      s_s2_g <= unsigned(s_s1_sprite(15 downto 8)) * v_f;
+      s_s2_b <= unsigned(s_s1_sprite(23 downto 16)) * v_f;
+      s_s2_r_bg <= unsigned(s_s1_color(7 downto 0)) * v_f_bg;
+      s_s2_g_bg <= unsigned(s_s1_color(15 downto 8)) * v_f_bg;
+      s_s2_b_bg <= unsigned(s_s1_color(23 downto 16)) * v_f_bg;
+    end if;
+  end process;
+
+  -- S3 - Blend (the sum of the scaled colors is at most 255 * 256, so no clamping is required).
+  process(i_clk, i_rst)
+    variable v_r : unsigned(16 downto 0);
+    variable v_g : unsigned(16 downto 0);
+    variable v_b : unsigned(16 downto 0);
+  begin
+    if i_rst = '1' then
+      o_color <= (others => '0');
+    elsif rising_edge(i_clk) then
+      v_r := s_s2_r + s_s2_r_bg;
+      v_g := s_s2_g + s_s2_g_bg;
+      v_b := s_s2_b + s_s2_b_bg;
+      o_color <= x"ff" &
+                 std_logic_vector(v_b(15 downto 8)) &
+                 std_logic_vector(v_g(15 downto 8)) &
+                 std_logic_vector(v_r(15 downto 8));
+    end if;
+  end process;
+end rtl;
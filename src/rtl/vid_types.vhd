@@ -36,9 +36,37 @@ package vid_types is
     HSTOP : std_logic_vector(23 downto 0);
     CMODE : std_logic_vector(23 downto 0);
     RMODE : std_logic_vector(23 downto 0);
+    STRIDE : std_logic_vector(23 downto 0);
+    REPEAT : std_logic_vector(23 downto 0);
+    PALBANK : std_logic_vector(23 downto 0);
+    GLYPHS : std_logic_vector(23 downto 0);
   end record T_VID_REGS;
 
 
+  ------------------------------------------------------------------------------------------------
+  -- Pipeline delays (in clock cycles), excluding the optional extra pipeline stages.
+  ------------------------------------------------------------------------------------------------
+  constant C_VID_PIXEL_DELAY : natural := 6;  -- vid_pixel: i_raster_x -> o_color
+  constant C_VID_TILE_MODE_DELAY : natural := 3;  -- vid_pixel: Extra delay with ENABLE_TILE_MODE
+  constant C_VID_BLEND_DELAY : natural := 5;  -- vid_blend: i_color_* -> o_color
+  constant C_VID_SPRITE_DELAY : natural := 3; -- vid_sprite: i_color -> o_color
+
+
+  ------------------------------------------------------------------------------------------------
+  -- Video layers.
+  ------------------------------------------------------------------------------------------------
+  constant C_VID_MAX_LAYERS : positive := 4;
+
+  -- The VCP of layer k (1..C_VID_MAX_LAYERS) starts at VRAM word address k * 4.
+  constant C_VID_VCP_START_STRIDE : positive := 4;
+
+  -- Each layer has a line FIFO with 2^C_VID_LINE_FIFO_LOG2_DEPTH memory rows (see vid_line_fifo).
+  -- The FIFO:s are flushed and start to fill at raster x = C_VID_LINE_FIFO_FILL_X, during the
+  -- horizontal blanking interval.
+  constant C_VID_LINE_FIFO_LOG2_DEPTH : positive := 2;
+  constant C_VID_LINE_FIFO_FILL_X : integer := -96;
+
+
   ------------------------------------------------------------------------------------------------
   -- Supported video resolution configurations.
   ------------------------------------------------------------------------------------------------
@@ -39,13 +39,19 @@ use ieee.numeric_std.all;
 --
 -- EX:
 --   Decode instruction.
---   Execute WAIT & JUMP instructions.
+--   Execute WAIT, JUMP & LOOP instructions.
 --   Prepare SET operations.
 --
 -- WR:
 --   Execute the SET operation.
 --
 -- The program is restarted on a fixed memory address every time i_restart_frame goes high.
+--
+-- Loops are implemented with a single loop counter: SETLC loads the counter, and LOOP decrements
+-- it and jumps to the target address as long as the counter has not reached zero (i.e. a loop body
+-- that is terminated by LOOP is executed N times for SETLC N). Together with WAITYR (wait until a
+-- given number of lines relative to the current line have passed), per-line effects can be
+-- expressed with a constant number of instructions.
 ----------------------------------------------------------------------------------------------------
 
 entity vid_vcpp is
@@ -87,6 +93,9 @@ architecture rtl of vid_vcpp is
   constant C_INSTR_WAITY  : T_INSTR := 4x"5";
   constant C_INSTR_SETPAL : T_INSTR := 4x"6";
   constant C_INSTR_SETREG : T_INSTR := 4x"8";
+  constant C_INSTR_SETLC  : T_INSTR := 4x"9";
+  constant C_INSTR_LOOP   : T_INSTR := 4x"a";
+  constant C_INSTR_WAITYR : T_INSTR := 4x"b";
 
   type T_DECODE_STATE is (
     NEW_INSTR,
@@ -131,6 +140,9 @@ architecture rtl of vid_vcpp is
   signal s_is_waity_instr : std_logic;
   signal s_is_setpal_instr : std_logic;
   signal s_is_setreg_instr : std_logic;
+  signal s_is_setlc_instr : std_logic;
+  signal s_is_loop_instr : std_logic;
+  signal s_is_waityr_instr : std_logic;
 
   signal s_ex_is_waiting : std_logic;
   signal s_ex_do_jump : std_logic;
@@ -148,6 +160,8 @@ architecture rtl of vid_vcpp is
   signal s_ex_pal_write_enable : std_logic;
   signal s_ex_write_addr : std_logic_vector(7 downto 0);
   signal s_ex_write_data : std_logic_vector(31 downto 0);
+  signal s_ex_loop_cnt : unsigned(23 downto 0);
+  signal s_ex_loop_taken : std_logic;
 
   function xcoord_to_signed16(x: std_logic_vector) return std_logic_vector is
     variable v_result : std_logic_vector(15 downto 0);
@@ -286,9 +300,13 @@ begin
   s_is_jmp_instr <= s_is_new_instr when s_instr = C_INSTR_JMP else '0';
   s_is_jsr_instr <= s_is_new_instr when s_instr = C_INSTR_JSR else '0';
   s_is_rts_instr <= s_is_new_instr when s_instr = C_INSTR_RTS else '0';
-  s_ex_do_jump <= s_is_jmp_instr or s_is_jsr_instr or s_is_rts_instr;
+  s_is_loop_instr <= s_is_new_instr when s_instr = C_INSTR_LOOP else '0';
+  s_ex_do_jump <= s_is_jmp_instr or
+                  s_is_jsr_instr or
+                  s_is_rts_instr or
+                  (s_is_loop_instr and s_ex_loop_taken);
   s_ex_jump_target <= s_return_addr_from_stack when s_instr = C_INSTR_RTS else
-                      s_if2_data(23 downto 0);  -- C_INSTR_JMP | C_INSTR_JSR
+                      s_if2_data(23 downto 0);  -- C_INSTR_JMP | C_INSTR_JSR | C_INSTR_LOOP
   s_ex_do_stack_push <= s_is_jsr_instr;
   s_ex_do_stack_pop <= s_is_rts_instr;
   s_ex_stack_push_adr <= s_if2_pc_plus_1;
@@ -296,8 +314,10 @@ begin
   -- Should we wait?
   s_is_waitx_instr <= s_is_new_instr when s_instr = C_INSTR_WAITX else '0';
   s_is_waity_instr <= s_is_new_instr when s_instr = C_INSTR_WAITY else '0';
+  s_is_waityr_instr <= s_is_new_instr when s_instr = C_INSTR_WAITYR else '0';
   s_ex_is_waiting <= '1' when s_is_waitx_instr = '1' or
                               s_is_waity_instr = '1' or
+                              s_is_waityr_instr = '1' or
                               s_ex_state = WAITX or
                               s_ex_state = WAITY
                       else '0';
@@ -308,6 +328,9 @@ begin
   -- Should we set a VCR?
   s_is_setreg_instr <= s_is_new_instr when s_instr = C_INSTR_SETREG else '0';
 
+  -- Should we set the loop counter?
+  s_is_setlc_instr <= s_is_new_instr when s_instr = C_INSTR_SETLC else '0';
+
   process(i_clk, i_rst)
     variable v_next_state : T_DECODE_STATE;
     variable v_pal_base_idx : unsigned(7 downto 0);
@@ -325,6 +348,8 @@ begin
       s_ex_pal_write_enable <= '0';
       s_ex_write_addr <= (others => '0');
       s_ex_write_data <= (others => '0');
+      s_ex_loop_cnt <= (others => '0');
+      s_ex_loop_taken <= '0';
     elsif rising_edge(i_clk) then
       v_next_state := s_ex_state;
       v_pal_write_enable := '0';
@@ -347,6 +372,11 @@ begin
         -- New WAITY?
         v_next_state := WAITY;
         s_ex_instr_arg <= s_if2_data(15 downto 0);
+      elsif s_is_waityr_instr = '1' then
+        -- New WAITYR? (this is a WAITY relative to the current raster line)
+        v_next_state := WAITY;
+        s_ex_instr_arg <= std_logic_vector(signed(ycoord_to_signed16(i_raster_y)) +
+                                           signed(s_if2_data(15 downto 0)));
       elsif s_ex_state = WAITY then
         -- Finished WAITY?
         if ycoord_to_signed16(i_raster_y) = s_ex_instr_arg then
@@ -375,6 +405,27 @@ begin
         v_write_addr := "0000" & s_if2_data(27 downto 24);
       end if;
 
+      -- Update the loop counter. Note: The "loop taken" state is precalculated here in order to
+      -- keep the jump logic short.
+      if i_restart_frame = '1' then
+        s_ex_loop_cnt <= (others => '0');
+        s_ex_loop_taken <= '0';
+      elsif s_is_setlc_instr = '1' then
+        s_ex_loop_cnt <= unsigned(s_if2_data(23 downto 0));
+        if unsigned(s_if2_data(23 downto 0)) > 1 then
+          s_ex_loop_taken <= '1';
+        else
+          s_ex_loop_taken <= '0';
+        end if;
+      elsif s_is_loop_instr = '1' and s_ex_loop_cnt /= 0 then
+        s_ex_loop_cnt <= s_ex_loop_cnt - 1;
+        if s_ex_loop_cnt > 2 then
+          s_ex_loop_taken <= '1';
+        else
+          s_ex_loop_taken <= '0';
+        end if;
+      end if;
+
       -- This is an optimization for the asynchronous instruction decoding
       -- logic: Only use a single bit to determine whether or not we're in
       -- the NEW_INSTR state.
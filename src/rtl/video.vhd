@@ -29,14 +29,29 @@ entity video is
     COLOR_BITS_B : positive;
     ADR_BITS : positive;
     NUM_LAYERS : positive;
+    LOG2_PALETTE_BANKS : natural := 0;
+    LOG2_READ_WORDS : natural := 0;
+    PIXEL_ADDR_STAGES : natural := 0;
+    PIXEL_SHIFT_STAGES : natural := 0;
+    BLEND_MUL_STAGES : natural := 0;
+    ENABLE_SPRITE : boolean := false;
+    ENABLE_TILE_MODE : boolean := false;
     VIDEO_CONFIG : T_VIDEO_CONFIG
   );
   port(
     i_rst : in std_logic;
     i_clk : in std_logic;
 
-    o_read_adr : out std_logic_vector(ADR_BITS-1 downto 0);
-    i_read_dat : in std_logic_vector(31 downto 0);
+    -- VRAM read interface. The VRAM is read in rows of 2^LOG2_READ_WORDS words, and the read
+    -- address is given in units of rows.
+    o_read_adr : out std_logic_vector(ADR_BITS-LOG2_READ_WORDS-1 downto 0);
+    i_read_dat : in std_logic_vector(32*(2**LOG2_READ_WORDS)-1 downto 0);
+
+    -- Hardware sprite configuration (see vid_sprite), only used if ENABLE_SPRITE is true.
+    i_sprite_enable : in std_logic := '0';
+    i_sprite_addr : in std_logic_vector(23 downto 0) := (others => '0');
+    i_sprite_xpos : in std_logic_vector(15 downto 0) := (others => '0');
+    i_sprite_ypos : in std_logic_vector(15 downto 0) := (others => '0');
 
     o_r : out std_logic_vector(COLOR_BITS_R-1 downto 0);
     o_g : out std_logic_vector(COLOR_BITS_G-1 downto 0);
@@ -45,7 +60,11 @@ entity video is
     o_hsync : out std_logic;
     o_vsync : out std_logic;
 
-    o_raster_y : out std_logic_vector(15 downto 0)
+    o_raster_y : out std_logic_vector(15 downto 0);
+
+    -- Line FIFO underrun flags for the last frame (bit k-1 is set if layer k needed more VRAM
+    -- bandwidth than it got).
+    o_layer_underrun : out std_logic_vector(C_VID_MAX_LAYERS-1 downto 0)
   );
 end video;
 
@@ -60,17 +79,49 @@ architecture rtl of video is
     end if;
   end;
 
+  -- Number of cycles that the line FIFO:s have for filling up before the line starts, and the
+  -- number of memory cycles that are needed during that time. Each layer is guaranteed every
+  -- NUM_LAYERS:th cycle, except for the cycles that are used by the sprite (which has the highest
+  -- priority), and we conservatively assume that all the sprite reads hit the slots of one layer.
+  constant C_FIFO_FILL_CYCLES : integer := -C_VID_LINE_FIFO_FILL_X;
+  constant C_HBLANK_CYCLES : integer := VIDEO_CONFIG.front_porch_h + VIDEO_CONFIG.sync_width_h +
+                                        VIDEO_CONFIG.back_porch_h;
+  function FIFO_FILL_READS return integer is
+    variable v_reads : integer;
+  begin
+    v_reads := NUM_LAYERS * 2**C_VID_LINE_FIFO_LOG2_DEPTH;
+    if ENABLE_SPRITE then
+      v_reads := v_reads + NUM_LAYERS * (16 / 2**LOG2_READ_WORDS);
+    end if;
+    return v_reads;
+  end function;
+
+  -- Delay of one blend stage (the layers are blended in a cascade of NUM_LAYERS-1 stages).
+  constant C_BLEND_STAGE_DELAY : integer := C_VID_BLEND_DELAY + BLEND_MUL_STAGES;
+
+  -- Extra delay of the top layer when it supports tile mode (see vid_pixel).
+  function TILE_MODE_DELAY return integer is
+  begin
+    if ENABLE_TILE_MODE then
+      return C_VID_TILE_MODE_DELAY;
+    else
+      return 0;
+    end if;
+  end function;
+
+  -- Delay from the raster coordinates to the blended color of all the layers.
+  constant C_LAYERS_DELAY : integer := C_VID_PIXEL_DELAY + PIXEL_ADDR_STAGES + PIXEL_SHIFT_STAGES +
+                                       TILE_MODE_DELAY + (NUM_LAYERS-1) * C_BLEND_STAGE_DELAY;
+
   -- Number of cycles to delay the sync output signals, due to color pipeline
   -- delays.
   function SYNC_DELAY return integer is
-    constant C_PIXEL_DELAY : integer := 6;
-    constant C_BLEND_DELAY : integer := 5;
     constant C_DITHER_DELAY : integer := 2;
     variable v_delay : integer;
   begin
-    v_delay := C_PIXEL_DELAY;
-    if NUM_LAYERS >= 2 then
-      v_delay := v_delay + C_BLEND_DELAY;
+    v_delay := C_LAYERS_DELAY;
+    if ENABLE_SPRITE then
+      v_delay := v_delay + C_VID_SPRITE_DELAY;
     end if;
     if ENABLE_DITHERING then
       v_delay := v_delay + C_DITHER_DELAY;
@@ -78,23 +129,37 @@ architecture rtl of video is
     return v_delay;
   end function;
 
+  -- Per-layer signals (layer 1 is the bottom layer, layer NUM_LAYERS is the top layer).
+  type T_LAYER_VCR_ARRAY is array (1 to NUM_LAYERS) of std_logic_vector(23 downto 0);
+  type T_LAYER_COLOR_ARRAY is array (1 to NUM_LAYERS) of std_logic_vector(31 downto 0);
+  type T_LAYER_METHOD_ARRAY is array (1 to NUM_LAYERS) of std_logic_vector(7 downto 0);
+
   signal s_raster_x : std_logic_vector(11 downto 0);
   signal s_raster_y : std_logic_vector(11 downto 0);
   signal s_hsync : std_logic;
   signal s_vsync : std_logic;
   signal s_restart_frame : std_logic;
 
-  signal s_layer1_read_en : std_logic;
-  signal s_layer1_read_adr : std_logic_vector(23 downto 0);
-  signal s_layer1_read_ack : std_logic;
-  signal s_layer1_rmode : std_logic_vector(23 downto 0);
-  signal s_layer1_color : std_logic_vector(31 downto 0);
+  signal s_layer_read_en : std_logic_vector(1 to NUM_LAYERS);
+  signal s_layer_read_urgent : std_logic_vector(1 to NUM_LAYERS);
+  signal s_layer_read_adr : T_LAYER_VCR_ARRAY;
+  signal s_layer_read_grant : std_logic_vector(1 to NUM_LAYERS);
+  signal s_layer_read_ack : std_logic_vector(1 to NUM_LAYERS);
+  signal s_layer_underrun : std_logic_vector(1 to NUM_LAYERS);
+  signal s_read_slot : integer range 1 to NUM_LAYERS;
+  signal s_frame_underrun : std_logic_vector(1 to NUM_LAYERS);
+  signal s_layer_rmode : T_LAYER_VCR_ARRAY;
+  signal s_layer_color : T_LAYER_COLOR_ARRAY;
 
-  signal s_layer2_read_en : std_logic;
-  signal s_layer2_read_adr : std_logic_vector(23 downto 0);
-  signal s_layer2_read_ack : std_logic;
-  signal s_layer2_rmode : std_logic_vector(23 downto 0);
-  signal s_layer2_color : std_logic_vector(31 downto 0);
+  -- s_blend_color(k) is the blended color of layers 1 to k.
+  signal s_blend_method : T_LAYER_METHOD_ARRAY;
+  signal s_blend_input : T_LAYER_COLOR_ARRAY;
+  signal s_blend_base : T_LAYER_COLOR_ARRAY;
+  signal s_blend_color : T_LAYER_COLOR_ARRAY;
+
+  signal s_sprite_read_en : std_logic;
+  signal s_sprite_read_adr : std_logic_vector(23 downto 0);
+  signal s_sprite_read_ack : std_logic;
 
   signal s_final_color : std_logic_vector(31 downto 0);
 
@@ -106,6 +171,20 @@ architecture rtl of video is
   signal s_hsync_delayed : std_logic_vector(SYNC_DELAY-1 downto 0);
   signal s_vsync_delayed : std_logic_vector(SYNC_DELAY-1 downto 0);
 begin
+  assert NUM_LAYERS <= C_VID_MAX_LAYERS
+    report "NUM_LAYERS must be in the range 1 to " & integer'image(C_VID_MAX_LAYERS)
+    severity failure;
+
+  -- The line FIFO:s must be able to fill up during the horizontal blanking interval.
+  assert C_FIFO_FILL_CYCLES <= C_HBLANK_CYCLES
+    report "The horizontal blanking interval is too short for filling the line FIFO:s"
+    severity failure;
+  assert FIFO_FILL_READS <= C_FIFO_FILL_CYCLES
+    report "Too many layers for filling the line FIFO:s before the line starts (" &
+           integer'image(FIFO_FILL_READS) & " memory cycles are needed, but only " &
+           integer'image(C_FIFO_FILL_CYCLES) & " are available)"
+    severity failure;
+
   -- Instantiate the raster control unit.
   rcu_1: entity work.vid_raster
     generic map (
@@ -123,37 +202,23 @@ begin
       o_restart_frame => s_restart_frame
     );
 
-  -- Instantiate video layer #1 (bottom layer).
-  video_layer_1: entity work.video_layer
-    generic map (
-      X_COORD_BITS => s_raster_x'length,
-      Y_COORD_BITS => s_raster_y'length,
-      VCP_START_ADDRESS => 24x"000004",
-      ENABLE_PIXEL_PREFETCH => (NUM_LAYERS >= 2)
-    )
-    port map (
-      i_rst => i_rst,
-      i_clk => i_clk,
-      i_restart_frame => s_restart_frame,
-      i_raster_x => s_raster_x,
-      i_raster_y => s_raster_y,
-      o_read_en => s_layer1_read_en,
-      o_read_adr => s_layer1_read_adr,
-      i_read_ack => s_layer1_read_ack,
-      i_read_dat  => i_read_dat,
-      o_rmode => s_layer1_rmode,
-      o_color => s_layer1_color
-    );
-
-  Layer2Gen: if NUM_LAYERS >= 2 generate
+  -- Instantiate the video layers.
+  -- Note: Only the top layer supports tile mode (ENABLE_TILE_MODE), since the extra pipeline
+  -- stages of the tile mode would otherwise delay all the layers above it (see the layer blending
+  -- below). Tile mode reads bypass the line FIFO, so two layers in tile mode would also compete
+  -- for the urgent memory cycles.
+  LayerGen: for k in 1 to NUM_LAYERS generate
   begin
-    -- Instantiate video layer #2 (top layer).
-    video_layer_2: entity work.video_layer
+    video_layer_1: entity work.video_layer
       generic map (
         X_COORD_BITS => s_raster_x'length,
         Y_COORD_BITS => s_raster_y'length,
-        VCP_START_ADDRESS => 24x"000008",
-        ENABLE_PIXEL_PREFETCH => false
+        VCP_START_ADDRESS => std_logic_vector(to_unsigned(k * C_VID_VCP_START_STRIDE, 24)),
+        LOG2_PALETTE_BANKS => LOG2_PALETTE_BANKS,
+        LOG2_READ_WORDS => LOG2_READ_WORDS,
+        PIXEL_ADDR_STAGES => PIXEL_ADDR_STAGES,
+        PIXEL_SHIFT_STAGES => PIXEL_SHIFT_STAGES,
+        ENABLE_TILE_MODE => ENABLE_TILE_MODE and k = NUM_LAYERS
       )
       port map (
         i_rst => i_rst,
@@ -161,28 +226,132 @@ begin
         i_restart_frame => s_restart_frame,
         i_raster_x => s_raster_x,
         i_raster_y => s_raster_y,
-        o_read_en => s_layer2_read_en,
-        o_read_adr => s_layer2_read_adr,
-        i_read_ack => s_layer2_read_ack,
+        o_read_en => s_layer_read_en(k),
+        o_read_urgent => s_layer_read_urgent(k),
+        o_read_adr => s_layer_read_adr(k),
+        i_read_grant => s_layer_read_grant(k),
+        i_read_ack => s_layer_read_ack(k),
         i_read_dat  => i_read_dat,
-        o_rmode => s_layer2_rmode,
-        o_color => s_layer2_color
+        o_underrun => s_layer_underrun(k),
+        o_rmode => s_layer_rmode(k),
+        o_color => s_layer_color(k)
       );
+  end generate;
+
+
+  --------------------------------------------------------------------------------------------------
+  -- Layer blending.
+  --
+  -- The layers are blended in a cascade, from the bottom layer and up: Stage k blends layer k on
+  -- top of the result of stage k-1, using the blend method given by the layer k RMODE VCR. Since
+  -- each stage adds C_BLEND_STAGE_DELAY cycles, the color (and blend method) of layer k is delayed
+  -- by (k-2) * C_BLEND_STAGE_DELAY cycles before it enters its blend stage.
+  --
+  -- When the top layer supports tile mode, its pixel pipeline is C_VID_TILE_MODE_DELAY cycles
+  -- longer than the pipelines of the other layers, so the blended color of the layers below it is
+  -- delayed by the same amount before it enters the top blend stage.
+  --------------------------------------------------------------------------------------------------
+
+  s_blend_method(1) <= (others => '0');  -- Unused
+  s_blend_input(1) <= (others => '0');   -- Unused
+  s_blend_base(1) <= (others => '0');    -- Unused
+  s_blend_color(1) <= s_layer_color(1);
+
+  BlendGen: for k in 2 to NUM_LAYERS generate
+  begin
+    DelayGen: if k >= 3 generate
+      type T_DELAY_LINE is array (1 to (k-2) * C_BLEND_STAGE_DELAY) of
+          std_logic_vector(39 downto 0);
+      signal s_delay_line : T_DELAY_LINE;
+    begin
+      process(i_clk, i_rst)
+      begin
+        if i_rst = '1' then
+          s_delay_line <= (others => (others => '0'));
+        elsif rising_edge(i_clk) then
+          s_delay_line(1) <= s_layer_rmode(k)(7 downto 0) & s_layer_color(k);
+          for i in 2 to s_delay_line'high loop
+            s_delay_line(i) <= s_delay_line(i-1);
+          end loop;
+        end if;
+      end process;
+      s_blend_method(k) <= s_delay_line(s_delay_line'high)(39 downto 32);
+      s_blend_input(k) <= s_delay_line(s_delay_line'high)(31 downto 0);
+    else generate
+      s_blend_method(k) <= s_layer_rmode(k)(7 downto 0);
+      s_blend_input(k) <= s_layer_color(k);
+    end generate;
+
+    TileDelayGen: if ENABLE_TILE_MODE and k = NUM_LAYERS generate
+      type T_TILE_DELAY_LINE is array (1 to C_VID_TILE_MODE_DELAY) of
+          std_logic_vector(31 downto 0);
+      signal s_tile_delay_line : T_TILE_DELAY_LINE;
+    begin
+      process(i_clk, i_rst)
+      begin
+        if i_rst = '1' then
+          s_tile_delay_line <= (others => (others => '0'));
+        elsif rising_edge(i_clk) then
+          s_tile_delay_line(1) <= s_blend_color(k-1);
+          for i in 2 to s_tile_delay_line'high loop
+            s_tile_delay_line(i) <= s_tile_delay_line(i-1);
+          end loop;
+        end if;
+      end process;
+      s_blend_base(k) <= s_tile_delay_line(s_tile_delay_line'high);
+    else generate
+      s_blend_base(k) <= s_blend_color(k-1);
+    end generate;
 
-    -- Instantiate the layer blending logic.
     blend1: entity work.vid_blend
+      generic map (
+        MUL_STAGES => BLEND_MUL_STAGES
+      )
       port map (
         i_rst => i_rst,
         i_clk => i_clk,
-        i_method => s_layer2_rmode(7 downto 0),
-        i_color_1 => s_layer1_color,
-        i_color_2 => s_layer2_color,
+        i_method => s_blend_method(k),
+        i_color_1 => s_blend_base(k),
+        i_color_2 => s_blend_input(k),
+        o_color => s_blend_color(k)
+      );
+  end generate;
+
+
+
+  --------------------------------------------------------------------------------------------------
+  -- Hardware sprite (blended on top of all the layers).
+  --------------------------------------------------------------------------------------------------
+
+  SpriteGen: if ENABLE_SPRITE generate
+  begin
+    sprite_1: entity work.vid_sprite
+      generic map (
+        X_COORD_BITS => s_raster_x'length,
+        Y_COORD_BITS => s_raster_y'length,
+        LOG2_READ_WORDS => LOG2_READ_WORDS,
+        COLOR_DELAY => C_LAYERS_DELAY
+      )
+      port map (
+        i_rst => i_rst,
+        i_clk => i_clk,
+        i_raster_x => s_raster_x,
+        i_raster_y => s_raster_y,
+        i_enable => i_sprite_enable,
+        i_addr => i_sprite_addr,
+        i_xpos => i_sprite_xpos,
+        i_ypos => i_sprite_ypos,
+        o_read_en => s_sprite_read_en,
+        o_read_adr => s_sprite_read_adr,
+        i_read_ack => s_sprite_read_ack,
+        i_read_dat => i_read_dat,
+        i_color => s_blend_color(NUM_LAYERS),
         o_color => s_final_color
       );
   else generate
-    s_layer2_read_en <= '0';
-    s_layer2_read_adr <= (others => '0');
-    s_final_color <= s_layer1_color;
+    s_sprite_read_en <= '0';
+    s_sprite_read_adr <= (others => '0');
+    s_final_color <= s_blend_color(NUM_LAYERS);
   end generate;
 
 
@@ -190,19 +359,69 @@ begin
   -- VRAM read logic - only one entity may access VRAM during each clock cycle.
   --------------------------------------------------------------------------------------------------
 
-  -- Select the read address (layer 2 has priority over layer 1).
-  o_read_adr <= s_layer2_read_adr(ADR_BITS-1 downto 0) when s_layer2_read_en = '1' else
-                s_layer1_read_adr(ADR_BITS-1 downto 0);
+  -- Select the read address. The sprite has the highest priority (it only reads memory during the
+  -- horizontal blanking interval), followed by urgent reads (tile mode reads, that can not wait).
+  -- The remaining cycles are time slotted: Each cycle belongs to one of the layers in turn, and
+  -- the layer that owns the slot gets the cycle if it needs it. Otherwise the cycle is given to the
+  -- next layer (in slot order) that needs it, so idle slots are not wasted. Thus every layer is
+  -- guaranteed every NUM_LAYERS:th cycle that is not used by the sprite or by urgent reads, and
+  -- the line FIFO:s even out the demand over the line.
+  process(s_sprite_read_en, s_sprite_read_adr, s_layer_read_en, s_layer_read_urgent,
+          s_layer_read_adr, s_read_slot)
+    variable v_adr : std_logic_vector(23 downto 0);
+    variable v_busy : std_logic;
+    variable v_grant : std_logic_vector(1 to NUM_LAYERS);
+    variable v_k : integer range 1 to NUM_LAYERS;
+  begin
+    v_adr := s_layer_read_adr(1);
+    v_busy := '0';
+    v_grant := (others => '0');
+    if s_sprite_read_en = '1' then
+      v_adr := s_sprite_read_adr;
+      v_busy := '1';
+    end if;
+    for k in 1 to NUM_LAYERS loop
+      if s_layer_read_urgent(k) = '1' and v_busy = '0' then
+        v_adr := s_layer_read_adr(k);
+        v_busy := '1';
+        v_grant(k) := '1';
+      end if;
+    end loop;
+    for i in 0 to NUM_LAYERS-1 loop
+      v_k := ((s_read_slot - 1 + i) mod NUM_LAYERS) + 1;
+      if s_layer_read_en(v_k) = '1' and v_busy = '0' then
+        v_adr := s_layer_read_adr(v_k);
+        v_busy := '1';
+        v_grant(v_k) := '1';
+      end if;
+    end loop;
+    s_layer_read_grant <= v_grant;
+    o_read_adr <= v_adr(o_read_adr'left downto 0);
+  end process;
+
+  -- Advance the time slot.
+  process(i_clk, i_rst)
+  begin
+    if i_rst = '1' then
+      s_read_slot <= 1;
+    elsif rising_edge(i_clk) then
+      if s_read_slot = NUM_LAYERS then
+        s_read_slot <= 1;
+      else
+        s_read_slot <= s_read_slot + 1;
+      end if;
+    end if;
+  end process;
 
   -- Respond with an ack to the serviced layer (one cycle after the request).
   process(i_clk, i_rst)
   begin
     if i_rst = '1' then
-      s_layer1_read_ack <= '0';
-      s_layer2_read_ack <= '0';
+      s_sprite_read_ack <= '0';
+      s_layer_read_ack <= (others => '0');
     elsif rising_edge(i_clk) then
-      s_layer1_read_ack <= s_layer1_read_en and not s_layer2_read_en;
-      s_layer2_read_ack <= s_layer2_read_en;
+      s_sprite_read_ack <= s_sprite_read_en;
+      s_layer_read_ack <= s_layer_read_grant;
     end if;
   end process;
 
@@ -222,7 +441,7 @@ begin
   DitherGen: if ENABLE_DITHERING generate
   begin
     -- The dither method is controlled via the layer 1 RMODE VCR.
-    s_dither_method <= s_layer1_rmode(9 downto 8);
+    s_dither_method <= s_layer_rmode(1)(9 downto 8);
 
     dither1: entity work.dither
       generic map(
@@ -270,4 +489,23 @@ begin
   -- Extra output signals used for MMIO registers.
   o_raster_y(s_raster_x'left downto 0) <= s_raster_y;
   o_raster_y(15 downto s_raster_y'length) <= (others => s_raster_y(s_raster_y'left));
+
+  -- Collect the line FIFO underruns of each frame (the flags are updated when a new frame starts).
+  process(i_clk, i_rst)
+  begin
+    if i_rst = '1' then
+      s_frame_underrun <= (others => '0');
+      o_layer_underrun <= (others => '0');
+    elsif rising_edge(i_clk) then
+      if s_restart_frame = '1' then
+        o_layer_underrun <= (others => '0');
+        for k in 1 to NUM_LAYERS loop
+          o_layer_underrun(k-1) <= s_frame_underrun(k);
+        end loop;
+        s_frame_underrun <= s_layer_underrun;
+      else
+        s_frame_underrun <= s_frame_underrun or s_layer_underrun;
+      end if;
+    end if;
+  end process;
 end rtl;
@@ -27,7 +27,11 @@ entity video_layer is
     X_COORD_BITS : positive;
     Y_COORD_BITS : positive;
     VCP_START_ADDRESS : std_logic_vector(23 downto 0);
-    ENABLE_PIXEL_PREFETCH : boolean
+    LOG2_PALETTE_BANKS : natural;
+    LOG2_READ_WORDS : natural;
+    PIXEL_ADDR_STAGES : natural := 0;
+    PIXEL_SHIFT_STAGES : natural := 0;
+    ENABLE_TILE_MODE : boolean := false
   );
   port(
     i_rst : in std_logic;
@@ -37,10 +41,18 @@ entity video_layer is
     i_raster_x : in std_logic_vector(X_COORD_BITS-1 downto 0);
     i_raster_y : in std_logic_vector(Y_COORD_BITS-1 downto 0);
 
+    -- Note: The read address is given in units of memory rows (2^LOG2_READ_WORDS words).
+    -- An urgent read (o_read_urgent) must be granted during the same cycle, and i_read_grant is
+    -- asserted during the cycle that the read is granted (the ack follows one cycle later).
     o_read_en : out std_logic;
+    o_read_urgent : out std_logic;
     o_read_adr : out std_logic_vector(23 downto 0);
+    i_read_grant : in std_logic;
     i_read_ack : in std_logic;
-    i_read_dat : in std_logic_vector(31 downto 0);
+    i_read_dat : in std_logic_vector(32*(2**LOG2_READ_WORDS)-1 downto 0);
+
+    -- Line FIFO underrun (the layer needed more memory bandwidth than it got).
+    o_underrun : out std_logic;
 
     o_rmode : out std_logic_vector(23 downto 0);
     o_color : out std_logic_vector(31 downto 0)
@@ -48,38 +60,49 @@ entity video_layer is
 end video_layer;
 
 architecture rtl of video_layer is
+  constant C_NUM_WORDS : positive := 2**LOG2_READ_WORDS;
+  constant C_CMODE_TILE : std_logic_vector(3 downto 0) := 4X"6";
+
   signal s_vcpp_mem_read_en : std_logic;
   signal s_vcpp_mem_read_adr : std_logic_vector(23 downto 0);
+  signal s_vcpp_mem_read_row : std_logic_vector(23 downto 0);
   signal s_vcpp_mem_expect_ack : std_logic;
+  signal s_vcpp_mem_expect_word : integer range 0 to C_NUM_WORDS-1;
   signal s_vcpp_mem_ack : std_logic;
+  signal s_vcpp_mem_dat : std_logic_vector(31 downto 0);
   signal s_vcpp_reg_write_enable : std_logic;
   signal s_vcpp_pal_write_enable : std_logic;
   signal s_vcpp_write_adr : std_logic_vector(7 downto 0);
   signal s_vcpp_write_data : std_logic_vector(31 downto 0);
 
   signal s_regs : T_VID_REGS;
+  signal s_row_line : std_logic_vector(11 downto 0);
 
   signal s_pix_mem_read_en : std_logic;
   signal s_pix_mem_read_adr : std_logic_vector(23 downto 0);
   signal s_pix_mem_ack : std_logic;
-  signal s_pix_mem_dat : std_logic_vector(31 downto 0);
-  signal s_pix_decremental_read : std_logic;
-  signal s_pix_row_start_imminent : std_logic;
-  signal s_pix_row_start_addr : std_logic_vector(23 downto 0);
+  signal s_pix_mem_dat : std_logic_vector(32*C_NUM_WORDS-1 downto 0);
+  signal s_pix_is_tile : std_logic;
+  signal s_pix_direct_read_en : std_logic;
+  signal s_pix_direct_expect_ack : std_logic;
 
-  signal s_pix_cache_read_en : std_logic;
-  signal s_pix_cache_read_adr : std_logic_vector(23 downto 0);
-  signal s_pix_cache_ack : std_logic;
-  signal s_pix_cache_dat : std_logic_vector(31 downto 0);
-  signal s_pix_cache_expect_ack : std_logic;
+  signal s_fifo_fetch_en : std_logic;
+  signal s_fifo_decremental_read : std_logic;
+  signal s_fifo_row_start_imminent : std_logic;
+  signal s_fifo_row_start_addr : std_logic_vector(23 downto 0);
+  signal s_fifo_pix_read_en : std_logic;
+  signal s_fifo_pix_ack : std_logic;
+  signal s_fifo_pix_dat : std_logic_vector(32*C_NUM_WORDS-1 downto 0);
+  signal s_fifo_read_en : std_logic;
+  signal s_fifo_read_adr : std_logic_vector(23 downto 0);
+  signal s_fifo_read_grant : std_logic;
 
   signal s_pix_pal_adr : std_logic_vector(7 downto 0);
   signal s_pix_pal_data : std_logic_vector(31 downto 0);
 
   function is_row_start_imminent(raster_x : std_logic_vector) return std_logic is
-    constant C_IMMINENT_X_COORD : signed := to_signed(-16, X_COORD_BITS);
+    constant C_IMMINENT_X_COORD : signed := to_signed(C_VID_LINE_FIFO_FILL_X, X_COORD_BITS);
   begin
-    -- TODO(m): Make the imminent x coord relative to HSTRT for more headroom.
     if signed(raster_x) = C_IMMINENT_X_COORD then
       return '1';
     else
@@ -105,6 +128,23 @@ architecture rtl of video_layer is
     -- The real row start address is the base address + scaled offset.
     return std_logic_vector(v_base + resize(v_offset, v_base'length));
   end;
+
+  function to_row_addr(addr : std_logic_vector) return std_logic_vector is
+  begin
+    return std_logic_vector(shift_right(unsigned(addr), LOG2_READ_WORDS));
+  end;
+
+  function select_word(x : std_logic_vector; idx : integer) return std_logic_vector is
+    variable v_result : std_logic_vector(31 downto 0);
+  begin
+    v_result := (others => '0');
+    for k in 0 to C_NUM_WORDS-1 loop
+      if idx = k then
+        v_result := x(k*32+31 downto k*32);
+      end if;
+    end loop;
+    return v_result;
+  end;
 begin
   -- Instantiate the video control program processor.
   vcpp_1: entity work.vid_vcpp
@@ -121,7 +161,7 @@ begin
       i_raster_y => i_raster_y,
       o_mem_read_en => s_vcpp_mem_read_en,
       o_mem_read_addr => s_vcpp_mem_read_adr,
-      i_mem_data => i_read_dat,
+      i_mem_data => s_vcpp_mem_dat,
       i_mem_ack => s_vcpp_mem_ack,
       o_reg_write_enable => s_vcpp_reg_write_enable,
       o_pal_write_enable => s_vcpp_pal_write_enable,
@@ -131,24 +171,36 @@ begin
 
   -- Instantiate the video control registers.
   vcr_1: entity work.vid_regs
+    generic map (
+      Y_COORD_BITS => Y_COORD_BITS
+    )
     port map(
       i_rst => i_rst,
       i_clk => i_clk,
       i_restart_frame => i_restart_frame,
+      i_raster_y => i_raster_y,
       i_write_enable => s_vcpp_reg_write_enable,
-      i_write_addr => s_vcpp_write_adr(2 downto 0),
+      i_write_addr => s_vcpp_write_adr(3 downto 0),
       i_write_data => s_vcpp_write_data(23 downto 0),
-      o_regs => s_regs
+      o_regs => s_regs,
+      o_row_line => s_row_line
     );
 
   -- Instantiate the video palette.
+  -- The PALBANK VCR selects the palette bank for SETPAL writes (bits 15:8) and for display
+  -- (bits 7:0).
   palette_1: entity work.vid_palette
+    generic map (
+      LOG2_NUM_BANKS => LOG2_PALETTE_BANKS
+    )
     port map(
       i_rst => i_rst,
       i_clk => i_clk,
       i_write_enable => s_vcpp_pal_write_enable,
+      i_write_bank => s_regs.PALBANK(15 downto 8),
       i_write_addr => s_vcpp_write_adr,
       i_write_data => s_vcpp_write_data,
+      i_read_bank => s_regs.PALBANK(7 downto 0),
       i_read_addr => s_pix_pal_adr,
       o_read_data => s_pix_pal_data
     );
@@ -157,7 +209,11 @@ begin
   pixel_pipe_1: entity work.vid_pixel
     generic map (
       X_COORD_BITS => X_COORD_BITS,
-      Y_COORD_BITS => Y_COORD_BITS
+      Y_COORD_BITS => Y_COORD_BITS,
+      LOG2_READ_WORDS => LOG2_READ_WORDS,
+      ADDR_STAGES => PIXEL_ADDR_STAGES,
+      SHIFT_STAGES => PIXEL_SHIFT_STAGES,
+      ENABLE_TILE_MODE => ENABLE_TILE_MODE
     )
     port map(
       i_rst => i_rst,
@@ -171,66 +227,108 @@ begin
       o_pal_addr => s_pix_pal_adr,
       i_pal_data => s_pix_pal_data,
       i_regs => s_regs,
+      i_row_line => s_row_line,
       o_color => o_color
     );
 
-  PREFETCH_GEN: if ENABLE_PIXEL_PREFETCH generate
-  begin
-    -- Provide the prefetcher with pixel sampling information.
-    s_pix_decremental_read <= s_regs.XINCR(23);
-    s_pix_row_start_imminent <= is_row_start_imminent(i_raster_x);
-    s_pix_row_start_addr <= calc_row_start_addr(s_regs.ADDR, s_regs.XOFFS, s_regs.CMODE);
-
-    -- Instantiate the pixel prefetch cache.
-    vid_pix_prefetch_1: entity work.vid_pix_prefetch
-      port map(
-        i_rst => i_rst,
-        i_clk => i_clk,
-        i_read_en => s_pix_mem_read_en,
-        i_read_adr => s_pix_mem_read_adr,
-        i_decremental_read => s_pix_decremental_read,
-        i_row_start_imminent => s_pix_row_start_imminent,
-        i_row_start_addr => s_pix_row_start_addr,
-        o_read_ack => s_pix_mem_ack,
-        o_read_dat => s_pix_mem_dat,
-        o_read_en => s_pix_cache_read_en,
-        o_read_adr => s_pix_cache_read_adr,
-        i_read_ack => s_pix_cache_ack,
-        i_read_dat => i_read_dat
-      );
-  else generate
-    -- Bypass the pixel prefetch cache (uses less memory cycles). The top layer should not need a
-    -- prefetch cache, since it has the highest memory cacyle priority.
-    s_pix_cache_read_en <= s_pix_mem_read_en;
-    s_pix_cache_read_adr <= s_pix_mem_read_adr;
-    s_pix_mem_ack <= s_pix_cache_ack;
-    s_pix_mem_dat <= i_read_dat;
-  end generate;
-
   -- Output the render mode (used by the blending and dithering logic).
   o_rmode <= s_regs.RMODE;
 
 
+  --------------------------------------------------------------------------------------------------
+  -- Pixel memory reads.
+  --
+  -- In tile mode, the pixel pipeline reads the tile map and the glyphs directly from VRAM (urgent
+  -- reads that must be served without wait states). In all other modes, the pixel pipeline drains
+  -- the line FIFO, which fetches the pixel rows ahead of time whenever it gets a memory cycle.
+  --------------------------------------------------------------------------------------------------
+
+  s_pix_is_tile <= '1' when ENABLE_TILE_MODE and s_regs.CMODE(3 downto 0) = C_CMODE_TILE else
+                   '0';
+  s_pix_direct_read_en <= s_pix_mem_read_en and s_pix_is_tile;
+
+  -- Only the top layer supports tile mode (see video). Flag VCP programs that select tile mode in
+  -- another layer (CMODE = 6 is undefined without ENABLE_TILE_MODE).
+  process(i_clk)
+  begin
+    if rising_edge(i_clk) then
+      assert ENABLE_TILE_MODE or s_regs.CMODE(3 downto 0) /= C_CMODE_TILE
+        report "Tile mode (CMODE = 6) is only supported in the top video layer" severity warning;
+    end if;
+  end process;
+
+  -- Provide the line FIFO with pixel sampling information (only fetch rows for the line if the
+  -- layer has an active area).
+  s_fifo_fetch_en <= '1' when s_pix_is_tile = '0' and
+                              signed(s_regs.HSTRT) < signed(s_regs.HSTOP) else
+                     '0';
+  s_fifo_decremental_read <= s_regs.XINCR(23);
+  s_fifo_row_start_imminent <= is_row_start_imminent(i_raster_x);
+  s_fifo_row_start_addr <= to_row_addr(calc_row_start_addr(s_regs.ADDR,
+                                                           s_regs.XOFFS,
+                                                           s_regs.CMODE));
+  s_fifo_pix_read_en <= s_pix_mem_read_en and not s_pix_is_tile;
+
+  -- Instantiate the line FIFO.
+  vid_line_fifo_1: entity work.vid_line_fifo
+    generic map (
+      LOG2_READ_WORDS => LOG2_READ_WORDS,
+      LOG2_DEPTH => C_VID_LINE_FIFO_LOG2_DEPTH
+    )
+    port map(
+      i_rst => i_rst,
+      i_clk => i_clk,
+      i_fetch_en => s_fifo_fetch_en,
+      i_decremental_read => s_fifo_decremental_read,
+      i_row_start_imminent => s_fifo_row_start_imminent,
+      i_row_start_addr => s_fifo_row_start_addr,
+      o_underrun => o_underrun,
+      i_read_en => s_fifo_pix_read_en,
+      i_read_adr => s_pix_mem_read_adr,
+      o_read_ack => s_fifo_pix_ack,
+      o_read_dat => s_fifo_pix_dat,
+      o_read_en => s_fifo_read_en,
+      o_read_adr => s_fifo_read_adr,
+      i_read_grant => s_fifo_read_grant,
+      i_read_dat => i_read_dat
+    );
+
+  s_pix_mem_ack <= s_fifo_pix_ack or (i_read_ack and s_pix_direct_expect_ack);
+  s_pix_mem_dat <= i_read_dat when s_pix_direct_expect_ack = '1' else s_fifo_pix_dat;
+
+
   --------------------------------------------------------------------------------------------------
   -- VRAM read logic - only one entity may access VRAM during each clock cycle.
   --------------------------------------------------------------------------------------------------
 
-  -- Select the active read unit - The pixel pipe has priority over the VCPP.
-  o_read_en <= s_pix_cache_read_en or s_vcpp_mem_read_en;
-  o_read_adr <= s_pix_cache_read_adr when s_pix_cache_read_en = '1' else
-                s_vcpp_mem_read_adr;
+  -- Select the active read unit - Direct pixel reads have priority over line FIFO fetches, which
+  -- have priority over the VCPP.
+  -- Note: The pixel pipe produces row addresses, while the VCPP produces word addresses.
+  s_vcpp_mem_read_row <= to_row_addr(s_vcpp_mem_read_adr);
+  o_read_en <= s_pix_direct_read_en or s_fifo_read_en or s_vcpp_mem_read_en;
+  o_read_urgent <= s_pix_direct_read_en;
+  o_read_adr <= s_pix_mem_read_adr when s_pix_direct_read_en = '1' else
+                s_fifo_read_adr when s_fifo_read_en = '1' else
+                s_vcpp_mem_read_row;
+  s_fifo_read_grant <= i_read_grant and s_fifo_read_en and not s_pix_direct_read_en;
 
   -- Respond with an ack to the relevant unit (one cycle after).
   process(i_clk, i_rst)
   begin
     if i_rst = '1' then
-      s_pix_cache_expect_ack <= '0';
+      s_pix_direct_expect_ack <= '0';
       s_vcpp_mem_expect_ack <= '0';
+      s_vcpp_mem_expect_word <= 0;
     elsif rising_edge(i_clk) then
-      s_pix_cache_expect_ack <= s_pix_cache_read_en;
-      s_vcpp_mem_expect_ack <= s_vcpp_mem_read_en and not s_pix_cache_read_en;
+      s_pix_direct_expect_ack <= s_pix_direct_read_en;
+      s_vcpp_mem_expect_ack <= s_vcpp_mem_read_en and
+                               not (s_pix_direct_read_en or s_fifo_read_en);
+      s_vcpp_mem_expect_word <= to_integer(unsigned(s_vcpp_mem_read_adr(7 downto 0))) mod
+                                C_NUM_WORDS;
     end if;
   end process;
-  s_pix_cache_ack <= i_read_ack and s_pix_cache_expect_ack;
   s_vcpp_mem_ack <= i_read_ack and s_vcpp_mem_expect_ack;
+
+  -- Select the requested word from the memory row for the VCPP.
+  s_vcpp_mem_dat <= select_word(i_read_dat, s_vcpp_mem_expect_word);
 end rtl;
@@ -28,6 +28,9 @@
 --     - Single cycle read/write operation.
 --   * Port B:
 --     - Read-only (no byte enable)
+--     - Configurable data width (32 * 2^M bits), where M is given by LOG2_READ_WORDS.
+--     - The address is given in units of 2^M words (i.e. the read data is 2^M consecutive words,
+--       with the lowest addressed word in the least significant bits).
 --   * Synthesizes to BRAM
 ----------------------------------------------------------------------------------------------------
 
@@ -37,7 +40,8 @@ use ieee.numeric_std.all;
 
 entity vram is
   generic(
-    ADR_BITS : positive := 10  -- 2**10 = 1024 words
+    ADR_BITS : positive := 10;      -- 2**10 = 1024 words
+    LOG2_READ_WORDS : natural := 0  -- 2**0 = 1 word per port B read
   );
   port(
     -- Reset signal.
@@ -58,102 +62,69 @@ entity vram is
 
     -- Read-only second port to the RAM.
     i_read_clk : in std_logic;
-    i_read_adr : in std_logic_vector(ADR_BITS-1 downto 0);
-    o_read_dat : out std_logic_vector(31 downto 0)
+    i_read_adr : in std_logic_vector(ADR_BITS-LOG2_READ_WORDS-1 downto 0);
+    o_read_dat : out std_logic_vector(32*(2**LOG2_READ_WORDS)-1 downto 0)
   );
 end vram;
 
 architecture rtl of vram is
+  constant C_NUM_WORDS : positive := 2**LOG2_READ_WORDS;
+  constant C_ROW_ADR_BITS : positive := ADR_BITS-LOG2_READ_WORDS;
+
+  type T_WORD_ARRAY is array (0 to C_NUM_WORDS-1) of std_logic_vector(31 downto 0);
+
   signal s_is_valid_wb_request : std_logic;
   signal s_we_a : std_logic;
-  signal s_we_a_0 : std_logic;
-  signal s_we_a_1 : std_logic;
-  signal s_we_a_2 : std_logic;
-  signal s_we_a_3 : std_logic;
+  signal s_wb_row_adr : std_logic_vector(C_ROW_ADR_BITS-1 downto 0);
+  signal s_wb_word : integer range 0 to C_NUM_WORDS-1;
+  signal s_wb_word_latched : integer range 0 to C_NUM_WORDS-1;
+  signal s_wb_dat : T_WORD_ARRAY;
 begin
   -- Wishbone control logic.
   s_is_valid_wb_request <= i_wb_cyc and i_wb_stb;
   s_we_a <= s_is_valid_wb_request and i_wb_we;
-  s_we_a_0 <= s_we_a and i_wb_sel(0);
-  s_we_a_1 <= s_we_a and i_wb_sel(1);
-  s_we_a_2 <= s_we_a and i_wb_sel(2);
-  s_we_a_3 <= s_we_a and i_wb_sel(3);
+
+  -- The words are interleaved across the RAM banks: The least significant address bits select the
+  -- bank, and the remaining bits select the row within the bank.
+  s_wb_row_adr <= i_wb_adr(ADR_BITS-1 downto LOG2_READ_WORDS);
+  s_wb_word <= to_integer(unsigned(i_wb_adr)) mod C_NUM_WORDS;
 
   -- We always ack and never stall - we're that fast ;-)
   process(i_wb_clk)
   begin
     if rising_edge(i_wb_clk) then
       o_wb_ack <= s_is_valid_wb_request;
+      s_wb_word_latched <= s_wb_word;
     end if;
   end process;
   o_wb_stall <= '0';
 
-  -- We instatiate four 8-bit wide RAM entities in order to support byte select.
-  ram_tdp_0: entity work.ram_true_dual_port
-    generic map (
-      DATA_BITS => 8,
-      ADR_BITS => ADR_BITS
-    )
-    port map (
-      i_clk_a => i_wb_clk,
-      i_we_a => s_we_a_0,
-      i_adr_a => i_wb_adr,
-      i_data_a => i_wb_dat(7 downto 0),
-      o_data_a => o_wb_dat(7 downto 0),
-
-      i_clk_b => i_read_clk,
-      i_adr_b => i_read_adr,
-      o_data_b => o_read_dat(7 downto 0)
-    );
+  -- The read data is delayed by one cycle, so select it using the latched word index.
+  o_wb_dat <= s_wb_dat(s_wb_word_latched);
 
-  ram_tdp_1: entity work.ram_true_dual_port
-    generic map (
-      DATA_BITS => 8,
-      ADR_BITS => ADR_BITS
-    )
-    port map (
-      i_clk_a => i_wb_clk,
-      i_we_a => s_we_a_1,
-      i_adr_a => i_wb_adr,
-      i_data_a => i_wb_dat(15 downto 8),
-      o_data_a => o_wb_dat(15 downto 8),
-
-      i_clk_b => i_read_clk,
-      i_adr_b => i_read_adr,
-      o_data_b => o_read_dat(15 downto 8)
-    );
-
-  ram_tdp_2: entity work.ram_true_dual_port
-    generic map (
-      DATA_BITS => 8,
-      ADR_BITS => ADR_BITS
-    )
-    port map (
-      i_clk_a => i_wb_clk,
-      i_we_a => s_we_a_2,
-      i_adr_a => i_wb_adr,
-      i_data_a => i_wb_dat(23 downto 16),
-      o_data_a => o_wb_dat(23 downto 16),
-
-      i_clk_b => i_read_clk,
-      i_adr_b => i_read_adr,
-      o_data_b => o_read_dat(23 downto 16)
-    );
+  BankGen: for k in 0 to C_NUM_WORDS-1 generate
+    signal s_we_a_bytes : std_logic_vector(3 downto 0);
+  begin
+    s_we_a_bytes <= i_wb_sel when s_we_a = '1' and s_wb_word = k else "0000";
 
-  ram_tdp_3: entity work.ram_true_dual_port
-    generic map (
-      DATA_BITS => 8,
-      ADR_BITS => ADR_BITS
-    )
-    port map (
-      i_clk_a => i_wb_clk,
-      i_we_a => s_we_a_3,
-      i_adr_a => i_wb_adr,
-      i_data_a => i_wb_dat(31 downto 24),
-      o_data_a => o_wb_dat(31 downto 24),
+    -- We instatiate four 8-bit wide RAM entities in order to support byte select.
+    ByteGen: for b in 0 to 3 generate
+      ram_tdp: entity work.ram_true_dual_port
+        generic map (
+          DATA_BITS => 8,
+          ADR_BITS => C_ROW_ADR_BITS
+        )
+        port map (
+          i_clk_a => i_wb_clk,
+          i_we_a => s_we_a_bytes(b),
+          i_adr_a => s_wb_row_adr,
+          i_data_a => i_wb_dat(b*8+7 downto b*8),
+          o_data_a => s_wb_dat(k)(b*8+7 downto b*8),
 
-      i_clk_b => i_read_clk,
-      i_adr_b => i_read_adr,
-      o_data_b => o_read_dat(31 downto 24)
-    );
+          i_clk_b => i_read_clk,
+          i_adr_b => i_read_adr,
+          o_data_b => o_read_dat(k*32+b*8+7 downto k*32+b*8)
+        );
+    end generate;
+  end generate;
 end rtl;
@@ -0,0 +1,205 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- This is a 2 x 1 arbiter module with the following properties:
+--   * Wishbone B4 pipelined interface (see: https://cdn.opencores.org/downloads/wbspec_b4.pdf)
+--   * The arbiter connects two masters to one slave (e.g. a master port of a crossbar).
+--   * A master keeps the slave for as long as it has pending requests.
+--   * When the slave is free and both masters have a request, the master that did not issue the
+--     last request is selected (round robin).
+--   * A request (STB) from a master will be stalled (STALL) if:
+--     - The slave is busy with the other master.
+--     - It tries to issue more than the maximum allowed number of pending requests. (*)
+--
+-- (*) A pending request is one that has been issued by a master but not yet responded to.
+----------------------------------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity wb_arbiter_2x1 is
+  generic(
+    ADR_WIDTH : positive := 30;            -- Address bus width
+    DAT_WIDTH : positive := 32;            -- Must be a multiple of GRANULARITY
+    GRANULARITY : positive := 8;           -- Usually 8 (for byte granularity)
+    LOG2_MAX_PENDING_REQS : positive := 6  -- Max pending reqs = 2**LOG2_MAX_PENDING_REQS-1
+  );
+  port(
+    -- Common control signals.
+    i_rst : in std_logic;
+    i_clk : in std_logic;
+
+    -- Signals from/to MASTER A.
+    i_adr_a : in std_logic_vector(ADR_WIDTH-1 downto 0);
+    i_dat_a : in std_logic_vector(DAT_WIDTH-1 downto 0);
+    i_we_a : in std_logic;
+    i_sel_a : in std_logic_vector(DAT_WIDTH/GRANULARITY-1 downto 0);
+    i_cyc_a : in std_logic;
+    i_stb_a : in std_logic;
+    o_dat_a : out std_logic_vector(DAT_WIDTH-1 downto 0);
+    o_ack_a : out std_logic;
+    o_stall_a : out std_logic;
+    o_err_a : out std_logic;
+
+    -- Signals from/to MASTER B.
+    i_adr_b : in std_logic_vector(ADR_WIDTH-1 downto 0);
+    i_dat_b : in std_logic_vector(DAT_WIDTH-1 downto 0);
+    i_we_b : in std_logic;
+    i_sel_b : in std_logic_vector(DAT_WIDTH/GRANULARITY-1 downto 0);
+    i_cyc_b : in std_logic;
+    i_stb_b : in std_logic;
+    o_dat_b : out std_logic_vector(DAT_WIDTH-1 downto 0);
+    o_ack_b : out std_logic;
+    o_stall_b : out std_logic;
+    o_err_b : out std_logic;
+
+    -- Signals to/from the SLAVE.
+    o_adr : out std_logic_vector(ADR_WIDTH-1 downto 0);
+    o_dat : out std_logic_vector(DAT_WIDTH-1 downto 0);
+    o_we : out std_logic;
+    o_sel : out std_logic_vector(DAT_WIDTH/GRANULARITY-1 downto 0);
+    o_cyc : out std_logic;
+    o_stb : out std_logic;
+    i_dat : in std_logic_vector(DAT_WIDTH-1 downto 0);
+    i_ack : in std_logic;
+    i_stall : in std_logic;
+    i_err : in std_logic
+  );
+end wb_arbiter_2x1;
+
+architecture rtl of wb_arbiter_2x1 is
+  constant C_MAX_PENDING_REQS : positive := 2**LOG2_MAX_PENDING_REQS - 1;
+
+  subtype T_REQ_COUNT is unsigned(LOG2_MAX_PENDING_REQS-1 downto 0);
+
+  -- Registered state signals.
+  signal s_owner_b : std_logic;
+  signal s_last_b : std_logic;
+  signal s_pending_reqs : T_REQ_COUNT;
+  signal s_pending_reqs_is_0 : std_logic;
+  signal s_pending_reqs_is_1 : std_logic;
+  signal s_pending_reqs_is_max : std_logic;
+
+  -- Request arbiter signals.
+  signal s_resp : std_logic;
+  signal s_no_pending_req : std_logic;
+  signal s_req_a : std_logic;
+  signal s_req_b : std_logic;
+  signal s_grant_a : std_logic;
+  signal s_grant_b : std_logic;
+  signal s_stb : std_logic;
+begin
+  --------------------------------------------------------------------------------------------------
+  -- Master selection logic.
+  -- Note: These signals are non-registered, so keep the logic complexity to a minimum, and NO
+  -- combinatorial loops (signal feedback)!
+  --------------------------------------------------------------------------------------------------
+
+  -- Do we have any pending requests?
+  s_resp <= i_ack or i_err;
+  s_no_pending_req <= s_pending_reqs_is_0 or (s_pending_reqs_is_1 and s_resp);
+
+  -- Decode the current requests.
+  s_req_a <= i_cyc_a and i_stb_a;
+  s_req_b <= i_cyc_b and i_stb_b;
+
+  -- The owner of the pending requests keeps the slave. Otherwise the slave is granted to a
+  -- requesting master (alternating between the masters when both have a request).
+  s_grant_a <= not s_owner_b when s_no_pending_req = '0' else
+               s_req_a and (not s_req_b or s_last_b);
+  s_grant_b <= s_owner_b when s_no_pending_req = '0' else
+               s_req_b and (not s_req_a or not s_last_b);
+
+  -- Should STB be forwarded?
+  s_stb <= ((s_req_a and s_grant_a) or (s_req_b and s_grant_b)) and not s_pending_reqs_is_max;
+
+
+  --------------------------------------------------------------------------------------------------
+  -- Send the signals to the masters.
+  --------------------------------------------------------------------------------------------------
+
+  o_dat_a <= i_dat;
+  o_ack_a <= i_ack and not s_owner_b;
+  o_stall_a <= i_stall when s_grant_a = '1' and s_pending_reqs_is_max = '0' else '1';
+  o_err_a <= i_err and not s_owner_b;
+
+  o_dat_b <= i_dat;
+  o_ack_b <= i_ack and s_owner_b;
+  o_stall_b <= i_stall when s_grant_b = '1' and s_pending_reqs_is_max = '0' else '1';
+  o_err_b <= i_err and s_owner_b;
+
+
+  --------------------------------------------------------------------------------------------------
+  -- Send the signals to the slave.
+  --------------------------------------------------------------------------------------------------
+
+  o_adr <= i_adr_b when s_grant_b = '1' else i_adr_a;
+  o_dat <= i_dat_b when s_grant_b = '1' else i_dat_a;
+  o_we <= i_we_b when s_grant_b = '1' else i_we_a;
+  o_sel <= i_sel_b when s_grant_b = '1' else i_sel_a;
+  o_cyc <= (i_cyc_a and s_grant_a) or (i_cyc_b and s_grant_b);
+  o_stb <= s_stb;
+
+
+  --------------------------------------------------------------------------------------------------
+  -- Prepare state for the next cycle (update registered signals).
+  --------------------------------------------------------------------------------------------------
+
+  process(i_rst, i_clk)
+    variable v_pending_reqs : T_REQ_COUNT;
+  begin
+    if i_rst = '1' then
+      s_owner_b <= '0';
+      s_last_b <= '0';
+      s_pending_reqs <= (others => '0');
+      s_pending_reqs_is_0 <= '1';
+      s_pending_reqs_is_1 <= '0';
+      s_pending_reqs_is_max <= '0';
+    elsif rising_edge(i_clk) then
+      -- Update the number of pending requests.
+      v_pending_reqs := s_pending_reqs;
+      if s_stb = '1' and i_stall = '0' then
+        v_pending_reqs := v_pending_reqs + 1;
+        s_owner_b <= s_grant_b;
+        s_last_b <= s_grant_b;
+      end if;
+      if s_resp = '1' then
+        v_pending_reqs := v_pending_reqs - 1;
+      end if;
+      if v_pending_reqs = 0 then
+        s_pending_reqs_is_0 <= '1';
+      else
+        s_pending_reqs_is_0 <= '0';
+      end if;
+      if v_pending_reqs = 1 then
+        s_pending_reqs_is_1 <= '1';
+      else
+        s_pending_reqs_is_1 <= '0';
+      end if;
+      if v_pending_reqs = C_MAX_PENDING_REQS then
+        s_pending_reqs_is_max <= '1';
+      else
+        s_pending_reqs_is_max <= '0';
+      end if;
+      s_pending_reqs <= v_pending_reqs;
+    end if;
+  end process;
+end rtl;
@@ -43,6 +43,7 @@ entity xram_sdram is
     T_DESL : real := 200000.0;
     T_MRD : real := 12.0;
     T_RC : real := 60.0;
+    T_RAS : real := 42.0;
     T_RCD : real := 18.0;
     T_RP : real := 18.0;
     T_WR : real := 12.0;
@@ -93,26 +94,30 @@ architecture rtl of xram_sdram is
   signal s_sdram_ba : unsigned(SDRAM_BANK_WIDTH-1 downto 0);
 
   signal s_req_from_wb : std_logic;
+  signal s_can_start_req : std_logic;
   signal s_start_req : std_logic;
-  signal s_wating_for_ack : std_logic;
-  signal s_waiting_for_read_response : std_logic;
-  signal s_waiting_for_write_response : std_logic;
+  signal s_started_write : std_logic;
+  signal s_pending_reads : unsigned(2 downto 0);
+  signal s_pending_reads_is_max : std_logic;
 begin
   -- Convert the Wishbone address to an address for the SDRAM controller.
   s_addr <= unsigned(i_wb_adr(C_ADDR_WIDTH-1 downto 0));
 
   -- Should & can we start a new request?
+  -- The SDRAM controller may have several reads in flight. Since Wishbone responses must be given
+  -- in order, and writes are responded to as soon as they have been accepted, we must not start a
+  -- write while there are pending reads.
   s_req_from_wb <= i_wb_cyc and i_wb_stb;
-  s_start_req <= s_req_from_wb and s_ready;
-
-  -- Keep the SDRAM controller REQ signal high until we've got the final ACK.
-  -- TODO(m): Correct/necessary?
-  s_req <= s_start_req or s_wating_for_ack;
+  s_pending_reads_is_max <= '1' when s_pending_reads = (s_pending_reads'range => '1') else '0';
+  s_can_start_req <= s_ready and not s_pending_reads_is_max when i_wb_we = '0' else
+                     s_ready when s_pending_reads = 0 else
+                     '0';
+  s_start_req <= s_req_from_wb and s_can_start_req;
+  s_req <= s_start_req;
 
   -- Wishbone outputs.
-  o_wb_ack <= (s_waiting_for_read_response and s_valid) or
-              (s_waiting_for_write_response and s_ack);
-  o_wb_stall <= not s_ready;
+  o_wb_ack <= s_valid or (s_started_write and s_ack);
+  o_wb_stall <= not s_can_start_req;
   o_wb_err <= '0';
 
   -- Convert some SDRAM outputs to SLV.
@@ -121,25 +126,24 @@ begin
 
   -- Keep track of ongoing requests.
   process (i_rst, i_wb_clk)
+    variable v_pending_reads : unsigned(2 downto 0);
   begin
     if i_rst = '1' then
-      s_wating_for_ack <= '0';
-      s_waiting_for_read_response <= '0';
-      s_waiting_for_write_response <= '0';
+      s_started_write <= '0';
+      s_pending_reads <= (others => '0');
     elsif rising_edge(i_wb_clk) then
-      if s_start_req = '1' then
-        s_wating_for_ack <= '1';
-        s_waiting_for_read_response <= not i_wb_we;
-        s_waiting_for_write_response <= i_wb_we;
-      else
-        if s_ack = '1' then
-          s_wating_for_ack <= '0';
-          s_waiting_for_write_response <= '0';
-        end if;
-        if s_valid = '1' then
-          s_waiting_for_read_response <= '0';
-        end if;
+      -- The SDRAM controller ACKs a request one cycle after it has been accepted.
+      s_started_write <= s_start_req and i_wb_we;
+
+      -- Count the number of reads that have not yet been responded to.
+      v_pending_reads := s_pending_reads;
+      if s_start_req = '1' and i_wb_we = '0' then
+        v_pending_reads := v_pending_reads + 1;
+      end if;
+      if s_valid = '1' then
+        v_pending_reads := v_pending_reads - 1;
       end if;
+      s_pending_reads <= v_pending_reads;
     end if;
   end process;
 
@@ -159,6 +163,7 @@ begin
       T_DESL => T_DESL,
       T_MRD => T_MRD,
       T_RC => T_RC,
+      T_RAS => T_RAS,
       T_RCD => T_RCD,
       T_RP => T_RP,
       T_WR => T_WR,
@@ -2,7 +2,7 @@
 import os
 import struct
 import sys
-from vunit import VUnit
+from vunit import VUnit, VUnitCLI
 
 sys.path.insert(1, os.path.join(sys.path[0], 'mc1-sdk/tools'))
 import vcpas
@@ -10,6 +10,7 @@ import vcpas
 
 _VIDEO_TB_VCP_SOURCE = "test/test-image-640x360-pal8.vcp"
 _VIDEO_TB_VRAM_FILE = "vunit_out/video_tb_ram.bin"
+_VIDEO_TB_GOLDEN_DIR = "test/golden"
 
 
 def bake_video_tb_vram():
@@ -19,18 +20,25 @@ def bake_video_tb_vram():
 
 def main():
     # Create VUnit instance by parsing command line arguments
-    vu = VUnit.from_argv()
+    cli = VUnitCLI()
+    cli.parser.add_argument("--update-golden", action="store_true",
+                            help="update the golden video_tb results instead of comparing")
+    args = cli.parse_args()
+    vu = VUnit.from_args(args=args)
     
     # Create library 'lib' containing all the test benches...
     lib = vu.add_library("lib")
     lib.add_source_files("test/*_tb.vhd")
 
     # Add simulation models.
+    lib.add_source_files("test/sdcard_model.vhd")
     lib.add_source_files("test/sdram_model.vhd")
 
     # Add the MC1 design.
     lib.add_source_files("rtl/bit_synchronizer.vhd")
     lib.add_source_files("rtl/dither.vhd")
+    lib.add_source_files("rtl/handshake_synchronizer.vhd")
+    lib.add_source_files("rtl/lzgdec.vhd")
     lib.add_source_files("rtl/mc1.vhd")
     lib.add_source_files("rtl/mmio_types.vhd")
     lib.add_source_files("rtl/mmio.vhd")
@@ -41,19 +49,22 @@ def main():
     lib.add_source_files("rtl/reset_conditioner.vhd")
     lib.add_source_files("rtl/reset_stabilizer.vhd")
     lib.add_source_files("rtl/sdram.vhd")
+    lib.add_source_files("rtl/sdspi.vhd")
     lib.add_source_files("rtl/synchronizer.vhd")
     lib.add_source_files("rtl/vid_blend.vhd")
     lib.add_source_files("rtl/video_layer.vhd")
     lib.add_source_files("rtl/video.vhd")
+    lib.add_source_files("rtl/vid_line_fifo.vhd")
     lib.add_source_files("rtl/vid_palette.vhd")
     lib.add_source_files("rtl/vid_pixel.vhd")
-    lib.add_source_files("rtl/vid_pix_prefetch.vhd")
     lib.add_source_files("rtl/vid_raster.vhd")
     lib.add_source_files("rtl/vid_regs.vhd")
+    lib.add_source_files("rtl/vid_sprite.vhd")
     lib.add_source_files("rtl/vid_types.vhd")
     lib.add_source_files("rtl/vid_vcpp_stack.vhd")
     lib.add_source_files("rtl/vid_vcpp.vhd")
     lib.add_source_files("rtl/vram.vhd")
+    lib.add_source_files("rtl/wb_arbiter_2x1.vhd")
     lib.add_source_files("rtl/wb_crossbar_2x4.vhd")
     lib.add_source_files("rtl/xram_sdram.vhd")
 
@@ -74,6 +85,14 @@ def main():
     # Bake the video_tb test data.
     bake_video_tb_vram()
 
+    # Let video_tb compare its results against (or update) the golden results.
+    golden_dir = os.path.abspath(_VIDEO_TB_GOLDEN_DIR)
+    if args.update_golden:
+        os.makedirs(golden_dir, exist_ok=True)
+    video_tb = lib.test_bench("video_tb")
+    video_tb.set_generic("golden_dir", golden_dir)
+    video_tb.set_generic("update_golden", args.update_golden)
+
     # Run vunit function
     vu.main()
 
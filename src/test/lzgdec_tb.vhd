@@ -0,0 +1,719 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- This is a test bench for the LZG decompression engine. LZG buffers that use all the LZG1 token
+-- types (literals, escaped marker symbols and near, short, medium and distant copies) are generated
+-- by the test bench, and the output of the engine is compared against the output of a port of the
+-- liblzg software decoder. The decompression throughput is reported in bytes per clock cycle.
+--
+-- A fixed LZG buffer with a known decoded text is decoded too, and malformed buffers (bad magic ID,
+-- truncated token stream and a copy that starts before the start of the output) must be rejected.
+----------------------------------------------------------------------------------------------------
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use ieee.math_real.all;
+
+entity lzgdec_tb is
+  generic (runner_cfg : string);
+end entity;
+
+architecture tb of lzgdec_tb is
+  constant C_CLK_HALF_PERIOD : time := 5 ns;
+  constant C_TIMEOUT_CYCLES : positive := 1000000;
+
+  -- 64 KiB of memory: The LZG buffer is placed at C_SRC_ADR, and it is decompressed to C_DST_ADR.
+  constant C_LOG2_MEM_WORDS : positive := 14;
+  constant C_MEM_WORDS : positive := 2**C_LOG2_MEM_WORDS;
+  constant C_SRC_ADR : natural := 16#0100#;
+  constant C_DST_ADR : natural := 16#8000#;
+  constant C_FILL_BYTE : natural := 16#5a#;
+
+  -- Size of the generated test data (enough for distant copies that are longer than the history
+  -- buffer of the engine).
+  constant C_MAX_SIZE : positive := 16384;
+  constant C_DEC_SIZE : positive := 12000;
+  constant C_HEADER_SIZE : positive := 16;
+
+  type T_BYTES is array (natural range <>) of integer range 0 to 255;
+  type T_MEM is array (0 to C_MEM_WORDS-1) of std_logic_vector(31 downto 0);
+
+  type T_LENGTH_LUT is array (0 to 31) of natural;
+  constant C_LENGTH_LUT : T_LENGTH_LUT := (
+      2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17,
+      18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 35, 48, 72, 128
+    );
+
+  -- A fixed LZG1 buffer and its decoded text. The buffer is encoded token by token (independently
+  -- of the test data generator below), and copies are given as (offset, length).
+  constant C_FIXTURE : T_BYTES := (
+      16#4c#, 16#5a#, 16#47#,                                         -- "LZG"
+      16#00#, 16#00#, 16#00#, 16#a4#,                                 -- Decoded size
+      16#00#, 16#00#, 16#00#, 16#5f#,                                 -- Encoded size
+      16#1e#, 16#ac#, 16#18#, 16#b9#,                                 -- Checksum
+      16#01#,                                                         -- Method (LZG1)
+      16#01#, 16#02#, 16#03#, 16#21#,                                 -- Markers
+      16#4d#, 16#43#, 16#31#, 16#20#, 16#4c#, 16#5a#, 16#47#, 16#20#, -- Literals "MC1 LZG "
+      16#66#, 16#69#, 16#78#, 16#74#, 16#75#, 16#72#, 16#65#,         -- Literals "fixture"
+      16#21#, 16#00#,                                                 -- Escaped marker "!"
+      16#20#, 16#54#, 16#68#, 16#65#, 16#20#, 16#71#, 16#75#, 16#69#, -- Literals " The qui"
+      16#63#, 16#6b#, 16#20#, 16#62#, 16#72#, 16#6f#, 16#77#, 16#6e#, -- Literals "ck brown"
+      16#20#, 16#66#, 16#6f#, 16#78#, 16#20#, 16#6a#, 16#75#, 16#6d#, -- Literals " fox jum"
+      16#70#, 16#73#, 16#20#, 16#6f#, 16#76#, 16#65#, 16#72#, 16#20#, -- Literals "ps over "
+      16#74#,                                                         -- Literals "t"
+      16#03#, 16#17#,                                                 -- Short copy (31, 3)
+      16#6c#, 16#61#, 16#7a#, 16#79#, 16#20#, 16#64#, 16#6f#, 16#67#, -- Literals "lazy dog"
+      16#2e#,                                                         -- Literals "."
+      16#02#, 16#1c#, 16#25#,                                         -- Medium copy (45, 35)
+      16#02#, 16#07#, 16#25#,                                         -- Medium copy (45, 9)
+      16#3f#, 16#20#, 16#5a#, 16#7a#,                                 -- Literals "? Zz"
+      16#21#, 16#12#,                                                 -- Near copy (1, 20)
+      16#2e#, 16#2e#, 16#2e#, 16#20#, 16#31#, 16#32#,                 -- Literals "... 12"
+      16#21#, 16#26#,                                                 -- Near copy (2, 8)
+      16#20#, 16#2d#,                                                 -- Literals " -"
+      16#02#, 16#0d#, 16#32#,                                         -- Medium copy (58, 15)
+      16#02#, 16#01#, 16#4a#,                                         -- Medium copy (82, 3)
+      16#21#, 16#00#                                                  -- Escaped marker "!"
+106
+    );
+  constant C_FIXTURE_TEXT : string :=
+      "MC1 LZG fixture! The quick brown fox jumps over the lazy dog. The quick brown fox jumps " &
+      "over the lazy dog? Zzzzzzzzzzzzzzzzzzzzzz... 1212121212 - over the lazy fox!";
+
+  -- Offset of the marker symbol of the first near copy in C_FIXTURE, and the number of decoded
+  -- bytes that precede the copy.
+  constant C_FIXTURE_NEAR_POS : natural := 91;
+  constant C_FIXTURE_NEAR_OUT : natural := 109;
+
+  signal s_rst : std_logic;
+  signal s_clk : std_logic;
+  signal s_done : boolean := false;
+
+  signal s_src : std_logic_vector(31 downto 0);
+  signal s_dst : std_logic_vector(31 downto 0);
+  signal s_start : std_logic;
+  signal s_stat : std_logic_vector(31 downto 0);
+
+  signal s_wb_cyc : std_logic;
+  signal s_wb_stb : std_logic;
+  signal s_wb_adr : std_logic_vector(29 downto 0);
+  signal s_wb_dat_w : std_logic_vector(31 downto 0);
+  signal s_wb_we : std_logic;
+  signal s_wb_sel : std_logic_vector(3 downto 0);
+  signal s_wb_dat : std_logic_vector(31 downto 0);
+  signal s_wb_ack : std_logic;
+  signal s_wb_stall : std_logic;
+
+  -- Memory model signals.
+  signal s_mem : T_MEM;
+  signal s_init_mem : T_MEM;
+  signal s_load : std_logic := '0';
+  signal s_random_stall : boolean := false;
+  signal s_num_reads : natural;
+  signal s_num_writes : natural;
+
+  function get_mem_byte(mem : T_MEM; adr : natural) return natural is
+    variable v_word : std_logic_vector(31 downto 0);
+    variable v_lane : natural;
+  begin
+    v_word := mem((adr / 4) mod C_MEM_WORDS);
+    v_lane := adr mod 4;
+    return to_integer(unsigned(v_word(v_lane*8+7 downto v_lane*8)));
+  end function;
+
+  -- Write a 32-bit big endian value to a byte buffer (as two 16-bit halves, to stay within the
+  -- integer range).
+  procedure put_u32(buf : inout T_BYTES; pos : natural; hi : natural; lo : natural) is
+  begin
+    buf(pos) := hi / 256;
+    buf(pos + 1) := hi mod 256;
+    buf(pos + 2) := lo / 256;
+    buf(pos + 3) := lo mod 256;
+  end procedure;
+
+  function get_u16(buf : T_BYTES; pos : natural) return natural is
+  begin
+    return buf(pos) * 256 + buf(pos + 1);
+  end function;
+
+  -- Calculate the LZG checksum of the encoded data (everything after the header).
+  procedure calc_checksum(buf : T_BYTES; len : natural; a : out natural; b : out natural) is
+    variable v_a : natural;
+    variable v_b : natural;
+  begin
+    v_a := 1;
+    v_b := 0;
+    for k in C_HEADER_SIZE to len-1 loop
+      v_a := (v_a + buf(k)) mod 65536;
+      v_b := (v_b + v_a) mod 65536;
+    end loop;
+    a := v_a;
+    b := v_b;
+  end procedure;
+
+  -- Fill in the LZG header of an encoded buffer.
+  procedure put_header(buf : inout T_BYTES; len : natural; dec_size : natural; method : natural) is
+    variable v_a : natural;
+    variable v_b : natural;
+  begin
+    buf(0) := character'pos('L');
+    buf(1) := character'pos('Z');
+    buf(2) := character'pos('G');
+    put_u32(buf, 3, dec_size / 65536, dec_size mod 65536);
+    put_u32(buf, 7, (len - C_HEADER_SIZE) / 65536, (len - C_HEADER_SIZE) mod 65536);
+    calc_checksum(buf, len, v_a, v_b);
+    put_u32(buf, 11, v_b, v_a);
+    buf(15) := method;
+  end procedure;
+
+  -- This is a port of LZG_Decode() from liblzg (the reference software decoder).
+  procedure lzg_decode_ref(enc : T_BYTES;
+                           enc_len : natural;
+                           dec : out T_BYTES;
+                           dec_len : out natural;
+                           ok : out boolean) is
+    variable v_dec_size : natural;
+    variable v_enc_size : natural;
+    variable v_a : natural;
+    variable v_b : natural;
+    variable v_src : natural;
+    variable v_src_end : natural;
+    variable v_dst : natural;
+    variable v_m1 : natural;
+    variable v_m2 : natural;
+    variable v_m3 : natural;
+    variable v_m4 : natural;
+    variable v_symbol : natural;
+    variable v_b1 : natural;
+    variable v_b2 : natural;
+    variable v_b3 : natural;
+    variable v_length : natural;
+    variable v_offset : natural;
+  begin
+    ok := false;
+    dec_len := 0;
+
+    -- Check the header.
+    if enc_len < C_HEADER_SIZE or
+       enc(0) /= character'pos('L') or
+       enc(1) /= character'pos('Z') or
+       enc(2) /= character'pos('G') then
+      return;
+    end if;
+    v_dec_size := get_u16(enc, 3) * 65536 + get_u16(enc, 5);
+    v_enc_size := get_u16(enc, 7) * 65536 + get_u16(enc, 9);
+    if enc_len < v_enc_size + C_HEADER_SIZE or v_dec_size > dec'length then
+      return;
+    end if;
+    calc_checksum(enc, v_enc_size + C_HEADER_SIZE, v_a, v_b);
+    if get_u16(enc, 11) /= v_b or get_u16(enc, 13) /= v_a then
+      return;
+    end if;
+
+    v_src := C_HEADER_SIZE;
+    v_src_end := C_HEADER_SIZE + v_enc_size;
+    v_dst := 0;
+
+    if enc(15) = 0 then
+      -- Method COPY.
+      if v_enc_size /= v_dec_size then
+        return;
+      end if;
+      for k in 0 to v_dec_size-1 loop
+        dec(k) := enc(v_src + k);
+      end loop;
+      v_dst := v_dec_size;
+    elsif enc(15) = 1 then
+      -- Method LZG1.
+      if v_enc_size < 4 then
+        return;
+      end if;
+      v_m1 := enc(v_src);
+      v_m2 := enc(v_src + 1);
+      v_m3 := enc(v_src + 2);
+      v_m4 := enc(v_src + 3);
+      v_src := v_src + 4;
+
+      while v_src < v_src_end loop
+        v_symbol := enc(v_src);
+        v_src := v_src + 1;
+
+        if v_symbol /= v_m1 and v_symbol /= v_m2 and v_symbol /= v_m3 and v_symbol /= v_m4 then
+          -- Literal.
+          if v_dst >= v_dec_size then
+            return;
+          end if;
+          dec(v_dst) := v_symbol;
+          v_dst := v_dst + 1;
+        else
+          if v_src >= v_src_end then
+            return;
+          end if;
+          v_b1 := enc(v_src);
+          v_src := v_src + 1;
+
+          if v_b1 = 0 then
+            -- Single occurrence of a marker symbol.
+            if v_dst >= v_dec_size then
+              return;
+            end if;
+            dec(v_dst) := v_symbol;
+            v_dst := v_dst + 1;
+          else
+            if v_symbol = v_m1 then
+              -- Distant copy.
+              if v_src + 2 > v_src_end then
+                return;
+              end if;
+              v_b2 := enc(v_src);
+              v_b3 := enc(v_src + 1);
+              v_src := v_src + 2;
+              v_length := C_LENGTH_LUT(v_b1 mod 32);
+              v_offset := (v_b1 / 32) * 65536 + v_b2 * 256 + v_b3 + 2056;
+            elsif v_symbol = v_m2 then
+              -- Medium copy.
+              if v_src >= v_src_end then
+                return;
+              end if;
+              v_b2 := enc(v_src);
+              v_src := v_src + 1;
+              v_length := C_LENGTH_LUT(v_b1 mod 32);
+              v_offset := (v_b1 / 32) * 256 + v_b2 + 8;
+            elsif v_symbol = v_m3 then
+              -- Short copy.
+              v_length := (v_b1 / 64) + 3;
+              v_offset := (v_b1 mod 64) + 8;
+            else
+              -- Near copy (including RLE).
+              v_length := C_LENGTH_LUT(v_b1 mod 32);
+              v_offset := (v_b1 / 32) + 1;
+            end if;
+
+            if v_offset > v_dst or v_dst + v_length > v_dec_size then
+              return;
+            end if;
+            for k in 1 to v_length loop
+              dec(v_dst) := dec(v_dst - v_offset);
+              v_dst := v_dst + 1;
+            end loop;
+          end if;
+        end if;
+      end loop;
+    else
+      return;
+    end if;
+
+    if v_dst /= v_dec_size then
+      return;
+    end if;
+    dec_len := v_dst;
+    ok := true;
+  end procedure;
+begin
+  lzgdec_0: entity work.lzgdec
+    port map (
+      i_rst => s_rst,
+      i_clk => s_clk,
+      i_src => s_src,
+      i_dst => s_dst,
+      i_start => s_start,
+      o_stat => s_stat,
+      o_wb_cyc => s_wb_cyc,
+      o_wb_stb => s_wb_stb,
+      o_wb_adr => s_wb_adr,
+      o_wb_dat => s_wb_dat_w,
+      o_wb_we => s_wb_we,
+      o_wb_sel => s_wb_sel,
+      i_wb_dat => s_wb_dat,
+      i_wb_ack => s_wb_ack,
+      i_wb_stall => s_wb_stall,
+      i_wb_err => '0'
+    );
+
+  -- Clock generator.
+  process
+  begin
+    while not s_done loop
+      s_clk <= '0';
+      wait for C_CLK_HALF_PERIOD;
+      s_clk <= '1';
+      wait for C_CLK_HALF_PERIOD;
+    end loop;
+    wait;
+  end process;
+
+  -- Memory model (Wishbone B4 pipelined slave, every accepted request is acknowledged in the next
+  -- cycle, and requests are stalled at random when s_random_stall is true).
+  memory : process(s_clk)
+    variable v_seed1 : positive := 17;
+    variable v_seed2 : positive := 4711;
+    variable v_rnd : real;
+    variable v_adr : natural;
+    variable v_word : std_logic_vector(31 downto 0);
+  begin
+    if rising_edge(s_clk) then
+      s_wb_ack <= '0';
+      if s_load = '1' then
+        s_mem <= s_init_mem;
+        s_num_reads <= 0;
+        s_num_writes <= 0;
+      elsif s_wb_cyc = '1' and s_wb_stb = '1' and s_wb_stall = '0' then
+        check(unsigned(s_wb_adr) < C_MEM_WORDS, "Memory address out of range");
+        v_adr := to_integer(unsigned(s_wb_adr(C_LOG2_MEM_WORDS-1 downto 0)));
+        if s_wb_we = '1' then
+          v_word := s_mem(v_adr);
+          for k in 0 to 3 loop
+            if s_wb_sel(k) = '1' then
+              v_word(k*8+7 downto k*8) := s_wb_dat_w(k*8+7 downto k*8);
+            end if;
+          end loop;
+          s_mem(v_adr) <= v_word;
+          s_num_writes <= s_num_writes + 1;
+        else
+          s_wb_dat <= s_mem(v_adr);
+          s_num_reads <= s_num_reads + 1;
+        end if;
+        s_wb_ack <= '1';
+      end if;
+
+      if s_random_stall then
+        uniform(v_seed1, v_seed2, v_rnd);
+        if v_rnd < 0.4 then
+          s_wb_stall <= '1';
+        else
+          s_wb_stall <= '0';
+        end if;
+      else
+        s_wb_stall <= '0';
+      end if;
+    end if;
+  end process;
+
+  main : process
+    variable v_seed1 : positive := 1;
+    variable v_seed2 : positive := 2;
+    variable v_raw : T_BYTES(0 to C_MAX_SIZE-1);
+    variable v_raw_len : natural;
+    variable v_enc : T_BYTES(0 to C_MAX_SIZE-1);
+    variable v_enc_len : natural;
+    variable v_ref : T_BYTES(0 to C_MAX_SIZE-1);
+    variable v_ref_len : natural;
+    variable v_ref_ok : boolean;
+
+    -- A random number in the range [0, n).
+    procedure rand(n : positive; r : out natural) is
+      variable v_x : real;
+    begin
+      uniform(v_seed1, v_seed2, v_x);
+      r := integer(floor(v_x * real(n))) mod n;
+    end procedure;
+
+    procedure emit_enc(value : natural) is
+    begin
+      v_enc(v_enc_len) := value;
+      v_enc_len := v_enc_len + 1;
+    end procedure;
+
+    procedure emit_copy(offset : natural; length : natural) is
+    begin
+      for k in 1 to length loop
+        v_raw(v_raw_len) := v_raw(v_raw_len - offset);
+        v_raw_len := v_raw_len + 1;
+      end loop;
+    end procedure;
+
+    -- Generate an LZG1 buffer that uses all the token types.
+    procedure gen_lzg1 is
+      constant C_M1 : natural := 16#f1#;
+      constant C_M2 : natural := 16#f2#;
+      constant C_M3 : natural := 16#f3#;
+      constant C_M4 : natural := 16#f4#;
+      variable v_kind : natural;
+      variable v_count : natural;
+      variable v_value : natural;
+      variable v_idx : natural;
+      variable v_length : natural;
+      variable v_offset : natural;
+      variable v_b1 : natural;
+    begin
+      v_raw_len := 0;
+      v_enc_len := C_HEADER_SIZE;
+      emit_enc(C_M1);
+      emit_enc(C_M2);
+      emit_enc(C_M3);
+      emit_enc(C_M4);
+
+      while v_raw_len < C_DEC_SIZE - 128 loop
+        rand(10, v_kind);
+        if v_kind = 4 and v_raw_len >= 8 then
+          -- Near copy (the offset and the length index may not both be zero).
+          rand(8, v_offset);
+          rand(32, v_idx);
+          if v_offset = 0 and v_idx = 0 then
+            v_idx := 1;
+          end if;
+          v_length := C_LENGTH_LUT(v_idx);
+          emit_enc(C_M4);
+          emit_enc(v_offset * 32 + v_idx);
+          emit_copy(v_offset + 1, v_length);
+        elsif v_kind = 5 and v_raw_len >= 71 then
+          -- Short copy (the offset and the length may not both be the minimum values).
+          rand(4, v_length);
+          rand(64, v_offset);
+          if v_offset = 0 and v_length = 0 then
+            v_offset := 1;
+          end if;
+          emit_enc(C_M3);
+          emit_enc(v_length * 64 + v_offset);
+          emit_copy(v_offset + 8, v_length + 3);
+        elsif (v_kind = 6 or v_kind = 7) and v_raw_len >= 2055 then
+          -- Medium copy.
+          rand(2048, v_offset);
+          rand(31, v_idx);
+          v_idx := v_idx + 1;
+          v_length := C_LENGTH_LUT(v_idx);
+          emit_enc(C_M2);
+          emit_enc((v_offset / 256) * 32 + v_idx);
+          emit_enc(v_offset mod 256);
+          emit_copy(v_offset + 8, v_length);
+        elsif (v_kind = 8 or v_kind = 9) and v_raw_len > 2056 then
+          -- Distant copy.
+          rand(v_raw_len - 2056, v_offset);
+          rand(31, v_idx);
+          v_idx := v_idx + 1;
+          v_length := C_LENGTH_LUT(v_idx);
+          emit_enc(C_M1);
+          emit_enc((v_offset / 65536) * 32 + v_idx);
+          emit_enc((v_offset / 256) mod 256);
+          emit_enc(v_offset mod 256);
+          emit_copy(v_offset + 2056, v_length);
+        else
+          -- Literals (escape marker symbols).
+          rand(8, v_count);
+          for k in 0 to v_count loop
+            rand(256, v_value);
+            emit_enc(v_value);
+            if v_value = C_M1 or v_value = C_M2 or v_value = C_M3 or v_value = C_M4 then
+              emit_enc(0);
+            end if;
+            v_raw(v_raw_len) := v_value;
+            v_raw_len := v_raw_len + 1;
+          end loop;
+        end if;
+      end loop;
+
+      put_header(v_enc, v_enc_len, v_raw_len, 1);
+    end procedure;
+
+    -- Generate a COPY method buffer.
+    procedure gen_copy(size : natural) is
+      variable v_value : natural;
+    begin
+      v_raw_len := 0;
+      v_enc_len := C_HEADER_SIZE;
+      for k in 0 to size-1 loop
+        rand(256, v_value);
+        emit_enc(v_value);
+        v_raw(v_raw_len) := v_value;
+        v_raw_len := v_raw_len + 1;
+      end loop;
+      put_header(v_enc, v_enc_len, v_raw_len, 0);
+    end procedure;
+
+    -- Load the fixed LZG buffer.
+    procedure load_fixture is
+    begin
+      for k in C_FIXTURE'range loop
+        v_enc(k) := C_FIXTURE(k);
+      end loop;
+      v_enc_len := C_FIXTURE'length;
+    end procedure;
+
+    -- Run the engine on the current encoded buffer.
+    procedure run_engine(src : natural; dst : natural; cycles : out natural) is
+      variable v_mem : T_MEM;
+      variable v_adr : natural;
+      variable v_word : std_logic_vector(31 downto 0);
+      variable v_lane : natural;
+      variable v_cycles : natural;
+    begin
+      -- Load the memory.
+      v_mem := (others => std_logic_vector(to_unsigned(C_FILL_BYTE, 8)) &
+                          std_logic_vector(to_unsigned(C_FILL_BYTE, 8)) &
+                          std_logic_vector(to_unsigned(C_FILL_BYTE, 8)) &
+                          std_logic_vector(to_unsigned(C_FILL_BYTE, 8)));
+      for k in 0 to v_enc_len-1 loop
+        v_adr := src + k;
+        v_lane := v_adr mod 4;
+        v_word := v_mem(v_adr / 4);
+        v_word(v_lane*8+7 downto v_lane*8) := std_logic_vector(to_unsigned(v_enc(k), 8));
+        v_mem(v_adr / 4) := v_word;
+      end loop;
+      s_init_mem <= v_mem;
+      s_load <= '1';
+      wait until rising_edge(s_clk);
+      s_load <= '0';
+
+      -- Start the engine, and wait for it to finish.
+      s_src <= std_logic_vector(to_unsigned(src, 32));
+      s_dst <= std_logic_vector(to_unsigned(dst, 32));
+      s_start <= '1';
+      wait until rising_edge(s_clk);
+      s_start <= '0';
+      v_cycles := 1;
+      loop
+        wait until rising_edge(s_clk);
+        v_cycles := v_cycles + 1;
+        exit when s_stat(1) = '1' or v_cycles = C_TIMEOUT_CYCLES;
+      end loop;
+      check(s_stat(1) = '1', "Timeout");
+      check(s_stat(0) = '0', "BUSY after DONE");
+      check(s_stat(31) = '1', "Present bit");
+      cycles := v_cycles;
+    end procedure;
+
+    -- Decompress the current encoded buffer using the engine, and check the result against the
+    -- reference decoder.
+    procedure check_decode(src : natural; dst : natural; name : string) is
+      variable v_cycles : natural;
+    begin
+      lzg_decode_ref(v_enc, v_enc_len, v_ref, v_ref_len, v_ref_ok);
+      check(v_ref_ok, "Reference decoder");
+      check_equal(v_ref_len, v_raw_len, "Reference decoded size");
+      for k in 0 to v_raw_len-1 loop
+        check_equal(v_ref(k), v_raw(k), "Reference byte " & integer'image(k));
+      end loop;
+
+      run_engine(src, dst, v_cycles);
+      check(s_stat(2) = '0', "ERROR");
+      for k in 0 to v_ref_len-1 loop
+        check_equal(get_mem_byte(s_mem, dst + k), v_ref(k), "Output byte " & integer'image(k));
+      end loop;
+      check_equal(get_mem_byte(s_mem, dst - 1), C_FILL_BYTE, "Byte before the output");
+      check_equal(get_mem_byte(s_mem, dst + v_ref_len), C_FILL_BYTE, "Byte after the output");
+
+      info(name & ": " & integer'image(v_ref_len) & " bytes (" & integer'image(v_enc_len) &
+           " encoded) in " & integer'image(v_cycles) & " cycles (" &
+           real'image(real(v_ref_len) / real(v_cycles)) & " bytes/cycle, " &
+           integer'image(s_num_reads) & " reads, " & integer'image(s_num_writes) & " writes)");
+    end procedure;
+
+    -- Run the engine on a malformed buffer, and check that it is rejected (both by the engine and
+    -- by the reference decoder). Only the first num_valid output bytes may have been written.
+    procedure check_error(num_valid : natural; name : string) is
+      variable v_cycles : natural;
+    begin
+      lzg_decode_ref(v_enc, v_enc_len, v_ref, v_ref_len, v_ref_ok);
+      check(not v_ref_ok, name & ": Reference decoder");
+      run_engine(C_SRC_ADR, C_DST_ADR, v_cycles);
+      check(s_stat(2) = '1', name & ": ERROR");
+      check_equal(get_mem_byte(s_mem, C_DST_ADR - 1),
+                  C_FILL_BYTE,
+                  name & ": Byte before the output");
+      check_equal(get_mem_byte(s_mem, C_DST_ADR + num_valid),
+                  C_FILL_BYTE,
+                  name & ": Byte after the valid output");
+    end procedure;
+
+    variable v_cycles : natural;
+  begin
+    test_runner_setup(runner, runner_cfg);
+
+    s_start <= '0';
+    s_src <= (others => '0');
+    s_dst <= (others => '0');
+    s_rst <= '1';
+    wait for 4 * C_CLK_HALF_PERIOD;
+    wait until rising_edge(s_clk);
+    s_rst <= '0';
+    wait until rising_edge(s_clk);
+
+    while test_suite loop
+      if run("lzg1_tokens") then
+        gen_lzg1;
+        check_decode(C_SRC_ADR, C_DST_ADR, "LZG1");
+      elsif run("lzg1_random_stall") then
+        s_random_stall <= true;
+        gen_lzg1;
+        check_decode(C_SRC_ADR, C_DST_ADR, "LZG1 (random stall)");
+      elsif run("unaligned") then
+        gen_lzg1;
+        check_decode(C_SRC_ADR + 3, C_DST_ADR + 1, "LZG1 (unaligned)");
+      elsif run("copy_method") then
+        gen_copy(1001);
+        check_decode(C_SRC_ADR + 2, C_DST_ADR + 3, "COPY");
+      elsif run("fixture") then
+        load_fixture;
+        lzg_decode_ref(v_enc, v_enc_len, v_ref, v_ref_len, v_ref_ok);
+        check(v_ref_ok, "Reference decoder");
+        check_equal(v_ref_len, C_FIXTURE_TEXT'length, "Reference decoded size");
+        run_engine(C_SRC_ADR + 1, C_DST_ADR + 2, v_cycles);
+        check(s_stat(2) = '0', "ERROR");
+        for k in 0 to C_FIXTURE_TEXT'length-1 loop
+          check_equal(get_mem_byte(s_mem, C_DST_ADR + 2 + k),
+                      character'pos(C_FIXTURE_TEXT(k + 1)),
+                      "Output byte " & integer'image(k));
+          check_equal(v_ref(k), character'pos(C_FIXTURE_TEXT(k + 1)),
+                      "Reference byte " & integer'image(k));
+        end loop;
+        check_equal(get_mem_byte(s_mem, C_DST_ADR + 2 + C_FIXTURE_TEXT'length),
+                    C_FILL_BYTE,
+                    "Byte after the output");
+      elsif run("bad_magic") then
+        load_fixture;
+        v_enc(0) := character'pos('X');
+        check_error(0, "Bad magic");
+      elsif run("truncated") then
+        -- The stream ends right after a marker symbol (the header is consistent with the shorter
+        -- stream, so only the incomplete token is wrong).
+        load_fixture;
+        v_enc_len := C_FIXTURE_NEAR_POS + 1;
+        put_header(v_enc, v_enc_len, C_FIXTURE_TEXT'length, 1);
+        check_error(C_FIXTURE_NEAR_OUT, "Truncated");
+      elsif run("copy_before_start") then
+        -- One literal followed by a near copy with offset 2.
+        v_enc_len := C_HEADER_SIZE;
+        emit_enc(16#f1#);
+        emit_enc(16#f2#);
+        emit_enc(16#f3#);
+        emit_enc(16#f4#);
+        emit_enc(character'pos('A'));
+        emit_enc(16#f4#);
+        emit_enc(1 * 32 + 0);
+        put_header(v_enc, v_enc_len, 3, 1);
+        check_error(1, "Copy before start");
+        check_equal(get_mem_byte(s_mem, C_DST_ADR), character'pos('A'), "Decoded literal");
+      elsif run("bad_checksum") then
+        gen_lzg1;
+        v_enc(14) := (v_enc(14) + 1) mod 256;
+        lzg_decode_ref(v_enc, v_enc_len, v_ref, v_ref_len, v_ref_ok);
+        check(not v_ref_ok, "Reference decoder");
+        run_engine(C_SRC_ADR, C_DST_ADR, v_cycles);
+        check(s_stat(2) = '1', "ERROR");
+      end if;
+    end loop;
+
+    s_done <= true;
+    test_runner_cleanup(runner);
+  end process;
+end architecture;
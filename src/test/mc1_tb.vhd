@@ -30,6 +30,7 @@ use std.textio.all;
 library mrisc32;
 use mrisc32.debug.all;
 
+use work.mmio_types.all;
 use work.vid_types.all;
 
 entity mc1_tb is
@@ -46,6 +47,9 @@ architecture tb of mc1_tb is
   -- (1920 + hblank) x (1080 + vblank) = 2475000 cycles per frame
   constant C_TEST_CYCLES : integer := 2475000 * C_TEST_FRAMES;
 
+  -- Max number of extra cycles to simulate while waiting for the ROM memory benchmark to finish.
+  constant C_MEMBENCH_MAX_CYCLES : integer := 2475000 * 4;
+
   -- 1920x1080: 148.500 MHz
   constant C_CPU_CLK_HZ : positive := 148_500_000;
   constant C_CLK_HALF_PERIOD : time := 1000 ms / (2 * C_CPU_CLK_HZ);
@@ -57,6 +61,7 @@ architecture tb of mc1_tb is
   signal s_b : std_logic_vector(3 downto 0);
   signal s_hsync : std_logic;
   signal s_vsync : std_logic;
+  signal s_io_regs_w : T_MMIO_REGS_WO;
 
   signal s_xram_cyc : std_logic;
   signal s_xram_stb : std_logic;
@@ -82,6 +87,15 @@ architecture tb of mc1_tb is
 
   -- Debug trace interface.
   signal s_debug_trace : T_DEBUG_TRACE;
+
+  -- Memory benchmark state.
+  signal s_membench_running : std_logic := '0';
+
+  signal s_io_sdin : std_logic_vector(31 downto 0);
+  signal s_sd_miso : std_logic;
+  signal s_sd_num_reads : natural;
+  signal s_sd_num_writes : natural;
+  signal s_sd_tested : std_logic := '0';
 begin
   -- Instantiate the MC1 machine.
   mc1_1: entity work.mc1
@@ -92,6 +106,7 @@ begin
       COLOR_BITS_B => s_b'length,
       LOG2_VRAM_SIZE => 17,          -- 2^17 = 128 KiB
       XRAM_SIZE => 2**(10+13+2+1),
+      LZG_ENGINE => true,
       VIDEO_CONFIG => C_1920_1080
     )
     port map (
@@ -116,7 +131,8 @@ begin
       i_io_kb_stb => '0',
       i_io_mousepos => (others => '0'),
       i_io_mousebtns => (others => '0'),
-      i_io_sdin => (others => '0'),
+      i_io_sdin => s_io_sdin,
+      o_io_regs_w => s_io_regs_w,
 
       -- XRAM interface.
       o_xram_cyc => s_xram_cyc,
@@ -197,6 +213,144 @@ begin
   -- The SDRAM clock is 180 degrees phase delayed (for simplicity).
   s_sdram_clk <= not s_clk;
 
+  -- SD card - Simulate an SD card in SPI mode (the pins are driven by the SD SPI engine, or by
+  -- software via SDOUT).
+  sdcard_model_1: entity work.sdcard_model
+    port map (
+      i_sck => s_io_regs_w.SDOUT(5),
+      i_mosi => s_io_regs_w.SDOUT(4),
+      i_cs_n => s_io_regs_w.SDOUT(3),
+      o_miso => s_sd_miso,
+      i_corrupt_crc => '0',
+      o_num_reads => s_sd_num_reads,
+      o_num_writes => s_sd_num_writes
+    );
+  s_io_sdin <= (0 => s_sd_miso, others => '0');
+
+  -- Collect the results from the ROM memory benchmark (see rom/membench.hpp), and write them to
+  -- CSV files. The ROM reports each value via SEGDISP6, and a tag that describes the value via
+  -- SEGDISP7.
+  membench : process(s_clk)
+    file f_csv_file : text open WRITE_MODE is "vunit_out/mc1_tb_membench.csv";
+    file f_func_csv_file : text open WRITE_MODE is "vunit_out/mc1_tb_memfuncs.csv";
+
+    function memory_name(x : std_logic_vector(3 downto 0)) return string is
+    begin
+      case x is
+        when x"0" => return "ROM";
+        when x"1" => return "VRAM";
+        when x"2" => return "XRAM";
+        when others => return "?";
+      end case;
+    end function;
+
+    function test_name(x : std_logic_vector(3 downto 0)) return string is
+    begin
+      case x is
+        when x"0" => return "read";
+        when x"1" => return "write";
+        when x"2" => return "copy";
+        when x"3" => return "random_read";
+        when x"4" => return "random_write";
+        when x"5" => return "latency";
+        when others => return "?";
+      end case;
+    end function;
+
+    -- Convert an unsigned 32-bit value to a decimal string (integer'image can not be used, since
+    -- the value may be 2^31 or larger).
+    function to_dec(x : unsigned(31 downto 0)) return string is
+      variable v_x : unsigned(31 downto 0) := x;
+      variable v_str : string(1 to 10);
+      variable v_pos : natural := v_str'high + 1;
+    begin
+      loop
+        v_pos := v_pos - 1;
+        v_str(v_pos) := character'val(character'pos('0') + to_integer(v_x mod 10));
+        v_x := v_x / 10;
+        exit when v_x = 0;
+      end loop;
+      return v_str(v_pos to v_str'high);
+    end function;
+
+    function func_name(x : std_logic_vector(3 downto 0)) return string is
+    begin
+      case x is
+        when x"0" => return "memset_libc";
+        when x"1" => return "memset_rom";
+        when x"2" => return "fill32_rom";
+        when x"3" => return "memcpy_libc";
+        when x"4" => return "memcpy_rom";
+        when x"5" => return "memcpy_unaligned_libc";
+        when x"6" => return "memcpy_unaligned_rom";
+        when x"7" => return "memcmp_libc";
+        when x"8" => return "memcmp_rom";
+        when x"9" => return "crc32_rom";
+        when others => return "?";
+      end case;
+    end function;
+
+    variable v_line : line;
+    variable v_tag : std_logic_vector(31 downto 0);
+    variable v_prev_tag : std_logic_vector(31 downto 0) := (others => '0');
+    variable v_value : unsigned(31 downto 0);
+    variable v_size : unsigned(31 downto 0) := (others => '0');
+    variable v_has_header : boolean := false;
+    variable v_has_func_header : boolean := false;
+  begin
+    if rising_edge(s_clk) then
+      v_tag := s_io_regs_w.SEGDISP7;
+      v_value := unsigned(s_io_regs_w.SEGDISP6);
+      if v_tag /= v_prev_tag and v_tag(31 downto 16) = x"4d42" then
+        case v_tag(15 downto 12) is
+          when x"1" =>
+            -- Size (number of bytes, or number of loads for the latency test).
+            v_size := v_value;
+            s_membench_running <= '1';
+          when x"2" =>
+            -- Cycles (this completes the record).
+            if not v_has_header then
+              write(v_line, string'("video,memory,test,size,cycles"));
+              writeline(f_csv_file, v_line);
+              v_has_header := true;
+            end if;
+            if v_tag(8) = '1' then
+              write(v_line, string'("on,"));
+            else
+              write(v_line, string'("off,"));
+            end if;
+            write(v_line, memory_name(v_tag(7 downto 4)) & "," & test_name(v_tag(3 downto 0)) &
+                          "," & to_dec(v_size) & "," & to_dec(v_value));
+            writeline(f_csv_file, v_line);
+          when x"3" =>
+            -- End of the benchmark.
+            s_membench_running <= '0';
+          when x"4" =>
+            -- Memory function cycles (this completes the record).
+            if not v_has_func_header then
+              write(v_line, string'("function,size,cycles"));
+              writeline(f_func_csv_file, v_line);
+              v_has_func_header := true;
+            end if;
+            write(v_line, func_name(v_tag(3 downto 0)) & "," & to_dec(v_size) & "," &
+                          to_dec(v_value));
+            writeline(f_func_csv_file, v_line);
+          when x"5" =>
+            -- Result of the memory function self test.
+            check(v_value = 0,
+                  "Memory function self test: " & to_dec(v_value) & " failed checks");
+          when x"6" =>
+            -- Result of the SD engine test (block read, write and read back).
+            check(v_value = 0, "SD engine test: " & to_dec(v_value) & " failed checks");
+            s_sd_tested <= '1';
+          when others =>
+            null;
+        end case;
+      end if;
+      v_prev_tag := v_tag;
+    end if;
+  end process;
+
   main : process
     -- File I/O.
     type T_CHAR_FILE is file of character;
@@ -300,6 +454,24 @@ begin
     end loop;
     file_close(f_char_file);
 
+    -- If the ROM memory benchmark is running, continue until it has finished.
+    for i in 0 to C_MEMBENCH_MAX_CYCLES-1 loop
+      exit when s_membench_running = '0';
+      s_clk <= '1';
+      wait for C_CLK_HALF_PERIOD;
+      s_clk <= '0';
+      wait for C_CLK_HALF_PERIOD;
+    end loop;
+    check(s_membench_running = '0', "The memory benchmark did not finish");
+
+    -- The SD engine test should be visible at the card too.
+    info("SD card: " & integer'image(s_sd_num_reads) & " block reads, " &
+         integer'image(s_sd_num_writes) & " block writes");
+    if s_sd_tested = '1' then
+      check(s_sd_num_reads >= 2 and s_sd_num_writes >= 1,
+            "The SD engine test did not reach the SD card");
+    end if;
+
     -- Close the debug trace file.
     if C_DEBUG_ENABLE_TRACE then
       file_close(f_trace_file);
@@ -0,0 +1,265 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- This is a simple simulation model of an SD card in SPI mode (after initialization).
+--
+-- Only the commands that are needed for block transfers are implemented:
+--   * CMD17 (READ_SINGLE_BLOCK)
+--   * CMD24 (WRITE_BLOCK)
+-- All other commands get an R1 response of 0x00. The block address is a block number (i.e. the
+-- card behaves like an SDHC card). The card holds NUM_BLOCKS blocks (block numbers wrap around), and
+-- blocks that have not been written contain a known pattern (see sdcard_pattern_byte).
+----------------------------------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+package sdcard_model_pkg is
+  -- The initial contents of byte idx of block block_no.
+  function sdcard_pattern_byte(block_no : natural; idx : natural) return std_logic_vector;
+end package;
+
+package body sdcard_model_pkg is
+  function sdcard_pattern_byte(block_no : natural; idx : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned((block_no * 31 + idx * 7 + idx / 256) mod 256, 8));
+  end function;
+end package body;
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.sdcard_model_pkg.all;
+
+entity sdcard_model is
+  generic (
+    NUM_BLOCKS : positive := 16;
+    ACCESS_BYTES : natural := 4;  -- Number of 0xff bytes before the start token of a block read.
+    BUSY_BYTES : natural := 8     -- Number of busy bytes after a block write.
+  );
+  port (
+    i_sck : in std_logic;
+    i_mosi : in std_logic;
+    i_cs_n : in std_logic;
+    o_miso : out std_logic;
+
+    -- Send a bad CRC for block reads.
+    i_corrupt_crc : in std_logic;
+
+    -- Number of blocks that have been read, and written (i.e. accepted).
+    o_num_reads : out natural;
+    o_num_writes : out natural
+  );
+end sdcard_model;
+
+architecture behavioral of sdcard_model is
+  constant C_BLOCK_SIZE : positive := 512;
+
+  type T_BYTE_ARRAY is array (natural range <>) of std_logic_vector(7 downto 0);
+  subtype T_BLOCK is T_BYTE_ARRAY(0 to C_BLOCK_SIZE-1);
+  type T_BLOCKS is array (0 to NUM_BLOCKS-1) of T_BLOCK;
+
+  type T_STATE is (CMD, CMD_ARGS, WR_TOKEN, WR_DATA, WR_CRC);
+
+  function crc16_update(crc : std_logic_vector(15 downto 0);
+                        data : std_logic_vector(7 downto 0)) return std_logic_vector is
+    variable v_crc : std_logic_vector(15 downto 0);
+    variable v_feedback : std_logic;
+  begin
+    v_crc := crc;
+    for k in 7 downto 0 loop
+      v_feedback := v_crc(15) xor data(k);
+      v_crc := v_crc(14 downto 0) & '0';
+      if v_feedback = '1' then
+        v_crc := v_crc xor x"1021";
+      end if;
+    end loop;
+    return v_crc;
+  end function;
+
+  function init_blocks return T_BLOCKS is
+    variable v_blocks : T_BLOCKS;
+  begin
+    for b in 0 to NUM_BLOCKS-1 loop
+      for k in 0 to C_BLOCK_SIZE-1 loop
+        v_blocks(b)(k) := sdcard_pattern_byte(b, k);
+      end loop;
+    end loop;
+    return v_blocks;
+  end function;
+begin
+  process
+    variable v_blocks : T_BLOCKS := init_blocks;
+
+    -- Output byte queue (bytes that the card will send).
+    variable v_queue : T_BYTE_ARRAY(0 to 1023);
+    variable v_queue_head : natural := 0;
+    variable v_queue_count : natural := 0;
+
+    variable v_state : T_STATE := CMD;
+    variable v_rx : std_logic_vector(7 downto 0) := x"ff";
+    variable v_tx : std_logic_vector(7 downto 0) := x"ff";
+    variable v_bit_cnt : natural := 0;
+    variable v_cmd : T_BYTE_ARRAY(0 to 5);
+    variable v_cmd_cnt : natural;
+    variable v_block_no : natural;
+    variable v_byte_cnt : natural;
+    variable v_crc : std_logic_vector(15 downto 0);
+    variable v_crc_rx : std_logic_vector(15 downto 0);
+    variable v_num_reads : natural := 0;
+    variable v_num_writes : natural := 0;
+
+    procedure queue_byte(data : std_logic_vector(7 downto 0)) is
+    begin
+      assert v_queue_count < v_queue'length report "SD card queue overflow" severity failure;
+      v_queue((v_queue_head + v_queue_count) mod v_queue'length) := data;
+      v_queue_count := v_queue_count + 1;
+    end procedure;
+
+    procedure dequeue_byte(data : out std_logic_vector(7 downto 0)) is
+    begin
+      if v_queue_count = 0 then
+        data := x"ff";
+      else
+        data := v_queue(v_queue_head);
+        v_queue_head := (v_queue_head + 1) mod v_queue'length;
+        v_queue_count := v_queue_count - 1;
+      end if;
+    end procedure;
+
+    procedure handle_command is
+      variable v_block : T_BLOCK;
+    begin
+      v_block_no := to_integer(unsigned(v_cmd(1) & v_cmd(2) & v_cmd(3) & v_cmd(4))) mod NUM_BLOCKS;
+
+      -- NCR (one byte) + R1.
+      queue_byte(x"ff");
+      queue_byte(x"00");
+
+      case to_integer(unsigned(v_cmd(0)(5 downto 0))) is
+        when 17 =>
+          -- READ_SINGLE_BLOCK: Access time + start token + data + CRC16.
+          for k in 1 to ACCESS_BYTES loop
+            queue_byte(x"ff");
+          end loop;
+          queue_byte(x"fe");
+          v_block := v_blocks(v_block_no);
+          v_crc := (others => '0');
+          for k in 0 to C_BLOCK_SIZE-1 loop
+            queue_byte(v_block(k));
+            v_crc := crc16_update(v_crc, v_block(k));
+          end loop;
+          if i_corrupt_crc = '1' then
+            v_crc(0) := not v_crc(0);
+          end if;
+          queue_byte(v_crc(15 downto 8));
+          queue_byte(v_crc(7 downto 0));
+          v_num_reads := v_num_reads + 1;
+          o_num_reads <= v_num_reads;
+        when 24 =>
+          -- WRITE_BLOCK: Wait for the start token.
+          v_state := WR_TOKEN;
+        when others =>
+          null;
+      end case;
+    end procedure;
+
+    procedure handle_byte(data : std_logic_vector(7 downto 0)) is
+    begin
+      case v_state is
+        when CMD =>
+          if data(7 downto 6) = "01" then
+            v_cmd(0) := data;
+            v_cmd_cnt := 1;
+            v_state := CMD_ARGS;
+          end if;
+
+        when CMD_ARGS =>
+          v_cmd(v_cmd_cnt) := data;
+          v_cmd_cnt := v_cmd_cnt + 1;
+          if v_cmd_cnt = 6 then
+            v_state := CMD;
+            handle_command;
+          end if;
+
+        when WR_TOKEN =>
+          if data = x"fe" then
+            v_byte_cnt := 0;
+            v_crc := (others => '0');
+            v_state := WR_DATA;
+          end if;
+
+        when WR_DATA =>
+          v_blocks(v_block_no)(v_byte_cnt) := data;
+          v_crc := crc16_update(v_crc, data);
+          v_byte_cnt := v_byte_cnt + 1;
+          if v_byte_cnt = C_BLOCK_SIZE then
+            v_byte_cnt := 0;
+            v_state := WR_CRC;
+          end if;
+
+        when WR_CRC =>
+          v_crc_rx := v_crc_rx(7 downto 0) & data;
+          v_byte_cnt := v_byte_cnt + 1;
+          if v_byte_cnt = 2 then
+            -- Data response token ("data accepted" or "CRC error") + busy.
+            if v_crc_rx = v_crc then
+              queue_byte(x"e5");
+              v_num_writes := v_num_writes + 1;
+              o_num_writes <= v_num_writes;
+            else
+              queue_byte(x"eb");
+            end if;
+            for k in 1 to BUSY_BYTES loop
+              queue_byte(x"00");
+            end loop;
+            v_state := CMD;
+          end if;
+      end case;
+    end procedure;
+  begin
+    o_miso <= '1';
+    o_num_reads <= 0;
+    o_num_writes <= 0;
+
+    loop
+      wait on i_sck, i_cs_n;
+      if i_cs_n = '1' then
+        v_bit_cnt := 0;
+        o_miso <= '1';
+      elsif rising_edge(i_sck) then
+        -- The card samples MOSI on the rising edge.
+        v_rx := v_rx(6 downto 0) & i_mosi;
+        v_bit_cnt := v_bit_cnt + 1;
+        if v_bit_cnt = 8 then
+          v_bit_cnt := 0;
+          handle_byte(v_rx);
+        end if;
+      elsif falling_edge(i_sck) then
+        -- The card updates MISO on the falling edge.
+        if v_bit_cnt = 0 then
+          dequeue_byte(v_tx);
+        end if;
+        o_miso <= v_tx(7 - v_bit_cnt);
+      end if;
+    end loop;
+  end process;
+end behavioral;
@@ -34,15 +34,15 @@ entity sdram_model is
     i_rst : in std_logic;
     i_clk : in std_logic;
 
-    i_a : out std_logic_vector(ADDR_WIDTH-1 downto 0);
-    i_ba : out std_logic_vector(BANK_WIDTH-1 downto 0);
+    i_a : in std_logic_vector(ADDR_WIDTH-1 downto 0);
+    i_ba : in std_logic_vector(BANK_WIDTH-1 downto 0);
     io_dq : inout std_logic_vector(DATA_WIDTH-1 downto 0);
-    i_cke : out std_logic;
-    i_cs_n : out std_logic;
-    i_ras_n : out std_logic;
-    i_cas_n : out std_logic;
-    i_we_n : out std_logic;
-    i_dqm : out std_logic_vector(DATA_WIDTH/8-1 downto 0)
+    i_cke : in std_logic;
+    i_cs_n : in std_logic;
+    i_ras_n : in std_logic;
+    i_cas_n : in std_logic;
+    i_we_n : in std_logic;
+    i_dqm : in std_logic_vector(DATA_WIDTH/8-1 downto 0)
   );
 end sdram_model;
 
@@ -128,10 +128,14 @@ architecture behavioral of sdram_model is
 
   signal s_mode_reg : T_MODE_REG;
   signal s_row_of_bank : T_INT_ARRAY(0 to C_NUM_BANKS-1);
+  signal s_bank_is_active : std_logic_vector(0 to C_NUM_BANKS-1);
   signal s_burst_idx : integer;
 begin
   -- Simple simulation of the behaviour of an SDRAM (just respond with some
   -- data for read requests).
+  --
+  -- The model keeps track of which banks are active (i.e. have an open row), and reports an error
+  -- if a command is issued that is not allowed for the current bank state.
   process(i_rst, i_clk)
     variable v_cmd : T_CMD;
     variable v_bank_no : integer;
@@ -151,6 +155,7 @@ begin
           burst_length => 2
         );
       s_row_of_bank <= (others => 0);
+      s_bank_is_active <= (others => '0');
 
       -- Reset burst queue.
       for i in 0 to C_BURST_QUEUE_LEN-1 loop
@@ -169,12 +174,32 @@ begin
 
       if v_cmd = C_CMD_MRS then
         -- Set the mode register (configure burst mode etc).
+        assert s_bank_is_active = (s_bank_is_active'range => '0')
+          report "MODE REGISTER SET while a bank is active" severity error;
         s_mode_reg <= decode_mode_reg(unsigned(i_a));
+      elsif v_cmd = C_CMD_REF then
+        -- Auto refresh (requires all banks to be idle).
+        assert s_bank_is_active = (s_bank_is_active'range => '0')
+          report "AUTO REFRESH while a bank is active" severity error;
+      elsif v_cmd = C_CMD_PRE then
+        -- Precharge (close the row of) the given bank, or all banks if A10 is set.
+        if i_a(10) = '1' then
+          s_bank_is_active <= (others => '0');
+        else
+          s_bank_is_active(v_bank_no) <= '0';
+        end if;
       elsif v_cmd = C_CMD_ACT then
         -- Activate the row of the given bank.
+        assert s_bank_is_active(v_bank_no) = '0'
+          report "ACTIVE to bank " & integer'image(v_bank_no) & ", which is already active"
+          severity error;
+        s_bank_is_active(v_bank_no) <= '1';
         s_row_of_bank(v_bank_no) <= to_integer(unsigned(i_a(ROW_WIDTH-1 downto 0)));
       elsif v_cmd = C_CMD_RD then
         -- Read burst from the given bank.
+        assert s_bank_is_active(v_bank_no) = '1'
+          report "READ from bank " & integer'image(v_bank_no) & ", which is not active"
+          severity error;
         v_row_no := s_row_of_bank(v_bank_no);
         v_col_no := decode_col(i_a);
         v_idx := (s_burst_idx + s_mode_reg.cas_latency) mod C_BURST_QUEUE_LEN;
@@ -186,8 +211,16 @@ begin
           v_col_no := v_col_no + 1;
           v_idx := (v_idx + 1) mod C_BURST_QUEUE_LEN;
         end loop;
+
+        -- Auto precharge?
+        if i_a(10) = '1' then
+          s_bank_is_active(v_bank_no) <= '0';
+        end if;
       elsif v_cmd = C_CMD_WR then
         -- Write burst to the given bank.
+        assert s_bank_is_active(v_bank_no) = '1'
+          report "WRITE to bank " & integer'image(v_bank_no) & ", which is not active"
+          severity error;
         v_row_no := s_row_of_bank(v_bank_no);
         v_col_no := decode_col(i_a);
         v_idx := s_burst_idx;
@@ -199,6 +232,11 @@ begin
           v_col_no := v_col_no + 1;
           v_idx := (v_idx + 1) mod C_BURST_QUEUE_LEN;
         end loop;
+
+        -- Auto precharge?
+        if i_a(10) = '1' then
+          s_bank_is_active(v_bank_no) <= '0';
+        end if;
       end if;
 
       -- Execute read/write commands from the burst queue.
@@ -0,0 +1,340 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- This is a bandwidth and latency benchmark for the SDRAM controller, using the SDRAM simulation
+-- model. Each test writes and reads back a number of words using a specific access pattern, checks
+-- the data, and reports the number of clock cycles per word and the resulting bandwidth.
+----------------------------------------------------------------------------------------------------
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity sdram_tb is
+  generic (runner_cfg : string);
+end entity;
+
+architecture tb of sdram_tb is
+  -- 100 MHz.
+  constant C_CLK_FREQ : real := 100.0;
+  constant C_CLK_HALF_PERIOD : time := 5 ns;
+
+  -- A small SDRAM (4 banks x 256 rows x 512 columns x 16 bits) keeps the simulation model small.
+  constant C_SDRAM_ADDR_WIDTH : natural := 13;
+  constant C_SDRAM_DATA_WIDTH : natural := 16;
+  constant C_SDRAM_COL_WIDTH : natural := 9;
+  constant C_SDRAM_ROW_WIDTH : natural := 8;
+  constant C_SDRAM_BANK_WIDTH : natural := 2;
+  constant C_ADDR_WIDTH : natural := C_SDRAM_COL_WIDTH+C_SDRAM_ROW_WIDTH+C_SDRAM_BANK_WIDTH-1;
+
+  -- The number of 32-bit words per SDRAM row, and per row of all banks.
+  constant C_WORDS_PER_ROW : natural := 2**(C_SDRAM_COL_WIDTH-1);
+  constant C_WORDS_PER_BANK_ROW : natural := C_WORDS_PER_ROW * 2**C_SDRAM_BANK_WIDTH;
+
+  constant C_NUM_WORDS : natural := 2048;
+
+  type T_PATTERN is (SEQUENTIAL, BANK_INTERLEAVED, ROW_CONFLICTS, RANDOM);
+
+  signal s_rst : std_logic;
+  signal s_clk : std_logic;
+  signal s_sdram_clk : std_logic;
+  signal s_done : boolean := false;
+
+  signal s_addr : unsigned(C_ADDR_WIDTH-1 downto 0);
+  signal s_data : std_logic_vector(31 downto 0);
+  signal s_we : std_logic;
+  signal s_req : std_logic;
+  signal s_ready : std_logic;
+  signal s_ack : std_logic;
+  signal s_valid : std_logic;
+  signal s_q : std_logic_vector(31 downto 0);
+
+  signal s_sdram_a : unsigned(C_SDRAM_ADDR_WIDTH-1 downto 0);
+  signal s_sdram_ba : unsigned(C_SDRAM_BANK_WIDTH-1 downto 0);
+  signal s_sdram_dq : std_logic_vector(C_SDRAM_DATA_WIDTH-1 downto 0);
+  signal s_sdram_cke : std_logic;
+  signal s_sdram_cs_n : std_logic;
+  signal s_sdram_ras_n : std_logic;
+  signal s_sdram_cas_n : std_logic;
+  signal s_sdram_we_n : std_logic;
+  signal s_sdram_dqm : std_logic_vector(C_SDRAM_DATA_WIDTH/8-1 downto 0);
+
+  -- Get the word address of access number idx for the given access pattern.
+  function pattern_addr(pattern : T_PATTERN; idx : natural) return unsigned is
+    variable v_addr : natural;
+  begin
+    case pattern is
+      when SEQUENTIAL =>
+        v_addr := idx;
+      when BANK_INTERLEAVED =>
+        -- Visit all banks in turn (same column), moving to the next column after each round.
+        v_addr := (idx / C_WORDS_PER_BANK_ROW) * C_WORDS_PER_BANK_ROW +
+                  (idx mod 4) * C_WORDS_PER_ROW + (idx / 4) mod C_WORDS_PER_ROW;
+      when ROW_CONFLICTS =>
+        -- Alternate between two rows of the same bank.
+        v_addr := (idx mod 2) * C_WORDS_PER_BANK_ROW + (idx / 2);
+      when RANDOM =>
+        -- A simple LCG (a full period permutation of the address space).
+        v_addr := (idx * 40503 + 12345) mod 2**C_ADDR_WIDTH;
+    end case;
+    return to_unsigned(v_addr mod 2**C_ADDR_WIDTH, C_ADDR_WIDTH);
+  end function;
+
+  -- The data that is written to (and expected to be read from) a given address.
+  function pattern_data(addr : unsigned) return std_logic_vector is
+  begin
+    return std_logic_vector(resize(addr, 32) xor x"a5c3f00f");
+  end function;
+begin
+  sdram_0: entity work.sdram
+    generic map (
+      CLK_FREQ => C_CLK_FREQ,
+      ADDR_WIDTH => C_ADDR_WIDTH,
+      DATA_WIDTH => 32,
+      SDRAM_ADDR_WIDTH => C_SDRAM_ADDR_WIDTH,
+      SDRAM_DATA_WIDTH => C_SDRAM_DATA_WIDTH,
+      SDRAM_COL_WIDTH => C_SDRAM_COL_WIDTH,
+      SDRAM_ROW_WIDTH => C_SDRAM_ROW_WIDTH,
+      SDRAM_BANK_WIDTH => C_SDRAM_BANK_WIDTH,
+      CAS_LATENCY => 2,
+      BURST_LENGTH => 2,
+      T_DESL => 1000.0  -- Shorter than a real device, to speed up the simulation.
+    )
+    port map (
+      reset => s_rst,
+      clk => s_clk,
+      addr => s_addr,
+      data => s_data,
+      we => s_we,
+      sel => "1111",
+      req => s_req,
+      ready => s_ready,
+      ack => s_ack,
+      valid => s_valid,
+      q => s_q,
+      sdram_a => s_sdram_a,
+      sdram_ba => s_sdram_ba,
+      sdram_dq => s_sdram_dq,
+      sdram_cke => s_sdram_cke,
+      sdram_cs_n => s_sdram_cs_n,
+      sdram_ras_n => s_sdram_ras_n,
+      sdram_cas_n => s_sdram_cas_n,
+      sdram_we_n => s_sdram_we_n,
+      sdram_dqm => s_sdram_dqm
+    );
+
+  sdram_model_0: entity work.sdram_model
+    generic map (
+      ADDR_WIDTH => C_SDRAM_ADDR_WIDTH,
+      DATA_WIDTH => C_SDRAM_DATA_WIDTH,
+      COL_WIDTH => C_SDRAM_COL_WIDTH,
+      ROW_WIDTH => C_SDRAM_ROW_WIDTH,
+      BANK_WIDTH => C_SDRAM_BANK_WIDTH
+    )
+    port map (
+      i_rst => s_rst,
+      i_clk => s_sdram_clk,
+      i_a => std_logic_vector(s_sdram_a),
+      i_ba => std_logic_vector(s_sdram_ba),
+      io_dq => s_sdram_dq,
+      i_cke => s_sdram_cke,
+      i_cs_n => s_sdram_cs_n,
+      i_ras_n => s_sdram_ras_n,
+      i_cas_n => s_sdram_cas_n,
+      i_we_n => s_sdram_we_n,
+      i_dqm => s_sdram_dqm
+    );
+
+  -- The SDRAM clock is 180 degrees phase delayed (for simplicity).
+  s_sdram_clk <= not s_clk;
+
+  -- Clock generator.
+  process
+  begin
+    while not s_done loop
+      s_clk <= '0';
+      wait for C_CLK_HALF_PERIOD;
+      s_clk <= '1';
+      wait for C_CLK_HALF_PERIOD;
+    end loop;
+    wait;
+  end process;
+
+  main : process
+    -- Perform count accesses according to the given pattern, and return the number of clock
+    -- cycles that it took. Requests are issued back to back (as fast as the controller accepts
+    -- them). For reads, the returned data is checked.
+    procedure run_accesses(pattern : T_PATTERN;
+                           is_write : boolean;
+                           count : natural;
+                           cycles : out natural) is
+      variable v_issued : natural;
+      variable v_done : natural;
+      variable v_cycles : natural;
+    begin
+      v_issued := 0;
+      v_done := 0;
+      v_cycles := 0;
+      while v_done < count loop
+        -- Present the next request.
+        if v_issued < count then
+          s_req <= '1';
+          s_addr <= pattern_addr(pattern, v_issued);
+          s_data <= pattern_data(pattern_addr(pattern, v_issued));
+          if is_write then
+            s_we <= '1';
+          else
+            s_we <= '0';
+          end if;
+        else
+          s_req <= '0';
+          s_we <= '0';
+        end if;
+
+        wait until rising_edge(s_clk);
+        v_cycles := v_cycles + 1;
+
+        -- Was the request accepted?
+        if s_req = '1' and s_ready = '1' then
+          v_issued := v_issued + 1;
+          if is_write then
+            -- Writes are complete as soon as they have been accepted.
+            v_done := v_done + 1;
+          end if;
+        end if;
+
+        -- Check read responses (they are returned in order).
+        if not is_write and s_valid = '1' then
+          check_equal(s_q, pattern_data(pattern_addr(pattern, v_done)),
+                      "Read data for word " & integer'image(v_done));
+          v_done := v_done + 1;
+        end if;
+      end loop;
+      s_req <= '0';
+      s_we <= '0';
+      cycles := v_cycles;
+    end procedure;
+
+    -- Perform a single read and return the number of clock cycles until the data is valid.
+    procedure single_read(addr : natural; cycles : out natural) is
+      variable v_cycles : natural;
+    begin
+      s_req <= '1';
+      s_we <= '0';
+      s_addr <= to_unsigned(addr, C_ADDR_WIDTH);
+      v_cycles := 0;
+      loop
+        wait until rising_edge(s_clk);
+        v_cycles := v_cycles + 1;
+        if s_req = '1' and s_ready = '1' then
+          s_req <= '0';
+        end if;
+        exit when s_valid = '1';
+      end loop;
+      check_equal(s_q, pattern_data(to_unsigned(addr, C_ADDR_WIDTH)), "Read data");
+      cycles := v_cycles;
+    end procedure;
+
+    -- Wait for a number of clock cycles.
+    procedure wait_cycles(count : natural) is
+    begin
+      for i in 1 to count loop
+        wait until rising_edge(s_clk);
+      end loop;
+    end procedure;
+
+    procedure report_bandwidth(name : string; count : natural; cycles : natural) is
+      variable v_mb_per_s : real;
+    begin
+      v_mb_per_s := real(4 * count) * C_CLK_FREQ / real(cycles);
+      info(name & ": " & integer'image(count) & " words in " & integer'image(cycles) &
+           " cycles (" & real'image(real(cycles) / real(count)) & " cycles/word, " &
+           real'image(v_mb_per_s) & " MB/s)");
+    end procedure;
+
+    procedure benchmark(pattern : T_PATTERN; max_read_cycles_per_word : real) is
+      variable v_cycles : natural;
+    begin
+      run_accesses(pattern, true, C_NUM_WORDS, v_cycles);
+      report_bandwidth(T_PATTERN'image(pattern) & " write", C_NUM_WORDS, v_cycles);
+      wait_cycles(16);
+      run_accesses(pattern, false, C_NUM_WORDS, v_cycles);
+      report_bandwidth(T_PATTERN'image(pattern) & " read", C_NUM_WORDS, v_cycles);
+      check(real(v_cycles) <= max_read_cycles_per_word * real(C_NUM_WORDS),
+            T_PATTERN'image(pattern) & " read bandwidth");
+    end procedure;
+
+    variable v_cycles : natural;
+  begin
+    test_runner_setup(runner, runner_cfg);
+
+    -- Continue running even if we have failures (for easier debugging).
+    set_stop_level(failure);
+
+    -- Reset.
+    s_req <= '0';
+    s_we <= '0';
+    s_addr <= (others => '0');
+    s_data <= (others => '0');
+    s_rst <= '1';
+    wait for 4 * C_CLK_HALF_PERIOD;
+    s_rst <= '0';
+
+    while test_suite loop
+      if run("sequential") then
+        -- Open row hits, with a row change every C_WORDS_PER_ROW words.
+        benchmark(SEQUENTIAL, 3.0);
+      elsif run("bank_interleaved") then
+        -- All four banks are kept open.
+        benchmark(BANK_INTERLEAVED, 3.0);
+      elsif run("row_conflicts") then
+        -- Every access needs a PRECHARGE + ACTIVE (the worst case for an open-page policy).
+        benchmark(ROW_CONFLICTS, 16.0);
+      elsif run("random") then
+        benchmark(RANDOM, 16.0);
+      elsif run("latency") then
+        -- Fill the first two rows of bank 0.
+        run_accesses(ROW_CONFLICTS, true, 16, v_cycles);
+
+        -- Wait for an idle refresh (which closes all rows).
+        wait_cycles(1000);
+
+        -- Idle bank (ACTIVE + READ).
+        single_read(0, v_cycles);
+        info("Read latency, idle bank: " & integer'image(v_cycles) & " cycles");
+        wait_cycles(16);
+
+        -- Open row (READ).
+        single_read(1, v_cycles);
+        info("Read latency, open row: " & integer'image(v_cycles) & " cycles");
+        wait_cycles(16);
+
+        -- Row conflict (PRECHARGE + ACTIVE + READ).
+        single_read(C_WORDS_PER_BANK_ROW, v_cycles);
+        info("Read latency, row conflict: " & integer'image(v_cycles) & " cycles");
+      end if;
+    end loop;
+
+    s_done <= true;
+    test_runner_cleanup(runner);
+  end process;
+end architecture;
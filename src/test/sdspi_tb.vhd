@@ -0,0 +1,275 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- This is a test bench for the SD card SPI engine, using the SD card simulation model. Block reads
+-- and writes are performed the same way as a driver would do it (CMD17 / CMD24 via SDDATA, followed
+-- by a block transfer via SDBLK and SDFIFO), and the read bandwidth is reported.
+----------------------------------------------------------------------------------------------------
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.sdcard_model_pkg.all;
+
+entity sdspi_tb is
+  generic (runner_cfg : string);
+end entity;
+
+architecture tb of sdspi_tb is
+  -- 100 MHz.
+  constant C_CLK_FREQ : real := 100.0;
+  constant C_CLK_HALF_PERIOD : time := 5 ns;
+
+  -- Enable + CS, DIV = 1 (25 MHz SPI clock).
+  constant C_CTRL : std_logic_vector(31 downto 0) := x"00000103";
+
+  constant C_BLOCK_SIZE : natural := 512;
+  constant C_BLOCK_WORDS : natural := C_BLOCK_SIZE / 4;
+  constant C_NUM_BLOCKS : natural := 16;
+
+  signal s_rst : std_logic;
+  signal s_clk : std_logic;
+  signal s_done : boolean := false;
+
+  signal s_ctrl : std_logic_vector(31 downto 0);
+  signal s_wdata : std_logic_vector(31 downto 0);
+  signal s_data_we : std_logic;
+  signal s_blk_we : std_logic;
+  signal s_fifo_we : std_logic;
+  signal s_fifo_re : std_logic;
+  signal s_data : std_logic_vector(31 downto 0);
+  signal s_stat : std_logic_vector(31 downto 0);
+  signal s_fifo : std_logic_vector(31 downto 0);
+
+  signal s_sck : std_logic;
+  signal s_mosi : std_logic;
+  signal s_cs_n : std_logic;
+  signal s_miso : std_logic;
+  signal s_corrupt_crc : std_logic;
+
+  -- The data that is written to block block_no (different from the initial card contents).
+  function write_pattern_word(block_no : natural; idx : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned(block_no * 65536 + idx * 4099, 32) xor x"5a3cc3a5");
+  end function;
+
+  function pattern_word(block_no : natural; idx : natural) return std_logic_vector is
+  begin
+    return sdcard_pattern_byte(block_no, idx*4+3) &
+           sdcard_pattern_byte(block_no, idx*4+2) &
+           sdcard_pattern_byte(block_no, idx*4+1) &
+           sdcard_pattern_byte(block_no, idx*4);
+  end function;
+begin
+  sdspi_0: entity work.sdspi
+    port map (
+      i_rst => s_rst,
+      i_clk => s_clk,
+      i_ctrl => s_ctrl,
+      i_wdata => s_wdata,
+      i_data_we => s_data_we,
+      i_blk_we => s_blk_we,
+      i_fifo_we => s_fifo_we,
+      i_fifo_re => s_fifo_re,
+      o_data => s_data,
+      o_stat => s_stat,
+      o_fifo => s_fifo,
+      o_sck => s_sck,
+      o_mosi => s_mosi,
+      o_cs_n => s_cs_n,
+      i_miso => s_miso
+    );
+
+  sdcard_model_0: entity work.sdcard_model
+    generic map (
+      NUM_BLOCKS => C_NUM_BLOCKS
+    )
+    port map (
+      i_sck => s_sck,
+      i_mosi => s_mosi,
+      i_cs_n => s_cs_n,
+      o_miso => s_miso,
+      i_corrupt_crc => s_corrupt_crc
+    );
+
+  -- Clock generator.
+  process
+  begin
+    while not s_done loop
+      s_clk <= '0';
+      wait for C_CLK_HALF_PERIOD;
+      s_clk <= '1';
+      wait for C_CLK_HALF_PERIOD;
+    end loop;
+    wait;
+  end process;
+
+  main : process
+    procedure wait_not_busy is
+    begin
+      loop
+        wait until rising_edge(s_clk);
+        exit when s_stat(0) = '0';
+      end loop;
+    end procedure;
+
+    -- Transfer a single byte via SDDATA.
+    procedure spi_byte(data : std_logic_vector(7 downto 0);
+                       rx : out std_logic_vector(7 downto 0)) is
+    begin
+      s_wdata <= x"000000" & data;
+      s_data_we <= '1';
+      wait until rising_edge(s_clk);
+      s_data_we <= '0';
+      wait_not_busy;
+      rx := s_data(7 downto 0);
+    end procedure;
+
+    -- Send a command and check that the card responds with R1 = 0x00.
+    procedure send_cmd(cmd : natural; arg : natural) is
+      variable v_arg : std_logic_vector(31 downto 0);
+      variable v_rx : std_logic_vector(7 downto 0);
+    begin
+      v_arg := std_logic_vector(to_unsigned(arg, 32));
+      spi_byte(std_logic_vector(to_unsigned(64 + cmd, 8)), v_rx);
+      spi_byte(v_arg(31 downto 24), v_rx);
+      spi_byte(v_arg(23 downto 16), v_rx);
+      spi_byte(v_arg(15 downto 8), v_rx);
+      spi_byte(v_arg(7 downto 0), v_rx);
+      spi_byte(x"01", v_rx);
+      for k in 1 to 8 loop
+        spi_byte(x"ff", v_rx);
+        exit when v_rx /= x"ff";
+      end loop;
+      check_equal(v_rx, std_logic_vector'(x"00"), "R1 for CMD" & integer'image(cmd));
+    end procedure;
+
+    procedure start_block(blk : std_logic_vector(31 downto 0)) is
+    begin
+      s_wdata <= blk;
+      s_blk_we <= '1';
+      wait until rising_edge(s_clk);
+      s_blk_we <= '0';
+      wait_not_busy;
+    end procedure;
+
+    -- Read a block and check the contents against the expected pattern.
+    procedure read_block(block_no : natural; written : boolean; expect_crc_err : boolean) is
+      variable v_expected : std_logic_vector(31 downto 0);
+    begin
+      send_cmd(17, block_no);
+      start_block(x"00000200");
+      if expect_crc_err then
+        check_equal(s_stat(3 downto 1), std_logic_vector'("001"), "Status after block read");
+      else
+        check_equal(s_stat(3 downto 1), std_logic_vector'("000"), "Status after block read");
+      end if;
+      check_equal(unsigned(s_stat(23 downto 16)), C_BLOCK_WORDS, "FIFO count after block read");
+      check_equal(s_stat(31), '1', "Engine present bit");
+
+      for k in 0 to C_BLOCK_WORDS-1 loop
+        if written then
+          v_expected := write_pattern_word(block_no, k);
+        else
+          v_expected := pattern_word(block_no, k);
+        end if;
+        check_equal(s_fifo, v_expected, "Block " & integer'image(block_no) & ", word " &
+                    integer'image(k));
+        s_fifo_re <= '1';
+        wait until rising_edge(s_clk);
+        s_fifo_re <= '0';
+        wait until rising_edge(s_clk);
+      end loop;
+      check_equal(unsigned(s_stat(23 downto 16)), 0, "FIFO count after popping the block");
+    end procedure;
+
+    -- Write a block with the write pattern.
+    procedure write_block(block_no : natural) is
+    begin
+      for k in 0 to C_BLOCK_WORDS-1 loop
+        s_wdata <= write_pattern_word(block_no, k);
+        s_fifo_we <= '1';
+        wait until rising_edge(s_clk);
+        s_fifo_we <= '0';
+      end loop;
+      wait until rising_edge(s_clk);
+
+      send_cmd(24, block_no);
+      start_block(x"80000200");
+      check_equal(s_stat(3 downto 1), std_logic_vector'("000"), "Status after block write");
+      check_equal(s_data(4 downto 0), std_logic_vector'("00101"), "Data response token");
+      check_equal(unsigned(s_stat(23 downto 16)), 0, "FIFO count after block write");
+    end procedure;
+
+    variable v_start : time;
+    variable v_cycles : natural;
+    variable v_mb_per_s : real;
+  begin
+    test_runner_setup(runner, runner_cfg);
+
+    -- Continue running even if we have failures (for easier debugging).
+    set_stop_level(failure);
+
+    -- Reset.
+    s_ctrl <= C_CTRL;
+    s_wdata <= (others => '0');
+    s_data_we <= '0';
+    s_blk_we <= '0';
+    s_fifo_we <= '0';
+    s_fifo_re <= '0';
+    s_corrupt_crc <= '0';
+    s_rst <= '1';
+    wait for 4 * C_CLK_HALF_PERIOD;
+    s_rst <= '0';
+    wait until rising_edge(s_clk);
+
+    while test_suite loop
+      if run("read_block") then
+        read_block(5, false, false);
+      elsif run("write_read") then
+        write_block(3);
+        read_block(3, true, false);
+        read_block(4, false, false);
+      elsif run("crc_error") then
+        s_corrupt_crc <= '1';
+        read_block(2, false, true);
+        s_corrupt_crc <= '0';
+        read_block(2, false, false);
+      elsif run("read_bandwidth") then
+        v_start := now;
+        for b in 0 to C_NUM_BLOCKS-1 loop
+          read_block(b, false, false);
+        end loop;
+        v_cycles := (now - v_start) / (2 * C_CLK_HALF_PERIOD);
+        v_mb_per_s := real(C_NUM_BLOCKS * C_BLOCK_SIZE) * C_CLK_FREQ / real(v_cycles);
+        info("Read: " & integer'image(C_NUM_BLOCKS) & " blocks in " & integer'image(v_cycles) &
+             " cycles (" & real'image(v_mb_per_s) & " MB/s)");
+
+        -- At 25 MHz the raw SPI bit rate is 3.125 MB/s.
+        check(v_mb_per_s >= 2.5, "Read bandwidth");
+      end if;
+    end loop;
+
+    s_done <= true;
+    test_runner_cleanup(runner);
+  end process;
+end architecture;
@@ -0,0 +1,296 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- This is a test bench for the video line FIFO. The memory model returns the row address in the
+-- data (and garbage when there is no response), so every acknowledged pixel read is checked
+-- against the requested row. The memory grants are controlled by each test, which makes it possible
+-- to test gaps in the grants, underruns, and reads of the row that is granted during the same
+-- cycle (i.e. forwarded from the memory).
+----------------------------------------------------------------------------------------------------
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity vid_line_fifo_tb is
+  generic (runner_cfg : string);
+end entity;
+
+architecture tb of vid_line_fifo_tb is
+  constant C_CLK_HALF_PERIOD : time := 5 ns;
+
+  constant C_LOG2_READ_WORDS : natural := 1;
+  constant C_LOG2_DEPTH : positive := 2;
+  constant C_DEPTH : positive := 2**C_LOG2_DEPTH;
+
+  subtype T_ROW is std_logic_vector(32*(2**C_LOG2_READ_WORDS)-1 downto 0);
+
+  signal s_rst : std_logic;
+  signal s_clk : std_logic;
+  signal s_done : boolean := false;
+  signal s_cycle : natural;
+
+  signal s_fetch_en : std_logic;
+  signal s_decremental_read : std_logic;
+  signal s_row_start_imminent : std_logic;
+  signal s_row_start_addr : std_logic_vector(23 downto 0);
+  signal s_underrun : std_logic;
+
+  signal s_pix_read_en : std_logic;
+  signal s_pix_read_adr : std_logic_vector(23 downto 0);
+  signal s_pix_read_ack : std_logic;
+  signal s_pix_read_dat : T_ROW;
+
+  signal s_mem_read_en : std_logic;
+  signal s_mem_read_adr : std_logic_vector(23 downto 0);
+  signal s_mem_read_grant : std_logic;
+  signal s_mem_read_dat : T_ROW;
+
+  -- Memory grants: Every s_grant_period:th cycle (never if zero), or when s_grant_force is set.
+  signal s_grant_period : natural;
+  signal s_grant_force : std_logic;
+  signal s_num_grants : natural;
+
+  function row_data(adr : natural) return T_ROW is
+    variable v_result : T_ROW;
+  begin
+    for k in 0 to 2**C_LOG2_READ_WORDS-1 loop
+      v_result(k*32+31 downto k*32) := std_logic_vector(to_unsigned(k + 1, 8)) &
+                                       std_logic_vector(to_unsigned(adr, 24));
+    end loop;
+    return v_result;
+  end function;
+begin
+  vid_line_fifo_0: entity work.vid_line_fifo
+    generic map (
+      LOG2_READ_WORDS => C_LOG2_READ_WORDS,
+      LOG2_DEPTH => C_LOG2_DEPTH
+    )
+    port map (
+      i_rst => s_rst,
+      i_clk => s_clk,
+      i_fetch_en => s_fetch_en,
+      i_decremental_read => s_decremental_read,
+      i_row_start_imminent => s_row_start_imminent,
+      i_row_start_addr => s_row_start_addr,
+      o_underrun => s_underrun,
+      i_read_en => s_pix_read_en,
+      i_read_adr => s_pix_read_adr,
+      o_read_ack => s_pix_read_ack,
+      o_read_dat => s_pix_read_dat,
+      o_read_en => s_mem_read_en,
+      o_read_adr => s_mem_read_adr,
+      i_read_grant => s_mem_read_grant,
+      i_read_dat => s_mem_read_dat
+    );
+
+  -- Clock generator.
+  process
+  begin
+    while not s_done loop
+      s_clk <= '0';
+      wait for C_CLK_HALF_PERIOD;
+      s_clk <= '1';
+      wait for C_CLK_HALF_PERIOD;
+    end loop;
+    wait;
+  end process;
+
+  s_mem_read_grant <= '1' when s_grant_force = '1' or
+                               (s_grant_period > 0 and s_cycle mod s_grant_period = 0) else
+                      '0';
+
+  -- Memory model (the data for a granted request arrives during the next cycle).
+  memory : process(s_clk, s_rst)
+  begin
+    if s_rst = '1' then
+      s_cycle <= 0;
+      s_num_grants <= 0;
+      s_mem_read_dat <= (others => '0');
+    elsif rising_edge(s_clk) then
+      s_cycle <= s_cycle + 1;
+      if s_mem_read_en = '1' and s_mem_read_grant = '1' then
+        s_mem_read_dat <= row_data(to_integer(unsigned(s_mem_read_adr)));
+        s_num_grants <= s_num_grants + 1;
+      else
+        s_mem_read_dat <= (others => '1');
+      end if;
+    end if;
+  end process;
+
+  main : process
+    procedure wait_cycles(n : natural) is
+    begin
+      for k in 1 to n loop
+        wait until rising_edge(s_clk);
+      end loop;
+    end procedure;
+
+    -- Start fetching a new line (the FIFO is flushed).
+    procedure start_line(adr : natural; decremental : std_logic) is
+    begin
+      s_decremental_read <= decremental;
+      s_row_start_addr <= std_logic_vector(to_unsigned(adr, 24));
+      s_row_start_imminent <= '1';
+      wait until rising_edge(s_clk);
+      s_row_start_imminent <= '0';
+    end procedure;
+
+    -- Read a row from the FIFO (during one cycle, together with a forced grant if requested), and
+    -- check the response during the next cycle.
+    procedure read_row(adr : natural; expect_hit : boolean; force_grant : std_logic := '0') is
+      constant C_MSG : string := "Row " & integer'image(adr);
+    begin
+      s_pix_read_en <= '1';
+      s_pix_read_adr <= std_logic_vector(to_unsigned(adr, 24));
+      s_grant_force <= force_grant;
+      wait until rising_edge(s_clk);
+      s_pix_read_en <= '0';
+      s_grant_force <= '0';
+      wait until falling_edge(s_clk);
+      if expect_hit then
+        check_equal(s_pix_read_ack, '1', C_MSG & ": Ack");
+        check_equal(s_underrun, '0', C_MSG & ": Underrun");
+        check_equal(s_pix_read_dat, row_data(adr), C_MSG & ": Data");
+      else
+        check_equal(s_pix_read_ack, '0', C_MSG & ": Ack");
+        check_equal(s_underrun, '1', C_MSG & ": Underrun");
+      end if;
+    end procedure;
+
+    variable v_grants : natural;
+  begin
+    test_runner_setup(runner, runner_cfg);
+
+    s_fetch_en <= '1';
+    s_decremental_read <= '0';
+    s_row_start_imminent <= '0';
+    s_row_start_addr <= (others => '0');
+    s_pix_read_en <= '0';
+    s_pix_read_adr <= (others => '0');
+    s_grant_period <= 0;
+    s_grant_force <= '0';
+
+    s_rst <= '1';
+    wait for 4 * C_CLK_HALF_PERIOD;
+    wait until rising_edge(s_clk);
+    s_rst <= '0';
+
+    while test_suite loop
+      if run("grant_gaps") then
+        -- Grants during every third cycle, and a pixel read during every fourth cycle.
+        start_line(100, '0');
+        s_grant_period <= 3;
+        wait_cycles(20);
+        for k in 100 to 129 loop
+          read_row(k, true);
+          wait_cycles(3);
+        end loop;
+
+        -- The FIFO is refilled with the head row and three more rows (and nothing more).
+        wait_cycles(20);
+        check_equal(s_num_grants, 133 - 100, "Memory reads");
+
+        -- A full FIFO bridges a gap in the grants: Read it empty without any grants (the
+        -- requested row stays in the FIFO, so it can be read twice).
+        s_grant_period <= 0;
+        wait_cycles(2);
+        read_row(129, true);
+        read_row(129, true);
+        read_row(130, true);
+        read_row(131, true);
+        read_row(132, true);
+        read_row(133, false);
+
+      elsif run("underrun_restart") then
+        -- Read a row before it has been fetched.
+        start_line(100, '0');
+        read_row(100, false);
+
+        -- The FIFO restarts from the row after the missed row.
+        check_equal(s_mem_read_en, '1', "Fetch after underrun");
+        check_equal(unsigned(s_mem_read_adr), 101, "Fetch address after underrun");
+        s_grant_period <= 1;
+        wait_cycles(10);
+        v_grants := s_num_grants;
+        check_equal(v_grants, C_DEPTH, "Memory reads after underrun");
+        read_row(101, true);
+        read_row(102, true);
+
+        -- Skipping rows (dropping them) is fine, but a row that is too far ahead underruns.
+        read_row(104, true);
+        wait_cycles(10);
+        read_row(104 + C_DEPTH + 1, false);
+        wait_cycles(10);
+        read_row(104 + C_DEPTH + 2, true);
+
+      elsif run("decremental_reads") then
+        start_line(500, '1');
+        s_grant_period <= 2;
+        wait_cycles(10);
+        check_equal(unsigned(s_mem_read_adr), 500 - C_DEPTH, "Fetch address when full");
+        read_row(500, true);
+        wait_cycles(2);
+        read_row(499, true);
+        wait_cycles(2);
+        read_row(497, true);
+        for k in 496 downto 480 loop
+          wait_cycles(3);
+          read_row(k, true);
+        end loop;
+
+        -- A row after the head row (i.e. a higher address) underruns, and the FIFO restarts
+        -- from the row before it.
+        wait_cycles(10);
+        read_row(490, false);
+        check_equal(unsigned(s_mem_read_adr), 489, "Fetch address after underrun");
+        wait_cycles(10);
+        read_row(489, true);
+
+      elsif run("forward_on_grant_cycle") then
+        -- Empty FIFO: The row is read during the same cycle as it is granted.
+        start_line(200, '0');
+        wait_cycles(2);
+        read_row(200, true, '1');
+
+        -- The forwarded row is stored in the FIFO too, but nothing more has been fetched.
+        wait_cycles(2);
+        read_row(200, true);
+        read_row(201, false);
+
+        -- Two rows in the FIFO (one of them still in flight), and the third row is read during
+        -- the same cycle as it is granted.
+        start_line(300, '0');
+        s_grant_force <= '1';
+        wait_cycles(2);
+        s_grant_force <= '0';
+        read_row(302, true, '1');
+        wait_cycles(2);
+        read_row(302, true);
+        read_row(303, false);
+      end if;
+    end loop;
+
+    s_done <= true;
+    test_runner_cleanup(runner);
+  end process;
+end architecture;
@@ -0,0 +1,325 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- This is a test bench for tile mode (CMODE = 6) in the pixel pipeline. A small raster is
+-- generated, and every output pixel is compared against the expected glyph pixel. The tile map
+-- span is more than two tile map words (32 pixels per word) wide and starts at a non-zero HSTRT,
+-- so the glyph indirection, the tile map prefetch cache and the HSTRT restart are all exercised.
+----------------------------------------------------------------------------------------------------
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.vid_types.all;
+
+entity vid_pixel_tb is
+  generic (runner_cfg : string);
+end entity;
+
+architecture tb of vid_pixel_tb is
+  constant C_CLK_HALF_PERIOD : time := 5 ns;
+
+  constant C_LOG2_READ_WORDS : natural := 1;
+  constant C_CHECK_DELAY : positive := C_VID_PIXEL_DELAY + C_VID_TILE_MODE_DELAY;
+
+  -- A small raster (128x17 pixels, of which 100x16 are visible, i.e. x >= 0 and y >= 0).
+  constant C_X_FIRST : integer := -28;
+  constant C_X_LAST : integer := 99;
+  constant C_Y_FIRST : integer := -1;
+  constant C_Y_LAST : integer := 15;
+  constant C_FRAME_CYCLES : positive := (C_X_LAST - C_X_FIRST + 1) * (C_Y_LAST - C_Y_FIRST + 1);
+
+  -- The active area (80 pixels, i.e. 10 tiles).
+  constant C_HSTRT : integer := 7;
+  constant C_HSTOP : integer := 87;
+
+  -- VRAM word addresses of the tile map (a few words, placed anywhere in [C_MAP_ADDR, +8)) and the
+  -- glyph table (256 glyphs, four words each).
+  constant C_MAP_ADDR : natural := 64;
+  constant C_GLYPHS_ADDR : natural := 1024;
+
+  type T_POS is record
+    valid : boolean;
+    x : integer;
+    y : integer;
+  end record;
+  type T_POS_DELAY is array (1 to C_CHECK_DELAY) of T_POS;
+
+  signal s_rst : std_logic;
+  signal s_clk : std_logic;
+  signal s_done : boolean := false;
+
+  signal s_x : integer;
+  signal s_y : integer;
+  signal s_cycle : natural;
+  signal s_pos_delay : T_POS_DELAY;
+
+  signal s_raster_x : std_logic_vector(11 downto 0);
+  signal s_raster_y : std_logic_vector(11 downto 0);
+  signal s_row_line : std_logic_vector(11 downto 0);
+  signal s_regs : T_VID_REGS;
+  signal s_read_en : std_logic;
+  signal s_read_adr : std_logic_vector(23 downto 0);
+  signal s_read_ack : std_logic;
+  signal s_read_dat : std_logic_vector(32*(2**C_LOG2_READ_WORDS)-1 downto 0);
+  signal s_pal_addr : std_logic_vector(7 downto 0);
+  signal s_pal_data : std_logic_vector(31 downto 0);
+  signal s_color : std_logic_vector(31 downto 0);
+
+  -- The tile map entries (glyph indices). Neighbouring tiles use different glyphs.
+  function map_tile(idx : natural) return natural is
+  begin
+    return (idx * 37 + 5) mod 256;
+  end function;
+
+  -- The glyph rows (one byte per row, the leftmost pixel in the least significant bit).
+  function glyph_row(tile : natural; row : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned((tile * 29 + row * 83 + 17) mod 256, 8));
+  end function;
+
+  function mem_word(adr : natural) return std_logic_vector is
+    variable v_result : std_logic_vector(31 downto 0);
+    variable v_tile : natural;
+    variable v_row : natural;
+  begin
+    if adr >= C_MAP_ADDR and adr < C_MAP_ADDR + 8 then
+      for k in 0 to 3 loop
+        v_result(k*8+7 downto k*8) :=
+            std_logic_vector(to_unsigned(map_tile((adr - C_MAP_ADDR) * 4 + k), 8));
+      end loop;
+      return v_result;
+    elsif adr >= C_GLYPHS_ADDR and adr < C_GLYPHS_ADDR + 256 * 4 then
+      v_tile := (adr - C_GLYPHS_ADDR) / 4;
+      v_row := ((adr - C_GLYPHS_ADDR) mod 4) * 4;
+      for k in 0 to 3 loop
+        v_result(k*8+7 downto k*8) := glyph_row(v_tile, v_row + k);
+      end loop;
+      return v_result;
+    end if;
+    return x"deadbeef";
+  end function;
+
+  -- The palette colors encode the palette index (only index 0 and 1 are used in tile mode).
+  function palette_color(idx : natural) return std_logic_vector is
+  begin
+    return x"ff5a3c" & std_logic_vector(to_unsigned(idx, 8));
+  end function;
+
+  -- The expected output color. ADDR points to tile map entry map_offs, and the first pixel is xoffs
+  -- pixels into the tile map row.
+  function expected_color(x : integer;
+                          y : integer;
+                          map_offs : natural;
+                          xoffs : natural;
+                          log2_scale : natural) return std_logic_vector is
+    variable v_px : natural;
+    variable v_tile : natural;
+    variable v_row : natural;
+    variable v_glyph : std_logic_vector(7 downto 0);
+  begin
+    if x < 0 or y < 0 then
+      return x"00000000";
+    end if;
+    if x < C_HSTRT or x >= C_HSTOP then
+      return palette_color(0);
+    end if;
+    v_px := xoffs + (x - C_HSTRT);
+    v_tile := map_tile(map_offs + v_px / 8);
+    v_row := (y / 2**log2_scale) mod 16;
+    v_glyph := glyph_row(v_tile, v_row);
+    if v_glyph(v_px mod 8) = '1' then
+      return palette_color(1);
+    end if;
+    return palette_color(0);
+  end function;
+begin
+  vid_pixel_0: entity work.vid_pixel
+    generic map (
+      X_COORD_BITS => s_raster_x'length,
+      Y_COORD_BITS => s_raster_y'length,
+      LOG2_READ_WORDS => C_LOG2_READ_WORDS,
+      ENABLE_TILE_MODE => true
+    )
+    port map (
+      i_rst => s_rst,
+      i_clk => s_clk,
+      i_raster_x => s_raster_x,
+      i_raster_y => s_raster_y,
+      o_mem_read_en => s_read_en,
+      o_mem_read_addr => s_read_adr,
+      i_mem_data => s_read_dat,
+      i_mem_ack => s_read_ack,
+      o_pal_addr => s_pal_addr,
+      i_pal_data => s_pal_data,
+      i_regs => s_regs,
+      i_row_line => s_row_line,
+      o_color => s_color
+    );
+
+  -- Clock generator.
+  process
+  begin
+    while not s_done loop
+      s_clk <= '0';
+      wait for C_CLK_HALF_PERIOD;
+      s_clk <= '1';
+      wait for C_CLK_HALF_PERIOD;
+    end loop;
+    wait;
+  end process;
+
+  -- Raster generator (the raster position of the output pixels is delayed C_CHECK_DELAY cycles).
+  raster : process(s_clk, s_rst)
+  begin
+    if s_rst = '1' then
+      s_x <= C_X_FIRST;
+      s_y <= C_Y_FIRST;
+      s_cycle <= 0;
+      s_pos_delay <= (others => (valid => false, x => 0, y => 0));
+    elsif rising_edge(s_clk) then
+      if s_x = C_X_LAST then
+        s_x <= C_X_FIRST;
+        if s_y = C_Y_LAST then
+          s_y <= C_Y_FIRST;
+        else
+          s_y <= s_y + 1;
+        end if;
+      else
+        s_x <= s_x + 1;
+      end if;
+      s_cycle <= s_cycle + 1;
+
+      s_pos_delay(1) <= (valid => s_cycle < C_FRAME_CYCLES, x => s_x, y => s_y);
+      for k in 2 to C_CHECK_DELAY loop
+        s_pos_delay(k) <= s_pos_delay(k-1);
+      end loop;
+    end if;
+  end process;
+
+  s_raster_x <= std_logic_vector(to_signed(s_x, s_raster_x'length));
+  s_raster_y <= std_logic_vector(to_signed(s_y, s_raster_y'length));
+
+  -- All visible lines use the same tile map row (the row line is the raster line).
+  s_row_line <= std_logic_vector(to_unsigned(s_y mod 4096, s_row_line'length));
+
+  -- VRAM model (every read request is acknowledged in the next cycle, just like the line FIFO and
+  -- the urgent reads in video_layer).
+  vram : process(s_clk)
+    variable v_adr : natural;
+  begin
+    if rising_edge(s_clk) then
+      v_adr := to_integer(unsigned(s_read_adr)) * 2**C_LOG2_READ_WORDS;
+      for k in 0 to 2**C_LOG2_READ_WORDS-1 loop
+        s_read_dat(k*32+31 downto k*32) <= mem_word(v_adr + k);
+      end loop;
+      s_read_ack <= s_read_en;
+    end if;
+  end process;
+
+  -- Palette model (one cycle read latency, like vid_palette).
+  palette : process(s_clk)
+  begin
+    if rising_edge(s_clk) then
+      s_pal_data <= palette_color(to_integer(unsigned(s_pal_addr)));
+    end if;
+  end process;
+
+  main : process
+    -- The tile map starts at tile map_offs (i.e. ADDR points to the tile map word that holds the
+    -- tile, and XOFFS skips the preceding tiles of that word), and the first pixel is xoffs pixels
+    -- into the tile.
+    procedure run_frame(map_offs : natural; xoffs : natural; log2_scale : natural) is
+      variable v_word_offs : natural;
+      variable v_px_offs : natural;
+      variable v_pos : T_POS;
+      variable v_expected : std_logic_vector(31 downto 0);
+      variable v_num_pixels : natural;
+      variable v_num_glyph_pixels : natural;
+    begin
+      v_word_offs := map_offs / 4;
+      v_px_offs := (map_offs mod 4) * 8 + xoffs;
+
+      -- Set up the VCR:s for tile mode.
+      s_regs <= (ADDR => std_logic_vector(to_unsigned(C_MAP_ADDR + v_word_offs, 24)),
+                 XOFFS => std_logic_vector(to_unsigned(v_px_offs * 65536, 24)),
+                 XINCR => 24x"010000",
+                 HSTRT => std_logic_vector(to_signed(C_HSTRT, 24)),
+                 HSTOP => std_logic_vector(to_signed(C_HSTOP, 24)),
+                 CMODE => std_logic_vector(to_unsigned(log2_scale * 16 + 6, 24)),
+                 RMODE => (others => '0'),
+                 STRIDE => (others => '0'),
+                 REPEAT => (others => '0'),
+                 PALBANK => (others => '0'),
+                 GLYPHS => std_logic_vector(to_unsigned(C_GLYPHS_ADDR, 24)));
+
+      v_num_pixels := 0;
+      v_num_glyph_pixels := 0;
+      s_rst <= '1';
+      wait for 4 * C_CLK_HALF_PERIOD;
+      wait until rising_edge(s_clk);
+      s_rst <= '0';
+
+      -- Check the output pixels.
+      for k in 1 to C_FRAME_CYCLES + C_CHECK_DELAY + 2 loop
+        wait until rising_edge(s_clk);
+        v_pos := s_pos_delay(C_CHECK_DELAY);
+        if v_pos.valid then
+          v_expected := expected_color(v_pos.x,
+                                       v_pos.y,
+                                       v_word_offs * 4,
+                                       v_px_offs,
+                                       log2_scale);
+          check_equal(s_color,
+                      v_expected,
+                      "Pixel (" & integer'image(v_pos.x) & ", " & integer'image(v_pos.y) & ")");
+          v_num_pixels := v_num_pixels + 1;
+          if v_expected = palette_color(1) then
+            v_num_glyph_pixels := v_num_glyph_pixels + 1;
+          end if;
+        end if;
+      end loop;
+
+      check_equal(v_num_pixels, C_FRAME_CYCLES, "Checked pixels");
+      check(v_num_glyph_pixels > 0, "No glyph pixels were drawn");
+    end procedure;
+  begin
+    test_runner_setup(runner, runner_cfg);
+
+    while test_suite loop
+      if run("aligned") then
+        run_frame(0, 0, 0);
+      elsif run("unaligned_map") then
+        -- The first tile is in the middle of a tile map word at an odd word address.
+        run_frame(6, 0, 0);
+      elsif run("xoffs") then
+        -- Start in the middle of a tile.
+        run_frame(0, 13, 0);
+      elsif run("scaled") then
+        run_frame(4, 3, 1);
+      end if;
+    end loop;
+
+    s_done <= true;
+    test_runner_cleanup(runner);
+  end process;
+end architecture;
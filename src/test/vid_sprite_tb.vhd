@@ -0,0 +1,314 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- This is a test bench for the hardware sprite. A small raster is generated, and every output
+-- pixel of a frame is compared against the expected result (the sprite on top of a background that
+-- encodes the raster coordinate). The number of VRAM reads is checked too.
+--
+-- The sprite is either a checkerboard of opaque and transparent blocks, or a sprite that uses all
+-- the 256 alpha values (one per pixel), which tests the alpha blending.
+----------------------------------------------------------------------------------------------------
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.vid_types.all;
+
+entity vid_sprite_tb is
+  generic (runner_cfg : string);
+end entity;
+
+architecture tb of vid_sprite_tb is
+  constant C_CLK_HALF_PERIOD : time := 5 ns;
+
+  constant C_LOG2_READ_WORDS : natural := 1;
+  constant C_COLOR_DELAY : positive := 4;
+  constant C_CHECK_DELAY : positive := C_COLOR_DELAY + C_VID_SPRITE_DELAY;
+
+  -- A small raster (128x26 pixels, of which 48x24 are visible, i.e. x >= 0 and y >= 0).
+  constant C_X_FIRST : integer := -80;
+  constant C_X_LAST : integer := 47;
+  constant C_Y_FIRST : integer := -2;
+  constant C_Y_LAST : integer := 23;
+  constant C_FRAME_CYCLES : positive := (C_X_LAST - C_X_FIRST + 1) * (C_Y_LAST - C_Y_FIRST + 1);
+
+  -- VRAM word address of the sprite bitmap.
+  constant C_SPRITE_ADDR : natural := 256;
+
+  type T_POS is record
+    valid : boolean;
+    x : integer;
+    y : integer;
+  end record;
+  type T_POS_DELAY is array (1 to C_CHECK_DELAY) of T_POS;
+
+  signal s_rst : std_logic;
+  signal s_clk : std_logic;
+  signal s_done : boolean := false;
+
+  signal s_x : integer;
+  signal s_y : integer;
+  signal s_cycle : natural;
+  signal s_pos_delay : T_POS_DELAY;
+
+  signal s_raster_x : std_logic_vector(11 downto 0);
+  signal s_raster_y : std_logic_vector(11 downto 0);
+  signal s_partial_alpha : boolean;
+  signal s_enable : std_logic;
+  signal s_addr : std_logic_vector(23 downto 0);
+  signal s_xpos : std_logic_vector(15 downto 0);
+  signal s_ypos : std_logic_vector(15 downto 0);
+  signal s_read_en : std_logic;
+  signal s_read_adr : std_logic_vector(23 downto 0);
+  signal s_read_ack : std_logic;
+  signal s_read_dat : std_logic_vector(32*(2**C_LOG2_READ_WORDS)-1 downto 0);
+  signal s_color : std_logic_vector(31 downto 0);
+  signal s_out_color : std_logic_vector(31 downto 0);
+
+  signal s_num_pixels : natural;
+  signal s_num_reads : natural;
+
+  -- The sprite is a checkerboard of 4x4 opaque and transparent blocks, and the pixel colors encode
+  -- the sprite coordinate. With partial alpha, the alpha of each pixel is the pixel index instead
+  -- (i.e. all alpha values from 0 to 255 are used).
+  function sprite_pixel(px : natural; py : natural; partial_alpha : boolean)
+      return std_logic_vector is
+    variable v_alpha : std_logic_vector(7 downto 0);
+  begin
+    if partial_alpha then
+      v_alpha := std_logic_vector(to_unsigned(py * 16 + px, 8));
+    elsif ((px / 4) + (py / 4)) mod 2 = 0 then
+      v_alpha := x"ff";
+    else
+      v_alpha := x"00";
+    end if;
+    return v_alpha & std_logic_vector(to_unsigned(py * 16 + px, 8)) & x"c33c";
+  end function;
+
+  function mem_word(adr : natural; partial_alpha : boolean) return std_logic_vector is
+  begin
+    if adr >= C_SPRITE_ADDR and adr < C_SPRITE_ADDR + 256 then
+      return sprite_pixel((adr - C_SPRITE_ADDR) mod 16, (adr - C_SPRITE_ADDR) / 16, partial_alpha);
+    end if;
+    return x"deadbeef";
+  end function;
+
+  -- Reference alpha blending: (sprite * f + bg * (256 - f)) / 256, f = alpha + alpha / 128.
+  function blend(sprite : std_logic_vector(31 downto 0); bg : std_logic_vector(31 downto 0))
+      return std_logic_vector is
+    variable v_f : natural;
+    variable v_result : std_logic_vector(31 downto 0);
+    variable v_c : natural;
+  begin
+    v_f := to_integer(unsigned(sprite(31 downto 24)));
+    v_f := v_f + v_f / 128;
+    v_result(31 downto 24) := x"ff";
+    for k in 0 to 2 loop
+      v_c := (to_integer(unsigned(sprite(k*8+7 downto k*8))) * v_f +
+              to_integer(unsigned(bg(k*8+7 downto k*8))) * (256 - v_f)) / 256;
+      v_result(k*8+7 downto k*8) := std_logic_vector(to_unsigned(v_c, 8));
+    end loop;
+    return v_result;
+  end function;
+
+  -- The background (the output of the video layers) encodes the raster coordinate.
+  function background(x : integer; y : integer) return std_logic_vector is
+  begin
+    return x"00" & x"5a" & std_logic_vector(to_unsigned(y mod 256, 8)) &
+           std_logic_vector(to_unsigned(x mod 256, 8));
+  end function;
+
+  function expected_color(x : integer;
+                          y : integer;
+                          enable : std_logic;
+                          xpos : integer;
+                          ypos : integer;
+                          partial_alpha : boolean) return std_logic_vector is
+  begin
+    if enable = '1' and x >= xpos and x < xpos + 16 and y >= ypos and y < ypos + 16 then
+      return blend(sprite_pixel(x - xpos, y - ypos, partial_alpha), background(x, y));
+    end if;
+    return x"ff" & background(x, y)(23 downto 0);
+  end function;
+begin
+  vid_sprite_0: entity work.vid_sprite
+    generic map (
+      X_COORD_BITS => s_raster_x'length,
+      Y_COORD_BITS => s_raster_y'length,
+      LOG2_READ_WORDS => C_LOG2_READ_WORDS,
+      COLOR_DELAY => C_COLOR_DELAY
+    )
+    port map (
+      i_rst => s_rst,
+      i_clk => s_clk,
+      i_raster_x => s_raster_x,
+      i_raster_y => s_raster_y,
+      i_enable => s_enable,
+      i_addr => s_addr,
+      i_xpos => s_xpos,
+      i_ypos => s_ypos,
+      o_read_en => s_read_en,
+      o_read_adr => s_read_adr,
+      i_read_ack => s_read_ack,
+      i_read_dat => s_read_dat,
+      i_color => s_color,
+      o_color => s_out_color
+    );
+
+  -- Clock generator.
+  process
+  begin
+    while not s_done loop
+      s_clk <= '0';
+      wait for C_CLK_HALF_PERIOD;
+      s_clk <= '1';
+      wait for C_CLK_HALF_PERIOD;
+    end loop;
+    wait;
+  end process;
+
+  -- Raster generator (the raster position of the output pixels is delayed C_CHECK_DELAY cycles).
+  raster : process(s_clk, s_rst)
+  begin
+    if s_rst = '1' then
+      s_x <= C_X_FIRST;
+      s_y <= C_Y_FIRST;
+      s_cycle <= 0;
+      s_pos_delay <= (others => (valid => false, x => 0, y => 0));
+    elsif rising_edge(s_clk) then
+      if s_x = C_X_LAST then
+        s_x <= C_X_FIRST;
+        if s_y = C_Y_LAST then
+          s_y <= C_Y_FIRST;
+        else
+          s_y <= s_y + 1;
+        end if;
+      else
+        s_x <= s_x + 1;
+      end if;
+      s_cycle <= s_cycle + 1;
+
+      s_pos_delay(1) <= (valid => s_cycle < C_FRAME_CYCLES, x => s_x, y => s_y);
+      for k in 2 to C_CHECK_DELAY loop
+        s_pos_delay(k) <= s_pos_delay(k-1);
+      end loop;
+    end if;
+  end process;
+
+  s_raster_x <= std_logic_vector(to_signed(s_x, s_raster_x'length));
+  s_raster_y <= std_logic_vector(to_signed(s_y, s_raster_y'length));
+  s_color <= background(s_pos_delay(C_COLOR_DELAY).x, s_pos_delay(C_COLOR_DELAY).y);
+
+  -- VRAM model (every read request is acknowledged in the next cycle).
+  vram : process(s_clk)
+    variable v_adr : natural;
+  begin
+    if rising_edge(s_clk) then
+      v_adr := to_integer(unsigned(s_read_adr)) * 2**C_LOG2_READ_WORDS;
+      for k in 0 to 2**C_LOG2_READ_WORDS-1 loop
+        s_read_dat(k*32+31 downto k*32) <= mem_word(v_adr + k, s_partial_alpha);
+      end loop;
+      s_read_ack <= s_read_en;
+    end if;
+  end process;
+
+  -- Check the output pixels, and count the VRAM reads.
+  checker : process(s_clk, s_rst)
+    variable v_pos : T_POS;
+  begin
+    if s_rst = '1' then
+      s_num_pixels <= 0;
+      s_num_reads <= 0;
+    elsif rising_edge(s_clk) then
+      v_pos := s_pos_delay(C_CHECK_DELAY);
+      if v_pos.valid then
+        check_equal(s_out_color,
+                    expected_color(v_pos.x,
+                                   v_pos.y,
+                                   s_enable,
+                                   to_integer(signed(s_xpos)),
+                                   to_integer(signed(s_ypos)),
+                                   s_partial_alpha),
+                    "Pixel (" & integer'image(v_pos.x) & ", " & integer'image(v_pos.y) & ")");
+        s_num_pixels <= s_num_pixels + 1;
+      end if;
+      if s_read_en = '1' and s_cycle < C_FRAME_CYCLES then
+        s_num_reads <= s_num_reads + 1;
+      end if;
+    end if;
+  end process;
+
+  main : process
+    procedure run_frame(enable : std_logic;
+                        xpos : integer;
+                        ypos : integer;
+                        partial_alpha : boolean := false) is
+      variable v_lines : natural;
+    begin
+      s_enable <= enable;
+      s_partial_alpha <= partial_alpha;
+      s_xpos <= std_logic_vector(to_signed(xpos, 16));
+      s_ypos <= std_logic_vector(to_signed(ypos, 16));
+
+      s_rst <= '1';
+      wait for 4 * C_CLK_HALF_PERIOD;
+      wait until rising_edge(s_clk);
+      s_rst <= '0';
+      for k in 1 to C_FRAME_CYCLES + C_CHECK_DELAY + 2 loop
+        wait until rising_edge(s_clk);
+      end loop;
+
+      -- Each covered line is fetched as 16 / 2^LOG2_READ_WORDS row reads.
+      v_lines := 0;
+      if enable = '1' then
+        for y in C_Y_FIRST to C_Y_LAST loop
+          if y >= ypos and y < ypos + 16 then
+            v_lines := v_lines + 1;
+          end if;
+        end loop;
+      end if;
+      check_equal(s_num_pixels, C_FRAME_CYCLES, "Checked pixels");
+      check_equal(s_num_reads, v_lines * (16 / 2**C_LOG2_READ_WORDS), "VRAM reads");
+    end procedure;
+  begin
+    test_runner_setup(runner, runner_cfg);
+
+    s_addr <= std_logic_vector(to_unsigned(C_SPRITE_ADDR, 24));
+
+    while test_suite loop
+      if run("inside") then
+        run_frame('1', 10, 2);
+      elsif run("clipped_top_left") then
+        run_frame('1', -5, -3);
+      elsif run("clipped_bottom_right") then
+        run_frame('1', 40, 12);
+      elsif run("partial_alpha") then
+        run_frame('1', 10, 2, true);
+      elsif run("disabled") then
+        run_frame('0', 10, 2);
+      end if;
+    end loop;
+
+    s_done <= true;
+    test_runner_cleanup(runner);
+  end process;
+end architecture;
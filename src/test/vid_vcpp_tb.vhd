@@ -94,6 +94,35 @@ begin
         X"20000000"   -- RTS
     );
 
+    -- A VCPP program for testing loops (self checking, see below).
+    constant loop_program : program_array := (
+        X"90000003",  -- SETLC 3
+        X"b0000001",  -- WAITYR 1             (addr: 0x0001)
+        X"80000100",  -- SETREG 0, 0x000100
+        X"a0000001",  -- LOOP 0x000001
+        X"90000000",  -- SETLC 0
+        X"81000001",  -- SETREG 1, 0x000001   (addr: 0x0005)
+        X"a0000005",  -- LOOP 0x000005
+        X"82000002",  -- SETREG 2, 0x000002
+        X"50007fff"   -- WAITY 32767 (end)
+    );
+
+    -- The expected register writes of the loop program, and the raster line at which they are
+    -- expected to happen.
+    type loop_write_type is record
+      write_addr : std_logic_vector(7 downto 0);
+      write_data : std_logic_vector(31 downto 0);
+      raster_y : integer;
+    end record;
+    type loop_write_array is array (natural range <>) of loop_write_type;
+    constant loop_writes : loop_write_array := (
+        (X"00", X"00000100", 1),
+        (X"00", X"00000100", 2),
+        (X"00", X"00000100", 3),
+        (X"01", X"00000001", 3),
+        (X"02", X"00000002", 3)
+      );
+
     -- The patterns to apply.
     type pattern_type is record
       -- Inputs.
@@ -258,59 +287,129 @@ begin
         )
       );
     variable v_write_en : std_logic;
+    variable v_read_en : std_logic;
+    variable v_read_addr : integer;
+    variable v_num_writes : integer;
   begin
     test_runner_setup(runner, runner_cfg);
 
     -- Continue running even if we have failures (for easier debugging).
     set_stop_level(failure);
 
-    -- Start by resetting the signals.
-    s_rst <= '1';
-    s_clk <= '0';
-    s_restart_frame <= '0';
-    s_raster_x <= (others => '0');
-    s_raster_y <= (others => '0');
-    s_mem_data <= (others => '1');
-    s_mem_ack <= '0';
+    while test_suite loop
+      if run("patterns") then
+        -- Start by resetting the signals.
+        s_rst <= '1';
+        s_clk <= '0';
+        s_restart_frame <= '0';
+        s_raster_x <= (others => '0');
+        s_raster_y <= (others => '0');
+        s_mem_data <= (others => '1');
+        s_mem_ack <= '0';
+
+        wait for 0.5 ps;
+        s_clk <= '1';
+        wait for 0.5 ps;
+        s_rst <= '0';
+        s_clk <= '0';
+        wait for 0.5 ps;
+        s_clk <= '1';
+
+        -- Test all the patterns in the pattern array.
+        for i in patterns'range loop
+          wait until s_clk = '1';
+
+          --  Set the inputs.
+          s_restart_frame <= patterns(i).restart_frame;
+          s_raster_x <= patterns(i).raster_x;
+          s_raster_y <= patterns(i).raster_y;
+          s_mem_ack <= patterns(i).mem_ack;
+
+          -- Read the memory.
+          s_mem_data <= program(to_integer(unsigned(s_mem_read_addr))) when patterns(i).mem_ack = '1' else
+                        X"ffffffff";
+
+          -- Wait for the result to be produced.
+          wait for 0.5 ps;
+
+          --  Check the outputs.
+          v_write_en := patterns(i).reg_write_enable or patterns(i).pal_write_enable;
+          check(s_mem_read_en = patterns(i).mem_read_en, "mem_read_en is incorrect");
+          check(patterns(i).mem_read_en = '0' or s_mem_read_addr = patterns(i).mem_read_addr, "mem_read_addr is incorrect");
+          check(s_reg_write_enable = patterns(i).reg_write_enable, "reg_write_enable is incorrect");
+          check(s_pal_write_enable = patterns(i).pal_write_enable, "pal_write_enable is incorrect");
+          check(v_write_en = '0' or s_write_addr = patterns(i).write_addr, "write_addr is incorrect");
+          check(v_write_en = '0' or s_write_data = patterns(i).write_data, "write_data is incorrect");
+
+          -- Tick the clock.
+          s_clk <= '0';
+          wait for 0.5 ps;
+          s_clk <= '1';
+        end loop;
+      elsif run("loops") then
+        -- Reset.
+        s_rst <= '1';
+        s_clk <= '0';
+        s_restart_frame <= '0';
+        s_raster_x <= (others => '0');
+        s_raster_y <= (others => '0');
+        s_mem_data <= (others => '1');
+        s_mem_ack <= '0';
+
+        wait for 0.5 ps;
+        s_clk <= '1';
+        wait for 0.5 ps;
+        s_rst <= '0';
+        s_clk <= '0';
+        wait for 0.5 ps;
+        s_clk <= '1';
 
-    wait for 0.5 ps;
-    s_clk <= '1';
-    wait for 0.5 ps;
-    s_rst <= '0';
-    s_clk <= '0';
-    wait for 0.5 ps;
-    s_clk <= '1';
+        -- Run the loop program for a few raster lines. The memory responds to every read request
+        -- during the following cycle, and each raster line is 16 cycles long.
+        v_num_writes := 0;
+        for i in 0 to 16*6-1 loop
+          wait until s_clk = '1';
 
-    -- Test all the patterns in the pattern array.
-    for i in patterns'range loop
-      wait until s_clk = '1';
+          -- Respond to the memory request from the previous cycle.
+          v_read_en := s_mem_read_en;
+          v_read_addr := to_integer(unsigned(s_mem_read_addr));
+          s_mem_ack <= v_read_en;
+          if v_read_en = '1' and v_read_addr <= loop_program'high then
+            s_mem_data <= loop_program(v_read_addr);
+          elsif v_read_en = '1' then
+            s_mem_data <= X"30000000";  -- NOP
+          else
+            s_mem_data <= X"ffffffff";
+          end if;
 
-      --  Set the inputs.
-      s_restart_frame <= patterns(i).restart_frame;
-      s_raster_x <= patterns(i).raster_x;
-      s_raster_y <= patterns(i).raster_y;
-      s_mem_ack <= patterns(i).mem_ack;
+          -- Advance the raster position.
+          s_raster_x <= std_logic_vector(to_unsigned(i mod 16, 4));
+          s_raster_y <= std_logic_vector(to_unsigned(i / 16, 4));
 
-      -- Read the memory.
-      s_mem_data <= program(to_integer(unsigned(s_mem_read_addr))) when patterns(i).mem_ack = '1' else
-                    X"ffffffff";
+          wait for 0.5 ps;
 
-      -- Wait for the result to be produced.
-      wait for 0.5 ps;
+          -- Check the register writes.
+          check(s_pal_write_enable = '0', "pal_write_enable is incorrect");
+          if s_reg_write_enable = '1' then
+            if v_num_writes <= loop_writes'high then
+              check(s_write_addr = loop_writes(v_num_writes).write_addr,
+                    "write_addr is incorrect");
+              check(s_write_data = loop_writes(v_num_writes).write_data,
+                    "write_data is incorrect");
+              check(to_integer(unsigned(s_raster_y)) = loop_writes(v_num_writes).raster_y,
+                    "register written at the wrong raster line");
+            end if;
+            v_num_writes := v_num_writes + 1;
+          end if;
 
-      --  Check the outputs.
-      v_write_en := patterns(i).reg_write_enable or patterns(i).pal_write_enable;
-      check(s_mem_read_en = patterns(i).mem_read_en, "mem_read_en is incorrect");
-      check(patterns(i).mem_read_en = '0' or s_mem_read_addr = patterns(i).mem_read_addr, "mem_read_addr is incorrect");
-      check(s_reg_write_enable = patterns(i).reg_write_enable, "reg_write_enable is incorrect");
-      check(s_pal_write_enable = patterns(i).pal_write_enable, "pal_write_enable is incorrect");
-      check(v_write_en = '0' or s_write_addr = patterns(i).write_addr, "write_addr is incorrect");
-      check(v_write_en = '0' or s_write_data = patterns(i).write_data, "write_data is incorrect");
+          -- Tick the clock.
+          s_clk <= '0';
+          wait for 0.5 ps;
+          s_clk <= '1';
+        end loop;
 
-      -- Tick the clock.
-      s_clk <= '0';
-      wait for 0.5 ps;
-      s_clk <= '1';
+        check(v_num_writes = loop_writes'length, "incorrect number of register writes");
+      end if;
     end loop;
 
     test_runner_cleanup(runner);
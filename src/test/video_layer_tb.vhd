@@ -0,0 +1,258 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- This is a test bench for the palette banks of a video layer. A VCP program writes a new palette
+-- to bank 1 (in the middle of a visible line) while bank 0 is displayed, and then flips PALBANK so
+-- that bank 1 is displayed from a later line. Every visible output pixel is compared against the
+-- expected color of the displayed bank.
+----------------------------------------------------------------------------------------------------
+
+library vunit_lib;
+context vunit_lib.vunit_context;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.vid_types.all;
+
+entity video_layer_tb is
+  generic (runner_cfg : string);
+end entity;
+
+architecture tb of video_layer_tb is
+  constant C_CLK_HALF_PERIOD : time := 5 ns;
+
+  constant C_LOG2_READ_WORDS : natural := 1;
+  constant C_CHECK_DELAY : positive := C_VID_PIXEL_DELAY;
+
+  -- A small raster (160x10 pixels, of which 48x8 are visible, i.e. x >= 0 and y >= 0). The
+  -- horizontal blanking interval is long enough for filling the line FIFO.
+  constant C_X_FIRST : integer := -112;
+  constant C_X_LAST : integer := 47;
+  constant C_Y_FIRST : integer := -2;
+  constant C_Y_LAST : integer := 7;
+  constant C_FRAME_CYCLES : positive := (C_X_LAST - C_X_FIRST + 1) * (C_Y_LAST - C_Y_FIRST + 1);
+
+  -- The first line that displays palette bank 1.
+  constant C_FLIP_Y : natural := 4;
+
+  -- VRAM word addresses of the VCP and the pixels (PAL8, every other pixel is color 0 and 1).
+  constant C_VCP_ADDR : natural := 16;
+  constant C_PIXELS_ADDR : natural := 256;
+  constant C_PIXELS_WORD : std_logic_vector(31 downto 0) := x"01000100";
+
+  -- The palette colors of bank 0 and bank 1.
+  constant C_BANK0_COLOR0 : std_logic_vector(31 downto 0) := x"ff0000a0";
+  constant C_BANK0_COLOR1 : std_logic_vector(31 downto 0) := x"ff0000a1";
+  constant C_BANK1_COLOR0 : std_logic_vector(31 downto 0) := x"ff00b000";
+  constant C_BANK1_COLOR1 : std_logic_vector(31 downto 0) := x"ff00b100";
+
+  type T_PROGRAM is array (natural range <>) of std_logic_vector(31 downto 0);
+  constant C_PROGRAM : T_PROGRAM := (
+      x"89000000",      -- SETREG PALBANK, 0x000000 (write bank 0, display bank 0)
+      x"60000001",      -- SETPAL 0, 2
+      C_BANK0_COLOR0,   --   PAL #0
+      C_BANK0_COLOR1,   --   PAL #1
+      x"80000100",      -- SETREG ADDR, C_PIXELS_ADDR
+      x"82010000",      -- SETREG XINCR, 1.0
+      x"83000000",      -- SETREG HSTRT, 0
+      x"84000030",      -- SETREG HSTOP, 48
+      x"85000002",      -- SETREG CMODE, PAL8
+      x"50000001",      -- WAITY 1
+      x"40000008",      -- WAITX 8 (in the middle of the line)
+      x"89000100",      -- SETREG PALBANK, 0x000100 (write bank 1, display bank 0)
+      x"60000001",      -- SETPAL 0, 2
+      C_BANK1_COLOR0,   --   PAL #0
+      C_BANK1_COLOR1,   --   PAL #1
+      x"50000004",      -- WAITY C_FLIP_Y
+      x"89000101",      -- SETREG PALBANK, 0x000101 (write bank 1, display bank 1)
+      x"50007fff"       -- WAITY 32767 (end)
+    );
+
+  type T_POS is record
+    valid : boolean;
+    x : integer;
+    y : integer;
+  end record;
+  type T_POS_DELAY is array (1 to C_CHECK_DELAY) of T_POS;
+
+  signal s_rst : std_logic;
+  signal s_clk : std_logic;
+  signal s_done : boolean := false;
+
+  signal s_x : integer;
+  signal s_y : integer;
+  signal s_cycle : natural;
+  signal s_pos_delay : T_POS_DELAY;
+
+  signal s_restart_frame : std_logic;
+  signal s_raster_x : std_logic_vector(11 downto 0);
+  signal s_raster_y : std_logic_vector(11 downto 0);
+  signal s_read_en : std_logic;
+  signal s_read_urgent : std_logic;
+  signal s_read_adr : std_logic_vector(23 downto 0);
+  signal s_read_ack : std_logic;
+  signal s_read_dat : std_logic_vector(32*(2**C_LOG2_READ_WORDS)-1 downto 0);
+  signal s_underrun : std_logic;
+  signal s_rmode : std_logic_vector(23 downto 0);
+  signal s_color : std_logic_vector(31 downto 0);
+
+  function mem_word(adr : natural) return std_logic_vector is
+  begin
+    if adr >= C_VCP_ADDR and adr < C_VCP_ADDR + C_PROGRAM'length then
+      return C_PROGRAM(adr - C_VCP_ADDR);
+    elsif adr >= C_PIXELS_ADDR and adr < C_PIXELS_ADDR + 256 then
+      return C_PIXELS_WORD;
+    end if;
+    return x"deadbeef";
+  end function;
+
+  function expected_color(x : integer; y : integer) return std_logic_vector is
+  begin
+    if y < C_FLIP_Y then
+      if x mod 2 = 0 then
+        return C_BANK0_COLOR0;
+      end if;
+      return C_BANK0_COLOR1;
+    end if;
+    if x mod 2 = 0 then
+      return C_BANK1_COLOR0;
+    end if;
+    return C_BANK1_COLOR1;
+  end function;
+begin
+  video_layer_0: entity work.video_layer
+    generic map (
+      X_COORD_BITS => s_raster_x'length,
+      Y_COORD_BITS => s_raster_y'length,
+      VCP_START_ADDRESS => std_logic_vector(to_unsigned(C_VCP_ADDR, 24)),
+      LOG2_PALETTE_BANKS => 1,
+      LOG2_READ_WORDS => C_LOG2_READ_WORDS
+    )
+    port map (
+      i_rst => s_rst,
+      i_clk => s_clk,
+      i_restart_frame => s_restart_frame,
+      i_raster_x => s_raster_x,
+      i_raster_y => s_raster_y,
+      o_read_en => s_read_en,
+      o_read_urgent => s_read_urgent,
+      o_read_adr => s_read_adr,
+      i_read_grant => s_read_en,
+      i_read_ack => s_read_ack,
+      i_read_dat => s_read_dat,
+      o_underrun => s_underrun,
+      o_rmode => s_rmode,
+      o_color => s_color
+    );
+
+  -- Clock generator.
+  process
+  begin
+    while not s_done loop
+      s_clk <= '0';
+      wait for C_CLK_HALF_PERIOD;
+      s_clk <= '1';
+      wait for C_CLK_HALF_PERIOD;
+    end loop;
+    wait;
+  end process;
+
+  -- Raster generator (the raster position of the output pixels is delayed C_CHECK_DELAY cycles).
+  raster : process(s_clk, s_rst)
+  begin
+    if s_rst = '1' then
+      s_x <= C_X_FIRST;
+      s_y <= C_Y_FIRST;
+      s_cycle <= 0;
+      s_pos_delay <= (others => (valid => false, x => 0, y => 0));
+    elsif rising_edge(s_clk) then
+      if s_x = C_X_LAST then
+        s_x <= C_X_FIRST;
+        if s_y = C_Y_LAST then
+          s_y <= C_Y_FIRST;
+        else
+          s_y <= s_y + 1;
+        end if;
+      else
+        s_x <= s_x + 1;
+      end if;
+      s_cycle <= s_cycle + 1;
+
+      s_pos_delay(1) <= (valid => s_cycle < C_FRAME_CYCLES, x => s_x, y => s_y);
+      for k in 2 to C_CHECK_DELAY loop
+        s_pos_delay(k) <= s_pos_delay(k-1);
+      end loop;
+    end if;
+  end process;
+
+  s_raster_x <= std_logic_vector(to_signed(s_x, s_raster_x'length));
+  s_raster_y <= std_logic_vector(to_signed(s_y, s_raster_y'length));
+
+  -- The frame restarts at the first raster position (as in vid_raster).
+  s_restart_frame <= '1' when s_x = C_X_FIRST and s_y = C_Y_FIRST else '0';
+
+  -- VRAM model (every read is granted immediately, and acknowledged in the next cycle).
+  vram : process(s_clk)
+    variable v_adr : natural;
+  begin
+    if rising_edge(s_clk) then
+      v_adr := to_integer(unsigned(s_read_adr)) * 2**C_LOG2_READ_WORDS;
+      for k in 0 to 2**C_LOG2_READ_WORDS-1 loop
+        s_read_dat(k*32+31 downto k*32) <= mem_word(v_adr + k);
+      end loop;
+      s_read_ack <= s_read_en;
+    end if;
+  end process;
+
+  main : process
+    variable v_pos : T_POS;
+    variable v_num_pixels : natural;
+  begin
+    test_runner_setup(runner, runner_cfg);
+
+    while test_suite loop
+      if run("palette_banks") then
+        v_num_pixels := 0;
+        s_rst <= '1';
+        wait for 4 * C_CLK_HALF_PERIOD;
+        wait until rising_edge(s_clk);
+        s_rst <= '0';
+
+        -- Check the visible output pixels.
+        for k in 1 to C_FRAME_CYCLES + C_CHECK_DELAY + 2 loop
+          wait until rising_edge(s_clk);
+          v_pos := s_pos_delay(C_CHECK_DELAY);
+          if v_pos.valid and v_pos.x >= 0 and v_pos.y >= 0 then
+            check_equal(s_color,
+                        expected_color(v_pos.x, v_pos.y),
+                        "Pixel (" & integer'image(v_pos.x) & ", " & integer'image(v_pos.y) & ")");
+            v_num_pixels := v_num_pixels + 1;
+          end if;
+          check_equal(s_underrun, '0', "Line FIFO underrun");
+        end loop;
+
+        check_equal(v_num_pixels, (C_X_LAST + 1) * (C_Y_LAST + 1), "Checked pixels");
+      end if;
+    end loop;
+
+    s_done <= true;
+    test_runner_cleanup(runner);
+  end process;
+end architecture;
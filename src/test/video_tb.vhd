@@ -27,18 +27,44 @@ use std.textio.all;
 use work.vid_types.all;
 
 entity video_tb is
-  generic (runner_cfg : string);
+  generic (
+    runner_cfg : string;
+
+    -- Folder with the golden images and scanline statistics (no comparison if empty).
+    golden_dir : string := "";
+
+    -- Write the results to golden_dir instead of comparing against them.
+    update_golden : boolean := false
+  );
 end entity;
 
 architecture tb of video_tb is
   constant C_ADR_BITS : positive := 16;
   constant C_VRAM_WORDS : positive := 2**C_ADR_BITS;
+  constant C_LOG2_READ_WORDS : natural := 1;  -- 64-bit video read port.
+  constant C_NUM_LAYERS : positive := 2;
+  constant C_VIDEO_CONFIG : T_VIDEO_CONFIG := C_1920_1080;
+
+  -- Raster geometry (see vid_raster).
+  constant C_TOTAL_WIDTH : integer := C_VIDEO_CONFIG.width + C_VIDEO_CONFIG.front_porch_h +
+                                      C_VIDEO_CONFIG.sync_width_h + C_VIDEO_CONFIG.back_porch_h;
+  constant C_TOTAL_HEIGHT : integer := C_VIDEO_CONFIG.height + C_VIDEO_CONFIG.front_porch_v +
+                                       C_VIDEO_CONFIG.sync_width_v + C_VIDEO_CONFIG.back_porch_v;
+  constant C_X_START : integer := C_VIDEO_CONFIG.width - C_TOTAL_WIDTH;
+  constant C_Y_START : integer := C_VIDEO_CONFIG.height - C_TOTAL_HEIGHT;
 
   -- (640 + hblank) x (480 + vblank) = 420000 cycles
   -- (800 + hblank) x (600 + vblank) = 663168 cycles
   -- (1280 + hblank) x (720 + vblank) = 1237500 cycles
   -- (1920 + hblank) x (1080 + vblank) = 2475000 cycles
-  constant C_TEST_CYCLES : integer := 2475000;
+  constant C_FRAME_CYCLES : integer := C_TOTAL_WIDTH * C_TOTAL_HEIGHT;
+
+  -- Number of frames to capture and profile. The first frame after reset is not necessarily
+  -- identical to the following frames, so we check more than one.
+  constant C_NUM_FRAMES : positive := 2;
+
+  -- Upper limit for the number of cycles to run (with some slack for the pipeline delay).
+  constant C_TEST_CYCLES : integer := C_NUM_FRAMES * C_FRAME_CYCLES + 1000;
 
   --  25.175 MHz -> 19.8609732 ns
   --  40.000 MHz -> 12.5 ns
@@ -55,22 +81,39 @@ architecture tb of video_tb is
 
   signal s_rst : std_logic;
   signal s_clk : std_logic;
-  signal s_read_adr : std_logic_vector(C_ADR_BITS-1 downto 0);
-  signal s_read_dat : std_logic_vector(31 downto 0);
+  signal s_read_adr : std_logic_vector(C_ADR_BITS-C_LOG2_READ_WORDS-1 downto 0);
+  signal s_read_dat : std_logic_vector(32*(2**C_LOG2_READ_WORDS)-1 downto 0);
   signal s_r : std_logic_vector(3 downto 0);
   signal s_g : std_logic_vector(3 downto 0);
   signal s_b : std_logic_vector(3 downto 0);
   signal s_hsync : std_logic;
   signal s_vsync : std_logic;
+
+  signal s_capture_done : std_logic := '0';
+  signal s_profile_done : std_logic := '0';
+
+  -- File I/O.
+  type T_CHAR_FILE is file of character;
+
+  -- Helper function for getting the path to a result file.
+  function result_path(name : string) return string is
+  begin
+    if update_golden then
+      return golden_dir & "/" & name;
+    else
+      return "vunit_out/" & name;
+    end if;
+  end function;
 begin
   video_0: entity work.video
     generic map(
       COLOR_BITS_R => s_r'length,
       COLOR_BITS_G => s_g'length,
       COLOR_BITS_B => s_b'length,
-      ADR_BITS => s_read_adr'length,
-      NUM_LAYERS => 2,
-      VIDEO_CONFIG => C_1920_1080
+      ADR_BITS => C_ADR_BITS,
+      NUM_LAYERS => C_NUM_LAYERS,
+      LOG2_READ_WORDS => C_LOG2_READ_WORDS,
+      VIDEO_CONFIG => C_VIDEO_CONFIG
     )
     port map(
       i_rst => s_rst,
@@ -86,7 +129,8 @@ begin
 
   vram_1: entity work.vram
     generic map (
-      ADR_BITS => s_read_adr'length
+      ADR_BITS => C_ADR_BITS,
+      LOG2_READ_WORDS => C_LOG2_READ_WORDS
     )
     port map (
       i_rst => '0',
@@ -107,8 +151,6 @@ begin
     );
 
   main : process
-    -- File I/O.
-    type T_CHAR_FILE is file of character;
     file f_char_file : T_CHAR_FILE;
 
       -- Helper function for reading one word from a binary file.
@@ -202,9 +244,11 @@ begin
     s_clk <= '0';
     wait for C_CLK_HALF_PERIOD;
 
-    -- Run a lot of cycles...
+    -- Run until all the frames have been captured and profiled. The raw output of the first frame
+    -- (including the blanking areas) is written to a file too.
     file_open(f_char_file, "vunit_out/video_tb_output.data", WRITE_MODE);
     for i in 0 to C_TEST_CYCLES-1 loop
+      exit when s_capture_done = '1' and s_profile_done = '1';
       -- Construct a word from the generated RGB output.
       -- We inject hsync and vsync into the color channels for visualization.
       v_rgb_word(31 downto 24) := 8x"ff";
@@ -221,7 +265,9 @@ begin
       end if;
 
       -- Write the word to the output file.
-      write_word(f_char_file, v_rgb_word);
+      if i < C_FRAME_CYCLES then
+        write_word(f_char_file, v_rgb_word);
+      end if;
 
       -- Tick the clock.
       s_clk <= '1';
@@ -231,6 +277,264 @@ begin
     end loop;
     file_close(f_char_file);
 
+    check(s_capture_done = '1', "Not all frames were captured");
+    check(s_profile_done = '1', "Not all frames were profiled");
+
     test_runner_cleanup(runner);
   end process;
+
+  -- Capture the visible area of each frame to a PPM file, and compare it against the golden image.
+  capture : process
+    file f_frame : T_CHAR_FILE;
+    file f_golden : T_CHAR_FILE;
+
+    -- Helper procedure for writing a string to a binary file.
+    procedure write_string(file f : T_CHAR_FILE; str : string) is
+    begin
+      for i in str'range loop
+        write(f, str(i));
+      end loop;
+    end procedure;
+
+    -- Helper function for reading a string from a binary file (shorter at the end of the file).
+    impure function read_string(file f : T_CHAR_FILE; len : natural) return string is
+      variable v_str : string(1 to len);
+      variable v_len : natural := 0;
+    begin
+      while v_len < len and not endfile(f) loop
+        v_len := v_len + 1;
+        read(f, v_str(v_len));
+      end loop;
+      return v_str(1 to v_len);
+    end function;
+
+    -- Convert a color component to an 8-bit PPM sample (replicating the bits, as in the output
+    -- data file).
+    function to_sample(c : std_logic_vector) return character is
+      variable v_sample : std_logic_vector(7 downto 0);
+    begin
+      for i in 0 to 7 loop
+        v_sample(7 - i) := c(c'left - (i mod c'length));
+      end loop;
+      return character'val(to_integer(unsigned(v_sample)));
+    end function;
+
+    constant C_HEADER : string := "P6" & LF & integer'image(C_VIDEO_CONFIG.width) & " " &
+                                  integer'image(C_VIDEO_CONFIG.height) & LF & "255" & LF;
+
+    variable v_status : file_open_status;
+    variable v_has_golden : boolean;
+    variable v_frame : natural := 0;
+    variable v_idx : integer := -1;
+    variable v_x : integer;
+    variable v_y : integer;
+    variable v_prev_hsync : std_logic := not C_VIDEO_CONFIG.polarity_h;
+    variable v_pixel : string(1 to 3);
+    variable v_mismatches : natural;
+  begin
+    while v_frame < C_NUM_FRAMES loop
+      wait until rising_edge(s_clk) and s_rst = '0';
+
+      -- The output is delayed by the video pipeline, so we synchronize to the first hsync pulse,
+      -- which starts at a known raster position (after the front porch of the first line).
+      if v_idx < 0 then
+        if s_hsync = C_VIDEO_CONFIG.polarity_h and v_prev_hsync /= C_VIDEO_CONFIG.polarity_h then
+          v_idx := C_VIDEO_CONFIG.front_porch_h;
+        end if;
+        v_prev_hsync := s_hsync;
+      else
+        v_idx := (v_idx + 1) mod C_FRAME_CYCLES;
+      end if;
+
+      if v_idx >= 0 then
+        v_x := (v_idx mod C_TOTAL_WIDTH) + C_X_START;
+        v_y := (v_idx / C_TOTAL_WIDTH) + C_Y_START;
+        if v_x >= 0 and v_x < C_VIDEO_CONFIG.width and v_y >= 0 and
+           v_y < C_VIDEO_CONFIG.height then
+          -- Start of a new frame?
+          if v_x = 0 and v_y = 0 then
+            file_open(f_frame,
+                      result_path("video_tb_frame" & integer'image(v_frame) & ".ppm"),
+                      WRITE_MODE);
+            write_string(f_frame, C_HEADER);
+            v_has_golden := false;
+            if golden_dir'length > 0 and not update_golden then
+              file_open(v_status,
+                        f_golden,
+                        golden_dir & "/video_tb_frame" & integer'image(v_frame) & ".ppm",
+                        READ_MODE);
+              if v_status = OPEN_OK then
+                v_has_golden := true;
+                check(read_string(f_golden, C_HEADER'length) = C_HEADER,
+                      "Frame " & integer'image(v_frame) & ": Unexpected golden image header");
+              else
+                warning("Frame " & integer'image(v_frame) & ": No golden image");
+              end if;
+            end if;
+            v_mismatches := 0;
+          end if;
+
+          -- Write the pixel, and compare it against the golden image.
+          v_pixel := to_sample(s_r) & to_sample(s_g) & to_sample(s_b);
+          write_string(f_frame, v_pixel);
+          if v_has_golden then
+            if read_string(f_golden, 3) /= v_pixel then
+              v_mismatches := v_mismatches + 1;
+            end if;
+          end if;
+
+          -- End of the frame?
+          if v_x = C_VIDEO_CONFIG.width-1 and v_y = C_VIDEO_CONFIG.height-1 then
+            file_close(f_frame);
+            if v_has_golden then
+              file_close(f_golden);
+              check(v_mismatches = 0,
+                    "Frame " & integer'image(v_frame) & ": " & integer'image(v_mismatches) &
+                    " pixels differ from the golden image");
+            end if;
+            v_frame := v_frame + 1;
+          end if;
+        end if;
+      end if;
+    end loop;
+
+    s_capture_done <= '1';
+    wait;
+  end process;
+
+  -- Log per-scanline VRAM video port statistics, and compare them against the golden statistics.
+  -- The counters are sampled inside the video logic (with VHDL-2008 external names), and each line
+  -- is logged when the raster moves on to the next line (i.e. in raster time, not output time).
+  profile : process
+    alias a_raster_y is <<signal .video_tb.video_0.s_raster_y : std_logic_vector(11 downto 0)>>;
+    alias a_layer_read_grant is
+        <<signal .video_tb.video_0.s_layer_read_grant : std_logic_vector(1 to C_NUM_LAYERS)>>;
+    alias a_layer1_vcpp_ack is
+        <<signal .video_tb.video_0.LayerGen(1).video_layer_1.s_vcpp_mem_ack : std_logic>>;
+    alias a_layer2_vcpp_ack is
+        <<signal .video_tb.video_0.LayerGen(2).video_layer_1.s_vcpp_mem_ack : std_logic>>;
+    alias a_layer1_fifo_ack is
+        <<signal .video_tb.video_0.LayerGen(1).video_layer_1.s_fifo_pix_ack : std_logic>>;
+    alias a_layer2_fifo_ack is
+        <<signal .video_tb.video_0.LayerGen(2).video_layer_1.s_fifo_pix_ack : std_logic>>;
+    alias a_layer_underrun is
+        <<signal .video_tb.video_0.s_layer_underrun : std_logic_vector(1 to C_NUM_LAYERS)>>;
+
+    file f_stats : text;
+    file f_golden : text;
+
+    variable v_status : file_open_status;
+    variable v_has_golden : boolean := false;
+    variable v_line : line;
+    variable v_golden_line : line;
+    variable v_mismatches : natural := 0;
+
+    variable v_frame : natural := 0;
+    variable v_y : integer;
+    variable v_port_reads : natural := 0;
+    variable v_layer1_reads : natural := 0;
+    variable v_layer2_reads : natural := 0;
+    variable v_vcpp_fetches : natural := 0;
+    variable v_fifo_hits : natural := 0;
+    variable v_underruns : natural := 0;
+    variable v_total_underruns : natural := 0;
+
+    -- Write one line to the statistics file, and compare it against the golden statistics.
+    procedure emit_line is
+    begin
+      if v_has_golden then
+        if endfile(f_golden) then
+          v_mismatches := v_mismatches + 1;
+        else
+          readline(f_golden, v_golden_line);
+          if v_golden_line.all /= v_line.all then
+            v_mismatches := v_mismatches + 1;
+          end if;
+        end if;
+      end if;
+      writeline(f_stats, v_line);
+    end procedure;
+  begin
+    file_open(f_stats, result_path("video_tb_lines.csv"), WRITE_MODE);
+    if golden_dir'length > 0 and not update_golden then
+      file_open(v_status, f_golden, golden_dir & "/video_tb_lines.csv", READ_MODE);
+      if v_status = OPEN_OK then
+        v_has_golden := true;
+      else
+        warning("No golden scanline statistics");
+      end if;
+    end if;
+    write(v_line, string'("frame,line,port_reads,layer1_reads,layer2_reads,vcpp_fetches," &
+                          "fifo_hits,underruns"));
+    emit_line;
+
+    wait until rising_edge(s_clk) and s_rst = '0';
+    v_y := to_integer(signed(a_raster_y));
+    while v_frame < C_NUM_FRAMES loop
+      -- Count the VRAM video port requests, the VCPP fetches, and the pixel reads that hit the line
+      -- FIFOs (the successor of the pixel prefetch cache) or that underrun them during this cycle.
+      if a_layer_read_grant(2) = '1' then
+        v_port_reads := v_port_reads + 1;
+        v_layer2_reads := v_layer2_reads + 1;
+      elsif a_layer_read_grant(1) = '1' then
+        v_port_reads := v_port_reads + 1;
+        v_layer1_reads := v_layer1_reads + 1;
+      end if;
+      if a_layer1_vcpp_ack = '1' then
+        v_vcpp_fetches := v_vcpp_fetches + 1;
+      end if;
+      if a_layer2_vcpp_ack = '1' then
+        v_vcpp_fetches := v_vcpp_fetches + 1;
+      end if;
+      if a_layer1_fifo_ack = '1' then
+        v_fifo_hits := v_fifo_hits + 1;
+      end if;
+      if a_layer2_fifo_ack = '1' then
+        v_fifo_hits := v_fifo_hits + 1;
+      end if;
+      for k in 1 to C_NUM_LAYERS loop
+        if a_layer_underrun(k) = '1' then
+          v_underruns := v_underruns + 1;
+        end if;
+      end loop;
+
+      wait until rising_edge(s_clk);
+
+      -- Log the line when the raster moves on to the next line.
+      if to_integer(signed(a_raster_y)) /= v_y then
+        write(v_line, string'(integer'image(v_frame) & "," & integer'image(v_y) & "," &
+                              integer'image(v_port_reads) & "," &
+                              integer'image(v_layer1_reads) & "," &
+                              integer'image(v_layer2_reads) & "," &
+                              integer'image(v_vcpp_fetches) & "," &
+                              integer'image(v_fifo_hits) & "," &
+                              integer'image(v_underruns)));
+        emit_line;
+        v_port_reads := 0;
+        v_layer1_reads := 0;
+        v_layer2_reads := 0;
+        v_vcpp_fetches := 0;
+        v_fifo_hits := 0;
+        v_total_underruns := v_total_underruns + v_underruns;
+        v_underruns := 0;
+        v_y := to_integer(signed(a_raster_y));
+        if v_y = C_Y_START then
+          v_frame := v_frame + 1;
+        end if;
+      end if;
+    end loop;
+
+    file_close(f_stats);
+    check(v_total_underruns = 0,
+          integer'image(v_total_underruns) & " line FIFO underruns (not enough VRAM bandwidth)");
+    if v_has_golden then
+      check(endfile(f_golden), "More golden scanline statistics than expected");
+      file_close(f_golden);
+      check(v_mismatches = 0,
+            integer'image(v_mismatches) & " lines differ from the golden scanline statistics");
+    end if;
+
+    s_profile_done <= '1';
+    wait;
+  end process;
 end architecture;
@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+# -*- mode: python; tab-width: 4; indent-tabs-mode: nil; -*-
+# --------------------------------------------------------------------------------------------------
+# Copyright (c) 2022 Marcus Geelnard
+#
+# This software is provided 'as-is', without any express or implied warranty. In no event will the
+# authors be held liable for any damages arising from the use of this software.
+#
+# Permission is granted to anyone to use this software for any purpose, including commercial
+# applications, and to alter it and redistribute it freely, subject to the following restrictions:
+#
+#  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+#     the original software. If you use this software in a product, an acknowledgment in the
+#     product documentation would be appreciated but is not required.
+#
+#  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+#     being the original software.
+#
+#  3. This notice may not be removed or altered from any source distribution.
+# --------------------------------------------------------------------------------------------------
+
+# Fmax benchmark for the video logic, using an open source FPGA flow: GHDL + Yosys (via the
+# ghdl-yosys-plugin) for synthesis, and nextpnr-ecp5 for place and route. Each configuration (a set
+# of generics for fmax_top.vhd) is synthesized, placed and routed, and the achieved Fmax and the
+# resource usage are reported.
+#
+# The absolute numbers are for a Lattice ECP5 device, but the relative numbers between
+# configurations are a good indication of what to expect from other FPGA families too.
+
+import argparse
+import csv
+import json
+import os
+import subprocess
+import sys
+
+_THIS_DIR = os.path.dirname(os.path.abspath(__file__))
+_RTL_DIR = os.path.join(_THIS_DIR, '..', '..', 'rtl')
+
+# Source files, in compilation order.
+_SOURCES = [
+    os.path.join(_RTL_DIR, 'vid_types.vhd'),
+    os.path.join(_RTL_DIR, 'prng.vhd'),
+    os.path.join(_RTL_DIR, 'dither.vhd'),
+    os.path.join(_RTL_DIR, 'vid_raster.vhd'),
+    os.path.join(_RTL_DIR, 'vid_regs.vhd'),
+    os.path.join(_RTL_DIR, 'vid_palette.vhd'),
+    os.path.join(_RTL_DIR, 'vid_pixel.vhd'),
+    os.path.join(_RTL_DIR, 'vid_line_fifo.vhd'),
+    os.path.join(_RTL_DIR, 'vid_vcpp_stack.vhd'),
+    os.path.join(_RTL_DIR, 'vid_vcpp.vhd'),
+    os.path.join(_RTL_DIR, 'video_layer.vhd'),
+    os.path.join(_RTL_DIR, 'vid_blend.vhd'),
+    os.path.join(_RTL_DIR, 'vid_sprite.vhd'),
+    os.path.join(_RTL_DIR, 'video.vhd'),
+    os.path.join(_THIS_DIR, 'fmax_top.vhd'),
+]
+
+# Configuration keys (short name -> fmax_top generic).
+_GENERICS = {
+    'layers': 'NUM_LAYERS',
+    'words': 'LOG2_READ_WORDS',
+    'addr': 'PIXEL_ADDR_STAGES',
+    'shift': 'PIXEL_SHIFT_STAGES',
+    'blend': 'BLEND_MUL_STAGES',
+    'tile': 'TILE_MODE',
+}
+
+# Default configurations (two layers with increasing pipeline depth, tile mode, and four layers).
+_DEFAULT_CONFIGS = [
+    'layers=2',
+    'layers=2,addr=1',
+    'layers=2,addr=1,shift=1',
+    'layers=2,addr=1,shift=1,blend=1',
+    'layers=2,addr=2,shift=1,blend=2',
+    'layers=2,tile=1',
+    'layers=4,addr=1,shift=1,blend=1',
+]
+
+# nextpnr resource names -> report column names.
+_RESOURCES = [
+    ('TRELLIS_COMB', 'LUT4'),
+    ('TRELLIS_FF', 'FF'),
+    ('DP16KD', 'BRAM'),
+    ('MULT18X18D', 'MULT18'),
+]
+
+
+def parse_config(config):
+    generics = {}
+    for item in config.split(','):
+        key, sep, value = item.partition('=')
+        if not sep or key not in _GENERICS or not value.isdigit():
+            raise ValueError(f'Invalid configuration item: "{item}"')
+        generics[_GENERICS[key]] = int(value)
+    return generics
+
+
+def config_name(config):
+    return config.replace(',', '_').replace('=', '')
+
+
+def run(cmd, log_file):
+    try:
+        with open(log_file, 'w', encoding='utf8') as f:
+            result = subprocess.run(cmd, stdout=f, stderr=subprocess.STDOUT)
+    except FileNotFoundError:
+        sys.exit(f'Error: {cmd[0]} not found (see the Fmax benchmark section in src/README.md)')
+    if result.returncode != 0:
+        sys.exit(f'Error: {cmd[0]} failed (see {log_file})')
+
+
+def synthesize(config, out_dir):
+    name = config_name(config)
+    json_file = os.path.join(out_dir, f'{name}.json')
+    generics = ' '.join(f'-g{k}={v}' for k, v in parse_config(config).items())
+    script = (f'ghdl --std=08 {generics} {" ".join(_SOURCES)} -e fmax_top; ' +
+              f'synth_ecp5 -top fmax_top -json {json_file}')
+    run(['yosys', '-m', 'ghdl', '-p', script], os.path.join(out_dir, f'{name}.yosys.log'))
+    return json_file
+
+
+def place_and_route(config, json_file, args, out_dir):
+    name = config_name(config)
+    report_file = os.path.join(out_dir, f'{name}.report.json')
+    cmd = ['nextpnr-ecp5',
+           f'--{args.device}',
+           '--package', args.package,
+           '--speed', str(args.speed),
+           '--freq', str(args.freq),
+           '--seed', str(args.seed),
+           '--json', json_file,
+           '--report', report_file,
+           '--timing-allow-fail']
+    run(cmd, os.path.join(out_dir, f'{name}.nextpnr.log'))
+    with open(report_file, 'r', encoding='utf8') as f:
+        return json.load(f)
+
+
+def summarize(config, report):
+    # There is only one clock domain, so pick the slowest clock in the report.
+    fmax = min(clk['achieved'] for clk in report['fmax'].values())
+    result = {'config': config, 'fmax': f'{fmax:.1f}'}
+    utilization = report['utilization']
+    for resource, column in _RESOURCES:
+        result[column] = utilization.get(resource, {}).get('used', 0)
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(
+            description='Report the Fmax and resource usage of video logic configurations')
+    parser.add_argument('configs', metavar='CONFIG', nargs='*',
+                        help='configuration, e.g. "layers=2,addr=1,shift=1,blend=1" (keys: ' +
+                        ', '.join(_GENERICS.keys()) + ')')
+    parser.add_argument('--device', default='85k', help='ECP5 device (default: 85k)')
+    parser.add_argument('--package', default='CABGA381', help='package (default: CABGA381)')
+    parser.add_argument('--speed', type=int, default=6, choices=[6, 7, 8],
+                        help='speed grade (default: 6, the slowest)')
+    parser.add_argument('--freq', type=float, default=148.5,
+                        help='target frequency in MHz (default: 148.5, i.e. 1920x1080)')
+    parser.add_argument('--seed', type=int, default=1, help='nextpnr placement seed (default: 1)')
+    parser.add_argument('--out', default='out', help='output directory (default: out)')
+    parser.add_argument('--csv', metavar='CSV_FILE', help='also write the results to a CSV file')
+    args = parser.parse_args()
+
+    configs = args.configs if args.configs else _DEFAULT_CONFIGS
+    for config in configs:
+        try:
+            parse_config(config)
+        except ValueError as e:
+            parser.error(str(e))
+    os.makedirs(args.out, exist_ok=True)
+
+    # Run the flow for all the configurations.
+    columns = ['config', 'fmax'] + [column for _, column in _RESOURCES]
+    results = []
+    print(f'{"Config":<36}{"Fmax":>8}' + ''.join(f'{column:>8}' for _, column in _RESOURCES))
+    for config in configs:
+        json_file = synthesize(config, args.out)
+        report = place_and_route(config, json_file, args, args.out)
+        result = summarize(config, report)
+        results.append(result)
+        print(f'{config:<36}{result["fmax"]:>8}' +
+              ''.join(f'{result[column]:>8}' for _, column in _RESOURCES))
+
+    if args.csv:
+        with open(args.csv, 'w', newline='', encoding='utf8') as f:
+            writer = csv.DictWriter(f, fieldnames=columns)
+            writer.writeheader()
+            writer.writerows(results)
+
+    # Fail if any configuration does not reach the target frequency.
+    if any(float(r['fmax']) < args.freq for r in results):
+        print(f'\nNote: Some configurations do not reach {args.freq} MHz')
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,112 @@
+----------------------------------------------------------------------------------------------------
+-- Copyright (c) 2022 Marcus Geelnard
+--
+-- This software is provided 'as-is', without any express or implied warranty. In no event will the
+-- authors be held liable for any damages arising from the use of this software.
+--
+-- Permission is granted to anyone to use this software for any purpose, including commercial
+-- applications, and to alter it and redistribute it freely, subject to the following restrictions:
+--
+--  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+--     the original software. If you use this software in a product, an acknowledgment in the
+--     product documentation would be appreciated but is not required.
+--
+--  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+--     being the original software.
+--
+--  3. This notice may not be removed or altered from any source distribution.
+----------------------------------------------------------------------------------------------------
+
+----------------------------------------------------------------------------------------------------
+-- Top level entity for the Fmax benchmark (see fmax.py).
+--
+-- This is the video logic (at 1920x1080) together with a block RAM that acts as the VRAM video
+-- port, so that the VRAM to pixel pipeline paths are part of the timing analysis. The VRAM write
+-- port is exposed as top level I/O, so that the VRAM contents are not optimized away.
+----------------------------------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.vid_types.all;
+
+entity fmax_top is
+  generic(
+    ADR_BITS : positive := 14;
+    NUM_LAYERS : positive := 2;
+    LOG2_READ_WORDS : natural := 0;
+    PIXEL_ADDR_STAGES : natural := 0;
+    PIXEL_SHIFT_STAGES : natural := 0;
+    BLEND_MUL_STAGES : natural := 0;
+    TILE_MODE : natural := 0  -- 1 = tile mode in the top layer
+  );
+  port(
+    i_rst : in std_logic;
+    i_clk : in std_logic;
+
+    -- VRAM write interface.
+    i_write_en : in std_logic;
+    i_write_adr : in std_logic_vector(ADR_BITS-1 downto 0);
+    i_write_dat : in std_logic_vector(31 downto 0);
+
+    -- Video output.
+    o_r : out std_logic_vector(7 downto 0);
+    o_g : out std_logic_vector(7 downto 0);
+    o_b : out std_logic_vector(7 downto 0);
+    o_hsync : out std_logic;
+    o_vsync : out std_logic
+  );
+end fmax_top;
+
+architecture rtl of fmax_top is
+  constant C_NUM_WORDS : positive := 2**LOG2_READ_WORDS;
+  constant C_NUM_ROWS : positive := 2**(ADR_BITS-LOG2_READ_WORDS);
+
+  type T_MEM is array (0 to C_NUM_ROWS-1) of std_logic_vector(32*C_NUM_WORDS-1 downto 0);
+  signal s_mem : T_MEM;
+
+  signal s_read_adr : std_logic_vector(ADR_BITS-LOG2_READ_WORDS-1 downto 0);
+  signal s_read_dat : std_logic_vector(32*C_NUM_WORDS-1 downto 0);
+begin
+  -- VRAM (one read port for the video logic, and one write port).
+  process(i_clk)
+    variable v_row : integer range 0 to C_NUM_ROWS-1;
+    variable v_word : integer range 0 to C_NUM_WORDS-1;
+  begin
+    if rising_edge(i_clk) then
+      if i_write_en = '1' then
+        v_row := to_integer(unsigned(i_write_adr(ADR_BITS-1 downto LOG2_READ_WORDS)));
+        v_word := to_integer(unsigned(i_write_adr)) mod C_NUM_WORDS;
+        s_mem(v_row)(32*v_word+31 downto 32*v_word) <= i_write_dat;
+      end if;
+      s_read_dat <= s_mem(to_integer(unsigned(s_read_adr)));
+    end if;
+  end process;
+
+  video_1: entity work.video
+    generic map (
+      COLOR_BITS_R => 8,
+      COLOR_BITS_G => 8,
+      COLOR_BITS_B => 8,
+      ADR_BITS => ADR_BITS,
+      NUM_LAYERS => NUM_LAYERS,
+      LOG2_READ_WORDS => LOG2_READ_WORDS,
+      PIXEL_ADDR_STAGES => PIXEL_ADDR_STAGES,
+      PIXEL_SHIFT_STAGES => PIXEL_SHIFT_STAGES,
+      BLEND_MUL_STAGES => BLEND_MUL_STAGES,
+      ENABLE_TILE_MODE => TILE_MODE /= 0,
+      VIDEO_CONFIG => C_1920_1080
+    )
+    port map (
+      i_rst => i_rst,
+      i_clk => i_clk,
+      o_read_adr => s_read_adr,
+      i_read_dat => s_read_dat,
+      o_r => o_r,
+      o_g => o_g,
+      o_b => o_b,
+      o_hsync => o_hsync,
+      o_vsync => o_vsync,
+      o_raster_y => open
+    );
+end rtl;
@@ -0,0 +1,241 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2022 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "vid_model.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+void print_usage(const char* prg_name) {
+  std::printf("Usage: %s [options] vram-image\n", prg_name);
+  std::printf("\nRender video frames from a VRAM image using a model of the MC1 video logic.\n");
+  std::printf("\nOptions:\n");
+  std::printf("  --mode WxH           Video mode (1920x1080, 1280x720, 800x600 or 640x480)\n");
+  std::printf("  --layers N           Number of video layers (1 to 4, default: 2)\n");
+  std::printf("  --adr-bits N         Number of VRAM word address bits (default: 16)\n");
+  std::printf("  --read-words-log2 N  Width of the VRAM video port, log2 words (default: 0)\n");
+  std::printf("  --pal-banks-log2 N   Number of palette banks per layer, log2 (default: 0)\n");
+  std::printf("  --tile-mode          Enable tile mode in the top layer\n");
+  std::printf("  --color-bits N       Output bits per color component (1 to 8, default: 8)\n");
+  std::printf("  --base ADDR          VRAM word address of the image (default: 0)\n");
+  std::printf("  --frames N           Number of frames to run (default: 1)\n");
+  std::printf("  --ppm FILE           Write the last frame to a PPM file (a %%d in FILE writes\n");
+  std::printf("                       every frame, with %%d replaced by the frame number)\n");
+  std::printf("  --stats FILE         Write per-scanline VRAM port statistics to a CSV file\n");
+  std::printf("  --lines FILE         Write the VRAM port reads of every frame and scanline to\n");
+  std::printf("                       a CSV file (same format as test/video_tb.vhd)\n");
+  std::printf("  --check              Fail if any line FIFO underruns occurred\n");
+}
+
+bool parse_int(const char* str, int& result) {
+  char* end;
+  const long value = std::strtol(str, &end, 0);
+  if (*str == 0 || *end != 0) {
+    return false;
+  }
+  result = static_cast<int>(value);
+  return true;
+}
+
+// Replace %d in a file name pattern with the frame number.
+std::string frame_file_name(const std::string& pattern, const int frame) {
+  auto result = pattern;
+  const auto pos = result.find("%d");
+  if (pos != std::string::npos) {
+    result.replace(pos, 2, std::to_string(frame));
+  }
+  return result;
+}
+
+// Write the VRAM port reads of each scanline of the last frame (the same columns as the
+// video_tb_lines.csv file that is written by test/video_tb.vhd).
+void write_lines(FILE* file,
+                 const int frame,
+                 const vidmodel::video_model_t& model,
+                 const int layers) {
+  for (const auto& s : model.line_stats()) {
+    uint32_t vcpp_fetches = 0U;
+    for (int k = 0; k < layers; ++k) {
+      vcpp_fetches += s.vcp_reads[k];
+    }
+    std::fprintf(file, "%d,%d,%u", frame, s.y, s.total_reads());
+    for (int k = 0; k < layers; ++k) {
+      std::fprintf(file, ",%u", s.pix_reads[k] + s.vcp_reads[k]);
+    }
+    std::fprintf(file, ",%u,%u,%u\n", vcpp_fetches, s.fifo_hits, s.underruns);
+  }
+}
+
+}  // namespace
+
+int main(const int argc, const char** argv) {
+  vidmodel::hw_config_t config;
+  vidmodel::video_config_t::from_name("1920x1080", config.video);
+  int base = 0;
+  int num_frames = 1;
+  bool check = false;
+  std::string image_file;
+  std::string ppm_file;
+  std::string stats_file;
+  std::string lines_file;
+
+  // Parse the command line arguments.
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const bool has_value = (i + 1) < argc;
+    bool ok = true;
+    if (std::strcmp(arg, "--mode") == 0 && has_value) {
+      ok = vidmodel::video_config_t::from_name(argv[++i], config.video);
+    } else if (std::strcmp(arg, "--layers") == 0 && has_value) {
+      ok = parse_int(argv[++i], config.num_layers) && config.num_layers >= 1 &&
+           config.num_layers <= vidmodel::MAX_LAYERS;
+    } else if (std::strcmp(arg, "--adr-bits") == 0 && has_value) {
+      ok = parse_int(argv[++i], config.adr_bits) && config.adr_bits >= 8 &&
+           config.adr_bits <= 24;
+    } else if (std::strcmp(arg, "--read-words-log2") == 0 && has_value) {
+      ok = parse_int(argv[++i], config.log2_read_words) && config.log2_read_words >= 0 &&
+           config.log2_read_words <= 3;
+    } else if (std::strcmp(arg, "--pal-banks-log2") == 0 && has_value) {
+      ok = parse_int(argv[++i], config.log2_palette_banks) && config.log2_palette_banks >= 0 &&
+           config.log2_palette_banks <= 8;
+    } else if (std::strcmp(arg, "--tile-mode") == 0) {
+      config.enable_tile_mode = true;
+    } else if (std::strcmp(arg, "--color-bits") == 0 && has_value) {
+      ok = parse_int(argv[++i], config.color_bits) && config.color_bits >= 1 &&
+           config.color_bits <= 8;
+    } else if (std::strcmp(arg, "--base") == 0 && has_value) {
+      ok = parse_int(argv[++i], base) && base >= 0;
+    } else if (std::strcmp(arg, "--frames") == 0 && has_value) {
+      ok = parse_int(argv[++i], num_frames) && num_frames >= 1;
+    } else if (std::strcmp(arg, "--ppm") == 0 && has_value) {
+      ppm_file = argv[++i];
+    } else if (std::strcmp(arg, "--stats") == 0 && has_value) {
+      stats_file = argv[++i];
+    } else if (std::strcmp(arg, "--lines") == 0 && has_value) {
+      lines_file = argv[++i];
+    } else if (std::strcmp(arg, "--check") == 0) {
+      check = true;
+    } else if (arg[0] != '-' && image_file.empty()) {
+      image_file = arg;
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+  if (image_file.empty()) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  // Load the VRAM image.
+  vidmodel::video_model_t model(config);
+  if (!model.load_vram(image_file, static_cast<uint32_t>(base))) {
+    std::fprintf(stderr, "Unable to read %s\n", image_file.c_str());
+    return 1;
+  }
+
+  FILE* lines = nullptr;
+  if (!lines_file.empty()) {
+    lines = std::fopen(lines_file.c_str(), "w");
+    if (lines == nullptr) {
+      std::fprintf(stderr, "Unable to write %s\n", lines_file.c_str());
+      return 1;
+    }
+    std::fprintf(lines, "frame,line,port_reads");
+    for (int k = 1; k <= config.num_layers; ++k) {
+      std::fprintf(lines, ",layer%d_reads", k);
+    }
+    std::fprintf(lines, ",vcpp_fetches,fifo_hits,underruns\n");
+  }
+
+  // Run the requested number of frames.
+  const bool ppm_per_frame = ppm_file.find("%d") != std::string::npos;
+  double total_ms = 0.0;
+  for (int i = 0; i < num_frames; ++i) {
+    const auto t0 = std::chrono::steady_clock::now();
+    model.run_frame();
+    const auto t1 = std::chrono::steady_clock::now();
+    total_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+    // Write the results of this frame.
+    if (lines != nullptr) {
+      write_lines(lines, i, model, config.num_layers);
+    }
+    const bool is_last_frame = i == num_frames - 1;
+    if (!ppm_file.empty() && (ppm_per_frame || is_last_frame)) {
+      const auto file_name = frame_file_name(ppm_file, i);
+      if (!model.write_ppm(file_name)) {
+        std::fprintf(stderr, "Unable to write %s\n", file_name.c_str());
+        return 1;
+      }
+    }
+  }
+  const double ms_per_frame = total_ms / static_cast<double>(num_frames);
+
+  // Write the results.
+  if (lines != nullptr && std::fclose(lines) != 0) {
+    std::fprintf(stderr, "Unable to write %s\n", lines_file.c_str());
+    return 1;
+  }
+  if (!stats_file.empty() && !model.write_stats(stats_file)) {
+    std::fprintf(stderr, "Unable to write %s\n", stats_file.c_str());
+    return 1;
+  }
+
+  // Summarize the VRAM port usage of the last frame.
+  uint32_t max_reads = 0U;
+  int max_reads_y = 0;
+  uint32_t total_reads = 0U;
+  uint32_t total_cycles = 0U;
+  uint32_t underruns = 0U;
+  int underrun_lines = 0;
+  for (const auto& s : model.line_stats()) {
+    if (s.total_reads() > max_reads) {
+      max_reads = s.total_reads();
+      max_reads_y = s.y;
+    }
+    total_reads += s.total_reads();
+    total_cycles += s.cycles;
+    underruns += s.underruns;
+    if (s.underruns > 0U) {
+      ++underrun_lines;
+    }
+  }
+  const uint32_t line_cycles = static_cast<uint32_t>(config.video.total_width());
+  std::printf("Frame time:     %.2f ms (model), %u cycles (hardware)\n", ms_per_frame, total_cycles);
+  std::printf("Port usage:     %.1f%% of the frame\n",
+              100.0 * static_cast<double>(total_reads) / static_cast<double>(total_cycles));
+  std::printf("Busiest line:   y=%d, %u of %u cycles (%.1f%%)\n",
+              max_reads_y,
+              max_reads,
+              line_cycles,
+              100.0 * static_cast<double>(max_reads) / static_cast<double>(line_cycles));
+  std::printf("Underruns:      %u (on %d lines)\n", underruns, underrun_lines);
+
+  return (check && underruns > 0U) ? 2 : 0;
+}
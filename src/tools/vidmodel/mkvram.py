@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+# -*- mode: python; tab-width: 4; indent-tabs-mode: nil; -*-
+# --------------------------------------------------------------------------------------------------
+# Copyright (c) 2022 Marcus Geelnard
+#
+# This software is provided 'as-is', without any express or implied warranty. In no event will the
+# authors be held liable for any damages arising from the use of this software.
+#
+# Permission is granted to anyone to use this software for any purpose, including commercial
+# applications, and to alter it and redistribute it freely, subject to the following restrictions:
+#
+#  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+#     the original software. If you use this software in a product, an acknowledgment in the
+#     product documentation would be appreciated but is not required.
+#
+#  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+#     being the original software.
+#
+#  3. This notice may not be removed or altered from any source distribution.
+# --------------------------------------------------------------------------------------------------
+
+# Build the video_tb VRAM image (the same image that ../../run.py bakes for video_tb), by assembling
+# the video_tb VCP program with vcpas from the MC1 SDK.
+
+import argparse
+import os
+import sys
+
+_THIS_DIR = os.path.dirname(os.path.abspath(__file__))
+_SRC_DIR = os.path.join(_THIS_DIR, '..', '..')
+
+sys.path.insert(1, os.path.join(_SRC_DIR, 'mc1-sdk', 'tools'))
+import vcpas
+
+_VIDEO_TB_VCP_SOURCE = os.path.join('test', 'test-image-640x360-pal8.vcp')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Build the video_tb VRAM image')
+    parser.add_argument('output', help='the VRAM image file (raw 32-bit little endian words)')
+    args = parser.parse_args()
+
+    # Assemble from the same directory as run.py does, so that the include paths are the same.
+    output = os.path.abspath(args.output)
+    os.chdir(_SRC_DIR)
+    vcpas.assemble(_VIDEO_TB_VCP_SOURCE, output, 'bin')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,775 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2022 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "vid_model.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+namespace vidmodel {
+
+namespace {
+
+// Video control registers.
+enum {
+  VCR_ADDR = 0,
+  VCR_XOFFS = 1,
+  VCR_XINCR = 2,
+  VCR_HSTRT = 3,
+  VCR_HSTOP = 4,
+  VCR_CMODE = 5,
+  VCR_RMODE = 6,
+  VCR_STRIDE = 7,
+  VCR_REPEAT = 8,
+  VCR_PALBANK = 9,
+  VCR_GLYPHS = 10,
+  NUM_VCRS = 11
+};
+
+// Color modes.
+enum {
+  CMODE_RGBA32 = 0,
+  CMODE_RGBA16 = 1,
+  CMODE_PAL8 = 2,
+  CMODE_PAL4 = 3,
+  CMODE_PAL2 = 4,
+  CMODE_PAL1 = 5,
+  CMODE_TILE = 6
+};
+
+// VCPP instructions.
+enum {
+  INSTR_JMP = 0x0,
+  INSTR_JSR = 0x1,
+  INSTR_RTS = 0x2,
+  INSTR_NOP = 0x3,
+  INSTR_WAITX = 0x4,
+  INSTR_WAITY = 0x5,
+  INSTR_SETPAL = 0x6,
+  INSTR_SETREG = 0x8,
+  INSTR_SETLC = 0x9,
+  INSTR_LOOP = 0xa,
+  INSTR_WAITYR = 0xb
+};
+
+// Default VCR values (set at the start of each frame, see rtl/vid_regs.vhd).
+const uint32_t DEFAULT_VCRS[NUM_VCRS] = {
+    0x000000,  // ADDR
+    0x000000,  // XOFFS
+    0x004000,  // XINCR
+    0x000000,  // HSTRT
+    0x000000,  // HSTOP
+    0x000002,  // CMODE
+    0x000135,  // RMODE
+    0x000000,  // STRIDE
+    0x000000,  // REPEAT
+    0x000000,  // PALBANK
+    0x000000   // GLYPHS
+};
+
+// One scanline in 12.12 fixed point.
+const uint32_t ONE_LINE = 0x001000U;
+
+// Number of entries in the VCPP call stack (see rtl/vid_vcpp_stack.vhd).
+const int STACK_SIZE = 16;
+
+// Number of cycles that are lost when the VCPP takes a jump (the IF1 and IF2 stages are
+// cancelled, but the reads that they issued have already used the VRAM port).
+const int JUMP_PENALTY = 2;
+
+// The line FIFO:s are flushed and start to fetch the next line at this x coordinate, and they hold
+// this many memory rows (see C_VID_LINE_FIFO_* in rtl/vid_types.vhd).
+const int LINE_FIFO_FILL_X = -96;
+const int LINE_FIFO_DEPTH = 4;
+
+const uint32_t MASK24 = 0x00ffffffU;
+
+int32_t sext24(const uint32_t x) {
+  return static_cast<int32_t>(x << 8) >> 8;
+}
+
+uint32_t abgr16_to_abgr32(const uint32_t x) {
+  const uint32_t a = (x & 0x8000U) ? 0xffU : 0x00U;
+  const uint32_t b5 = (x >> 10) & 31U;
+  const uint32_t g5 = (x >> 5) & 31U;
+  const uint32_t r5 = x & 31U;
+  const uint32_t b = (b5 << 3) | (b5 >> 2);
+  const uint32_t g = (g5 << 3) | (g5 >> 2);
+  const uint32_t r = (r5 << 3) | (r5 >> 2);
+  return (a << 24) | (b << 16) | (g << 8) | r;
+}
+
+// Select a blend factor in the range [1, 256] (see rtl/vid_blend.vhd).
+uint32_t blend_factor(const uint32_t sel, const uint32_t alpha1, const uint32_t alpha2) {
+  switch (sel) {
+    case 2:
+      return alpha1 + 1U;
+    case 3:
+      return alpha2 + 1U;
+    case 4:
+      return 256U - alpha1;
+    case 5:
+      return 256U - alpha2;
+    default:
+      // Note: "-1" (sel = 1) is treated as 1, just as in the RTL.
+      return 256U;
+  }
+}
+
+uint32_t blend(const uint32_t method, const uint32_t color1, const uint32_t color2) {
+  const uint32_t alpha1 = color1 >> 24;
+  const uint32_t alpha2 = color2 >> 24;
+  const uint32_t f1 = blend_factor(method & 7U, alpha1, alpha2);
+  const uint32_t f2 = blend_factor((method >> 4) & 7U, alpha1, alpha2);
+  uint32_t result = 0xff000000U;
+  for (int shift = 0; shift < 24; shift += 8) {
+    const uint32_t c1 = (color1 >> shift) & 0xffU;
+    const uint32_t c2 = (color2 >> shift) & 0xffU;
+    uint32_t c = (c1 * f1 + c2 * f2) >> 8;
+    if (c > 255U) {
+      c = 255U;
+    }
+    result |= c << shift;
+  }
+  return result;
+}
+
+// Truncate the color components to the given number of bits, and replicate the remaining bits to
+// fill each 8-bit component.
+uint32_t truncate_color(const uint32_t color, const int bits) {
+  if (bits >= 8) {
+    return color;
+  }
+  uint32_t result = color & 0xff000000U;
+  for (int shift = 0; shift < 24; shift += 8) {
+    const uint32_t c = ((color >> shift) & 0xffU) >> (8 - bits);
+    uint32_t replicated = 0U;
+    int n = 0;
+    for (; n < 8; n += bits) {
+      replicated = (replicated << bits) | c;
+    }
+    result |= ((replicated >> (n - 8)) & 0xffU) << shift;
+  }
+  return result;
+}
+
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Video configurations.
+//--------------------------------------------------------------------------------------------------
+
+bool video_config_t::from_name(const std::string& name, video_config_t& config) {
+  if (name == "1920x1080") {
+    config = {1920, 1080, 88, 44, 148, 4, 5, 36};
+  } else if (name == "1280x720") {
+    config = {1280, 720, 110, 40, 220, 5, 5, 20};
+  } else if (name == "800x600") {
+    config = {800, 600, 40, 128, 88, 1, 4, 23};
+  } else if (name == "640x480") {
+    config = {640, 480, 16, 96, 48, 10, 2, 33};
+  } else {
+    return false;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// A single video layer (VCPP + VCR:s + palette + pixel pipeline, see rtl/video_layer.vhd).
+//--------------------------------------------------------------------------------------------------
+
+class video_model_t::layer_t {
+public:
+  layer_t(const video_model_t& model, const uint32_t vcp_start_addr, const bool enable_tile_mode)
+      : m_model(model),
+        m_vcp_start_addr(vcp_start_addr),
+        m_enable_tile_mode(enable_tile_mode),
+        m_palette(256U << model.m_config.log2_palette_banks, 0U) {
+  }
+
+  void restart_frame(const int y) {
+    for (int i = 0; i < NUM_VCRS; ++i) {
+      m_vcrs[i] = DEFAULT_VCRS[i];
+    }
+    m_line_acc = 0U;
+    m_prev_y = y;
+
+    m_pc = m_vcp_start_addr;
+    m_state = NEW_INSTR;
+    m_loop_cnt = 0U;
+    m_bubble = 0;
+  }
+
+  uint32_t rmode() const {
+    return m_vcrs[VCR_RMODE];
+  }
+
+  // VCR:s - automatic row stepping.
+  void regs_cycle(const int y) {
+    const bool new_line = (y != m_prev_y);
+    m_prev_y = y;
+    const uint32_t line_acc_plus_1 = m_line_acc + (new_line ? ONE_LINE : 0U);
+    const uint32_t repeat = m_vcrs[VCR_REPEAT];
+    if (repeat != 0U && m_line_acc >= repeat) {
+      m_vcrs[VCR_ADDR] = (m_vcrs[VCR_ADDR] + m_vcrs[VCR_STRIDE]) & MASK24;
+      m_line_acc = (line_acc_plus_1 - repeat) & MASK24;
+    } else {
+      m_line_acc = line_acc_plus_1 & MASK24;
+    }
+  }
+
+  // Pixel pipeline: Produce the color for the raster position, and determine which VRAM rows need
+  // to be read by the pixel pipeline during this cycle.
+  uint32_t pixel_cycle(const int x, const int y) {
+    const int log2_read_words = m_model.m_config.log2_read_words;
+    const uint32_t cmode = m_vcrs[VCR_CMODE] & 15U;
+    const bool is_tile = this->is_tile();
+
+    // XCOORD
+    const bool in_blanking_area = (x < 0) || (y < 0);
+    const bool active = x >= sext24(m_vcrs[VCR_HSTRT]) && x < sext24(m_vcrs[VCR_HSTOP]);
+    const bool is_hstrt = x == sext24(m_vcrs[VCR_HSTRT]);
+    if (is_hstrt) {
+      m_pos = static_cast<uint32_t>(sext24(m_vcrs[VCR_XOFFS]));
+    } else if (active) {
+      m_pos += static_cast<uint32_t>(sext24(m_vcrs[VCR_XINCR]));
+    }
+
+    // The line FIFO starts to fetch the next line from this memory row.
+    m_row_start_imminent = (x == LINE_FIFO_FILL_X);
+    {
+      const int shift = static_cast<int>(m_vcrs[VCR_CMODE] & 7U);
+      const int32_t offset = static_cast<int8_t>(m_vcrs[VCR_XOFFS] >> 16) >> shift;
+      m_row_start = to_row(m_vcrs[VCR_ADDR] + static_cast<uint32_t>(offset));
+    }
+
+    // PIXADDR
+    const int log2_ppw = log2_pixels_per_word(cmode);
+    const uint32_t offs = static_cast<uint32_t>(static_cast<int32_t>(m_pos) >> (16 + log2_ppw));
+    const uint32_t addr = (m_vcrs[VCR_ADDR] + offs) & MASK24;
+    const uint32_t diff = (addr ^ m_prev_addr) & 0x1ffU;
+    bool new_word = false;
+    m_pix_read_en = false;
+    m_pix_read_en_tile = false;
+    if (is_tile) {
+      m_pix_read_en_tile = active && is_hstrt;
+      new_word = active && (diff != 0U || is_hstrt);
+    } else {
+      m_pix_read_en = active && ((diff >> log2_read_words) != 0U || is_hstrt);
+    }
+    if (m_pix_read_en || m_pix_read_en_tile || new_word) {
+      m_prev_addr = addr;
+    }
+    m_pix_read_row = to_row(addr);
+
+    // Tile mode memory requests: Glyph reads have priority over tile map prefetches.
+    m_glyph_read_en = false;
+    uint32_t glyph_word = 0U;
+    uint32_t glyph_row = 0U;
+    if (is_tile && active) {
+      const uint32_t map_word = m_model.read_vram(addr);
+      const uint32_t tile = (map_word >> (((m_pos >> 19) & 3U) * 8U)) & 0xffU;
+      glyph_row = (m_line_acc >> 12) >> ((m_vcrs[VCR_CMODE] >> 4) & 3U);
+      const uint32_t glyph_addr = (m_vcrs[VCR_GLYPHS] + tile * 4U + ((glyph_row >> 2) & 3U)) &
+                                  MASK24;
+      m_glyph_read_en = is_hstrt || glyph_addr != m_glyph_addr;
+      m_glyph_addr = glyph_addr;
+      glyph_word = m_model.read_vram(glyph_addr);
+    }
+    if (new_word) {
+      m_map_prefetch_pending = true;
+    }
+    m_map_prefetch_en = m_map_prefetch_pending && !m_pix_read_en_tile && !m_glyph_read_en;
+    if (m_map_prefetch_en) {
+      m_map_prefetch_pending = false;
+    }
+
+    // SHIFT, PALADDR & PALFETCH
+    if (in_blanking_area) {
+      return 0U;
+    }
+    uint32_t pal_idx = 0U;
+    if (active) {
+      const uint32_t word = m_model.read_vram(addr);
+      const uint32_t pix = (m_pos >> 16) & 31U;
+      switch (cmode) {
+        case CMODE_RGBA32:
+          return word;
+        case CMODE_RGBA16:
+          return abgr16_to_abgr32((pix & 1U) ? (word >> 16) : word);
+        case CMODE_PAL4:
+          pal_idx = (word >> ((pix & 7U) * 4U)) & 15U;
+          break;
+        case CMODE_PAL2:
+          pal_idx = (word >> ((pix & 15U) * 2U)) & 3U;
+          break;
+        case CMODE_PAL1:
+          pal_idx = (word >> pix) & 1U;
+          break;
+        case CMODE_TILE:
+          if (is_tile) {
+            pal_idx = (glyph_word >> ((glyph_row & 3U) * 8U + (pix & 7U))) & 1U;
+          } else {
+            // Undefined color mode without tile mode support (as in the RTL).
+            pal_idx = (word >> pix) & 255U;
+          }
+          break;
+        default:
+          pal_idx = (word >> ((pix & 3U) * 8U)) & 255U;
+          break;
+      }
+    }
+    return m_palette[palette_index(m_vcrs[VCR_PALBANK], pal_idx)];
+  }
+
+  // Does the layer request a VRAM read that must be served during this cycle (tile mode reads
+  // bypass the line FIFO)?
+  bool urgent_read_request() const {
+    return m_pix_read_en_tile || m_glyph_read_en || m_map_prefetch_en;
+  }
+
+  // Does the layer (line FIFO or VCPP) request a VRAM read during this cycle?
+  bool read_request() const {
+    return urgent_read_request() || fifo_read_request() || vcpp_read_request();
+  }
+
+  // Tell the layer whether or not it got access to the VRAM port during this cycle, and serve the
+  // pixel pipeline from the line FIFO. Within a layer, tile mode reads have priority over the line
+  // FIFO, which has priority over the VCPP.
+  void port_cycle(const int x, const int y, const bool granted, line_stats_t& stats, const int k) {
+    const bool urgent = urgent_read_request();
+    const bool fifo_req = !urgent && fifo_read_request();
+    if (urgent) {
+      if (granted) {
+        ++stats.pix_reads[k];
+      } else {
+        ++stats.underruns;
+      }
+    }
+    const bool fifo_granted = fifo_req && granted;
+    if (fifo_granted) {
+      ++stats.pix_reads[k];
+    }
+    fifo_cycle(fifo_granted, stats.fifo_hits, stats.underruns);
+    vcpp_cycle(x, y, granted && !urgent && !fifo_req, stats.vcp_reads[k], stats.vcp_stalls[k]);
+  }
+
+private:
+  enum state_t { NEW_INSTR, PALETTE, WAITX, WAITY };
+
+  bool is_tile() const {
+    return m_enable_tile_mode && (m_vcrs[VCR_CMODE] & 15U) == CMODE_TILE;
+  }
+
+  bool is_decremental() const {
+    return (m_vcrs[VCR_XINCR] & 0x800000U) != 0U;
+  }
+
+  uint32_t next_row(const uint32_t row) const {
+    return (is_decremental() ? row - 1U : row + 1U) & MASK24;
+  }
+
+  // Line FIFO: Request a new row as long as there is room for it (see rtl/vid_line_fifo.vhd).
+  bool fifo_read_request() const {
+    const bool fetch_en = !is_tile() && sext24(m_vcrs[VCR_HSTRT]) < sext24(m_vcrs[VCR_HSTOP]);
+    return fetch_en && (m_fifo_count + (m_fifo_inflight ? 1 : 0)) < LINE_FIFO_DEPTH;
+  }
+
+  // Line FIFO: Execute one clock cycle, and count the pixel reads that hit or miss the FIFO.
+  void fifo_cycle(const bool granted, uint32_t& hits, uint32_t& underruns) {
+    bool flush = false;
+    uint32_t restart_row = 0U;
+
+    // The row that was granted during the last cycle is stored in the FIFO during this cycle.
+    int count = m_fifo_count + (m_fifo_inflight ? 1 : 0);
+    if (granted) {
+      m_fifo_fetch_row = next_row(m_fifo_fetch_row);
+    }
+    m_fifo_inflight = granted;
+
+    if (m_pix_read_en) {
+      // Serve the pixel pipeline, and drop the rows before the requested row.
+      m_fifo_primed = true;
+      const uint32_t dist = (is_decremental() ? m_fifo_head_row - m_pix_read_row
+                                              : m_pix_read_row - m_fifo_head_row) &
+                            MASK24;
+      const uint32_t avail = static_cast<uint32_t>(count + (granted ? 1 : 0));
+      if (dist < avail) {
+        count -= static_cast<int>(dist);
+        m_fifo_head_row = m_pix_read_row;
+        ++hits;
+      } else {
+        ++underruns;
+        flush = true;
+        restart_row = next_row(m_pix_read_row);
+      }
+    } else if (m_row_start_imminent || (!m_fifo_primed && m_row_start != m_fifo_start_row)) {
+      // Start fetching a new line.
+      m_fifo_start_row = m_row_start;
+      m_fifo_primed = false;
+      flush = true;
+      restart_row = m_row_start;
+    }
+
+    if (flush) {
+      count = 0;
+      m_fifo_inflight = false;
+      m_fifo_head_row = restart_row;
+      m_fifo_fetch_row = restart_row;
+    }
+    m_fifo_count = count;
+  }
+
+  // Does the VCPP want to read from VRAM during this cycle?
+  bool vcpp_read_request() const {
+    return m_state == NEW_INSTR || m_state == PALETTE;
+  }
+
+  // VCPP: Execute one clock cycle.
+  void vcpp_cycle(const int x,
+                  const int y,
+                  const bool granted,
+                  uint32_t& reads,
+                  uint32_t& stalls) {
+    if (m_state == WAITX) {
+      if (static_cast<int16_t>(x) == m_wait_arg) {
+        m_state = NEW_INSTR;
+      }
+      return;
+    }
+    if (m_state == WAITY) {
+      if (static_cast<int16_t>(y) == m_wait_arg) {
+        m_state = NEW_INSTR;
+      }
+      return;
+    }
+
+    // The VCPP stalls until it gets access to the VRAM port.
+    if (!granted) {
+      ++stalls;
+      return;
+    }
+    ++reads;
+    if (m_bubble > 0) {
+      --m_bubble;
+      return;
+    }
+    const uint32_t instr = m_model.read_vram(m_pc);
+    m_pc = (m_pc + 1U) & MASK24;
+
+    if (m_state == PALETTE) {
+      const uint32_t pal_idx = (m_pal_base + m_pal_cnt) & 255U;
+      m_palette[palette_index(m_vcrs[VCR_PALBANK] >> 8, pal_idx)] = instr;
+      ++m_pal_cnt;
+      if (m_pal_cnt == m_pal_count) {
+        m_state = NEW_INSTR;
+      }
+      return;
+    }
+
+    switch (instr >> 28) {
+      case INSTR_JMP:
+        jump(instr & MASK24);
+        break;
+      case INSTR_JSR:
+        m_stack_pos = (m_stack_pos + STACK_SIZE - 1) % STACK_SIZE;
+        m_stack[m_stack_pos] = m_pc;
+        jump(instr & MASK24);
+        break;
+      case INSTR_RTS:
+        jump(m_stack[m_stack_pos]);
+        m_stack_pos = (m_stack_pos + 1) % STACK_SIZE;
+        break;
+      case INSTR_WAITX:
+        m_wait_arg = static_cast<int16_t>(instr & 0xffffU);
+        m_state = WAITX;
+        break;
+      case INSTR_WAITY:
+        m_wait_arg = static_cast<int16_t>(instr & 0xffffU);
+        m_state = WAITY;
+        break;
+      case INSTR_WAITYR:
+        m_wait_arg = static_cast<int16_t>(static_cast<uint32_t>(y) + (instr & 0xffffU));
+        m_state = WAITY;
+        break;
+      case INSTR_SETPAL:
+        m_pal_base = (instr >> 8) & 255U;
+        m_pal_count = (instr & 255U) + 1U;
+        m_pal_cnt = 0U;
+        m_state = PALETTE;
+        break;
+      case INSTR_SETREG:
+        write_vcr((instr >> 24) & 15U, instr & MASK24);
+        break;
+      case INSTR_SETLC:
+        m_loop_cnt = instr & MASK24;
+        break;
+      case INSTR_LOOP: {
+        const bool taken = m_loop_cnt > 1U;
+        if (m_loop_cnt != 0U) {
+          --m_loop_cnt;
+        }
+        if (taken) {
+          jump(instr & MASK24);
+        }
+        break;
+      }
+      default:
+        // NOP and undefined instructions.
+        break;
+    }
+  }
+
+  static int log2_pixels_per_word(const uint32_t cmode) {
+    switch (cmode) {
+      case CMODE_RGBA32:
+        return 0;
+      case CMODE_RGBA16:
+        return 1;
+      case CMODE_PAL4:
+        return 3;
+      case CMODE_PAL2:
+        return 4;
+      case CMODE_PAL1:
+      case CMODE_TILE:
+        return 5;
+      default:
+        return 2;
+    }
+  }
+
+  uint32_t to_row(const uint32_t addr) const {
+    return (addr & MASK24) >> m_model.m_config.log2_read_words;
+  }
+
+  size_t palette_index(const uint32_t bank, const uint32_t idx) const {
+    const uint32_t num_banks = 1U << m_model.m_config.log2_palette_banks;
+    return static_cast<size_t>(((bank & 255U) % num_banks) * 256U + idx);
+  }
+
+  void write_vcr(const uint32_t reg, const uint32_t value) {
+    if (reg >= NUM_VCRS) {
+      return;
+    }
+    m_vcrs[reg] = value;
+    if (reg == VCR_ADDR || reg == VCR_REPEAT) {
+      m_line_acc = 0U;
+    }
+  }
+
+  void jump(const uint32_t target) {
+    m_pc = target;
+    m_bubble = JUMP_PENALTY;
+  }
+
+  const video_model_t& m_model;
+  const uint32_t m_vcp_start_addr;
+  const bool m_enable_tile_mode;
+
+  // VCR:s.
+  uint32_t m_vcrs[NUM_VCRS] = {};
+  uint32_t m_line_acc = 0U;
+  int m_prev_y = 0;
+
+  // Palette (all banks).
+  std::vector<uint32_t> m_palette;
+
+  // VCPP state.
+  uint32_t m_pc = 0U;
+  state_t m_state = NEW_INSTR;
+  int16_t m_wait_arg = 0;
+  uint32_t m_pal_base = 0U;
+  uint32_t m_pal_count = 0U;
+  uint32_t m_pal_cnt = 0U;
+  uint32_t m_loop_cnt = 0U;
+  uint32_t m_stack[STACK_SIZE] = {};
+  int m_stack_pos = 0;
+  int m_bubble = 0;
+
+  // Pixel pipeline state.
+  uint32_t m_pos = 0U;
+  uint32_t m_prev_addr = 0x123456U;
+  bool m_pix_read_en = false;
+  bool m_pix_read_en_tile = false;
+  uint32_t m_pix_read_row = 0U;
+  uint32_t m_glyph_addr = 0U;
+  bool m_glyph_read_en = false;
+  bool m_map_prefetch_pending = false;
+  bool m_map_prefetch_en = false;
+
+  // Line FIFO state.
+  bool m_row_start_imminent = false;
+  uint32_t m_row_start = 0U;
+  uint32_t m_fifo_start_row = 0U;
+  bool m_fifo_primed = false;
+  int m_fifo_count = 0;
+  bool m_fifo_inflight = false;
+  uint32_t m_fifo_head_row = 0U;
+  uint32_t m_fifo_fetch_row = 0U;
+};
+
+//--------------------------------------------------------------------------------------------------
+// The video model.
+//--------------------------------------------------------------------------------------------------
+
+video_model_t::video_model_t(const hw_config_t& config)
+    : m_config(config), m_vram(size_t(1) << config.adr_bits, 0U) {
+  // The VCP of layer k starts at word k * 4, and only the top layer may support tile mode.
+  for (int k = 1; k <= config.num_layers; ++k) {
+    const auto vcp_start_addr = static_cast<uint32_t>(k * 4);
+    const bool enable_tile_mode = config.enable_tile_mode && k == config.num_layers;
+    m_layers.emplace_back(new layer_t(*this, vcp_start_addr, enable_tile_mode));
+  }
+}
+
+video_model_t::~video_model_t() {
+}
+
+bool video_model_t::load_vram(const std::string& file_name, uint32_t word_addr) {
+  std::ifstream file(file_name, std::ios::binary);
+  if (!file.good()) {
+    return false;
+  }
+  uint8_t buf[4];
+  while (file.read(reinterpret_cast<char*>(buf), 4)) {
+    const uint32_t word = static_cast<uint32_t>(buf[0]) | (static_cast<uint32_t>(buf[1]) << 8) |
+                          (static_cast<uint32_t>(buf[2]) << 16) |
+                          (static_cast<uint32_t>(buf[3]) << 24);
+    write_vram(word_addr++, word);
+  }
+  return true;
+}
+
+void video_model_t::write_vram(uint32_t word_addr, uint32_t data) {
+  m_vram[word_addr & (m_vram.size() - 1U)] = data;
+}
+
+uint32_t video_model_t::read_vram(uint32_t word_addr) const {
+  return m_vram[word_addr & (m_vram.size() - 1U)];
+}
+
+void video_model_t::run_frame() {
+  const auto& vc = m_config.video;
+  const int x_start = -(vc.front_porch_h + vc.sync_width_h + vc.back_porch_h);
+  const int y_start = -(vc.front_porch_v + vc.sync_width_v + vc.back_porch_v);
+  const auto num_layers = m_layers.size();
+
+  m_pixels.assign(static_cast<size_t>(vc.width) * static_cast<size_t>(vc.height), 0U);
+  m_line_stats.clear();
+
+  int slot = 0;
+  for (int y = y_start; y < vc.height; ++y) {
+    line_stats_t stats = {};
+    stats.y = y;
+    stats.cycles = static_cast<uint32_t>(vc.total_width());
+
+    for (int x = x_start; x < vc.width; ++x) {
+      // The frame restarts during the first cycle of the vertical blanking interval.
+      if (x == x_start && y == y_start) {
+        for (auto& layer : m_layers) {
+          layer->restart_frame(y);
+        }
+      }
+
+      // Update the VCR:s and run the pixel pipelines.
+      uint32_t colors[MAX_LAYERS] = {};
+      for (size_t k = 0; k < num_layers; ++k) {
+        m_layers[k]->regs_cycle(y);
+        colors[k] = m_layers[k]->pixel_cycle(x, y);
+      }
+
+      // VRAM port arbitration: Tile mode reads are served first. Otherwise the port cycle belongs
+      // to the layer that owns the current time slot, or (if the owner does not need it) to the
+      // next requesting layer after the owner.
+      bool grants[MAX_LAYERS] = {};
+      bool port_busy = false;
+      for (size_t k = 0; k < num_layers && !port_busy; ++k) {
+        if (m_layers[k]->urgent_read_request()) {
+          grants[k] = true;
+          port_busy = true;
+        }
+      }
+      for (size_t i = 0; i < num_layers && !port_busy; ++i) {
+        const size_t k = (static_cast<size_t>(slot) + i) % num_layers;
+        if (m_layers[k]->read_request()) {
+          grants[k] = true;
+          port_busy = true;
+        }
+      }
+      for (size_t k = 0; k < num_layers; ++k) {
+        m_layers[k]->port_cycle(x, y, grants[k], stats, static_cast<int>(k));
+      }
+      slot = (slot + 1) % static_cast<int>(num_layers);
+
+      // Blend the layers from the bottom and up (the blend method for each layer is given by the
+      // RMODE VCR of the layer).
+      if (x >= 0 && y >= 0) {
+        uint32_t color = colors[0] | 0xff000000U;
+        for (size_t k = 1; k < num_layers; ++k) {
+          color = blend(m_layers[k]->rmode() & 255U, color, colors[k]);
+        }
+        m_pixels[static_cast<size_t>(y) * static_cast<size_t>(vc.width) +
+                 static_cast<size_t>(x)] = truncate_color(color, m_config.color_bits);
+      }
+    }
+
+    m_line_stats.push_back(stats);
+  }
+}
+
+bool video_model_t::write_ppm(const std::string& file_name) const {
+  std::ofstream file(file_name, std::ios::binary);
+  if (!file.good()) {
+    return false;
+  }
+  file << "P6\n" << m_config.video.width << " " << m_config.video.height << "\n255\n";
+  std::vector<char> rgb;
+  rgb.reserve(m_pixels.size() * 3U);
+  for (const auto color : m_pixels) {
+    rgb.push_back(static_cast<char>(color & 0xffU));
+    rgb.push_back(static_cast<char>((color >> 8) & 0xffU));
+    rgb.push_back(static_cast<char>((color >> 16) & 0xffU));
+  }
+  file.write(rgb.data(), static_cast<std::streamsize>(rgb.size()));
+  return file.good();
+}
+
+bool video_model_t::write_stats(const std::string& file_name) const {
+  FILE* file = std::fopen(file_name.c_str(), "w");
+  if (file == nullptr) {
+    return false;
+  }
+  const int num_layers = static_cast<int>(m_layers.size());
+  std::fprintf(file, "y,cycles");
+  for (int k = 1; k <= num_layers; ++k) {
+    std::fprintf(file, ",l%d_pix,l%d_vcp,l%d_vcp_stall", k, k, k);
+  }
+  std::fprintf(file, ",total,fifo_hits,underruns\n");
+  for (const auto& s : m_line_stats) {
+    std::fprintf(file, "%d,%u", s.y, s.cycles);
+    for (int k = 0; k < num_layers; ++k) {
+      std::fprintf(file, ",%u,%u,%u", s.pix_reads[k], s.vcp_reads[k], s.vcp_stalls[k]);
+    }
+    std::fprintf(file, ",%u,%u,%u\n", s.total_reads(), s.fifo_hits, s.underruns);
+  }
+  return std::fclose(file) == 0;
+}
+
+}  // namespace vidmodel
@@ -0,0 +1,166 @@
+// -*- mode: c++; tab-width: 2; indent-tabs-mode: nil; -*-
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2022 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef VIDMODEL_VID_MODEL_HPP_
+#define VIDMODEL_VID_MODEL_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+// This is a host reference model of the MC1 video pipeline (see rtl/video.vhd).
+//
+// The model is stepped one pixel clock cycle at a time, and it follows the RTL closely when it
+// comes to what is drawn (VCPP program flow, VCR:s incl. automatic row stepping, all color modes
+// incl. tile mode, palette banks and layer blending) and when the VRAM video port is used. It is
+// NOT cycle exact w.r.t. pipeline latencies (VCR writes take effect immediately, and the pixel
+// pipeline has no delay), so the relative timing of a SETREG and the pixels that it affects may
+// differ by a few clock cycles compared to the RTL.
+//
+// VRAM port accounting follows the RTL arbitration rules: Tile mode reads are served first, and the
+// remaining cycles are time slotted between the layers (a cycle that is not needed by the layer
+// that owns it is given to the next requesting layer). Within a layer the line FIFO has priority
+// over the VCPP. A pixel read that is not in the line FIFO (or a tile mode read that does not get
+// the port) is counted as an underrun (this produces corrupt pixels in the hardware).
+//
+// The output can be truncated to fewer bits per color component (just like the RTL does when the
+// dithering method in the layer 1 RMODE VCR is zero). Dithering noise is not modeled.
+//--------------------------------------------------------------------------------------------------
+
+namespace vidmodel {
+
+/// @brief Maximum number of video layers (same as C_VID_MAX_LAYERS in rtl/vid_types.vhd).
+constexpr int MAX_LAYERS = 4;
+
+/// @brief Video timing configuration (same as T_VIDEO_CONFIG in rtl/vid_types.vhd).
+struct video_config_t {
+  int width;
+  int height;
+  int front_porch_h;
+  int sync_width_h;
+  int back_porch_h;
+  int front_porch_v;
+  int sync_width_v;
+  int back_porch_v;
+
+  /// @brief Get a predefined video configuration by name (e.g. "1920x1080").
+  /// @param name The name of the configuration.
+  /// @param[out] config The video configuration.
+  /// @returns true if the configuration was found.
+  static bool from_name(const std::string& name, video_config_t& config);
+
+  int total_width() const {
+    return width + front_porch_h + sync_width_h + back_porch_h;
+  }
+
+  int total_height() const {
+    return height + front_porch_v + sync_width_v + back_porch_v;
+  }
+};
+
+/// @brief Hardware configuration (same as the generics of rtl/video.vhd).
+struct hw_config_t {
+  video_config_t video;
+  int adr_bits = 16;           // Number of VRAM word address bits.
+  int num_layers = 2;          // Number of video layers (1 to MAX_LAYERS).
+  int log2_palette_banks = 0;  // Number of palette banks per layer (log2).
+  int log2_read_words = 0;     // Width of the VRAM video read port (log2 of words).
+  bool enable_tile_mode = false;  // Tile mode (CMODE 6) in the top layer.
+  int color_bits = 8;          // Number of output bits per color component (1 to 8).
+};
+
+/// @brief VRAM video port usage for a single scanline.
+struct line_stats_t {
+  int y;                    // Raster y coordinate.
+  uint32_t cycles;          // Number of clock cycles (i.e. available video port cycles).
+  uint32_t pix_reads[MAX_LAYERS];   // Pixel reads (line FIFO fetches and tile mode reads).
+  uint32_t vcp_reads[MAX_LAYERS];   // VCPP instruction fetches, per layer.
+  uint32_t vcp_stalls[MAX_LAYERS];  // Cycles that the VCPP had to wait for the port, per layer.
+  uint32_t fifo_hits;               // Pixel reads that were served by the line FIFOs.
+  uint32_t underruns;               // Pixel reads that could not be served in time.
+
+  uint32_t total_reads() const {
+    uint32_t result = 0U;
+    for (int k = 0; k < MAX_LAYERS; ++k) {
+      result += pix_reads[k] + vcp_reads[k];
+    }
+    return result;
+  }
+};
+
+class video_model_t {
+public:
+  explicit video_model_t(const hw_config_t& config);
+  ~video_model_t();
+
+  /// @brief Load a raw (little endian) binary image into VRAM.
+  /// @param file_name Name of the file to load.
+  /// @param word_addr VRAM word address of the first word of the image.
+  /// @returns true on success.
+  bool load_vram(const std::string& file_name, uint32_t word_addr);
+
+  /// @brief Write a word to VRAM.
+  void write_vram(uint32_t word_addr, uint32_t data);
+
+  /// @brief Run one full video frame.
+  ///
+  /// The frame starts with the restart of the VCP:s (just like the RTL does at the start of the
+  /// vertical blanking interval). The palette is not reset between frames.
+  void run_frame();
+
+  /// @brief Get the visible area of the last frame.
+  ///
+  /// When color_bits < 8, the bits of each truncated color component are replicated to fill the
+  /// 8-bit component (the same way that test/video_tb.vhd writes its PPM files).
+  /// @returns width * height ABGR32 pixels (alpha is always 255).
+  const std::vector<uint32_t>& pixels() const {
+    return m_pixels;
+  }
+
+  /// @brief Get the VRAM video port statistics for all the scanlines of the last frame.
+  const std::vector<line_stats_t>& line_stats() const {
+    return m_line_stats;
+  }
+
+  /// @brief Write the visible area of the last frame to a binary PPM file.
+  /// @returns true on success.
+  bool write_ppm(const std::string& file_name) const;
+
+  /// @brief Write the scanline statistics of the last frame to a CSV file.
+  /// @returns true on success.
+  bool write_stats(const std::string& file_name) const;
+
+private:
+  class layer_t;
+
+  uint32_t read_vram(uint32_t word_addr) const;
+
+  const hw_config_t m_config;
+  std::vector<uint32_t> m_vram;
+  std::vector<std::unique_ptr<layer_t>> m_layers;
+  std::vector<uint32_t> m_pixels;
+  std::vector<line_stats_t> m_line_stats;
+};
+
+}  // namespace vidmodel
+
+#endif  // VIDMODEL_VID_MODEL_HPP_